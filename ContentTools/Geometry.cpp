@@ -1,5 +1,12 @@
 #include "Geometry.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "VertexElements.h"
 #include "Utilities\IOStream.h"
+#include "Utilities\MeshCodec.h"
+#include "Utilities\ThreadPool.h"
+#include <cfloat>
 
 namespace triengine::tools {
 	namespace {
@@ -127,22 +134,7 @@ namespace triengine::tools {
 
 		u64 get_vertex_element_size(elements::elements_type::type elements_type)
 		{
-			using namespace elements;
-
-			switch (elements_type)
-			{
-			case elements_type::static_normal: return sizeof(static_normal);
-			case elements_type::static_normal_texture: return sizeof(static_normal_texture);
-			case elements_type::static_color: return sizeof(static_color);
-			case elements_type::skeletal: return sizeof(skeletal);
-			case elements_type::skeletal_color:	 return sizeof(skeletal_color);
-			case elements_type::skeletal_normal: return sizeof(skeletal_normal);
-			case elements_type::skeletal_normal_color: return sizeof(skeletal_normal_color);
-			case elements_type::skeletal_normal_texture: return sizeof(skeletal_normal_texture);
-			case elements_type::skeletal_normal_texture_color: return sizeof(skeletal_normal_texture_color);
-			}
-
-			return 0;
+			return elements::get_element_trait(elements_type).size;
 		}
 
 		void pack_vertices(mesh& m)
@@ -158,155 +150,13 @@ namespace triengine::tools {
 				position_buffer[i] = m.vertices[i].position;
 			}
 
-			struct u16v2 { u16 x, y; };
-			struct u8v3 { u8 x, y, z; };
-
-			utl::vector<u8> t_signs(num_vertices);
-			utl::vector<u16v2> normals(num_vertices);
-			utl::vector<u16v2> tangents(num_vertices);
-			utl::vector<u8v3> joint_weights(num_vertices);
-
-			if (m.elements_type & elements::elements_type::static_normal)
-			{
-				// normals only
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					t_signs[i] = (u8)((v.normal.z > 0.f) << 1);
-					normals[i] = { (u16)pack_float<16>(v.normal.x, -1.f, 1.f), (u16)pack_float<16>(v.normal.y, -1.f, 1.f) };
-				}
-
-				if (m.elements_type & elements::elements_type::static_normal_texture)
-				{
-					// full T-space
-					for (u32 i{ 0 }; i < num_vertices; ++i)
-					{
-						vertex& v{ m.vertices[i] };
-						t_signs[i] |= (u8)((v.tangent.w > 0.f) && (v.tangent.z > 0.f));
-						tangents[i] = { (u16)pack_float<16>(v.tangent.x, -1.f, 1.f), (u16)pack_float<16>(v.tangent.y, -1.f, 1.f) };
-					}
-				}
-			}
-
-			if (m.elements_type & elements::elements_type::skeletal)
-			{
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					joint_weights[i] = { (u8)pack_unit_float<8>(v.joint_weights.x), (u8)pack_unit_float<8>(v.joint_weights.y), (u8)pack_unit_float<8>(v.joint_weights.z) };
-				}
-			}
-
-			m.element_buffer.resize(get_vertex_element_size(m.elements_type) * num_vertices);
-			using namespace elements;
-
-			switch (m.elements_type)
-			{
-			case elements_type::static_color:
-			{
-				static_color* const element_buffer{ (static_color* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					element_buffer[i] = { { v.red, v.green, v.blue }, {} };
-				}
-			}
-			break;
-			case elements_type::static_normal:
-			{
-				static_normal* const element_buffer{ (static_normal* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					element_buffer[i] = { { v.red, v.green, v.blue }, t_signs[i], {normals[i].x, normals[i].y} };
-				}
-			}
-			break;
-			case elements_type::static_normal_texture:
-			{
-				static_normal_texture* const element_buffer{ (static_normal_texture* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					element_buffer[i] = { { v.red, v.green, v.blue }, t_signs[i], {normals[i].x, normals[i].y}, {tangents[i].x, tangents[i].y}, v.uv };
-				}
-			}
-			break;
-			case elements_type::skeletal:
-			{
-				skeletal* const element_buffer{ (skeletal* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					const u16 indices[4]{ (u16)v.joint_indices.x, (u16)v.joint_indices.y, (u16)v.joint_indices.z, (u16)v.joint_indices.w };
-					element_buffer[i] = { {joint_weights[i].x, joint_weights[i].y, joint_weights[i].z}, {}, {indices[0], indices[1], indices[2], indices[3]} };
-				}
-			}
-			break;
-			case elements_type::skeletal_color:
-			{
-				skeletal_color* const element_buffer{ (skeletal_color* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					const u16 indices[4]{ (u16)v.joint_indices.x, (u16)v.joint_indices.y, (u16)v.joint_indices.z, (u16)v.joint_indices.w };
-					element_buffer[i] = { {joint_weights[i].x, joint_weights[i].y, joint_weights[i].z}, {}, {indices[0], indices[1], indices[2], indices[3]},
-						{v.red, v.green, v.blue}, {} };
-				}
-			}
-			break;
-			case elements_type::skeletal_normal:
-			{
-				skeletal_normal* const element_buffer{ (skeletal_normal* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					const u16 indices[4]{ (u16)v.joint_indices.x, (u16)v.joint_indices.y, (u16)v.joint_indices.z, (u16)v.joint_indices.w };
-					element_buffer[i] = { {joint_weights[i].x, joint_weights[i].y, joint_weights[i].z}, t_signs[i], {indices[0], indices[1], indices[2], indices[3]},
-						{normals[i].x, normals[i].y} };
-				}
-			}
-			break;
-			case elements_type::skeletal_normal_color:
-			{
-				skeletal_normal_color* const element_buffer{ (skeletal_normal_color* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					const u16 indices[4]{ (u16)v.joint_indices.x, (u16)v.joint_indices.y, (u16)v.joint_indices.z, (u16)v.joint_indices.w };
-					element_buffer[i] = { {joint_weights[i].x, joint_weights[i].y, joint_weights[i].z}, t_signs[i], {indices[0], indices[1], indices[2], indices[3]},
-						{normals[i].x, normals[i].y}, {v.red, v.green, v.blue}, {} };
-				}
-			}
-			break;
-			case elements_type::skeletal_normal_texture:
-			{
-				skeletal_normal_texture* const element_buffer{ (skeletal_normal_texture* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					const u16 indices[4]{ (u16)v.joint_indices.x, (u16)v.joint_indices.y, (u16)v.joint_indices.z, (u16)v.joint_indices.w };
-					element_buffer[i] = { {joint_weights[i].x, joint_weights[i].y, joint_weights[i].z}, t_signs[i], {indices[0], indices[1], indices[2], indices[3]},
-						{normals[i].x, normals[i].y}, {tangents[i].x, tangents[i].y}, v.uv };
-				}
-			}
-			break;
-			case elements_type::skeletal_normal_texture_color:
-			{
-				skeletal_normal_texture_color* const element_buffer{ (skeletal_normal_texture_color* const)m.element_buffer.data() };
-				for (u32 i{ 0 }; i < num_vertices; ++i)
-				{
-					vertex& v{ m.vertices[i] };
-					const u16 indices[4]{ (u16)v.joint_indices.x, (u16)v.joint_indices.y, (u16)v.joint_indices.z, (u16)v.joint_indices.w };
-					element_buffer[i] = { {joint_weights[i].x, joint_weights[i].y, joint_weights[i].z}, t_signs[i], {indices[0], indices[1], indices[2], indices[3]},
-						{normals[i].x, normals[i].y}, {tangents[i].x, tangents[i].y}, v.uv, {v.red, v.green, v.blue}, {} };
-				}
-			}
-			break;
-			}
+			// NOTE: each elements type has its own packer that encodes all fields of a vertex in one pass.
+			const elements::element_trait& trait{ elements::get_element_trait(m.elements_type) };
+			m.element_buffer.resize(trait.size * num_vertices);
+			if (trait.pack) trait.pack(m.vertices.data(), num_vertices, m.element_buffer.data());
 		}
 
-		void determine_elements_type(mesh& m)
+		void determine_elements_type(mesh& m, const geometry_import_settings& settings)
 		{
 			using namespace elements;
 			if (m.normals.size())
@@ -326,6 +176,13 @@ namespace triengine::tools {
 			}
 
 			// TODO: we lack data for skeletal meshes. Expand this when we have it.
+
+			// NOTE: only the static normal types have octahedral variants.
+			if (m.elements_type == elements_type::static_normal || m.elements_type == elements_type::static_normal_texture)
+			{
+				const u32 encoding{ ((u32)settings.normal_encoding << 4) & normal_encoding::mask };
+				m.elements_type = (elements_type::type)(m.elements_type | encoding);
+			}
 		}
 
 		void process_vertices(mesh& m, const geometry_import_settings& settings) {
@@ -343,8 +200,99 @@ namespace triengine::tools {
 				process_uvs(m);
 			}
 
-			determine_elements_type(m);
+			determine_elements_type(m, settings);
+		}
+
+		// NOTE: stream sizes include padding to 4 bytes. If the mesh has quantized positions,
+		//       the position stream encodes those instead of the f32 positions.
+		// struct {
+		//     u32 position_stream_size, u32 element_stream_size, u32 index_stream_size,
+		//     u8 position_stream[position_stream_size],
+		//     u8 element_stream[element_stream_size],
+		//     u8 index_stream[index_stream_size]
+		// } compressed_streams_section;
+		void compress_streams(mesh& m)
+		{
+			const u32 num_vertices{ (u32)m.vertices.size() };
+			const u32 elements_size{ (u32)get_vertex_element_size(m.elements_type) };
+			utl::vector<u8> streams[3];
+
+			const utl::vector<u8>& quantized_positions{ m.sections[mesh_section::quantized_positions] };
+			if (quantized_positions.empty())
+			{
+				utl::encode_vertex_stream(m.position_buffer.data(), num_vertices, sizeof(math::v3), utl::vertex_stream_filter::words32, streams[0]);
+			}
+			else
+			{
+				const u8* const positions{ quantized_positions.data() + sizeof(position_quantization) };
+				utl::encode_vertex_stream(positions, num_vertices, sizeof(u16) * 3, utl::vertex_stream_filter::bytes, streams[0]);
+			}
+			// NOTE: position-only meshes have no elements, so their element stream is empty.
+			if (elements_size)
+			{
+				utl::encode_vertex_stream(m.element_buffer.data(), num_vertices, elements_size, utl::vertex_stream_filter::bytes, streams[1]);
+			}
+			utl::encode_index_stream(m.indices.data(), (u32)m.indices.size(), streams[2]);
+
+			u64 size{ sizeof(u32) * _countof(streams) };
+			for (auto& stream : streams)
+			{
+				stream.resize(math::align_size_up<sizeof(u32)>(stream.size()));
+				size += stream.size();
+			}
+
+			utl::vector<u8>& buffer{ m.sections[mesh_section::compressed_streams] };
+			buffer.resize(size);
+			utl::blob_stream_writer blob{ buffer.data(), buffer.size() };
+			for (auto& stream : streams) blob.write((u32)stream.size());
+			for (auto& stream : streams) blob.write(stream.data(), stream.size());
+			assert(blob.offset() == size);
+
+#if _DEBUG
+			const u64 index_size{ (num_vertices < (1 << 16)) ? sizeof(u16) : sizeof(u32) };
+			const u64 position_size{ quantized_positions.empty() ? m.position_buffer.size() : sizeof(u16) * 3 * num_vertices };
+			const u64 raw_size{ position_size + m.element_buffer.size() + index_size * m.indices.size() };
+			char msg[256];
+			sprintf_s(msg, "::Mesh '%s' streams: %llu -> %llu bytes (%.1f%%)\n",
+				m.name.c_str(), raw_size, size, 100.f * (f32)size / (f32)raw_size);
+			OutputDebugStringA(msg);
+#endif
+		}
+
+		void optimize_and_pack_vertices(mesh& m, const geometry_import_settings& settings)
+		{
+			const mesh_optimization_stats stats{ optimize_mesh(m) };
+#if _DEBUG
+			char msg[256];
+			sprintf_s(msg, "::Mesh '%s' vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+				m.name.c_str(), stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr);
+			OutputDebugStringA(msg);
+#endif
+
 			pack_vertices(m);
+
+			if (settings.generate_meshlets)
+			{
+				meshlet_data meshlets{};
+				build_meshlets(m.indices.data(), (u32)m.indices.size(), (const math::v3*)m.position_buffer.data(), (u32)m.vertices.size(), meshlets);
+				pack_meshlets(meshlets, m.sections[mesh_section::meshlets]);
+			}
+
+			if (settings.quantize_positions)
+			{
+				[[maybe_unused]] const quantization_error error{
+					pack_quantized_positions((const math::v3*)m.position_buffer.data(), (u32)m.vertices.size(), m.sections[mesh_section::quantized_positions]) };
+#if _DEBUG
+				sprintf_s(msg, "::Mesh '%s' quantized positions: max error %f (%.5f%% of extent), average error %f\n",
+					m.name.c_str(), error.max_error, error.relative_max_error * 100.f, error.average_error);
+				OutputDebugStringA(msg);
+#endif
+			}
+
+			if (settings.compress_streams)
+			{
+				compress_streams(m);
+			}
 		}
 
 		u64 get_mesh_size(const mesh& m)
@@ -357,7 +305,7 @@ namespace triengine::tools {
 			const u64 index_size{ (num_vertices < (1 << 16)) ? sizeof(u16) : sizeof(u32) };
 			const u64 index_buffer_size{ index_size * m.indices.size() };
 			constexpr u64 su32{ sizeof(u32) };
-			const u64 size{
+			u64 size{
 				su32 + m.name.size() + // mesh name length and room for mesh name string
 				su32 + // lod id
 				su32 + // vertex element size (vertex size excluding position)
@@ -368,9 +316,15 @@ namespace triengine::tools {
 				sizeof(f32) + // lod threshold
 				position_buffer_size + // room for vertex position
 				element_buffer_size + // room for vertex elements
-				index_buffer_size // index buffer
+				index_buffer_size + // index buffer
+				su32 // number of sections
 			};
 
+			for (const auto& section : m.sections)
+			{
+				if (!section.empty()) size += su32 + su32 + section.size(); // section type, size and data
+			}
+
 			return size;
 		}
 
@@ -456,84 +410,155 @@ namespace triengine::tools {
 			}
 
 			blob.write(data, index_buffer_size);
+
+			// optional sections
+			u32 section_count{ 0 };
+			for (const auto& section : m.sections) section_count += section.empty() ? 0 : 1;
+			blob.write(section_count);
+
+			for (u32 i{ 0 }; i < mesh_section::count; ++i)
+			{
+				const utl::vector<u8>& section{ m.sections[i] };
+				if (section.empty()) continue;
+
+				blob.write(i);
+				blob.write((u32)section.size());
+				blob.write(section.data(), section.size());
+			}
 		}
 
-		bool split_meshes_by_material(u32 material_idx, mesh& m, mesh& submesh)
+		// Splits a mesh into one submesh per material in a single pass: triangles are bucketed by material with
+		// a counting sort (keeping their relative order), then each bucket is turned into a submesh.
+		void split_meshes_by_material(mesh& m, utl::vector<mesh>& submeshes)
 		{
-			submesh.name = m.name;
-			submesh.lod_threshold = m.lod_threshold;
-			submesh.lod_id = m.lod_id;
-			submesh.material_used.emplace_back(material_idx);
-			submesh.uv_sets.resize(m.uv_sets.size());
-
+			const u32 num_materials{ (u32)m.material_used.size() };
 			const u32 num_polys{ (u32)m.raw_indices.size() / 3 };
-			utl::vector<u32> vertex_ref(m.positions.size(), u32_invalid_id);
+			assert(m.material_indices.size() == num_polys);
+
+			u32 max_material_idx{ 0 };
+			for (u32 mtl_idx : m.material_used)
+				max_material_idx = std::max(max_material_idx, mtl_idx);
 
+			utl::vector<u32> material_slot(max_material_idx + 1, u32_invalid_id);
+			for (u32 i{ 0 }; i < num_materials; ++i)
+				material_slot[m.material_used[i]] = i;
+
+			utl::vector<u32> bucket_offsets(num_materials + 1, 0);
 			for (u32 i{ 0 }; i < num_polys; ++i)
+				++bucket_offsets[material_slot[m.material_indices[i]] + 1];
+
+			for (u32 i{ 0 }; i < num_materials; ++i)
+				bucket_offsets[i + 1] += bucket_offsets[i];
+
+			utl::vector<u32> sorted_polys(num_polys);
 			{
-				const u32 mtl_idx{ m.material_indices[i] };
-				if (mtl_idx != material_idx) continue;
+				utl::vector<u32> fill(num_materials, 0);
+				for (u32 i{ 0 }; i < num_polys; ++i)
+				{
+					const u32 slot{ material_slot[m.material_indices[i]] };
+					sorted_polys[bucket_offsets[slot] + fill[slot]++] = i;
+				}
+			}
 
-				const u32 index{ i * 3 };
-				for (u32 j = index; j < index + 3; ++j)
+			// NOTE: 'vertex_owner' tells which submesh 'vertex_ref' entries belong to, so we don't have
+			//       to clear or reallocate the lookup table for every material.
+			utl::vector<u32> vertex_ref(m.positions.size(), u32_invalid_id);
+			utl::vector<u32> vertex_owner(m.positions.size(), u32_invalid_id);
+
+			for (u32 slot{ 0 }; slot < num_materials; ++slot)
+			{
+				const u32 first_poly{ bucket_offsets[slot] };
+				const u32 poly_count{ bucket_offsets[slot + 1] - first_poly };
+				if (!poly_count) continue;
+
+				mesh& submesh{ submeshes.emplace_back() };
+				submesh.name = m.name;
+				submesh.lod_threshold = m.lod_threshold;
+				submesh.lod_id = m.lod_id;
+				submesh.material_used.emplace_back(m.material_used[slot]);
+				submesh.uv_sets.resize(m.uv_sets.size());
+
+				const u32 num_indices{ poly_count * 3 };
+				submesh.raw_indices.reserve(num_indices);
+				if (m.normals.size()) submesh.normals.reserve(num_indices);
+				if (m.tangents.size()) submesh.tangents.reserve(num_indices);
+				for (u32 k{ 0 }; k < m.uv_sets.size(); ++k)
+					if (m.uv_sets[k].size()) submesh.uv_sets[k].reserve(num_indices);
+
+				for (u32 p{ first_poly }; p < first_poly + poly_count; ++p)
 				{
-					const u32 v_idx{ m.raw_indices[j] };
-					if (vertex_ref[v_idx] != u32_invalid_id)
-					{
-						submesh.raw_indices.emplace_back(vertex_ref[v_idx]);
-					}
-					else
+					const u32 index{ sorted_polys[p] * 3 };
+					for (u32 j = index; j < index + 3; ++j)
 					{
-						submesh.raw_indices.emplace_back((u32)submesh.positions.size());
-						vertex_ref[v_idx] = (u32)submesh.positions.size();
-						submesh.positions.emplace_back(m.positions[v_idx]);
-					}
+						const u32 v_idx{ m.raw_indices[j] };
+						if (vertex_owner[v_idx] == slot)
+						{
+							submesh.raw_indices.emplace_back(vertex_ref[v_idx]);
+						}
+						else
+						{
+							submesh.raw_indices.emplace_back((u32)submesh.positions.size());
+							vertex_ref[v_idx] = (u32)submesh.positions.size();
+							vertex_owner[v_idx] = slot;
+							submesh.positions.emplace_back(m.positions[v_idx]);
+						}
 
-					if (m.normals.size())
-					{
-						submesh.normals.emplace_back(m.normals[j]);
-					}
+						if (m.normals.size())
+						{
+							submesh.normals.emplace_back(m.normals[j]);
+						}
 
-					if (m.tangents.size())
-					{
-						submesh.tangents.emplace_back(m.tangents[j]);
-					}
+						if (m.tangents.size())
+						{
+							submesh.tangents.emplace_back(m.tangents[j]);
+						}
 
-					for (u32 k{ 0 }; k < m.uv_sets.size(); ++k)
-					{
-						if (m.uv_sets[k].size())
+						for (u32 k{ 0 }; k < m.uv_sets.size(); ++k)
 						{
-							submesh.uv_sets[k].emplace_back(m.uv_sets[k][j]);
+							if (m.uv_sets[k].size())
+							{
+								submesh.uv_sets[k].emplace_back(m.uv_sets[k][j]);
+							}
 						}
 					}
 				}
-			}
 
-			assert((submesh.raw_indices.size() % 3) == 0);
-			return !submesh.raw_indices.empty();
+				assert((submesh.raw_indices.size() % 3) == 0);
+			}
 		}
 
 		void split_meshes_by_material(scene& scene)
 		{
+			// NOTE: meshes are split independently into their own output lists, which are then
+			//       concatenated in the original order so the result matches a serial split.
+			utl::vector<mesh*> meshes;
+			for (auto& lod : scene.lod_groups)
+				for (auto& m : lod.meshes)
+					meshes.emplace_back(&m);
+
+			utl::vector<utl::vector<mesh>> split_meshes(meshes.size());
+			utl::default_thread_pool().parallel_for((u32)meshes.size(), [&](u32 mesh_idx) {
+				mesh& m{ *meshes[mesh_idx] };
+				utl::vector<mesh>& new_meshes{ split_meshes[mesh_idx] };
+				const u32 num_materials{ (u32)m.material_used.size() };
+				if (num_materials > 1)
+				{
+					split_meshes_by_material(m, new_meshes);
+				}
+				else
+				{
+					new_meshes.emplace_back(std::move(m));
+				}
+			});
+
+			u32 mesh_idx{ 0 };
 			for (auto& lod : scene.lod_groups)
 			{
 				utl::vector<mesh> new_meshes;
-
-				for (auto& m : lod.meshes)
+				const u32 num_meshes{ (u32)lod.meshes.size() };
+				for (u32 i{ 0 }; i < num_meshes; ++i, ++mesh_idx)
 				{
-					const u32 num_materials{ (u32)m.material_used.size() };
-					if (num_materials > 1)
-					{
-						for (u32 i{ 0 }; i < num_materials; ++i)
-						{
-							mesh submesh{};
-							if (split_meshes_by_material(m.material_used[i], m, submesh))
-							{
-								new_meshes.emplace_back(std::move(submesh));
-							}
-						}
-					}
-					else
+					for (auto& m : split_meshes[mesh_idx])
 					{
 						new_meshes.emplace_back(std::move(m));
 					}
@@ -541,17 +566,188 @@ namespace triengine::tools {
 
 				new_meshes.swap(lod.meshes);
 			}
+			assert(mesh_idx == meshes.size());
+		}
+
+		// Generates a chain of simplified LODs for LOD groups that don't have any authored LODs.
+		void generate_lods(scene& scene, u32 lod_count)
+		{
+			constexpr f32 lod_triangle_ratio{ 0.5f };	// each LOD has about half the triangles of the previous one
+			constexpr f32 lod_error_budget{ 0.05f };	// max simplification error per LOD, relative to mesh size
+
+			// NOTE: LOD thresholds are view distances. We use the distance at which a LOD's error projects to
+			//       about one pixel on a 1080p screen with a 60 degree vertical field of view.
+			constexpr f32 pixel_error{ 1.f };
+			constexpr f32 screen_height{ 1080.f };
+			const f32 error_to_distance{ screen_height / (2.f * tanf(pi / 6.f) * pixel_error) };
+
+			utl::vector<lod_group*> lod_groups;
+			utl::vector<mesh*> meshes;
+			for (auto& lod : scene.lod_groups)
+			{
+				const bool has_lods{ std::any_of(lod.meshes.begin(), lod.meshes.end(),
+					[](const mesh& m) { return m.lod_id != 0 && m.lod_id != u32_invalid_id; }) };
+				if (has_lods) continue;
+
+				lod_groups.emplace_back(&lod);
+				for (auto& m : lod.meshes)
+					meshes.emplace_back(&m);
+			}
+
+			utl::vector<utl::vector<mesh>> lod_meshes(meshes.size());
+			utl::default_thread_pool().parallel_for((u32)meshes.size(), [&](u32 mesh_idx) {
+				mesh& m{ *meshes[mesh_idx] };
+				m.lod_id = 0;
+
+				const f32 extent{ get_mesh_extent(m.vertices) };
+				utl::vector<u32> indices{ m.indices };
+				f32 error{ 0.f };
+
+				for (u32 i{ 1 }; i <= lod_count; ++i)
+				{
+					const u32 target_index_count{ (u32)(m.indices.size() * powf(lod_triangle_ratio, (f32)i)) / 3 * 3 };
+					// NOTE: each LOD is simplified from the previous one, so the errors add up.
+					error += simplify_mesh(indices, m.vertices, target_index_count, lod_error_budget);
+
+					mesh& lod_mesh{ lod_meshes[mesh_idx].emplace_back() };
+					lod_mesh.name = m.name;
+					lod_mesh.lod_id = i;
+					lod_mesh.lod_threshold = error * extent;
+					lod_mesh.elements_type = m.elements_type;
+					lod_mesh.vertices = m.vertices;
+					lod_mesh.indices = indices;
+				}
+			});
+
+			u32 first_mesh{ 0 };
+			for (lod_group* lod : lod_groups)
+			{
+				const u32 num_meshes{ (u32)lod->meshes.size() };
+
+				// all meshes of a LOD share the same threshold, so use the largest error and keep them increasing.
+				f32 threshold{ 0.f };
+				for (u32 i{ 0 }; i < lod_count; ++i)
+				{
+					f32 max_error{ 0.f };
+					for (u32 j{ first_mesh }; j < first_mesh + num_meshes; ++j)
+						max_error = std::max(max_error, lod_meshes[j][i].lod_threshold);
+
+					threshold = std::max(threshold, max_error * error_to_distance);
+					for (u32 j{ first_mesh }; j < first_mesh + num_meshes; ++j)
+						lod_meshes[j][i].lod_threshold = threshold;
+				}
+
+				for (u32 i{ 0 }; i < lod_count; ++i)
+					for (u32 j{ first_mesh }; j < first_mesh + num_meshes; ++j)
+						lod->meshes.emplace_back(std::move(lod_meshes[j][i]));
+
+				first_mesh += num_meshes;
+			}
+
+			assert(first_mesh == meshes.size());
+		}
+
+		mesh_bounds calculate_bounds(const mesh* const* meshes, u32 mesh_count)
+		{
+			assert(meshes && mesh_count);
+
+			// bounding sphere: AABB center with the radius of the farthest vertex.
+			XMVECTOR min_corner{ XMVectorReplicate(FLT_MAX) };
+			XMVECTOR max_corner{ XMVectorReplicate(-FLT_MAX) };
+			for (u32 i{ 0 }; i < mesh_count; ++i)
+			{
+				for (const vertex& v : meshes[i]->vertices)
+				{
+					const XMVECTOR p{ XMLoadFloat3(&v.position) };
+					min_corner = XMVectorMin(min_corner, p);
+					max_corner = XMVectorMax(max_corner, p);
+				}
+			}
+
+			const XMVECTOR center{ (min_corner + max_corner) * 0.5f };
+			f32 radius_sq{ 0.f };
+			for (u32 i{ 0 }; i < mesh_count; ++i)
+			{
+				for (const vertex& v : meshes[i]->vertices)
+				{
+					const XMVECTOR p{ XMLoadFloat3(&v.position) };
+					radius_sq = std::max(radius_sq, XMVectorGetX(XMVector3LengthSq(p - center)));
+				}
+			}
+
+			mesh_bounds bounds{};
+			XMStoreFloat3(&bounds.min, min_corner);
+			XMStoreFloat3(&bounds.max, max_corner);
+			XMStoreFloat3(&bounds.center, center);
+			bounds.radius = sqrtf(radius_sq);
+			return bounds;
+		}
+
+		// Stores the bounds of every mesh, of its LOD and of the whole LOD group in the mesh's bounds section.
+		void calculate_bounds(lod_group& lod)
+		{
+			const u32 num_meshes{ (u32)lod.meshes.size() };
+			if (!num_meshes) return;
+
+			utl::vector<const mesh*> meshes(num_meshes);
+			for (u32 i{ 0 }; i < num_meshes; ++i) meshes[i] = &lod.meshes[i];
+
+			const mesh_bounds group_bounds{ calculate_bounds(meshes.data(), num_meshes) };
+			utl::vector<const mesh*> lod_meshes;
+
+			for (mesh& m : lod.meshes)
+			{
+				const mesh* const current{ &m };
+				const mesh_bounds submesh_bounds{ calculate_bounds(&current, 1) };
+
+				// NOTE: meshes without a LOD id end up in a LOD of their own.
+				lod_meshes.clear();
+				if (m.lod_id != u32_invalid_id)
+				{
+					for (const mesh* other : meshes)
+						if (other->lod_id == m.lod_id) lod_meshes.emplace_back(other);
+				}
+				else
+				{
+					lod_meshes.emplace_back(current);
+				}
+
+				const mesh_bounds bounds[]{ submesh_bounds, calculate_bounds(lod_meshes.data(), (u32)lod_meshes.size()), group_bounds };
+				utl::vector<u8>& buffer{ m.sections[mesh_section::bounds] };
+				buffer.resize(sizeof(bounds));
+				memcpy(buffer.data(), &bounds[0], sizeof(bounds));
+			}
 		}
 	}
 
 	void process_scene(scene& scene, const geometry_import_settings& settings) {
 		split_meshes_by_material(scene);
 
+		utl::vector<mesh*> meshes;
 		for (auto& lod : scene.lod_groups)
 			for (auto& m : lod.meshes)
-			{
-				process_vertices(m, settings);
-			}
+				meshes.emplace_back(&m);
+
+		utl::default_thread_pool().parallel_for((u32)meshes.size(), [&](u32 i) {
+			process_vertices(*meshes[i], settings);
+		});
+
+		if (settings.generated_lod_count)
+		{
+			generate_lods(scene, settings.generated_lod_count);
+
+			meshes.clear();
+			for (auto& lod : scene.lod_groups)
+				for (auto& m : lod.meshes)
+					meshes.emplace_back(&m);
+		}
+
+		utl::default_thread_pool().parallel_for((u32)meshes.size(), [&](u32 i) {
+			optimize_and_pack_vertices(*meshes[i], settings);
+		});
+
+		for (auto& lod : scene.lod_groups)
+			calculate_bounds(lod);
 	}
 
 	void pack_data(const scene& scene, scene_data& data)
@@ -570,6 +766,11 @@ namespace triengine::tools {
 		// number of LODs
 		blob.write((u32)scene.lod_groups.size());
 
+		// NOTE: headers are written serially and mesh data is only reserved here, so each
+		//       mesh can be packed into its own slice of the blob in parallel afterwards.
+		struct mesh_slice { const mesh* m; u64 offset; u64 size; };
+		utl::vector<mesh_slice> slices;
+
 		for (auto& lod : scene.lod_groups)
 		{
 			// LOD name
@@ -581,10 +782,19 @@ namespace triengine::tools {
 
 			for (auto& m : lod.meshes)
 			{
-				pack_mesh_data(m, blob);
+				const u64 mesh_size{ get_mesh_size(m) };
+				slices.emplace_back(mesh_slice{ &m, blob.offset(), mesh_size });
+				blob.skip(mesh_size);
 			}
 		}
 
 		assert(scene_size == blob.offset());
+
+		utl::default_thread_pool().parallel_for((u32)slices.size(), [&](u32 i) {
+			const mesh_slice& slice{ slices[i] };
+			utl::blob_stream_writer mesh_blob{ data.buffer + slice.offset, slice.size };
+			pack_mesh_data(*slice.m, mesh_blob);
+			assert(mesh_blob.offset() == slice.size);
+		});
 	}
 }
\ No newline at end of file
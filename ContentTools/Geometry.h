@@ -15,6 +15,18 @@ namespace triengine::tools {
 	};
 
 	namespace elements {
+		// How normals and tangents are stored. Combined with the static normal elements types (bits 4-5).
+		struct normal_encoding {
+			enum type : u32 {
+				xy_sign = 0x00,			// 16-bit x and y, sign of z in t_sign
+				octahedral_16 = 0x10,	// 16 + 16 bits octahedral
+				octahedral_8 = 0x20,	// 8 + 8 bits octahedral
+				octahedral_packed = 0x30,	// normal and tangent in 32 bits (see pack_normal_tangent())
+
+				mask = 0x30
+			};
+		};
+
 		struct elements_type {
 			enum type : u32 {
 				position_only = 0x00,
@@ -27,6 +39,13 @@ namespace triengine::tools {
 				skeletal_normal_color = skeletal_normal | static_color,
 				skeletal_normal_texture = skeletal | static_normal_texture,
 				skeletal_normal_texture_color = skeletal_normal_texture | static_color,
+
+				static_normal_oct16 = static_normal | normal_encoding::octahedral_16,
+				static_normal_texture_oct16 = static_normal_texture | normal_encoding::octahedral_16,
+				static_normal_oct8 = static_normal | normal_encoding::octahedral_8,
+				static_normal_texture_oct8 = static_normal_texture | normal_encoding::octahedral_8,
+				static_normal_packed = static_normal | normal_encoding::octahedral_packed,
+				static_normal_texture_packed = static_normal_texture | normal_encoding::octahedral_packed,
 			};
 		};
 
@@ -52,6 +71,54 @@ namespace triengine::tools {
 			math::v2 uv;
 		};
 
+		struct static_normal_oct16
+		{
+			u8 color[3];
+			u8 pad;
+			u16 normal[2];
+		};
+
+		struct static_normal_texture_oct16
+		{
+			u8 color[3];
+			u8 t_sign; // bit 0: tangent handedness (1 means +1)
+			u16 normal[2];
+			u16 tangent[2];
+			math::v2 uv;
+		};
+
+		struct static_normal_oct8
+		{
+			u8 color[3];
+			u8 pad;
+			u8 normal[2];
+			u8 pad2[2];
+		};
+
+		struct static_normal_texture_oct8
+		{
+			u8 color[3];
+			u8 t_sign; // bit 0: tangent handedness (1 means +1)
+			u8 normal[2];
+			u8 tangent[2];
+			math::v2 uv;
+		};
+
+		struct static_normal_packed
+		{
+			u8 color[3];
+			u8 pad;
+			u32 normal;
+		};
+
+		struct static_normal_texture_packed
+		{
+			u8 color[3];
+			u8 pad;
+			u32 normal_tangent;
+			math::v2 uv;
+		};
+
 		struct skeletal
 		{
 			u8 joint_weights[3]; // normalized joint weights for up to 4 joints0.
@@ -109,6 +176,27 @@ namespace triengine::tools {
 		};
 	}
 
+	// Optional data that follows a mesh's index buffer in the packed scene.
+	struct mesh_section {
+		enum type : u32 {
+			meshlets = 0,
+			compressed_streams,
+			quantized_positions,
+			bounds,		// mesh_bounds of the mesh, its LOD and its LOD group
+
+			count
+		};
+	};
+
+	// Axis aligned bounding box and bounding sphere.
+	struct mesh_bounds
+	{
+		math::v3 min;
+		math::v3 max;
+		math::v3 center;
+		f32 radius;
+	};
+
 	struct mesh
 	{
 		// initial data
@@ -131,6 +219,7 @@ namespace triengine::tools {
 		elements::elements_type::type elements_type;
 		utl::vector<u8> position_buffer;
 		utl::vector<u8> element_buffer;
+		utl::vector<u8> sections[mesh_section::count];
 
 		f32 lod_threshold{ -1.f };
 		u32 lod_id{ u32_invalid_id };
@@ -156,6 +245,11 @@ namespace triengine::tools {
 		u8 reverse_handedness;
 		u8 import_embeded_textures;
 		u8 import_animations;
+		u8 generate_meshlets;
+		u8 generated_lod_count; // number of LODs to generate for meshes without authored LODs
+		u8 compress_streams;
+		u8 quantize_positions;
+		u8 normal_encoding; // elements::normal_encoding >> 4
 	};
 
 	struct scene_data
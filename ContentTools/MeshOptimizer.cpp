@@ -0,0 +1,384 @@
+#include "MeshOptimizer.h"
+#include "Geometry.h"
+
+namespace triengine::tools {
+	namespace {
+		using namespace DirectX;
+
+		// Forsyth's scoring constants. See "Linear-Speed Vertex Cache Optimisation" by Tom Forsyth.
+		constexpr u32 max_cache_size{ 32 };
+		constexpr f32 cache_decay_power{ 1.5f };
+		constexpr f32 last_triangle_score{ 0.75f };
+		constexpr f32 valence_boost_scale{ 2.f };
+		constexpr f32 valence_boost_power{ 0.5f };
+
+		f32 vertex_score(s32 cache_position, u32 remaining_valence)
+		{
+			if (!remaining_valence) return -1.f;
+
+			f32 score{ 0.f };
+			if (cache_position >= 0)
+			{
+				if (cache_position < 3)
+				{
+					// the last triangle's vertices get a fixed score so that we don't favour
+					// using the same triangle's vertices again.
+					score = last_triangle_score;
+				}
+				else
+				{
+					assert(cache_position < (s32)max_cache_size);
+					const f32 scaler{ 1.f / (max_cache_size - 3) };
+					score = powf(1.f - (cache_position - 3) * scaler, cache_decay_power);
+				}
+			}
+
+			// bonus for vertices with few triangles left, so we don't leave lonely triangles behind.
+			score += valence_boost_scale * powf((f32)remaining_valence, -valence_boost_power);
+			return score;
+		}
+
+		struct cluster
+		{
+			u32 first_triangle;
+			u32 triangle_count;
+			f32 sort_key;
+		};
+
+		// Returns the number of cache misses for each triangle in a FIFO cache that starts out empty.
+		void simulate_cache_misses(const utl::vector<u32>& indices, u32 vertex_count, u32 cache_size, utl::vector<u8>& misses_per_triangle)
+		{
+			const u32 triangle_count{ (u32)indices.size() / 3 };
+			misses_per_triangle.resize(triangle_count);
+
+			utl::vector<u32> timestamps(vertex_count, 0);
+			u32 timestamp{ cache_size + 1 };
+
+			for (u32 i{ 0 }; i < triangle_count; ++i)
+			{
+				u8 misses{ 0 };
+				for (u32 j{ 0 }; j < 3; ++j)
+				{
+					const u32 v{ indices[i * 3 + j] };
+					if (timestamp - timestamps[v] > cache_size)
+					{
+						timestamps[v] = timestamp++;
+						++misses;
+					}
+				}
+				misses_per_triangle[i] = misses;
+			}
+		}
+	}
+
+	vertex_cache_stats analyze_vertex_cache(const utl::vector<u32>& indices, u32 vertex_count, u32 cache_size)
+	{
+		assert(indices.size() % 3 == 0 && cache_size);
+		vertex_cache_stats stats{};
+		const u32 triangle_count{ (u32)indices.size() / 3 };
+		if (!triangle_count) return stats;
+
+		utl::vector<u8> misses;
+		simulate_cache_misses(indices, vertex_count, cache_size, misses);
+
+		utl::vector<u8> referenced(vertex_count, 0);
+		u32 unique_vertices{ 0 };
+		for (u32 index : indices)
+		{
+			assert(index < vertex_count);
+			unique_vertices += referenced[index] ? 0 : 1;
+			referenced[index] = 1;
+		}
+
+		for (u32 i{ 0 }; i < triangle_count; ++i)
+			stats.vertices_transformed += misses[i];
+
+		stats.acmr = (f32)stats.vertices_transformed / triangle_count;
+		stats.atvr = (f32)stats.vertices_transformed / unique_vertices;
+		return stats;
+	}
+
+	void optimize_vertex_cache(utl::vector<u32>& indices, u32 vertex_count)
+	{
+		const u32 index_count{ (u32)indices.size() };
+		const u32 triangle_count{ index_count / 3 };
+		assert(index_count % 3 == 0);
+		if (!triangle_count) return;
+
+		// build vertex to triangle adjacency. 'valence' is the number of triangles
+		// not yet emitted and the live part of each vertex's adjacency list.
+		utl::vector<u32> valence(vertex_count, 0);
+		for (u32 index : indices)
+		{
+			assert(index < vertex_count);
+			++valence[index];
+		}
+
+		utl::vector<u32> adjacency_offsets(vertex_count);
+		u32 offset{ 0 };
+		for (u32 i{ 0 }; i < vertex_count; ++i)
+		{
+			adjacency_offsets[i] = offset;
+			offset += valence[i];
+		}
+
+		utl::vector<u32> adjacency(index_count);
+		{
+			utl::vector<u32> fill(vertex_count, 0);
+			for (u32 i{ 0 }; i < index_count; ++i)
+			{
+				const u32 v{ indices[i] };
+				adjacency[adjacency_offsets[v] + fill[v]++] = i / 3;
+			}
+		}
+
+		utl::vector<s32> cache_position(vertex_count, -1);
+		utl::vector<f32> vertex_scores(vertex_count);
+		for (u32 i{ 0 }; i < vertex_count; ++i)
+			vertex_scores[i] = vertex_score(-1, valence[i]);
+
+		utl::vector<f32> triangle_scores(triangle_count);
+		utl::vector<u8> emitted(triangle_count, 0);
+		u32 best_triangle{ 0 };
+		for (u32 i{ 0 }; i < triangle_count; ++i)
+		{
+			const u32* const tri{ &indices[i * 3] };
+			triangle_scores[i] = vertex_scores[tri[0]] + vertex_scores[tri[1]] + vertex_scores[tri[2]];
+			if (triangle_scores[i] > triangle_scores[best_triangle]) best_triangle = i;
+		}
+
+		utl::vector<u32> new_indices(index_count);
+		u32 cache[max_cache_size + 3];
+		u32 cache_count{ 0 };
+		u32 scan_cursor{ 0 };
+
+		for (u32 out{ 0 }; out < triangle_count; ++out)
+		{
+			if (best_triangle == u32_invalid_id)
+			{
+				// no candidate left in the cache. Pick the next triangle in input order.
+				while (emitted[scan_cursor]) ++scan_cursor;
+				best_triangle = scan_cursor;
+			}
+
+			assert(!emitted[best_triangle]);
+			emitted[best_triangle] = 1;
+			const u32* const tri{ &indices[best_triangle * 3] };
+			u32 new_cache[max_cache_size + 3];
+			u32 new_cache_count{ 0 };
+
+			for (u32 i{ 0 }; i < 3; ++i)
+			{
+				const u32 v{ tri[i] };
+				new_indices[out * 3 + i] = v;
+				new_cache[new_cache_count++] = v;
+
+				// remove the emitted triangle from the vertex's live adjacency.
+				u32* const adj{ &adjacency[adjacency_offsets[v]] };
+				const u32 count{ valence[v] };
+				for (u32 j{ 0 }; j < count; ++j)
+				{
+					if (adj[j] == best_triangle)
+					{
+						adj[j] = adj[count - 1];
+						adj[count - 1] = best_triangle;
+						--valence[v];
+						break;
+					}
+				}
+			}
+
+			for (u32 i{ 0 }; i < cache_count; ++i)
+			{
+				const u32 v{ cache[i] };
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					new_cache[new_cache_count++] = v;
+			}
+
+			// update the scores of every vertex whose cache position changed, including the
+			// ones that just fell out, and pick the best triangle among the cached vertices.
+			best_triangle = u32_invalid_id;
+			f32 best_score{ -1.f };
+			for (u32 i{ 0 }; i < new_cache_count; ++i)
+			{
+				const u32 v{ new_cache[i] };
+				const s32 position{ i < max_cache_size ? (s32)i : -1 };
+				cache_position[v] = position;
+
+				const f32 score{ vertex_score(position, valence[v]) };
+				const f32 delta{ score - vertex_scores[v] };
+				vertex_scores[v] = score;
+
+				const u32* const adj{ &adjacency[adjacency_offsets[v]] };
+				for (u32 j{ 0 }; j < valence[v]; ++j)
+				{
+					const u32 t{ adj[j] };
+					triangle_scores[t] += delta;
+					if (position >= 0 && triangle_scores[t] > best_score)
+					{
+						best_score = triangle_scores[t];
+						best_triangle = t;
+					}
+				}
+			}
+
+			cache_count = std::min(new_cache_count, max_cache_size);
+			memcpy(cache, new_cache, cache_count * sizeof(u32));
+		}
+
+		indices.swap(new_indices);
+	}
+
+	void optimize_overdraw(utl::vector<u32>& indices, const utl::vector<vertex>& vertices, f32 threshold)
+	{
+		const u32 triangle_count{ (u32)indices.size() / 3 };
+		const u32 vertex_count{ (u32)vertices.size() };
+		assert(indices.size() % 3 == 0);
+		if (triangle_count < 2) return;
+
+		constexpr u32 cache_size{ 16 };
+		utl::vector<u8> misses;
+		simulate_cache_misses(indices, vertex_count, cache_size, misses);
+
+		u32 total_misses{ 0 };
+		for (u32 i{ 0 }; i < triangle_count; ++i) total_misses += misses[i];
+		const f32 max_acmr{ (f32)total_misses / triangle_count * threshold };
+
+		// hard boundaries are triangles that miss on all 3 vertices, i.e. where the cache was already flushed.
+		// Within hard clusters, we add soft boundaries as long as the cluster's ACMR stays under max_acmr.
+		utl::vector<cluster> clusters;
+		{
+			utl::vector<u32> timestamps(vertex_count, 0);
+			u32 timestamp{ cache_size + 1 };
+			u32 cluster_start{ 0 };
+			u32 cluster_misses{ 0 };
+
+			for (u32 i{ 0 }; i < triangle_count; ++i)
+			{
+				if (i > cluster_start && misses[i] == 3)
+				{
+					clusters.emplace_back(cluster{ cluster_start, i - cluster_start, 0.f });
+					cluster_start = i;
+					cluster_misses = 0;
+					timestamp += cache_size + 1;
+				}
+
+				// re-simulate with a cache that's flushed at each cluster start, since that's
+				// what happens when clusters get reordered.
+				for (u32 j{ 0 }; j < 3; ++j)
+				{
+					const u32 v{ indices[i * 3 + j] };
+					if (timestamp - timestamps[v] > cache_size)
+					{
+						timestamps[v] = timestamp++;
+						++cluster_misses;
+					}
+				}
+
+				const u32 cluster_size{ i - cluster_start + 1 };
+				if ((f32)cluster_misses / cluster_size <= max_acmr && i + 1 < triangle_count && misses[i + 1] != 3)
+				{
+					clusters.emplace_back(cluster{ cluster_start, cluster_size, 0.f });
+					cluster_start = i + 1;
+					cluster_misses = 0;
+					timestamp += cache_size + 1;
+				}
+			}
+
+			if (cluster_start < triangle_count)
+				clusters.emplace_back(cluster{ cluster_start, triangle_count - cluster_start, 0.f });
+		}
+
+		if (clusters.size() < 2) return;
+
+		// sort key: how much the cluster faces away from the mesh center. Clusters on the outside
+		// of the mesh are more likely to occlude the rest, so they get drawn first.
+		XMVECTOR mesh_centroid{ XMVectorZero() };
+		f32 mesh_area{ 0.f };
+		utl::vector<XMFLOAT3> cluster_centroids(clusters.size());
+		utl::vector<XMFLOAT3> cluster_normals(clusters.size());
+
+		for (u32 c{ 0 }; c < clusters.size(); ++c)
+		{
+			const cluster& cl{ clusters[c] };
+			XMVECTOR centroid{ XMVectorZero() };
+			XMVECTOR normal{ XMVectorZero() };
+			f32 cluster_area{ 0.f };
+
+			for (u32 i{ cl.first_triangle }; i < cl.first_triangle + cl.triangle_count; ++i)
+			{
+				const XMVECTOR v0{ XMLoadFloat3(&vertices[indices[i * 3 + 0]].position) };
+				const XMVECTOR v1{ XMLoadFloat3(&vertices[indices[i * 3 + 1]].position) };
+				const XMVECTOR v2{ XMLoadFloat3(&vertices[indices[i * 3 + 2]].position) };
+				const XMVECTOR n{ XMVector3Cross(v1 - v0, v2 - v0) };
+				const f32 area{ XMVectorGetX(XMVector3Length(n)) };
+
+				centroid += (v0 + v1 + v2) * (area / 3.f);
+				normal += n;
+				cluster_area += area;
+			}
+
+			mesh_centroid += centroid;
+			mesh_area += cluster_area;
+			XMStoreFloat3(&cluster_centroids[c], cluster_area > 0.f ? centroid / cluster_area : centroid);
+			XMStoreFloat3(&cluster_normals[c], XMVector3Normalize(normal));
+		}
+
+		if (mesh_area > 0.f) mesh_centroid /= mesh_area;
+
+		for (u32 c{ 0 }; c < clusters.size(); ++c)
+		{
+			const XMVECTOR to_cluster{ XMLoadFloat3(&cluster_centroids[c]) - mesh_centroid };
+			clusters[c].sort_key = XMVectorGetX(XMVector3Dot(to_cluster, XMLoadFloat3(&cluster_normals[c])));
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const cluster& a, const cluster& b) { return a.sort_key > b.sort_key; });
+
+		utl::vector<u32> new_indices(indices.size());
+		u32 out{ 0 };
+		for (const cluster& cl : clusters)
+		{
+			const u32 count{ cl.triangle_count * 3 };
+			memcpy(&new_indices[out], &indices[cl.first_triangle * 3], count * sizeof(u32));
+			out += count;
+		}
+
+		assert(out == indices.size());
+		indices.swap(new_indices);
+	}
+
+	void optimize_vertex_fetch(utl::vector<vertex>& vertices, utl::vector<u32>& indices)
+	{
+		const u32 vertex_count{ (u32)vertices.size() };
+		utl::vector<u32> remap(vertex_count, u32_invalid_id);
+		utl::vector<vertex> new_vertices;
+		new_vertices.reserve(vertex_count);
+
+		for (u32& index : indices)
+		{
+			assert(index < vertex_count);
+			if (remap[index] == u32_invalid_id)
+			{
+				remap[index] = (u32)new_vertices.size();
+				new_vertices.emplace_back(vertices[index]);
+			}
+
+			index = remap[index];
+		}
+
+		vertices.swap(new_vertices);
+	}
+
+	mesh_optimization_stats optimize_mesh(mesh& m)
+	{
+		mesh_optimization_stats stats{};
+		stats.before = analyze_vertex_cache(m.indices, (u32)m.vertices.size());
+
+		optimize_vertex_cache(m.indices, (u32)m.vertices.size());
+		optimize_overdraw(m.indices, m.vertices);
+		optimize_vertex_fetch(m.vertices, m.indices);
+
+		stats.after = analyze_vertex_cache(m.indices, (u32)m.vertices.size());
+		return stats;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace triengine::tools {
+
+	struct vertex;
+	struct mesh;
+
+	struct vertex_cache_stats
+	{
+		f32 acmr{ 0.f };	// average cache miss ratio: transformed vertices per triangle (0.5 ... 3.0)
+		f32 atvr{ 0.f };	// average transform to vertex ratio: transformed vertices per unique vertex (1.0 is optimal)
+		u32 vertices_transformed{ 0 };
+	};
+
+	struct mesh_optimization_stats
+	{
+		vertex_cache_stats before;
+		vertex_cache_stats after;
+	};
+
+	// Simulates a FIFO post-transform cache of 'cache_size' entries.
+	vertex_cache_stats analyze_vertex_cache(const utl::vector<u32>& indices, u32 vertex_count, u32 cache_size = 16);
+
+	// Reorders triangles for post-transform cache locality (Forsyth's linear-speed algorithm).
+	void optimize_vertex_cache(utl::vector<u32>& indices, u32 vertex_count);
+
+	// Splits the cache-optimized index buffer into clusters and sorts them so that outward facing clusters
+	// are drawn first. 'threshold' is how much ACMR we're willing to lose to get smaller clusters.
+	void optimize_overdraw(utl::vector<u32>& indices, const utl::vector<vertex>& vertices, f32 threshold = 1.05f);
+
+	// Reorders vertices by first use in the index buffer and remaps the indices. Unreferenced vertices are dropped.
+	void optimize_vertex_fetch(utl::vector<vertex>& vertices, utl::vector<u32>& indices);
+
+	// Runs all of the above on a processed mesh (m.vertices and m.indices).
+	mesh_optimization_stats optimize_mesh(mesh& m);
+}
@@ -0,0 +1,316 @@
+#include "MeshSimplifier.h"
+#include "Geometry.h"
+#include <cfloat>
+
+namespace triengine::tools {
+	namespace {
+		using namespace DirectX;
+
+		constexpr f32 normal_weight{ 0.5f };
+		constexpr f32 uv_weight{ 1.f };
+
+		// Symmetric 4x4 matrix of a sum of weighted plane equations, see "Surface Simplification Using
+		// Quadric Error Metrics" by Garland and Heckbert.
+		struct quadric
+		{
+			f32 a00, a11, a22, a01, a02, a12;
+			f32 b0, b1, b2;
+			f32 c;
+			f32 w;
+
+			void add_plane(XMFLOAT3 n, f32 d, f32 weight)
+			{
+				a00 += weight * n.x * n.x; a11 += weight * n.y * n.y; a22 += weight * n.z * n.z;
+				a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a12 += weight * n.y * n.z;
+				b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+				c += weight * d * d;
+				w += weight;
+			}
+
+			void add(const quadric& q)
+			{
+				a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+				b0 += q.b0; b1 += q.b1; b2 += q.b2;
+				c += q.c;
+				w += q.w;
+			}
+
+			// mean squared distance of 'p' to the planes in this quadric
+			[[nodiscard]] f32 error(const XMFLOAT3& p) const
+			{
+				const f32 rx{ a00 * p.x + a01 * p.y + a02 * p.z + b0 };
+				const f32 ry{ a01 * p.x + a11 * p.y + a12 * p.z + b1 };
+				const f32 rz{ a02 * p.x + a12 * p.y + a22 * p.z + b2 };
+				const f32 e{ rx * p.x + ry * p.y + rz * p.z + b0 * p.x + b1 * p.y + b2 * p.z + c };
+				return w > 0.f ? fabsf(e) / w : 0.f;
+			}
+		};
+
+		struct collapse
+		{
+			u32 from;
+			u32 to;
+			f32 cost;
+		};
+
+		XMVECTOR triangle_normal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+		{
+			const XMVECTOR v0{ XMLoadFloat3(&p0) };
+			return XMVector3Cross(XMLoadFloat3(&p1) - v0, XMLoadFloat3(&p2) - v0);
+		}
+
+		// Finds vertices that share a position with other vertices (i.e. vertices that were split at normal
+		// or uv seams) and returns a welded index for every vertex.
+		void weld_positions(const utl::vector<XMFLOAT3>& positions, utl::vector<u32>& welded)
+		{
+			const u32 vertex_count{ (u32)positions.size() };
+			utl::vector<u32> order(vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i) order[i] = i;
+
+			auto less = [&positions](u32 a, u32 b) {
+				const XMFLOAT3& pa{ positions[a] };
+				const XMFLOAT3& pb{ positions[b] };
+				return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			welded.resize(vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+			{
+				const u32 v{ order[i] };
+				welded[v] = (i > 0 && !less(order[i - 1], v)) ? welded[order[i - 1]] : v;
+			}
+		}
+
+		// Marks vertices that can't move: vertices on open borders and vertices that have twins on a seam.
+		void find_locked_vertices(const utl::vector<u32>& indices, const utl::vector<u32>& welded, utl::vector<u8>& locked)
+		{
+			const u32 vertex_count{ (u32)welded.size() };
+			utl::vector<u32> twins(vertex_count, 0);
+			for (u32 i{ 0 }; i < vertex_count; ++i) ++twins[welded[i]];
+
+			utl::vector<u8> locked_welded(vertex_count, 0);
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+				if (twins[welded[i]] > 1) locked_welded[welded[i]] = 1;
+
+			// an edge is on an open border if only one triangle uses it.
+			utl::vector<u64> edges;
+			edges.reserve(indices.size());
+			for (u32 i{ 0 }; i < indices.size(); i += 3)
+			{
+				for (u32 j{ 0 }; j < 3; ++j)
+				{
+					const u32 a{ welded[indices[i + j]] };
+					const u32 b{ welded[indices[i + (j + 1) % 3]] };
+					edges.emplace_back(a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a);
+				}
+			}
+
+			std::sort(edges.begin(), edges.end());
+			const u32 edge_count{ (u32)edges.size() };
+			for (u32 i{ 0 }; i < edge_count;)
+			{
+				u32 j{ i + 1 };
+				while (j < edge_count && edges[j] == edges[i]) ++j;
+				if (j - i == 1)
+				{
+					locked_welded[(u32)(edges[i] >> 32)] = 1;
+					locked_welded[(u32)(edges[i] & 0xffff'ffff)] = 1;
+				}
+				i = j;
+			}
+
+			locked.resize(vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+				locked[i] = locked_welded[welded[i]];
+		}
+	}
+
+	f32 get_mesh_extent(const utl::vector<vertex>& vertices)
+	{
+		if (vertices.empty()) return 0.f;
+
+		XMVECTOR min_corner{ XMLoadFloat3(&vertices[0].position) };
+		XMVECTOR max_corner{ min_corner };
+		for (const vertex& v : vertices)
+		{
+			const XMVECTOR p{ XMLoadFloat3(&v.position) };
+			min_corner = XMVectorMin(min_corner, p);
+			max_corner = XMVectorMax(max_corner, p);
+		}
+
+		XMFLOAT3 size;
+		XMStoreFloat3(&size, max_corner - min_corner);
+		return std::max(size.x, std::max(size.y, size.z));
+	}
+
+	f32 simplify_mesh(utl::vector<u32>& indices, const utl::vector<vertex>& vertices, u32 target_index_count, f32 target_error)
+	{
+		assert(indices.size() % 3 == 0);
+		const u32 vertex_count{ (u32)vertices.size() };
+		if (indices.size() <= target_index_count || !vertex_count) return 0.f;
+
+		// NOTE: we work on positions scaled to a unit box, so that errors don't depend on the mesh size
+		//       and the quadrics don't lose precision with large coordinates.
+		const f32 extent{ get_mesh_extent(vertices) };
+		const f32 inv_extent{ extent > 0.f ? 1.f / extent : 1.f };
+		XMVECTOR min_corner{ XMLoadFloat3(&vertices[0].position) };
+		for (const vertex& v : vertices) min_corner = XMVectorMin(min_corner, XMLoadFloat3(&v.position));
+
+		utl::vector<XMFLOAT3> positions(vertex_count);
+		for (u32 i{ 0 }; i < vertex_count; ++i)
+			XMStoreFloat3(&positions[i], (XMLoadFloat3(&vertices[i].position) - min_corner) * inv_extent);
+
+		utl::vector<u32> welded;
+		utl::vector<u8> locked;
+		weld_positions(positions, welded);
+		find_locked_vertices(indices, welded, locked);
+
+		utl::vector<quadric> quadrics(vertex_count);
+		memset(quadrics.data(), 0, quadrics.size() * sizeof(quadric));
+		for (u32 i{ 0 }; i < indices.size(); i += 3)
+		{
+			const u32 i0{ indices[i] }, i1{ indices[i + 1] }, i2{ indices[i + 2] };
+			const XMVECTOR n{ triangle_normal(positions[i0], positions[i1], positions[i2]) };
+			const f32 area{ XMVectorGetX(XMVector3Length(n)) };
+			if (area == 0.f) continue;
+
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, n / area);
+			const f32 d{ -XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normal), XMLoadFloat3(&positions[i0]))) };
+
+			for (u32 v : { i0, i1, i2 })
+				quadrics[v].add_plane(normal, d, area);
+		}
+
+		auto collapse_cost = [&](u32 from, u32 to) {
+			quadric q{ quadrics[from] };
+			q.add(quadrics[to]);
+			f32 cost{ q.error(positions[to]) };
+
+			const vertex& a{ vertices[from] };
+			const vertex& b{ vertices[to] };
+			const f32 edge_length_sq{ XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&positions[to]) - XMLoadFloat3(&positions[from]))) };
+			const f32 normal_delta{ 1.f - XMVectorGetX(XMVector3Dot(XMLoadFloat3(&a.normal), XMLoadFloat3(&b.normal))) };
+			const f32 uv_delta{ (a.uv.x - b.uv.x) * (a.uv.x - b.uv.x) + (a.uv.y - b.uv.y) * (a.uv.y - b.uv.y) };
+			cost += edge_length_sq * (normal_weight * normal_delta + uv_weight * uv_delta);
+			return cost;
+		};
+
+		const f32 max_cost{ target_error * target_error };
+		f32 result_error{ 0.f };
+		utl::vector<u32> remap(vertex_count);
+		utl::vector<u8> touched(vertex_count);
+		utl::vector<u32> adjacency_offsets(vertex_count + 1);
+		utl::vector<u32> adjacency;
+		utl::vector<collapse> collapses;
+
+		while (indices.size() > target_index_count)
+		{
+			const u32 index_count{ (u32)indices.size() };
+
+			// vertex to triangle adjacency for the normal flip test.
+			memset(adjacency_offsets.data(), 0, adjacency_offsets.size() * sizeof(u32));
+			for (u32 index : indices) ++adjacency_offsets[index + 1];
+			for (u32 i{ 0 }; i < vertex_count; ++i) adjacency_offsets[i + 1] += adjacency_offsets[i];
+			adjacency.resize(index_count);
+			{
+				utl::vector<u32> fill(vertex_count, 0);
+				for (u32 i{ 0 }; i < index_count; ++i)
+				{
+					const u32 v{ indices[i] };
+					adjacency[adjacency_offsets[v] + fill[v]++] = i / 3;
+				}
+			}
+
+			// pick the cheaper direction for every edge. Locked vertices can be collapse targets, but never sources.
+			collapses.clear();
+			for (u32 i{ 0 }; i < index_count; i += 3)
+			{
+				for (u32 j{ 0 }; j < 3; ++j)
+				{
+					const u32 a{ indices[i + j] };
+					const u32 b{ indices[i + (j + 1) % 3] };
+					if (a > b || (locked[a] && locked[b])) continue;
+
+					const f32 cost_ab{ locked[a] ? FLT_MAX : collapse_cost(a, b) };
+					const f32 cost_ba{ locked[b] ? FLT_MAX : collapse_cost(b, a) };
+					collapses.emplace_back(cost_ab <= cost_ba ? collapse{ a, b, cost_ab } : collapse{ b, a, cost_ba });
+				}
+			}
+
+			if (collapses.empty()) break;
+			std::sort(collapses.begin(), collapses.end(), [](const collapse& a, const collapse& b) { return a.cost < b.cost; });
+
+			for (u32 i{ 0 }; i < vertex_count; ++i) remap[i] = i;
+			memset(touched.data(), 0, touched.size());
+
+			const u32 triangles_to_remove{ (index_count - target_index_count + 2) / 3 };
+			u32 triangles_removed{ 0 };
+			u32 collapse_count{ 0 };
+
+			for (const collapse& c : collapses)
+			{
+				if (c.cost > max_cost) break;
+				if (touched[c.from] || touched[c.to]) continue;
+
+				// reject collapses that flip triangles around 'from'.
+				bool flips{ false };
+				u32 removed{ 0 };
+				for (u32 k{ adjacency_offsets[c.from] }; k < adjacency_offsets[c.from + 1] && !flips; ++k)
+				{
+					const u32* const tri{ &indices[adjacency[k] * 3] };
+					if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+					{
+						++removed;
+						continue;
+					}
+
+					XMFLOAT3 p[3]{ positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+					const XMVECTOR n0{ triangle_normal(p[0], p[1], p[2]) };
+					for (u32 v{ 0 }; v < 3; ++v)
+						if (tri[v] == c.from) p[v] = positions[c.to];
+
+					const XMVECTOR n1{ triangle_normal(p[0], p[1], p[2]) };
+					flips = XMVectorGetX(XMVector3Dot(n0, n1)) <= 0.f;
+				}
+
+				if (flips) continue;
+
+				// NOTE: every vertex around 'from' gets touched, so the flip test above stays valid
+				//       for the remaining collapses in this pass.
+				for (u32 k{ adjacency_offsets[c.from] }; k < adjacency_offsets[c.from + 1]; ++k)
+				{
+					const u32* const tri{ &indices[adjacency[k] * 3] };
+					touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+				}
+
+				remap[c.from] = c.to;
+				quadrics[c.to].add(quadrics[c.from]);
+				result_error = std::max(result_error, c.cost);
+				triangles_removed += removed;
+				++collapse_count;
+
+				if (triangles_removed >= triangles_to_remove) break;
+			}
+
+			if (!collapse_count) break;
+
+			// apply the collapses and drop the triangles that became degenerate.
+			u32 write{ 0 };
+			for (u32 i{ 0 }; i < index_count; i += 3)
+			{
+				const u32 a{ remap[indices[i]] }, b{ remap[indices[i + 1]] }, c{ remap[indices[i + 2]] };
+				if (a == b || b == c || a == c) continue;
+
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+
+			indices.resize(write);
+		}
+
+		return sqrtf(result_error);
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace triengine::tools {
+
+	struct vertex;
+
+	// Returns the largest dimension of the mesh's bounding box. Simplification errors are relative to this.
+	[[nodiscard]] f32 get_mesh_extent(const utl::vector<vertex>& vertices);
+
+	// Collapses edges of a triangle list until it has at most 'target_index_count' indices, or until the next
+	// collapse would exceed 'target_error' (relative to the mesh extent). Costs use quadric error metrics plus
+	// a penalty for collapsing across different normals and uvs. Vertices on open borders and attribute seams
+	// are locked, so the mesh doesn't tear. Vertices aren't modified or removed, only the indices change.
+	// Returns the largest error introduced, relative to the mesh extent.
+	f32 simplify_mesh(utl::vector<u32>& indices, const utl::vector<vertex>& vertices, u32 target_index_count, f32 target_error);
+}
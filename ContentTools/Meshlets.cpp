@@ -0,0 +1,188 @@
+#include "Meshlets.h"
+#include "Utilities\IOStream.h"
+
+namespace triengine::tools {
+	namespace {
+		using namespace DirectX;
+
+		void add_meshlet(meshlet_data& data, meshlet& current, const math::v3* const positions)
+		{
+			if (!current.triangle_count) return;
+
+			data.meshlets.emplace_back(current);
+			data.bounds.emplace_back(calculate_meshlet_bounds(data, (u32)data.meshlets.size() - 1, positions));
+
+			current.vertex_offset = (u32)data.vertices.size();
+			current.triangle_offset = (u32)data.triangles.size();
+			current.vertex_count = 0;
+			current.triangle_count = 0;
+		}
+	}
+
+	void build_meshlets(const u32* const indices, u32 index_count, const math::v3* const positions, u32 vertex_count,
+		meshlet_data& data, u32 max_vertices, u32 max_triangles)
+	{
+		assert(indices && positions && index_count % 3 == 0);
+		// meshlet-local indices are stored in a byte and D3D12 mesh shaders output up to 256 vertices and primitives.
+		assert(max_vertices >= 3 && max_vertices <= 256);
+		assert(max_triangles >= 1 && max_triangles <= 256);
+
+		// NOTE: 'marker' holds the index of the meshlet that last used a vertex, so we don't have to clear
+		//       the lookup table between meshlets.
+		utl::vector<u32> marker(vertex_count, u32_invalid_id);
+		utl::vector<u8> local_index(vertex_count);
+		meshlet current{};
+		u32 meshlet_index{ 0 };
+
+		for (u32 i{ 0 }; i < index_count; i += 3)
+		{
+			const u32 a{ indices[i] }, b{ indices[i + 1] }, c{ indices[i + 2] };
+			assert(a < vertex_count && b < vertex_count && c < vertex_count);
+
+			const u32 new_vertices{
+				(u32)(marker[a] != meshlet_index) +
+				(u32)(marker[b] != meshlet_index && b != a) +
+				(u32)(marker[c] != meshlet_index && c != a && c != b) };
+
+			if (current.vertex_count + new_vertices > max_vertices || current.triangle_count + 1 > max_triangles)
+			{
+				add_meshlet(data, current, positions);
+				++meshlet_index;
+			}
+
+			for (u32 v : { a, b, c })
+			{
+				if (marker[v] != meshlet_index)
+				{
+					marker[v] = meshlet_index;
+					local_index[v] = (u8)current.vertex_count++;
+					data.vertices.emplace_back(v);
+				}
+
+				data.triangles.emplace_back(local_index[v]);
+			}
+
+			++current.triangle_count;
+		}
+
+		add_meshlet(data, current, positions);
+		assert(data.meshlets.size() == data.bounds.size());
+	}
+
+	meshlet_bounds calculate_meshlet_bounds(const meshlet_data& data, u32 meshlet_index, const math::v3* const positions)
+	{
+		const meshlet& m{ data.meshlets[meshlet_index] };
+		const u32* const vertices{ &data.vertices[m.vertex_offset] };
+		const u8* const triangles{ &data.triangles[m.triangle_offset] };
+		assert(m.vertex_count && m.triangle_count);
+
+		// bounding sphere: AABB center with the radius of the farthest vertex.
+		XMVECTOR min_corner{ XMLoadFloat3(&positions[vertices[0]]) };
+		XMVECTOR max_corner{ min_corner };
+		for (u32 i{ 1 }; i < m.vertex_count; ++i)
+		{
+			const XMVECTOR p{ XMLoadFloat3(&positions[vertices[i]]) };
+			min_corner = XMVectorMin(min_corner, p);
+			max_corner = XMVectorMax(max_corner, p);
+		}
+
+		const XMVECTOR center{ (min_corner + max_corner) * 0.5f };
+		f32 radius_sq{ 0.f };
+		for (u32 i{ 0 }; i < m.vertex_count; ++i)
+		{
+			const XMVECTOR p{ XMLoadFloat3(&positions[vertices[i]]) };
+			radius_sq = std::max(radius_sq, XMVectorGetX(XMVector3LengthSq(p - center)));
+		}
+
+		meshlet_bounds bounds{};
+		XMStoreFloat3(&bounds.center, center);
+		bounds.radius = sqrtf(radius_sq);
+
+		// normal cone: average of the triangle normals, widened to include every triangle.
+		XMVECTOR axis{ XMVectorZero() };
+		for (u32 i{ 0 }; i < m.triangle_count; ++i)
+		{
+			const XMVECTOR v0{ XMLoadFloat3(&positions[vertices[triangles[i * 3 + 0]]]) };
+			const XMVECTOR v1{ XMLoadFloat3(&positions[vertices[triangles[i * 3 + 1]]]) };
+			const XMVECTOR v2{ XMLoadFloat3(&positions[vertices[triangles[i * 3 + 2]]]) };
+			axis += XMVector3Normalize(XMVector3Cross(v1 - v0, v2 - v0));
+		}
+
+		axis = XMVector3Normalize(axis);
+		f32 min_dot{ 1.f };
+		f32 max_t{ 0.f };
+		for (u32 i{ 0 }; i < m.triangle_count; ++i)
+		{
+			const XMVECTOR v0{ XMLoadFloat3(&positions[vertices[triangles[i * 3 + 0]]]) };
+			const XMVECTOR v1{ XMLoadFloat3(&positions[vertices[triangles[i * 3 + 1]]]) };
+			const XMVECTOR v2{ XMLoadFloat3(&positions[vertices[triangles[i * 3 + 2]]]) };
+			const XMVECTOR n{ XMVector3Cross(v1 - v0, v2 - v0) };
+			if (XMVectorGetX(XMVector3LengthSq(n)) == 0.f) continue; // degenerate
+
+			const XMVECTOR normal{ XMVector3Normalize(n) };
+			const f32 d{ XMVectorGetX(XMVector3Dot(axis, normal)) };
+			min_dot = std::min(min_dot, d);
+
+			// move the apex back along the axis until it's behind every triangle's plane.
+			if (d > 0.f)
+			{
+				const f32 t{ XMVectorGetX(XMVector3Dot(center - v0, normal)) / d };
+				max_t = std::max(max_t, t);
+			}
+		}
+
+		XMStoreFloat3(&bounds.cone_axis, axis);
+		if (min_dot <= 0.1f)
+		{
+			// normals span more than ~84 degrees from the axis, so the cone can't be used for culling.
+			bounds.cone_apex = bounds.center;
+			bounds.cone_cutoff = 1.f;
+		}
+		else
+		{
+			XMStoreFloat3(&bounds.cone_apex, center - axis * max_t);
+			bounds.cone_cutoff = sqrtf(1.f - min_dot * min_dot);
+		}
+
+		return bounds;
+	}
+
+	bool is_meshlet_backfacing(const meshlet_bounds& bounds, math::v3 camera_position)
+	{
+		if (bounds.cone_cutoff >= 1.f) return false;
+
+		const XMVECTOR view{ XMVector3Normalize(XMLoadFloat3(&bounds.cone_apex) - XMLoadFloat3(&camera_position)) };
+		return XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&bounds.cone_axis))) >= bounds.cone_cutoff;
+	}
+
+	void pack_meshlets(const meshlet_data& data, utl::vector<u8>& buffer)
+	{
+		const u32 meshlet_count{ (u32)data.meshlets.size() };
+		const u32 vertex_count{ (u32)data.vertices.size() };
+		const u32 triangle_count{ (u32)data.triangles.size() / 3 };
+		assert(data.bounds.size() == meshlet_count && data.triangles.size() % 3 == 0);
+
+		constexpr u64 su32{ sizeof(u32) };
+		const u64 size{
+			su32 * 3 + // meshlet, vertex and triangle counts
+			sizeof(meshlet) * meshlet_count +
+			sizeof(meshlet_bounds) * meshlet_count +
+			su32 * vertex_count +
+			math::align_size_up<su32>(data.triangles.size())
+		};
+
+		buffer.resize(size);
+		utl::blob_stream_writer blob{ buffer.data(), buffer.size() };
+
+		blob.write(meshlet_count);
+		blob.write(vertex_count);
+		blob.write(triangle_count);
+		blob.write((const u8*)data.meshlets.data(), sizeof(meshlet) * meshlet_count);
+		blob.write((const u8*)data.bounds.data(), sizeof(meshlet_bounds) * meshlet_count);
+		blob.write((const u8*)data.vertices.data(), su32 * vertex_count);
+		blob.write(data.triangles.data(), data.triangles.size());
+		blob.skip(size - blob.offset()); // padding
+
+		assert(blob.offset() == size);
+	}
+}
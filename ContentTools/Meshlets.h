@@ -0,0 +1,55 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace triengine::tools {
+
+	// Recommended limits for mesh shaders (NVIDIA: 64 vertices, 126 primitives, rounded down to a multiple of 4).
+	constexpr u32 max_meshlet_vertices{ 64 };
+	constexpr u32 max_meshlet_triangles{ 124 };
+
+	struct meshlet
+	{
+		u32 vertex_offset;		// first entry in meshlet_data::vertices
+		u32 triangle_offset;	// first entry in meshlet_data::triangles (3 entries per triangle)
+		u32 vertex_count;
+		u32 triangle_count;
+	};
+
+	struct meshlet_bounds
+	{
+		math::v3 center;		// bounding sphere
+		f32 radius;
+		math::v3 cone_apex;		// normal cone
+		math::v3 cone_axis;
+		f32 cone_cutoff;		// sin of the cone's half angle. 1 means the cone is too wide to cull.
+	};
+
+	struct meshlet_data
+	{
+		utl::vector<meshlet> meshlets;
+		utl::vector<meshlet_bounds> bounds;
+		utl::vector<u32> vertices;	// mesh vertex indices referenced by each meshlet
+		utl::vector<u8> triangles;	// meshlet-local vertex indices, 3 per triangle
+	};
+
+	// Splits a triangle list into meshlets of at most 'max_vertices' unique vertices and 'max_triangles' triangles,
+	// keeping the input triangle order. Works best on an index buffer that was optimized for vertex cache locality.
+	void build_meshlets(const u32* const indices, u32 index_count, const math::v3* const positions, u32 vertex_count,
+		meshlet_data& data, u32 max_vertices = max_meshlet_vertices, u32 max_triangles = max_meshlet_triangles);
+
+	[[nodiscard]] meshlet_bounds calculate_meshlet_bounds(const meshlet_data& data, u32 meshlet_index, const math::v3* const positions);
+
+	// Cone test for cluster back-face culling. Returns true if no triangle in the meshlet can face the camera.
+	[[nodiscard]] bool is_meshlet_backfacing(const meshlet_bounds& bounds, math::v3 camera_position);
+
+	// Packs meshlets into a mesh blob section:
+	//
+	// struct {
+	//     u32 meshlet_count, u32 vertex_count, u32 triangle_count,
+	//     meshlet meshlets[meshlet_count],
+	//     meshlet_bounds bounds[meshlet_count],
+	//     u32 vertices[vertex_count],
+	//     u8 triangles[triangle_count * 3] (padded to 4 bytes)
+	// } meshlet_section;
+	void pack_meshlets(const meshlet_data& data, utl::vector<u8>& buffer);
+}
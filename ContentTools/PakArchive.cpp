@@ -0,0 +1,159 @@
+#include "PakArchive.h"
+#include "Content\PakFormat.h"
+#include "Utilities\LzCodec.h"
+#include "Utilities\ThreadPool.h"
+#include <fstream>
+
+namespace triengine::tools {
+	namespace {
+		// NOTE: compressed data is only kept if it saves at least 1/8 of the size. Decompressing costs more
+		//       load time than reading a few more bytes saves.
+		constexpr u64 min_compressed_saving{ 8 };
+		constexpr u64 min_compressed_size{ 256 };
+
+		struct packed_asset
+		{
+			utl::vector<u8> compressed;
+			content::pak::entry entry;
+			u32 shared_index;		// earlier asset with the same content, or u32_invalid_id
+		};
+
+		[[nodiscard]] u32 table_size(u32 entry_count)
+		{
+			// keep the table at most half full, so lookups only probe a few slots.
+			u32 size{ 2 };
+			while (size < entry_count * 2) size <<= 1;
+			return size;
+		}
+
+		void write_padding(std::ofstream& file, u64 size)
+		{
+			constexpr u32 chunk{ 4096 };
+			const u8 zeros[chunk]{};
+			while (size)
+			{
+				const u64 count{ std::min(size, (u64)chunk) };
+				file.write((const char*)&zeros[0], count);
+				size -= count;
+			}
+		}
+	}
+
+	EDITOR_INTERFACE bool WritePakArchive(const char* path, const pak_asset* assets, u32 asset_count)
+	{
+		assert(path && (assets || !asset_count));
+		using namespace content;
+
+		utl::vector<packed_asset> packed(asset_count);
+		utl::default_thread_pool().parallel_for(asset_count, [&](u32 i) {
+			const pak_asset& asset{ assets[i] };
+			assert(asset.name && (asset.data || !asset.size));
+			packed_asset& p{ packed[i] };
+			p.entry = {};
+			p.entry.name_hash = pak::hash_name(asset.name);
+			p.entry.content_hash = pak::hash(asset.data, asset.size);
+			p.entry.size = asset.size;
+			p.entry.stored_size = asset.size;
+			p.entry.type = asset.type;
+			p.entry.flags = pak::entry_flags::none;
+			p.shared_index = u32_invalid_id;
+
+			if (asset.compress && asset.size >= min_compressed_size)
+			{
+				utl::lz_compress(asset.data, asset.size, p.compressed);
+				if (p.compressed.size() <= asset.size - asset.size / min_compressed_saving)
+				{
+					p.entry.stored_size = p.compressed.size();
+					p.entry.flags = pak::entry_flags::compressed;
+				}
+				else
+				{
+					p.compressed.clear();
+				}
+			}
+		});
+
+		// find duplicate names and assets with the same content.
+		for (u32 i{ 0 }; i < asset_count; ++i)
+		{
+			packed_asset& p{ packed[i] };
+			for (u32 j{ 0 }; j < i; ++j)
+			{
+				const packed_asset& other{ packed[j] };
+				if (other.entry.name_hash == p.entry.name_hash) return false;
+				if (p.shared_index == u32_invalid_id && other.shared_index == u32_invalid_id &&
+					other.entry.content_hash == p.entry.content_hash && other.entry.size == p.entry.size &&
+					other.entry.flags == p.entry.flags && !memcmp(assets[j].data, assets[i].data, p.entry.size))
+				{
+					p.shared_index = j;
+				}
+			}
+		}
+
+		pak::archive_header header{};
+		header.magic = pak::magic;
+		header.version = pak::version;
+		header.entry_count = asset_count;
+		header.table_size = table_size(asset_count);
+
+		utl::vector<u32> table(header.table_size, u32_invalid_id);
+		const u32 mask{ header.table_size - 1 };
+		u64 offset{ math::align_size_up<pak::entry_alignment>(pak::table_offset(asset_count) + sizeof(u32) * header.table_size) };
+		for (u32 i{ 0 }; i < asset_count; ++i)
+		{
+			pak::entry& e{ packed[i].entry };
+			if (!e.stored_size)
+			{
+				e.offset = 0;
+			}
+			else if (packed[i].shared_index == u32_invalid_id)
+			{
+				e.offset = offset;
+				offset = math::align_size_up<pak::entry_alignment>(offset + e.stored_size);
+			}
+			else
+			{
+				e.offset = packed[packed[i].shared_index].entry.offset;
+			}
+
+			u32 slot{ (u32)e.name_hash & mask };
+			while (table[slot] != u32_invalid_id) slot = (slot + 1) & mask;
+			table[slot] = i;
+		}
+
+		// NOTE: the last entry isn't padded, so the archive ends right after its data.
+		u64 size{ pak::table_offset(asset_count) + sizeof(u32) * header.table_size };
+		for (u32 i{ 0 }; i < asset_count; ++i)
+		{
+			const pak::entry& e{ packed[i].entry };
+			size = std::max(size, e.offset + e.stored_size);
+		}
+		header.size = size;
+
+		std::ofstream file{ path, std::ios::out | std::ios::binary | std::ios::trunc };
+		if (!file) return false;
+
+		file.write((const char*)&header, sizeof(header));
+		for (u32 i{ 0 }; i < asset_count; ++i)
+		{
+			file.write((const char*)&packed[i].entry, sizeof(pak::entry));
+		}
+		file.write((const char*)table.data(), sizeof(u32) * header.table_size);
+
+		u64 position{ pak::table_offset(asset_count) + sizeof(u32) * header.table_size };
+		for (u32 i{ 0 }; i < asset_count; ++i)
+		{
+			const packed_asset& p{ packed[i] };
+			if (p.shared_index != u32_invalid_id || !p.entry.stored_size) continue;
+			assert(p.entry.offset >= position);
+			write_padding(file, p.entry.offset - position);
+			const u8* const data{ (p.entry.flags & pak::entry_flags::compressed) ? p.compressed.data() : assets[i].data };
+			file.write((const char*)data, p.entry.stored_size);
+			position = p.entry.offset + p.entry.stored_size;
+		}
+
+		assert(!file || position == header.size || !asset_count);
+		file.close();
+		return !file.fail();
+	}
+}
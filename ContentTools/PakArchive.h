@@ -0,0 +1,18 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace triengine::tools {
+	// An asset to put in a .pak archive (see content::pak).
+	struct pak_asset
+	{
+		const char* name;		// path relative to the game's folder, like "game.bin"
+		const u8* data;
+		u64 size;
+		u32 type;				// content::asset_type::type
+		u32 compress;			// 1 to compress the data, if it gets smaller enough
+	};
+
+	// Writes the assets to a .pak archive at 'path'. Returns false if two assets have the same name
+	// or the file can't be written.
+	EDITOR_INTERFACE bool WritePakArchive(const char* path, const pak_asset* assets, u32 asset_count);
+}
@@ -0,0 +1,9 @@
+#include "ToolsCommon.h"
+#include "Utilities\ThreadPool.h"
+
+namespace triengine::tools {
+	EDITOR_INTERFACE void ShutdownContentTools()
+	{
+		utl::shutdown_default_thread_pool();
+	}
+}
@@ -4,4 +4,10 @@
 
 #ifndef EDITOR_INTERFACE
 #define EDITOR_INTERFACE extern "C" __declspec(dllexport)
-#endif // !EDITOR_INTERFACE
\ No newline at end of file
+#endif // !EDITOR_INTERFACE
+
+namespace triengine::tools {
+	// Joins the worker threads of the content tools. The editor calls this before it exits, since the threads
+	// can't be joined while the DLL is unloaded.
+	EDITOR_INTERFACE void ShutdownContentTools();
+}
\ No newline at end of file
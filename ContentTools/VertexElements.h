@@ -0,0 +1,158 @@
+#pragma once
+#include "Geometry.h"
+#include "VertexEncoding.h"
+
+namespace triengine::tools::elements {
+	namespace detail {
+		// Fills in every field the element struct has, so the layout is described by the struct alone.
+		// NOTE: the normal encoding is part of the elements type and decides how normals and tangents are packed.
+		template<elements_type::type type, typename T>
+		[[nodiscard]] inline T make_element(const vertex& v)
+		{
+			constexpr normal_encoding::type encoding{ (normal_encoding::type)(type & normal_encoding::mask) };
+			T e{};
+
+			if constexpr (requires { &T::color; })
+			{
+				e.color[0] = v.red;
+				e.color[1] = v.green;
+				e.color[2] = v.blue;
+			}
+
+			if constexpr (requires { &T::t_sign; })
+			{
+				if constexpr (encoding == normal_encoding::xy_sign)
+					e.t_sign = (u8)(((v.normal.z > 0.f) << 1) | ((v.tangent.w > 0.f) && (v.tangent.z > 0.f)));
+				else
+					e.t_sign = (u8)(v.tangent.w > 0.f);
+			}
+
+			if constexpr (requires { &T::normal; })
+			{
+				if constexpr (std::is_same_v<decltype(T::normal), u32>)
+				{
+					e.normal = pack_octahedral(v.normal, 10);
+				}
+				else if constexpr (std::is_same_v<decltype(T::normal), u8[2]>)
+				{
+					const u32 n{ pack_octahedral(v.normal, 8) };
+					e.normal[0] = (u8)n;
+					e.normal[1] = (u8)(n >> 8);
+				}
+				else if constexpr (encoding == normal_encoding::octahedral_16)
+				{
+					const u32 n{ pack_octahedral(v.normal, 16) };
+					e.normal[0] = (u16)n;
+					e.normal[1] = (u16)(n >> 16);
+				}
+				else
+				{
+					e.normal[0] = (u16)math::pack_float<16>(v.normal.x, -1.f, 1.f);
+					e.normal[1] = (u16)math::pack_float<16>(v.normal.y, -1.f, 1.f);
+				}
+			}
+
+			if constexpr (requires { &T::tangent; })
+			{
+				if constexpr (std::is_same_v<decltype(T::tangent), u8[2]>)
+				{
+					const u32 t{ pack_octahedral({ v.tangent.x, v.tangent.y, v.tangent.z }, 8) };
+					e.tangent[0] = (u8)t;
+					e.tangent[1] = (u8)(t >> 8);
+				}
+				else if constexpr (encoding == normal_encoding::octahedral_16)
+				{
+					const u32 t{ pack_octahedral({ v.tangent.x, v.tangent.y, v.tangent.z }, 16) };
+					e.tangent[0] = (u16)t;
+					e.tangent[1] = (u16)(t >> 16);
+				}
+				else
+				{
+					e.tangent[0] = (u16)math::pack_float<16>(v.tangent.x, -1.f, 1.f);
+					e.tangent[1] = (u16)math::pack_float<16>(v.tangent.y, -1.f, 1.f);
+				}
+			}
+
+			if constexpr (requires { &T::normal_tangent; })
+			{
+				e.normal_tangent = pack_normal_tangent(v.normal, v.tangent);
+			}
+
+			if constexpr (requires { &T::uv; })
+			{
+				e.uv = v.uv;
+			}
+
+			if constexpr (requires { &T::joint_weights; })
+			{
+				e.joint_weights[0] = (u8)math::pack_unit_float<8>(v.joint_weights.x);
+				e.joint_weights[1] = (u8)math::pack_unit_float<8>(v.joint_weights.y);
+				e.joint_weights[2] = (u8)math::pack_unit_float<8>(v.joint_weights.z);
+			}
+
+			if constexpr (requires { &T::joint_indices; })
+			{
+				e.joint_indices[0] = (u16)v.joint_indices.x;
+				e.joint_indices[1] = (u16)v.joint_indices.y;
+				e.joint_indices[2] = (u16)v.joint_indices.z;
+				e.joint_indices[3] = (u16)v.joint_indices.w;
+			}
+
+			return e;
+		}
+
+		template<elements_type::type type, typename T>
+		void pack_elements(const vertex* const vertices, u32 vertex_count, u8* const buffer)
+		{
+			T* const elements{ (T* const)buffer };
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+			{
+				elements[i] = make_element<type, T>(vertices[i]);
+			}
+		}
+	}
+
+	struct element_trait
+	{
+		elements_type::type type;
+		u32 size;
+		void (*pack)(const vertex* const vertices, u32 vertex_count, u8* const buffer);
+	};
+
+	template<elements_type::type type, typename T>
+	[[nodiscard]] constexpr element_trait make_element_trait()
+	{
+		return { type, (u32)sizeof(T), detail::pack_elements<type, T> };
+	}
+
+	// One entry per elements type. Adding a layout only needs an element struct and a line here.
+	constexpr element_trait element_traits[]{
+		{ elements_type::position_only, 0, nullptr },
+		make_element_trait<elements_type::static_normal, static_normal>(),
+		make_element_trait<elements_type::static_normal_texture, static_normal_texture>(),
+		make_element_trait<elements_type::static_color, static_color>(),
+		make_element_trait<elements_type::skeletal, skeletal>(),
+		make_element_trait<elements_type::skeletal_color, skeletal_color>(),
+		make_element_trait<elements_type::skeletal_normal, skeletal_normal>(),
+		make_element_trait<elements_type::skeletal_normal_color, skeletal_normal_color>(),
+		make_element_trait<elements_type::skeletal_normal_texture, skeletal_normal_texture>(),
+		make_element_trait<elements_type::skeletal_normal_texture_color, skeletal_normal_texture_color>(),
+		make_element_trait<elements_type::static_normal_oct16, static_normal_oct16>(),
+		make_element_trait<elements_type::static_normal_texture_oct16, static_normal_texture_oct16>(),
+		make_element_trait<elements_type::static_normal_oct8, static_normal_oct8>(),
+		make_element_trait<elements_type::static_normal_texture_oct8, static_normal_texture_oct8>(),
+		make_element_trait<elements_type::static_normal_packed, static_normal_packed>(),
+		make_element_trait<elements_type::static_normal_texture_packed, static_normal_texture_packed>(),
+	};
+
+	[[nodiscard]] constexpr const element_trait& get_element_trait(elements_type::type type)
+	{
+		for (const element_trait& trait : element_traits)
+		{
+			if (trait.type == type) return trait;
+		}
+
+		assert(false); // unknown elements type
+		return element_traits[0];
+	}
+}
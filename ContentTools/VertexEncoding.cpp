@@ -0,0 +1,202 @@
+#include "VertexEncoding.h"
+#include "Utilities\IOStream.h"
+
+namespace triengine::tools {
+	namespace {
+		using namespace DirectX;
+
+		constexpr f32 quantization_intervals{ (f32)((1 << 16) - 1) };
+		constexpr u32 tangent_angle_bits{ 10 };
+
+		// NOTE: codes are centered on 0, so 0 and +/-1 are represented exactly.
+		[[nodiscard]] constexpr f32 snorm_scale(u32 bits) { return (f32)((1u << (bits - 1)) - 1); }
+
+		// Orthonormal basis around a unit vector, without branches on the vector's direction
+		// (Duff et al. 2017, "Building an Orthonormal Basis, Revisited").
+		void get_basis(XMVECTOR n, XMVECTOR& b1, XMVECTOR& b2)
+		{
+			math::v3 v;
+			XMStoreFloat3(&v, n);
+			const f32 sign{ v.z >= 0.f ? 1.f : -1.f };
+			const f32 a{ -1.f / (sign + v.z) };
+			const f32 b{ v.x * v.y * a };
+			b1 = XMVectorSet(1.f + sign * v.x * v.x * a, sign * b, -sign * v.x, 0.f);
+			b2 = XMVectorSet(b, sign + v.y * v.y * a, -v.y, 0.f);
+		}
+	}
+
+	position_quantization get_position_quantization(const math::v3* const positions, u32 vertex_count)
+	{
+		assert(positions && vertex_count);
+		XMVECTOR min_corner{ XMLoadFloat3(&positions[0]) };
+		XMVECTOR max_corner{ min_corner };
+		for (u32 i{ 1 }; i < vertex_count; ++i)
+		{
+			const XMVECTOR p{ XMLoadFloat3(&positions[i]) };
+			min_corner = XMVectorMin(min_corner, p);
+			max_corner = XMVectorMax(max_corner, p);
+		}
+
+		position_quantization quantization{};
+		XMStoreFloat3(&quantization.offset, min_corner);
+		XMStoreFloat3(&quantization.scale, (max_corner - min_corner) / quantization_intervals);
+		return quantization;
+	}
+
+	void quantize_positions(const math::v3* const positions, u32 vertex_count, const position_quantization& quantization, u16* const quantized)
+	{
+		assert(positions && quantized);
+		const f32* const offset{ &quantization.offset.x };
+		const f32* const scale{ &quantization.scale.x };
+
+		for (u32 i{ 0 }; i < vertex_count; ++i)
+		{
+			const f32* const p{ &positions[i].x };
+			for (u32 axis{ 0 }; axis < 3; ++axis)
+			{
+				// NOTE: flat axes have a scale of 0 and are always stored as 0.
+				const f32 q{ scale[axis] > 0.f ? (p[axis] - offset[axis]) / scale[axis] : 0.f };
+				quantized[i * 3 + axis] = (u16)math::clamp(q + 0.5f, 0.f, quantization_intervals);
+			}
+		}
+	}
+
+	math::v3 dequantize_position(const u16* const quantized, const position_quantization& quantization)
+	{
+		return {
+			quantization.offset.x + (f32)quantized[0] * quantization.scale.x,
+			quantization.offset.y + (f32)quantized[1] * quantization.scale.y,
+			quantization.offset.z + (f32)quantized[2] * quantization.scale.z,
+		};
+	}
+
+	quantization_error measure_position_error(const math::v3* const positions, u32 vertex_count,
+		const u16* const quantized, const position_quantization& quantization)
+	{
+		assert(positions && quantized);
+		quantization_error error{};
+		if (!vertex_count) return error;
+
+		f32 total_error{ 0.f };
+		for (u32 i{ 0 }; i < vertex_count; ++i)
+		{
+			const math::v3 decoded{ dequantize_position(&quantized[i * 3], quantization) };
+			const f32 e{ XMVectorGetX(XMVector3Length(XMLoadFloat3(&decoded) - XMLoadFloat3(&positions[i]))) };
+			error.max_error = std::max(error.max_error, e);
+			total_error += e;
+		}
+
+		error.average_error = total_error / (f32)vertex_count;
+		const f32 extent{ std::max({ quantization.scale.x, quantization.scale.y, quantization.scale.z }) * quantization_intervals };
+		error.relative_max_error = extent > 0.f ? error.max_error / extent : 0.f;
+		return error;
+	}
+
+	math::v2 encode_octahedral(math::v3 n)
+	{
+		const f32 l1_norm{ fabsf(n.x) + fabsf(n.y) + fabsf(n.z) };
+		math::v2 e{ n.x / l1_norm, n.y / l1_norm };
+		if (n.z < 0.f)
+		{
+			// fold the lower hemisphere over the diagonals.
+			e = { (1.f - fabsf(e.y)) * (e.x >= 0.f ? 1.f : -1.f), (1.f - fabsf(e.x)) * (e.y >= 0.f ? 1.f : -1.f) };
+		}
+		return e;
+	}
+
+	math::v3 decode_octahedral(math::v2 e)
+	{
+		math::v3 n{ e.x, e.y, 1.f - fabsf(e.x) - fabsf(e.y) };
+		const f32 t{ std::max(-n.z, 0.f) };
+		n.x += n.x >= 0.f ? -t : t;
+		n.y += n.y >= 0.f ? -t : t;
+		XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+		return n;
+	}
+
+	u32 pack_octahedral(math::v3 n, u32 bits)
+	{
+		assert(bits >= 2 && bits <= 16);
+		const f32 scale{ snorm_scale(bits) };
+		const math::v2 e{ encode_octahedral(n) };
+		const f32 x{ floorf(e.x * scale) }, y{ floorf(e.y * scale) };
+		const XMVECTOR v{ XMLoadFloat3(&n) };
+
+		u32 best{ 0 };
+		f32 best_dot{ -2.f };
+		for (u32 i{ 0 }; i < 4; ++i)
+		{
+			const f32 cx{ math::clamp(x + (f32)(i & 1), -scale, scale) };
+			const f32 cy{ math::clamp(y + (f32)(i >> 1), -scale, scale) };
+			const u32 code{ (u32)(cx + scale) | ((u32)(cy + scale) << bits) };
+			const math::v3 decoded{ unpack_octahedral(code, bits) };
+			const f32 d{ XMVectorGetX(XMVector3Dot(v, XMLoadFloat3(&decoded))) };
+			if (d > best_dot)
+			{
+				best_dot = d;
+				best = code;
+			}
+		}
+
+		return best;
+	}
+
+	math::v3 unpack_octahedral(u32 packed, u32 bits)
+	{
+		assert(bits >= 2 && bits <= 16);
+		const f32 scale{ snorm_scale(bits) };
+		const u32 mask{ (1u << bits) - 1 };
+		return decode_octahedral({ ((f32)(packed & mask) - scale) / scale, ((f32)((packed >> bits) & mask) - scale) / scale });
+	}
+
+	u32 pack_normal_tangent(math::v3 normal, math::v4 tangent)
+	{
+		u32 packed{ pack_octahedral(normal, 10) };
+
+		// NOTE: the basis is built from the decoded normal, so it's the same one the decoder sees.
+		XMVECTOR b1, b2;
+		const math::v3 n{ unpack_octahedral(packed, 10) };
+		get_basis(XMLoadFloat3(&n), b1, b2);
+
+		const XMVECTOR t{ XMLoadFloat4(&tangent) };
+		const f32 angle{ atan2f(XMVectorGetX(XMVector3Dot(t, b2)), XMVectorGetX(XMVector3Dot(t, b1))) };
+		constexpr f32 angle_intervals{ (f32)(1u << tangent_angle_bits) };
+		const u32 angle_code{ (u32)((angle + math::pi) / math::two_pi * angle_intervals + 0.5f) & ((1u << tangent_angle_bits) - 1) };
+
+		packed |= angle_code << 20;
+		packed |= (u32)(tangent.w > 0.f) << 30;
+		return packed;
+	}
+
+	void unpack_normal_tangent(u32 packed, math::v3& normal, math::v4& tangent)
+	{
+		normal = unpack_octahedral(packed & 0xfffff, 10);
+
+		XMVECTOR b1, b2;
+		get_basis(XMLoadFloat3(&normal), b1, b2);
+
+		constexpr f32 angle_intervals{ (f32)(1u << tangent_angle_bits) };
+		const f32 angle{ (f32)((packed >> 20) & ((1u << tangent_angle_bits) - 1)) / angle_intervals * math::two_pi - math::pi };
+		XMStoreFloat4(&tangent, b1 * cosf(angle) + b2 * sinf(angle));
+		tangent.w = (packed >> 30) & 1 ? 1.f : -1.f;
+	}
+
+	quantization_error pack_quantized_positions(const math::v3* const positions, u32 vertex_count, utl::vector<u8>& buffer)
+	{
+		const position_quantization quantization{ get_position_quantization(positions, vertex_count) };
+		utl::vector<u16> quantized(vertex_count * 3);
+		quantize_positions(positions, vertex_count, quantization, quantized.data());
+
+		const u64 positions_size{ sizeof(u16) * quantized.size() };
+		const u64 size{ sizeof(position_quantization) + math::align_size_up<sizeof(u32)>(positions_size) };
+		buffer.resize(size);
+		utl::blob_stream_writer blob{ buffer.data(), buffer.size() };
+		static_assert(sizeof(position_quantization) == sizeof(math::v3) * 2);
+		blob.write((const u8*)&quantization, sizeof(position_quantization));
+		blob.write((const u8*)quantized.data(), positions_size);
+		blob.skip(size - blob.offset()); // padding
+		assert(blob.offset() == size);
+
+		return measure_position_error(positions, vertex_count, quantized.data(), quantization);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace triengine::tools {
+
+	// Positions are stored as 16-bit unsigned integers per axis, relative to the mesh's bounding box:
+	//     position = offset + quantized * scale
+	struct position_quantization
+	{
+		math::v3 offset;	// bounding box minimum
+		math::v3 scale;		// bounding box extent / 65535
+	};
+
+	struct quantization_error
+	{
+		f32 max_error;			// largest distance between an original and a decoded position
+		f32 average_error;
+		f32 relative_max_error;	// max_error relative to the largest bounding box dimension
+	};
+
+	[[nodiscard]] position_quantization get_position_quantization(const math::v3* const positions, u32 vertex_count);
+
+	// Writes 3 u16 values per vertex to 'quantized'.
+	void quantize_positions(const math::v3* const positions, u32 vertex_count, const position_quantization& quantization, u16* const quantized);
+
+	// CPU reference for the dequantization done in the vertex shader.
+	[[nodiscard]] math::v3 dequantize_position(const u16* const quantized, const position_quantization& quantization);
+
+	[[nodiscard]] quantization_error measure_position_error(const math::v3* const positions, u32 vertex_count,
+		const u16* const quantized, const position_quantization& quantization);
+
+	// Octahedral encoding: the unit sphere is projected onto an octahedron which is unfolded into a square.
+	// Precision is spread evenly over the sphere, unlike storing x and y with a sign bit for z.
+	[[nodiscard]] math::v2 encode_octahedral(math::v3 n); // returns values in [-1, 1]
+	[[nodiscard]] math::v3 decode_octahedral(math::v2 e);
+
+	// Packs a unit vector into two 'bits'-wide values (x in the low bits). Of the 4 nearest codes,
+	// the one that decodes closest to 'n' is used.
+	[[nodiscard]] u32 pack_octahedral(math::v3 n, u32 bits);
+	[[nodiscard]] math::v3 unpack_octahedral(u32 packed, u32 bits);
+
+	// Packs a tangent frame into 32 bits:
+	//     bits 0-19: normal, 10 + 10 bits octahedral
+	//     bits 20-29: tangent, as an angle around the normal
+	//     bit 30: handedness (tangent.w), 1 means +1
+	[[nodiscard]] u32 pack_normal_tangent(math::v3 normal, math::v4 tangent);
+	void unpack_normal_tangent(u32 packed, math::v3& normal, math::v4& tangent);
+
+	// Packs quantized positions into a mesh blob section:
+	//
+	// struct {
+	//     f32 offset[3], f32 scale[3],
+	//     u16 positions[vertex_count * 3] (padded to 4 bytes)
+	// } quantized_positions_section;
+	quantization_error pack_quantized_positions(const math::v3* const positions, u32 vertex_count, utl::vector<u8>& buffer);
+}
@@ -3,8 +3,8 @@
 
 namespace triengine::transform {
 	namespace {
-		utl::vector<math::m4x4> to_world;
-		utl::vector<math::m4x4> inv_world;
+		utl::vector<math::m4x3> to_world;
+		utl::vector<math::m4x3> inv_world;
 		utl::vector<math::v3> positions;
 		utl::vector<math::v3> orientations;
 		utl::vector<math::v4> rotations;
@@ -25,11 +25,11 @@ namespace triengine::transform {
 			XMVECTOR s{ XMLoadFloat3(&scales[index]) };
 
 			XMMATRIX world{ XMMatrixAffineTransformation(s, XMQuaternionIdentity(), r, p) };
-			DirectX::XMStoreFloat4x4(&to_world[index], world);
+			DirectX::XMStoreFloat4x3(&to_world[index], world);
 
 			world.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
 			XMMATRIX inverse_world{ XMMatrixInverse(nullptr, world) };
-			DirectX::XMStoreFloat4x4(&inv_world[index], inverse_world);
+			DirectX::XMStoreFloat4x3(&inv_world[index], inverse_world);
 
 			has_transform[index] = 1;
 		}
@@ -113,7 +113,7 @@ namespace triengine::transform {
 		assert(c.is_valid());
 	}
 
-	void get_transform_matrices(const game_entity::entity_id id, math::m4x4& world, math::m4x4& inverse_world)
+	void get_transform_matrices(const game_entity::entity_id id, math::m4x3& world, math::m4x3& inverse_world)
 	{
 		assert(game_entity::entity{ id }.is_valid());
 
@@ -142,7 +142,9 @@ namespace triengine::transform {
 	void update(const component_cache* const cache, u32 count)
 	{
 		assert(cache && count);
-		if (!read_write_flag)
+		// NOTE: changes are only cleared once they've been read, so none are missed when there are several
+		//       updates between two reads.
+		if (read_write_flag)
 		{
 			memset(changes_from_previous_frame.data(), 0, changes_from_previous_frame.size());
 			read_write_flag = 0;
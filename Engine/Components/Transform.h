@@ -34,7 +34,7 @@ namespace triengine::transform {
 
 	component create(init_info info, game_entity::entity entity);
 	void remove(component c);
-	void get_transform_matrices(const game_entity::entity_id id, math::m4x4& world, math::m4x4& inverse_world);
+	void get_transform_matrices(const game_entity::entity_id id, math::m4x3& world, math::m4x3& inverse_world);
 	void get_updated_components_flags(const game_entity::entity_id* const ids, u32 count, u8 *const flags);
 	void update(const component_cache *const cache, u32 count);
 }
\ No newline at end of file
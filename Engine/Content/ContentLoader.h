@@ -1,14 +1,34 @@
 #pragma once
 #pragma once
 #include "CommonHeaders.h"
+#include "ContentToEngine.h"
 
 #if !defined(SHIPPING) && defined(_WIN64)
 
 namespace triengine::content {
+	// An asset read from the archive. 'data' points into the mapped archive, or into 'buffer' if the asset
+	// was compressed.
+	struct archive_asset
+	{
+		std::unique_ptr<u8[]> buffer;
+		const u8* data{ nullptr };
+		u64 size{ 0 };
+		asset_type::type type{ asset_type::unknown };
+	};
+
 	bool load_game();
 	void unload_game();
 
 	bool load_engine_shaders(std::unique_ptr<u8[]>& shaders, u64& size);
+
+	// Maps a .pak archive made by the content tools. While it's open, load_game() and load_engine_shaders()
+	// read from the archive, and only read loose files for content that isn't in it.
+	bool open_archive(const char* path);
+	void close_archive();
+	// Returns false if no archive is open, the asset isn't in it or its compressed data is corrupt.
+	[[nodiscard]] bool read_archive_asset(const char* name, archive_asset& asset);
+	// Creates the engine resource of an asset in the archive. Returns id::invalid_id if it isn't in the archive.
+	id::id_type create_resource_from_archive(const char* name);
 }
 
 #endif // !SHIPPING
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "Components\Transform.h"
 #include "Components\Script.h"
 #include "Graphics/Renderer.h"
+#include "PakFormat.h"
+#include "Utilities/LzCodec.h"
 
 #if !defined(SHIPPING) && defined(_WIN64)
 
@@ -59,6 +61,48 @@ namespace triengine::content {
 		using component_reader = bool(*)(const u8*&, game_entity::entity_info&);
 		component_reader component_readers[component_type::count]{ read_transform, read_script };
 		static_assert(_countof(component_readers) == component_type::count);
+
+		// The archive is mapped once and stays mapped until it's closed. Uncompressed assets are read
+		// straight from the mapping, so the OS only reads the pages that are used.
+		struct mapped_archive
+		{
+			HANDLE file{ INVALID_HANDLE_VALUE };
+			HANDLE mapping{ nullptr };
+			const u8* data{ nullptr };
+			u64 size{ 0 };
+		} archive{};
+
+		bool create_entities(const u8* const game_data, u64 size)
+		{
+			assert(game_data && size);
+			const u8* at{ game_data };
+			constexpr u32 su32{ sizeof(u32) };
+			const u32 num_entities{ *at }; at += su32;
+
+			for (u32 entity_index{ 0 }; entity_index < num_entities; ++entity_index)
+			{
+				game_entity::entity_info info{};
+				const u32 entity_type{ *at }; at += su32;
+				const u32 num_components{ *at }; at += su32;
+				if (!num_components) return false;
+
+				for (u32 component_index{ 0 }; component_index < num_components; ++component_index)
+				{
+					const u32 component_type{ *at }; at += su32;
+					assert(component_type < component_type::count);
+
+					if (!component_readers[component_type](at, info)) return false;
+				}
+
+				assert(info.transform);
+				game_entity::entity entity{ game_entity::create(info) };
+				if (!entity.is_valid()) return false;
+				entities.emplace_back(entity);
+			}
+
+			assert(at == game_data + size);
+			return true;
+		}
 	}
 
 	bool read_file(std::filesystem::path path, std::unique_ptr<u8[]>& data, u64& size) {
@@ -82,51 +126,127 @@ namespace triengine::content {
 
 	bool load_game() {
 		// read game.bin and creates the entities
+		archive_asset asset{};
+		if (read_archive_asset("game.bin", asset)) return create_entities(asset.data, asset.size);
+
 		std::unique_ptr<u8[]> game_data{};
 		u64 size{ 0 };
 		if (!read_file("game.bin", game_data, size)) return false;
 		assert(game_data.get());
-		const u8* at{ game_data.get() };
-		constexpr u32 su32{ sizeof(u32) };
-		const u32 num_entities{ *at }; at += su32;
+		return create_entities(game_data.get(), size);
+	}
 
-		for (u32 entity_index{ 0 }; entity_index < num_entities; ++entity_index)
+	void unload_game() {
+		for (auto entity : entities)
 		{
-			game_entity::entity_info info{};
-			const u32 entity_type{ *at }; at += su32;
-			const u32 num_components{ *at }; at += su32;
-			if (!num_components) return false;
+			game_entity::remove(entity.get_id());
+		}
+	}
 
-			for (u32 component_index{ 0 }; component_index < num_components; ++component_index)
-			{
-				const u32 component_type{ *at }; at += su32;
-				assert(component_type < component_type::count);
+	bool load_engine_shaders(std::unique_ptr<u8[]>& shaders, u64& size)
+	{
+		auto path = graphics::get_engine_shaders_path();
 
-				if (!component_readers[component_type](at, info)) return false;
+		archive_asset asset{};
+		if (read_archive_asset(path, asset))
+		{
+			size = asset.size;
+			if (asset.buffer)
+			{
+				shaders = std::move(asset.buffer);
 			}
+			else
+			{
+				// NOTE: the shaders are used after the archive is closed, so they're copied out of the mapping.
+				shaders = std::make_unique<u8[]>(size);
+				memcpy(shaders.get(), asset.data, size);
+			}
+			return true;
+		}
 
-			assert(info.transform);
-			game_entity::entity entity{ game_entity::create(info) };
-			if (!entity.is_valid()) return false;
-			entities.emplace_back(entity);
+		return read_file(path, shaders, size);
+	}
+
+	bool open_archive(const char* path)
+	{
+		assert(path && !archive.data);
+		archive.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (archive.file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size{};
+		if (GetFileSizeEx(archive.file, &size) && size.QuadPart)
+		{
+			archive.size = (u64)size.QuadPart;
+			archive.mapping = CreateFileMappingA(archive.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		}
+
+		if (archive.mapping)
+		{
+			archive.data = (const u8*)MapViewOfFile(archive.mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+
+		if (!archive.data || !pak::is_valid(archive.data, archive.size))
+		{
+			close_archive();
+			return false;
 		}
 
-		assert(at == game_data.get() + size);
 		return true;
 	}
 
-	void unload_game() {
-		for (auto entity : entities)
+	void close_archive()
+	{
+		if (archive.data) UnmapViewOfFile(archive.data);
+		if (archive.mapping) CloseHandle(archive.mapping);
+		if (archive.file != INVALID_HANDLE_VALUE) CloseHandle(archive.file);
+		archive = {};
+	}
+
+	bool read_archive_asset(const char* name, archive_asset& asset)
+	{
+		assert(name);
+		if (!archive.data) return false;
+		const pak::entry* const entry{ pak::find_entry(archive.data, pak::hash_name(name)) };
+		if (!entry) return false;
+
+		const u8* const data{ archive.data + entry->offset };
+		if (entry->stored_size)
 		{
-			game_entity::remove(entity.get_id());
+			// NOTE: reads the whole entry with large IOs, instead of a page at a time as the data is touched.
+			WIN32_MEMORY_RANGE_ENTRY range{ (void*)data, (size_t)entry->stored_size };
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		}
+
+		asset.type = (asset_type::type)entry->type;
+		asset.size = entry->size;
+		if (entry->flags & pak::entry_flags::compressed)
+		{
+			// NOTE: a corrupt stream can still decompress to the right size, so the data is checked as well.
+			asset.buffer = std::make_unique<u8[]>(entry->size);
+			if (!utl::lz_decompress(asset.buffer.get(), entry->size, data, entry->stored_size) ||
+				pak::hash(asset.buffer.get(), entry->size) != entry->content_hash)
+			{
+				asset.buffer.reset();
+				return false;
+			}
+			asset.data = asset.buffer.get();
 		}
+		else
+		{
+			// NOTE: data that's used in place is only checked in debug builds, so it isn't all read here.
+			asset.buffer.reset();
+			asset.data = data;
+			assert(pak::hash(asset.data, asset.size) == entry->content_hash);
+		}
+
+		return true;
 	}
 
-	bool load_engine_shaders(std::unique_ptr<u8[]>& shaders, u64& size)
+	id::id_type create_resource_from_archive(const char* name)
 	{
-		auto path = graphics::get_engine_shaders_path();
-
-		return read_file(path, shaders, size);
+		archive_asset asset{};
+		if (!read_archive_asset(name, asset)) return id::invalid_id;
+		return create_resource(asset.data, asset.type);
 	}
 }
 
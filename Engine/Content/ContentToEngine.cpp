@@ -1,6 +1,7 @@
 #include "ContentToEngine.h"
 #include "Graphics/Renderer.h"
 #include "Utilities/IOStream.h"
+#include "Utilities/EpochTable.h"
 
 namespace triengine::content {
 	namespace {
@@ -40,7 +41,6 @@ namespace triengine::content {
 					if (_thresholds[i] <= threshold) return i;
 				}
 
-				assert(false);
 				return 0;
 			}
 
@@ -48,6 +48,16 @@ namespace triengine::content {
 			[[nodiscard]] constexpr f32* thresholds() const { return _thresholds; }
 			[[nodiscard]] constexpr lod_offsets* lod_offsets() const { return _lod_offsets; }
 			[[nodiscard]] constexpr id::id_type* gpu_ids() const { return _gpu_ids; }
+
+			// NOTE: the bounds follow the gpu ids, so these are only valid once all lod_offsets are set.
+			[[nodiscard]] constexpr u32 submesh_count() const
+			{
+				const triengine::content::lod_offsets& last{ _lod_offsets[_lod_count - 1] };
+				return (u32)last.offset + (u32)last.count;
+			}
+			[[nodiscard]] mesh_bounds* bounds() const { return (mesh_bounds*)&_gpu_ids[submesh_count()]; }
+			[[nodiscard]] mesh_bounds* lod_bounds() const { return &bounds()[1]; }
+			[[nodiscard]] mesh_bounds* submesh_bounds() const { return &bounds()[1 + _lod_count]; }
 		private:
 			u8* const _buffer;
 			f32* _thresholds;
@@ -56,22 +66,54 @@ namespace triengine::content {
 			u32 _lod_count;
 		};
 
-		struct noexcept_map
+		// A shader group is a single buffer with its keys sorted, so a permutation is found with a binary search:
+		// struct {
+		//     u32 shader_count,
+		//     u32 keys[shader_count],
+		//     u32 offsets[shader_count],	// from the start of the buffer, 8 byte aligned
+		//     u8 shaders[]
+		// } shader_group;
+		class shader_group_stream
 		{
-			std::unordered_map<u32, std::unique_ptr<u8[]>> map;
-			noexcept_map() = default;
-			noexcept_map(const noexcept_map&) = default;
-			noexcept_map(noexcept_map&&) noexcept = default;
-			noexcept_map& operator=(const noexcept_map&) = default;
-			noexcept_map& operator=(noexcept_map&&) noexcept = default;
+		public:
+			DISABLE_COPY_AND_MOVE(shader_group_stream);
+			explicit shader_group_stream(const u8* const buffer)
+				: _buffer{ buffer }
+			{
+				assert(buffer);
+				_shader_count = *((const u32*)buffer);
+				_keys = (const u32*)(&buffer[sizeof(u32)]);
+				_offsets = &_keys[_shader_count];
+			}
+
+			[[nodiscard]] compiled_shader_ptr find(u32 key) const
+			{
+				const u32* const end{ _keys + _shader_count };
+				const u32* const it{ std::lower_bound(_keys, end, key) };
+				if (it == end || *it != key) return nullptr;
+				return (compiled_shader_ptr)&_buffer[_offsets[it - _keys]];
+			}
+
+			[[nodiscard]] constexpr static u32 header_size(u32 shader_count)
+			{
+				return (u32)math::align_size_up<sizeof(u64)>(sizeof(u32) * (1 + 2 * shader_count));
+			}
+
+		private:
+			const u8* const _buffer;
+			const u32* _keys;
+			const u32* _offsets;
+			u32 _shader_count;
 		};
 
+		// NOTE: lookups don't lock. Frame preparation and PSO compilation read these while loaders add and remove
+		//       content, so readers hold an epoch::read_guard, and removed buffers are freed once no reader can be
+		//       using them (see utl::epoch_table).
 		constexpr uintptr_t single_mesh_marker{ (uintptr_t)0x01 };
-		utl::free_list<u8*> geometry_hierarchies;
-		std::mutex geometry_mutex;
+		utl::epoch_table<u8*> geometry_hierarchies;
+		utl::epoch_table<mesh_bounds> single_mesh_bounds;
 
-		utl::free_list<noexcept_map> shader_groups;
-		std::mutex shader_mutex;
+		utl::epoch_table<u8*> shader_groups;
 
 		u32 get_geometry_hierarchy_buffer_size(const void* const data)
 		{
@@ -79,16 +121,21 @@ namespace triengine::content {
 			utl::blob_stream_reader blob{ (const u8*)data };
 			const u32 lod_count{ blob.read<u32>() };
 			assert(lod_count);
+			// skip geometry bounds
+			blob.skip(sizeof(mesh_bounds));
 
-			// add size of lod_count, thresholds, lod_offsets to the size of hierarchy buffer.
-			u32 size{ sizeof(u32) + (lod_count * sizeof(f32)) + (lod_count * sizeof(lod_offsets)) };
+			// add size of lod_count, thresholds, lod_offsets, geometry bounds and LOD bounds to the size of hierarchy buffer.
+			u32 size{ sizeof(u32) + (lod_count * sizeof(f32)) + (lod_count * sizeof(lod_offsets)) + ((1 + lod_count) * sizeof(mesh_bounds)) };
 
 			for (u32 lod_idx{ 0 }; lod_idx < lod_count; ++lod_idx)
 			{
 				// skip threshold
 				blob.skip(sizeof(f32));
-				// add size of gpu_ids
-				size += sizeof(id::id_type) * blob.read<u32>();
+				// add size of gpu_ids and submesh bounds
+				const u32 submesh_count{ blob.read<u32>() };
+				size += (sizeof(id::id_type) + sizeof(mesh_bounds)) * submesh_count;
+				// skip LOD and submesh bounds
+				blob.skip(sizeof(mesh_bounds) * (1 + submesh_count));
 				// skip submesh data and go to the next LOD
 				blob.skip(blob.read<u32>());
 			}
@@ -108,6 +155,12 @@ namespace triengine::content {
 			geometry_hierarchy_stream stream{ hierarchy_buffer, lod_count };
 			u16 submesh_index{ 0 };
 			id::id_type* const gpu_ids{ stream.gpu_ids() };
+			bool is_loaded{ true };
+
+			mesh_bounds geometry_bounds{};
+			blob.read((u8*)&geometry_bounds, sizeof(mesh_bounds));
+			utl::vector<mesh_bounds> lod_bounds(lod_count);
+			utl::vector<mesh_bounds> submesh_bounds;
 
 			for (u32 lod_idx{ 0 }; lod_idx < lod_count; ++lod_idx)
 			{
@@ -115,17 +168,41 @@ namespace triengine::content {
 				const u32 id_count{ blob.read<u32>() };
 				assert(id_count < (1 << 16));
 				stream.lod_offsets()[lod_idx] = { (u16)submesh_index, (u16)id_count };
+				blob.read((u8*)&lod_bounds[lod_idx], sizeof(mesh_bounds));
+				const u32 first_bounds{ (u32)submesh_bounds.size() };
+				submesh_bounds.resize(first_bounds + id_count);
+				blob.read((u8*)&submesh_bounds[first_bounds], sizeof(mesh_bounds) * id_count);
 				blob.skip(sizeof(u32)); // skip over size_of_submeshes
 
 				for (u32 id_idx{ 0 }; id_idx < id_count; ++id_idx)
 				{
 					const u8* at{ blob.position() };
-					gpu_ids[submesh_index++] = graphics::add_submesh(at);
+					gpu_ids[submesh_index] = graphics::add_submesh(at);
+					is_loaded &= id::is_valid(gpu_ids[submesh_index++]);
 					blob.skip((u32)(at - blob.position()));
 					assert(submesh_index < (1 << 16));
 				}
 			}
 
+			assert(submesh_bounds.size() == stream.submesh_count());
+
+			// NOTE: a submesh that failed to load fails the whole geometry, but the others are loaded first, since
+			//       the size of each submesh is only known once it's read.
+			if (!is_loaded)
+			{
+				for (u32 i{ 0 }; i < submesh_index; ++i)
+				{
+					if (id::is_valid(gpu_ids[i])) graphics::remove_submesh(gpu_ids[i]);
+				}
+
+				free(hierarchy_buffer);
+				return id::invalid_id;
+			}
+
+			*stream.bounds() = geometry_bounds;
+			memcpy(stream.lod_bounds(), lod_bounds.data(), sizeof(mesh_bounds) * lod_count);
+			memcpy(stream.submesh_bounds(), submesh_bounds.data(), sizeof(mesh_bounds) * submesh_bounds.size());
+
 			assert([&]() {
 				f32 previous_threshold{ stream.thresholds()[0] };
 				for (u32 i{ 1 }; i < lod_count; ++i)
@@ -138,7 +215,6 @@ namespace triengine::content {
 
 			static_assert(alignof(void*) > 2, "We need at least significant bit for the single mesh marker");
 
-			std::lock_guard lock{ geometry_mutex };
 			return geometry_hierarchies.add(hierarchy_buffer);
 		}
 
@@ -146,17 +222,23 @@ namespace triengine::content {
 		{
 			assert(data);
 			utl::blob_stream_reader blob{ (const u8*)data };
-			// skip lod_count, lod_threshold, submesh_count and size_of_submeshes
-			blob.skip(sizeof(u32) + sizeof(f32) + sizeof(u32) + sizeof(u32));
+			// skip lod_count, geometry bounds, lod_threshold, submesh_count and LOD bounds
+			blob.skip(sizeof(u32) + sizeof(mesh_bounds) + sizeof(f32) + sizeof(u32) + sizeof(mesh_bounds));
+			// NOTE: with a single LOD and submesh, the submesh bounds are also the LOD and geometry bounds.
+			mesh_bounds bounds{};
+			blob.read((u8*)&bounds, sizeof(mesh_bounds));
+			blob.skip(sizeof(u32)); // skip over size_of_submeshes
 			const u8* at{ blob.position() };
 			const id::id_type gpu_id{ graphics::add_submesh(at) };
-
+			if (!id::is_valid(gpu_id)) return id::invalid_id;
 
 			// create a fake pointer and put it in the geometry_hierarchies.
+			// NOTE: the bits between the gpu id and the marker hold the index of the mesh's bounds.
 			static_assert(sizeof(uintptr_t) > sizeof(id::id_type));
 			constexpr u8 shift_bits{ (sizeof(uintptr_t) - sizeof(id::id_type)) << 3 };
-			u8* const fake_pointer{ (u8* const)((((uintptr_t)gpu_id) << shift_bits) | single_mesh_marker) };
-			std::lock_guard lock{ geometry_mutex };
+			const u32 bounds_id{ single_mesh_bounds.add(bounds) };
+			assert(bounds_id < (1u << (shift_bits - 1)));
+			u8* const fake_pointer{ (u8* const)((((uintptr_t)gpu_id) << shift_bits) | ((uintptr_t)bounds_id << 1) | single_mesh_marker) };
 			return geometry_hierarchies.add(fake_pointer);
 		}
 
@@ -168,7 +250,7 @@ namespace triengine::content {
 			assert(lod_count);
 			if (lod_count > 1) return false;
 
-			blob.skip(sizeof(f32)); // skip threshold
+			blob.skip(sizeof(mesh_bounds) + sizeof(f32)); // skip geometry bounds and threshold
 			const u32 submesh_count{ blob.read<u32>() };
 			assert(submesh_count);
 			return submesh_count == 1;
@@ -182,16 +264,26 @@ namespace triengine::content {
 			return (id::id_type)((((uintptr_t)pointer) >> shift_bits) & (uintptr_t)id::invalid_id);
 		}
 
+		constexpr u32 bounds_id_from_fake_pointer(u8* const pointer)
+		{
+			assert((uintptr_t)pointer & single_mesh_marker);
+			return (u32)((((uintptr_t)pointer) >> 1) & (uintptr_t)0x7fffffff);
+		}
+
 		// NOTE: Expects 'data' to contain:
 		// struct {
 		//     u32 lod_count,
+		//     mesh_bounds bounds,
 		//     struct {
 		//          float lod_threshold,
 		//          u32 submesh_count,
+		//          mesh_bounds lod_bounds,
+		//          mesh_bounds submesh_bounds[submesh_count],
 		//          u32 size_of_submeshes,
 		//          struct {
 		//              u32 element_size, u32 vertex_count,
-		//              u32 index_count, u32 elements_type, u32 primitive_topology
+		//              u32 index_count, u32 elements_type, u32 primitive_topology,
+		//              u32 encoding,
 		//              u8 positions[sizeof(f32) * 3 * vertex_count],
 		//              u8 elements[sizeof(element_size) * index_count],
 		//              u8 indices[index_size * index_count]
@@ -210,11 +302,14 @@ namespace triengine::content {
 		//          u16 count
 		//     } lod_offsets[lod_count],
 		//     id::id_types gpu_ids[total_number_of_submeshes],
+		//     mesh_bounds bounds,
+		//     mesh_bounds lod_bounds[lod_count],
+		//     mesh_bounds submesh_bounds[total_number_of_submeshes]
 		// } geometry_hierarchy;
 		//
 		// If geometry has only one LOD and one submesh:
 		// 
-		// (gpu_id << 32) | 0x01
+		// (gpu_id << 32) | (bounds_id << 1) | 0x01
 		//
 		id::id_type create_geometry_resource(const void* const data)
 		{
@@ -224,11 +319,12 @@ namespace triengine::content {
 
 		void destroy_geometry_resource(id::id_type id)
 		{
-			std::lock_guard lock{ geometry_mutex };
 			u8* const pointer{ geometry_hierarchies[id] };
 			if ((uintptr_t)pointer & single_mesh_marker)
 			{
 				graphics::remove_submesh(gpu_id_from_fake_pointer(pointer));
+				single_mesh_bounds.remove(bounds_id_from_fake_pointer(pointer));
+				geometry_hierarchies.remove(id);
 			}
 			else
 			{
@@ -243,10 +339,9 @@ namespace triengine::content {
 					}
 				}
 
-				free(pointer);
+				// NOTE: the buffer is freed once no reader can be using it.
+				geometry_hierarchies.remove(id, pointer);
 			}
-
-			geometry_hierarchies.remove(id);
 		}
 
 		// NOTE: expects data to contain
@@ -323,50 +418,69 @@ namespace triengine::content {
 	id::id_type add_shader_group(const u8** shaders, u32 num_shaders, const u32* const keys)
 	{
 		assert(shaders && num_shaders && keys);
-		noexcept_map group;
+
+		// sort the shaders by key. When a key is given more than once, the last shader is used.
+		utl::vector<u32> order(num_shaders);
+		for (u32 i{ 0 }; i < num_shaders; ++i) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [keys](u32 a, u32 b) { return keys[a] < keys[b]; });
+		u32 shader_count{ 0 };
 		for (u32 i{ 0 }; i < num_shaders; ++i)
 		{
-			assert(shaders[i]);
-			const compiled_shader_ptr compiled_shader{ (const compiled_shader_ptr)shaders[i]};
-			const u64 size{ compiled_shader::buffer_size(compiled_shader->byte_code_size()) };
-			std::unique_ptr<u8[]> shader{ std::make_unique<u8[]>(size) };
-			memcpy(shader.get(), shaders[i], size);
-			group.map[keys[i]] = std::move(shader);
+			if (shader_count && keys[order[shader_count - 1]] == keys[order[i]]) order[shader_count - 1] = order[i];
+			else order[shader_count++] = order[i];
+		}
+
+		u64 size{ shader_group_stream::header_size(shader_count) };
+		for (u32 i{ 0 }; i < shader_count; ++i)
+		{
+			assert(shaders[order[i]]);
+			const compiled_shader_ptr compiled_shader{ (const compiled_shader_ptr)shaders[order[i]] };
+			size += math::align_size_up<sizeof(u64)>(compiled_shader::buffer_size(compiled_shader->byte_code_size()));
+		}
+
+		assert(size < u32_invalid_id);
+		u8* const buffer{ (u8* const)malloc(size) };
+		u32* const group_keys{ (u32*)&buffer[sizeof(u32)] };
+		u32* const offsets{ &group_keys[shader_count] };
+		*((u32*)buffer) = shader_count;
+		u32 offset{ shader_group_stream::header_size(shader_count) };
+		for (u32 i{ 0 }; i < shader_count; ++i)
+		{
+			const compiled_shader_ptr compiled_shader{ (const compiled_shader_ptr)shaders[order[i]] };
+			const u64 shader_size{ compiled_shader::buffer_size(compiled_shader->byte_code_size()) };
+			group_keys[i] = keys[order[i]];
+			offsets[i] = offset;
+			memcpy(&buffer[offset], compiled_shader, shader_size);
+			offset += (u32)math::align_size_up<sizeof(u64)>(shader_size);
 		}
-		
-		std::lock_guard lock{ shader_mutex };
-		return shader_groups.add(std::move(group));
+
+		return shader_groups.add(buffer);
 	}
 
 	void remove_shader_group(id::id_type id)
 	{
-		std::lock_guard lock{ shader_mutex };
 		assert(id::is_valid(id));
-
-		shader_groups[id].map.clear();
-		shader_groups.remove(id);
+		shader_groups.remove(id, shader_groups[id]);
 	}
 
 	compiled_shader_ptr get_shader(id::id_type id, u32 key)
 	{
-		std::lock_guard lock{ shader_mutex };
-		assert(id::is_valid(id));
-
-		for (const auto& [k, v] : shader_groups[id].map)
-		{
-			if (k == key)
-			{
-				return (const compiled_shader_ptr)v.get();
-			}
-		}
+		const compiled_shader_ptr shader{ find_shader(id, key) };
+		assert(shader); // should not be null
+		return shader;
+	}
 
-		assert(false); // should not reach here
-		return nullptr;
+	compiled_shader_ptr find_shader(id::id_type id, u32 key)
+	{
+		assert(id::is_valid(id));
+		// NOTE: the shader stays valid until its group is removed, so it can be used after the guard is gone.
+		utl::epoch::read_guard guard{};
+		return shader_group_stream{ shader_groups[id] }.find(key);
 	}
 
 	void get_submesh_gpu_ids(id::id_type geometry_content_id, u32 id_count, id::id_type* const gpu_ids)
 	{
-		std::lock_guard lock{ geometry_mutex };
+		utl::epoch::read_guard guard{};
 		u8* const pointer{ geometry_hierarchies[geometry_content_id] };
 		if ((uintptr_t)pointer & single_mesh_marker)
 		{
@@ -388,12 +502,90 @@ namespace triengine::content {
 		}
 	}
 
+	void get_geometry_bounds(id::id_type geometry_content_id, mesh_bounds& bounds)
+	{
+		utl::epoch::read_guard guard{};
+		u8* const pointer{ geometry_hierarchies[geometry_content_id] };
+		if ((uintptr_t)pointer & single_mesh_marker)
+		{
+			bounds = single_mesh_bounds[bounds_id_from_fake_pointer(pointer)];
+		}
+		else
+		{
+			bounds = *geometry_hierarchy_stream{ pointer }.bounds();
+		}
+	}
+
+	void get_lod_bounds(id::id_type geometry_content_id, u32 lod_count, mesh_bounds* const bounds)
+	{
+		assert(bounds && lod_count);
+		utl::epoch::read_guard guard{};
+		u8* const pointer{ geometry_hierarchies[geometry_content_id] };
+		if ((uintptr_t)pointer & single_mesh_marker)
+		{
+			assert(lod_count == 1);
+			*bounds = single_mesh_bounds[bounds_id_from_fake_pointer(pointer)];
+		}
+		else
+		{
+			geometry_hierarchy_stream stream{ pointer };
+			assert(lod_count == stream.lod_count());
+			memcpy(bounds, stream.lod_bounds(), sizeof(mesh_bounds) * lod_count);
+		}
+	}
+
+	void get_submesh_bounds(id::id_type geometry_content_id, u32 id_count, mesh_bounds* const bounds)
+	{
+		assert(bounds && id_count);
+		utl::epoch::read_guard guard{};
+		u8* const pointer{ geometry_hierarchies[geometry_content_id] };
+		if ((uintptr_t)pointer & single_mesh_marker)
+		{
+			assert(id_count == 1);
+			*bounds = single_mesh_bounds[bounds_id_from_fake_pointer(pointer)];
+		}
+		else
+		{
+			geometry_hierarchy_stream stream{ pointer };
+			assert(id_count == stream.submesh_count());
+			memcpy(bounds, stream.submesh_bounds(), sizeof(mesh_bounds) * id_count);
+		}
+	}
+
+	u32 get_lod_count(id::id_type geometry_content_id)
+	{
+		utl::epoch::read_guard guard{};
+		u8* const pointer{ geometry_hierarchies[geometry_content_id] };
+		if ((uintptr_t)pointer & single_mesh_marker) return 1;
+		return geometry_hierarchy_stream{ pointer }.lod_count();
+	}
+
+	void get_lods(id::id_type geometry_content_id, u32 lod_count, f32* const thresholds, lod_offsets* const offsets)
+	{
+		assert(thresholds && offsets && lod_count);
+		utl::epoch::read_guard guard{};
+		u8* const pointer{ geometry_hierarchies[geometry_content_id] };
+		if ((uintptr_t)pointer & single_mesh_marker)
+		{
+			assert(lod_count == 1);
+			*thresholds = 0.f;
+			*offsets = { 0, 1 };
+		}
+		else
+		{
+			geometry_hierarchy_stream stream{ pointer };
+			assert(lod_count == stream.lod_count());
+			memcpy(thresholds, stream.thresholds(), sizeof(f32) * lod_count);
+			memcpy(offsets, stream.lod_offsets(), sizeof(lod_offsets) * lod_count);
+		}
+	}
+
 	void get_lod_offset(const id::id_type* const geometry_ids, const f32* const thresholds, u32 id_count, utl::vector<lod_offsets>& offsets)
 	{
 		assert(geometry_ids && thresholds && id_count);
 		assert(offsets.empty());
 
-		std::lock_guard lock{ geometry_mutex };
+		utl::epoch::read_guard guard{};
 
 		for (u32 i{ 0 }; i < id_count; ++i)
 		{
@@ -37,13 +37,30 @@ namespace triengine::content {
 		u16 count;
 	};
 
+	// Axis aligned bounding box and bounding sphere, in model space.
+	struct mesh_bounds
+	{
+		math::v3 min;
+		math::v3 max;
+		math::v3 center;
+		f32 radius;
+	};
+
 	id::id_type create_resource(const void* const data, asset_type::type type);
 	void destroy_resource(id::id_type id, asset_type::type type);
 
 	id::id_type add_shader_group(const u8** shaders, u32 num_shaders, const u32 *const keys);
 	void remove_shader_group(id::id_type id);
 	compiled_shader_ptr get_shader(id::id_type id, u32 key);
+	// Same as get_shader(), but returns nullptr if the group has no shader for the key.
+	compiled_shader_ptr find_shader(id::id_type id, u32 key);
 
 	void get_submesh_gpu_ids(id::id_type geometry_content_id, u32 id_count, id::id_type* const gpu_ids);
+	void get_geometry_bounds(id::id_type geometry_content_id, mesh_bounds& bounds);
+	void get_lod_bounds(id::id_type geometry_content_id, u32 lod_count, mesh_bounds* const bounds);
+	void get_submesh_bounds(id::id_type geometry_content_id, u32 id_count, mesh_bounds* const bounds);
+	// Number of LODs of the geometry. get_lods() writes their thresholds and the range of submeshes in each LOD.
+	u32 get_lod_count(id::id_type geometry_content_id);
+	void get_lods(id::id_type geometry_content_id, u32 lod_count, f32* const thresholds, lod_offsets* const offsets);
 	void get_lod_offset(const id::id_type* const geometry_ids, const f32* const thresholds, u32 id_count, utl::vector<lod_offsets>& offsets);
 }
\ No newline at end of file
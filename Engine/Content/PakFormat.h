@@ -0,0 +1,129 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace triengine::content::pak {
+
+	// A .pak archive holds the content of a game in a single file, so loading doesn't pay a file open and a
+	// seek per asset. The content tools write it and the engine maps it into memory (see open_archive()).
+	//
+	// struct {
+	//     archive_header header,
+	//     entry entries[entry_count],
+	//     u32 table[table_size],	// index of the entry with the name hash, or u32_invalid_id. Linear probing.
+	//     u8 data[]				// each entry's data starts at a multiple of entry_alignment
+	// } archive;
+	//
+	// NOTE: entries with the same content share their data.
+
+	constexpr u32 magic{ 0x4b415054 };				// "TPAK"
+	constexpr u32 version{ 1 };
+	constexpr u64 entry_alignment{ 64 * 1024 };		// also the allocation granularity of file mappings on Windows
+
+	struct entry_flags {
+		enum flags : u32 {
+			none = 0x00,
+			compressed = 0x01,	// utl::lz_compress()
+		};
+	};
+
+	struct archive_header
+	{
+		u32 magic;
+		u32 version;
+		u32 entry_count;
+		u32 table_size;			// a power of 2
+		u64 size;				// of the whole archive
+	};
+
+	struct entry
+	{
+		u64 name_hash;
+		u64 content_hash;		// of the uncompressed data, checked when compressed entries are read
+		u64 offset;				// from the start of the archive
+		u64 stored_size;		// size in the archive
+		u64 size;				// uncompressed size
+		u32 type;				// asset_type::type
+		u32 flags;
+	};
+
+	static_assert(sizeof(archive_header) == 24 && sizeof(entry) == 48);
+
+	// FNV-1a.
+	[[nodiscard]] constexpr u64 hash(const u8* const data, u64 size)
+	{
+		u64 h{ 0xcbf29ce484222325ull };
+		for (u64 i{ 0 }; i < size; ++i)
+		{
+			h = (h ^ data[i]) * 0x100000001b3ull;
+		}
+		return h;
+	}
+
+	// Names are paths relative to the game's folder. They're not case sensitive, both slashes are the same,
+	// and a leading ".\" is ignored, so "Shaders/D3D12/shaders.bin" and ".\shaders\d3d12\shaders.bin" are the same.
+	[[nodiscard]] constexpr u64 hash_name(const char* name)
+	{
+		assert(name);
+		if (name[0] == '.' && (name[1] == '\\' || name[1] == '/')) name += 2;
+		u64 h{ 0xcbf29ce484222325ull };
+		for (; *name; ++name)
+		{
+			char c{ *name };
+			if (c == '/') c = '\\';
+			else if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+			h = (h ^ (u8)c) * 0x100000001b3ull;
+		}
+		return h;
+	}
+
+	[[nodiscard]] constexpr u64 table_offset(u32 entry_count)
+	{
+		return sizeof(archive_header) + sizeof(entry) * entry_count;
+	}
+
+	// Returns nullptr if the archive has no entry with the name hash.
+	// NOTE: expects an archive that was validated (see is_valid()).
+	[[nodiscard]] inline const entry* find_entry(const u8* const archive, u64 name_hash)
+	{
+		assert(archive);
+		const archive_header& header{ *(const archive_header*)archive };
+		const entry* const entries{ (const entry*)&archive[sizeof(archive_header)] };
+		const u32* const table{ (const u32*)&archive[table_offset(header.entry_count)] };
+		const u32 mask{ header.table_size - 1 };
+
+		for (u32 i{ (u32)name_hash & mask }, probes{ 0 }; probes < header.table_size; i = (i + 1) & mask, ++probes)
+		{
+			const u32 index{ table[i] };
+			if (index == u32_invalid_id) return nullptr;
+			if (entries[index].name_hash == name_hash) return &entries[index];
+		}
+
+		return nullptr;
+	}
+
+	// Checks that the header, the table and every entry fit in 'size' bytes.
+	[[nodiscard]] inline bool is_valid(const u8* const archive, u64 size)
+	{
+		if (!archive || size < sizeof(archive_header)) return false;
+		const archive_header& header{ *(const archive_header*)archive };
+		if (header.magic != magic || header.version != version || header.size != size) return false;
+		if (!header.table_size || (header.table_size & (header.table_size - 1)) || header.table_size <= header.entry_count) return false;
+		if (table_offset(header.entry_count) + sizeof(u32) * (u64)header.table_size > size) return false;
+
+		const entry* const entries{ (const entry*)&archive[sizeof(archive_header)] };
+		const u32* const table{ (const u32*)&archive[table_offset(header.entry_count)] };
+		for (u32 i{ 0 }; i < header.table_size; ++i)
+		{
+			if (table[i] != u32_invalid_id && table[i] >= header.entry_count) return false;
+		}
+
+		for (u32 i{ 0 }; i < header.entry_count; ++i)
+		{
+			const entry& e{ entries[i] };
+			if (e.offset % entry_alignment || e.offset > size || e.stored_size > size - e.offset) return false;
+			if (!(e.flags & entry_flags::compressed) && e.stored_size != e.size) return false;
+		}
+
+		return true;
+	}
+}
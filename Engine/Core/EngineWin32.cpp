@@ -38,6 +38,8 @@ namespace {
 }
 
 bool engine_initialize() {
+	// NOTE: packed games read their content from game.pak. Without it, content is read from loose files.
+	triengine::content::open_archive("game.pak");
 	if (!triengine::content::load_game()) return false;
 
 	platform::window_init_info info{
@@ -56,6 +58,7 @@ void engine_update() {
 void engine_shutdown() {
 	platform::remove_window(game_window.window.get_id());
 	triengine::content::unload_game();
+	triengine::content::close_archive();
 }
 
 #endif // !defined(SHIPPING)
\ No newline at end of file
@@ -1,9 +1,17 @@
 #include "D3D12Content.h"
 #include "D3D12Core.h"
 #include "D3D12Helpers.h"
+#include "D3D12Upload.h"
+#include "D3D12Memory.h"
 #include "Utilities/IOStream.h"
+#include "Utilities/MeshCodec.h"
 #include "Content/ContentToEngine.h"
 #include "D3D12GPass.h"
+#include "Shaders/SharedTypes.h"
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
 
 namespace triengine::graphics::d3d12::content {
 	namespace {
@@ -18,18 +26,114 @@ namespace triengine::graphics::d3d12::content {
 			D3D12_INDEX_BUFFER_VIEW index_buffer_view{};
 			D3D_PRIMITIVE_TOPOLOGY primitive_topology{};
 			u32 element_type{};
+			upload::upload_ticket upload{};	// copy of the vertex and index data
 		};
 
 		struct d3d12_render_item
 		{
 			id::id_type item_id;
-			id::id_type submesh_gpu_ids;
-			id::id_type material_id;
-			id::id_type pso_id;
-			id::id_type depth_pso_id;
+			u32 slot; // index in the draw database
+		};
+
+		// A render item has a d3d12 render item for each submesh of each LOD of its geometry.
+		// NOTE: LOD thresholds are copied from the geometry, so LODs can be selected without locking the content.
+		struct d3d12_render_item_group
+		{
+			utl::vector<f32> thresholds;
+			utl::vector<triengine::content::lod_offsets> lod_offsets;
+			utl::vector<id::id_type> item_ids;
+			triengine::content::mesh_bounds bounds;	// of the whole geometry
+			id::id_type entity_id;
+			u32 lod;								// LOD selected last frame
+		};
+
+		// NOTE: a LOD is only left once the metric is this much past its thresholds, so items near
+		//       a threshold don't switch back and forth.
+		constexpr f32 lod_hysteresis{ 0.1f };
+
+		// Everything needed to draw the d3d12 render items, stored as arrays that are indexed by the items' slots.
+		// Items are added and removed when render items are, so frames only gather the slots they draw.
+		// NOTE: removed items keep their slot until compact(), which moves the last items to the removed slots. It's only
+		//       called when a frame starts gathering slots, so the slots of a frame stay valid while it's prepared.
+		class draw_database
+		{
+		public:
+			utl::vector<id::id_type> render_item_ids;
+			utl::vector<id::id_type> entity_ids;
+			utl::vector<id::id_type> submesh_gpu_ids;
+			utl::vector<id::id_type> material_ids;
+			utl::vector<pso_id> pso_ids;
+			utl::vector<ID3D12PipelineState*> gpass_psos;	// null until the PSO is compiled
+			utl::vector<ID3D12PipelineState*> depth_psos;
+			utl::vector<ID3D12RootSignature*> root_signatures;
+			utl::vector<material_type::type> material_types;
+			utl::vector<D3D12_GPU_VIRTUAL_ADDRESS> position_buffers;
+			utl::vector<D3D12_GPU_VIRTUAL_ADDRESS> element_buffers;
+			utl::vector<D3D12_INDEX_BUFFER_VIEW> index_buffer_views;
+			utl::vector<D3D_PRIMITIVE_TOPOLOGY> primitive_topologies;
+			utl::vector<u32> elements_types;
+			utl::vector<triengine::content::mesh_bounds> bounds;
+			utl::vector<u64> sort_keys; // without the depth field
+			utl::vector<upload::upload_ticket> uploads; // of the submesh, reset once the copy is done
+
+			[[nodiscard]] u32 add()
+			{
+				const u32 slot{ size() };
+				for_each_array([](auto& array) { array.emplace_back(); });
+				return slot;
+			}
+
+			void remove(u32 slot)
+			{
+				assert(slot < size() && id::is_valid(render_item_ids[slot]));
+				render_item_ids[slot] = id::invalid_id;
+				_removed_slots.emplace_back(slot);
+			}
+
+			// Fills the slots of removed items with the last items. Calls 'moved(item_id, slot)' for each item that moved.
+			template<typename F>
+			void compact(F&& moved)
+			{
+				// NOTE: going from the last removed slot down, the last item is never one that was removed.
+				std::sort(_removed_slots.begin(), _removed_slots.end(), std::greater<u32>{});
+				for (const u32 slot : _removed_slots)
+				{
+					for_each_array([slot](auto& array) { utl::erase_unordered(array, slot); });
+					if (slot < size()) moved(render_item_ids[slot], slot);
+				}
+
+				_removed_slots.clear();
+			}
+
+			[[nodiscard]] u32 size() const { return (u32)render_item_ids.size(); }
+
+		private:
+			template<typename F>
+			void for_each_array(F&& func)
+			{
+				func(render_item_ids);
+				func(entity_ids);
+				func(submesh_gpu_ids);
+				func(material_ids);
+				func(pso_ids);
+				func(gpass_psos);
+				func(depth_psos);
+				func(root_signatures);
+				func(material_types);
+				func(position_buffers);
+				func(element_buffers);
+				func(index_buffer_views);
+				func(primitive_topologies);
+				func(elements_types);
+				func(bounds);
+				func(sort_keys);
+				func(uploads);
+			}
+
+			utl::vector<u32> _removed_slots;
 		};
 
-		utl::free_list<ID3D12Resource*> submesh_buffers{};
+		utl::free_list<memory::gpu_allocation> submesh_buffers{};
 		utl::free_list<submesh_view> submesh_views{};
 		std::mutex submesh_mutex{};
 
@@ -42,17 +146,132 @@ namespace triengine::graphics::d3d12::content {
 		std::mutex material_mutex{};
 
 		utl::free_list<d3d12_render_item> render_items;
-		utl::free_list<std::unique_ptr<id::id_type[]>> render_item_ids;
+		utl::free_list<d3d12_render_item_group> render_item_groups;
+		draw_database draws;
 		std::mutex render_item_mutex{};
 
 		utl::vector<ID3D12PipelineState*> pipeline_states;
 		std::unordered_map<u64, id::id_type> pso_map;
 		std::mutex pso_mutex{};
 
-		struct {
-			utl::vector<triengine::content::lod_offsets> lod_offsets;
-			utl::vector<id::id_type> geometry_ids;
-		} frame_cache;
+		// PSOs are created by background threads. Until then their entry in pipeline_states is null and
+		// draws that use them are skipped. Jobs for draws are done before precompiles.
+		struct pso_priority {
+			enum type : u32 {
+				precompile,
+				draw,
+
+				count
+			};
+		};
+
+		struct pso_job
+		{
+			std::unique_ptr<u8[]> stream;
+			u64 stream_size;
+			u64 key;
+			id::id_type pso_id;
+			id::id_type material_id;
+			bool is_depth;
+		};
+
+		constexpr u32 max_pso_compilers{ 4 };
+		std::deque<pso_job> pso_jobs[pso_priority::count];
+		std::thread pso_compilers[max_pso_compilers];
+		id::id_type compiling_materials[max_pso_compilers]{};
+		u32 pso_compiler_count{ 0 };
+		bool stop_pso_compilers{ false };
+		std::condition_variable pso_job_added{};
+		std::condition_variable pso_job_done{};
+		pso_compile_stats pso_stats{};
+
+		// Elements types and topologies of the submeshes that were loaded, and the loaded materials.
+		// PSOs are precompiled for every combination when a new one is loaded.
+		struct pso_variant
+		{
+			u32 elements_type;
+			D3D_PRIMITIVE_TOPOLOGY primitive_topology;
+		};
+
+		utl::vector<pso_variant> pso_variants;
+		utl::vector<id::id_type> loaded_materials;
+		std::mutex pso_variant_mutex{};
+
+		// NOTE: the functions below are called with pso_mutex locked, apart from pso_compiler_loop().
+		void raise_pso_priority(id::id_type pso_id)
+		{
+			std::deque<pso_job>& jobs{ pso_jobs[pso_priority::precompile] };
+			for (auto it{ jobs.begin() }; it != jobs.end(); ++it)
+			{
+				if (it->pso_id == pso_id)
+				{
+					pso_jobs[pso_priority::draw].emplace_back(std::move(*it));
+					jobs.erase(it);
+					return;
+				}
+			}
+		}
+
+		[[nodiscard]] bool has_pso_jobs(id::id_type material_id)
+		{
+			for (u32 i{ 0 }; i < pso_priority::count; ++i)
+			{
+				for (const pso_job& job : pso_jobs[i])
+				{
+					if (job.material_id == material_id) return true;
+				}
+			}
+
+			for (u32 i{ 0 }; i < pso_compiler_count; ++i)
+			{
+				if (compiling_materials[i] == material_id) return true;
+			}
+
+			return false;
+		}
+
+		void pso_compiler_loop(u32 index)
+		{
+			std::unique_lock lock{ pso_mutex };
+			while (true)
+			{
+				pso_job_added.wait(lock, [] {
+					return stop_pso_compilers || !pso_jobs[pso_priority::draw].empty() || !pso_jobs[pso_priority::precompile].empty();
+				});
+				if (stop_pso_compilers) return;
+
+				std::deque<pso_job>& jobs{ pso_jobs[pso_jobs[pso_priority::draw].empty() ? pso_priority::precompile : pso_priority::draw] };
+				const pso_job job{ std::move(jobs.front()) };
+				jobs.pop_front();
+				compiling_materials[index] = job.material_id;
+				lock.unlock();
+
+				const auto start{ std::chrono::steady_clock::now() };
+				ID3D12PipelineState* const pso{ d3dx::create_pipeline_state(job.stream.get(), job.stream_size) };
+				const f32 compile_ms{ std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count() };
+				if (pso)
+				{
+					NAME_D3D12_OBJECT_INDEXED(pso, job.key, job.is_depth ? L"Depth-Only PSO - key" : L"GPass PSO - key");
+				}
+
+				lock.lock();
+				pipeline_states[job.pso_id] = pso;
+				compiling_materials[index] = id::invalid_id;
+				--pso_stats.pending;
+				if (pso)
+				{
+					++pso_stats.compiled;
+					pso_stats.total_ms += compile_ms;
+					pso_stats.max_ms = std::max(pso_stats.max_ms, compile_ms);
+				}
+				else
+				{
+					++pso_stats.failed;
+				}
+
+				pso_job_done.notify_all();
+			}
+		}
 
 		id::id_type create_root_signature(material_type::type type, shader_flags::flags flags);
 
@@ -261,7 +480,8 @@ namespace triengine::graphics::d3d12::content {
 				parameters[params::position_buffer].as_srv(buffer_visibility, 0);
 				parameters[params::element_buffer].as_srv(buffer_visibility, 1);
 				parameters[params::srv_indices].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 2);
-				parameters[params::per_object_data].as_cbv(data_visibility, 1);
+				parameters[params::per_object_data].as_srv(data_visibility, 3);
+				parameters[params::object_indices].as_srv(data_visibility, 4);
 
 				root_signature = d3dx::d3d12_root_signature_desc{ &parameters[0], _countof(parameters), get_root_signature_flags(flags) }.create();
 			}
@@ -277,34 +497,29 @@ namespace triengine::graphics::d3d12::content {
 		}
 	}
 
-	id::id_type create_pso_if_needed(const u8* const stream_ptr, u64 aligned_stream_size, [[maybe_unused]] bool is_depth)
+	id::id_type create_pso_if_needed(const u8* const stream_ptr, u64 aligned_stream_size, bool is_depth, id::id_type material_id, pso_priority::type priority)
 	{
 		const u64 key{ math::calc_crc32_u64(stream_ptr, aligned_stream_size) };
-		{
-			std::lock_guard lock{ pso_mutex };
-			auto pair = pso_map.find(key);
-
-			if (pair != pso_map.end())
-			{
-				assert(pair->first == key);
-				return pair->second;
-			}
-		}
-
-
-		d3dx::d3d12_pipeline_state_subobject_stream* const stream{ (d3dx::d3d12_pipeline_state_subobject_stream* const)stream_ptr };
-		ID3D12PipelineState* pso{ d3dx::create_pipeline_state(stream, aligned_stream_size) };
+		std::lock_guard lock{ pso_mutex };
+		auto pair = pso_map.find(key);
 
+		if (pair != pso_map.end())
 		{
-			std::lock_guard lock{ pso_mutex };
-			const id::id_type id{ (u32)pipeline_states.size() };
-			pipeline_states.emplace_back(pso);
+			assert(pair->first == key);
+			if (priority == pso_priority::draw && !pipeline_states[pair->second]) raise_pso_priority(pair->second);
+			return pair->second;
+		}
 
-			NAME_D3D12_OBJECT_INDEXED(pipeline_states.back(), key, is_depth ? L"Depth-Only PSO - key" : L"GPass PSO - key");
+		const id::id_type id{ (u32)pipeline_states.size() };
+		pipeline_states.emplace_back(nullptr);
+		pso_map[key] = id;
 
-			pso_map[key] = id;
-			return id;
-		}
+		pso_job job{ std::make_unique<u8[]>(aligned_stream_size), aligned_stream_size, key, id, material_id, is_depth };
+		memcpy(job.stream.get(), stream_ptr, aligned_stream_size);
+		pso_jobs[priority].emplace_back(std::move(job));
+		++pso_stats.pending;
+		pso_job_added.notify_one();
+		return id;
 	}
 
 #pragma intrinsic(_BitScanForward)
@@ -316,7 +531,8 @@ namespace triengine::graphics::d3d12::content {
 		return (shader_type::type)index;
 	}
 
-	pso_id create_pso(id::id_type material_id, D3D12_PRIMITIVE_TOPOLOGY primitive_topology, u32 elements_type)
+	// NOTE: returns invalid ids if the material has no shaders for the elements type.
+	pso_id create_pso(id::id_type material_id, D3D12_PRIMITIVE_TOPOLOGY primitive_topology, u32 elements_type, pso_priority::type priority)
 	{
 		constexpr u64 aligned_stream_size{ math::align_size_up<sizeof(u64)>(sizeof(d3dx::d3d12_pipeline_state_subobject_stream)) };
 		u8* const stream_ptr{ (u8* const)alloca(aligned_stream_size) };
@@ -325,6 +541,7 @@ namespace triengine::graphics::d3d12::content {
 
 		d3dx::d3d12_pipeline_state_subobject_stream& stream{ *(d3dx::d3d12_pipeline_state_subobject_stream* const)stream_ptr };
 
+		bool has_shaders{ true };
 		{
 			std::lock_guard lock{ material_mutex };
 			const d3d12_material_stream material{ materials[material_id].get() };
@@ -348,8 +565,13 @@ namespace triengine::graphics::d3d12::content {
 				if (flags & (1 << i))
 				{
 					const u32 key{ get_shader_type(flags & (1 << i)) == shader_type::vertex ? elements_type : u32_invalid_id };
-					triengine::content::compiled_shader_ptr shader{ triengine::content::get_shader(material.shader_ids()[shader_index], key) };
-					assert(shader);
+					triengine::content::compiled_shader_ptr shader{ triengine::content::find_shader(material.shader_ids()[shader_index], key) };
+					if (!shader)
+					{
+						has_shaders = false;
+						break;
+					}
+
 					shaders[i].pShaderBytecode = shader->byte_code();
 					shaders[i].BytecodeLength = shader->byte_code_size();
 					++shader_index;
@@ -367,22 +589,110 @@ namespace triengine::graphics::d3d12::content {
 		}
 
 		pso_id id_pair{};
-		id_pair.gpass_pso_id = create_pso_if_needed(stream_ptr, aligned_stream_size, false);
+		if (!has_shaders)
+		{
+			if (priority == pso_priority::draw)
+			{
+				std::lock_guard lock{ pso_mutex };
+				++pso_stats.missing_shaders;
+			}
+
+			return id_pair;
+		}
+
+		id_pair.gpass_pso_id = create_pso_if_needed(stream_ptr, aligned_stream_size, false, material_id, priority);
 
 		stream.ps = D3D12_SHADER_BYTECODE{};
 		stream.depth_stencil1 = d3dx::depth_state.reversed;
-		id_pair.depth_pso_id = create_pso_if_needed(stream_ptr, aligned_stream_size, true);
+		id_pair.depth_pso_id = create_pso_if_needed(stream_ptr, aligned_stream_size, true, material_id, priority);
 
 		return id_pair;
 	}
 
+	void precompile_psos(id::id_type material_id)
+	{
+		std::lock_guard lock{ pso_variant_mutex };
+		loaded_materials.emplace_back(material_id);
+		for (const pso_variant& variant : pso_variants)
+		{
+			create_pso(material_id, variant.primitive_topology, variant.elements_type, pso_priority::precompile);
+		}
+	}
+
+	void precompile_psos(u32 elements_type, D3D_PRIMITIVE_TOPOLOGY primitive_topology)
+	{
+		std::lock_guard lock{ pso_variant_mutex };
+		for (const pso_variant& variant : pso_variants)
+		{
+			if (variant.elements_type == elements_type && variant.primitive_topology == primitive_topology) return;
+		}
+
+		pso_variants.emplace_back(pso_variant{ elements_type, primitive_topology });
+		for (const id::id_type material_id : loaded_materials)
+		{
+			create_pso(material_id, primitive_topology, elements_type, pso_priority::precompile);
+		}
+	}
+
+	// Waits until the material's PSOs are created, because their jobs read its shaders.
+	void finish_pso_jobs(id::id_type material_id)
+	{
+		std::unique_lock lock{ pso_mutex };
+		std::deque<pso_job>& jobs{ pso_jobs[pso_priority::precompile] };
+		for (u32 i{ 0 }; i < jobs.size();)
+		{
+			if (jobs[i].material_id == material_id)
+			{
+				pso_jobs[pso_priority::draw].emplace_back(std::move(jobs[i]));
+				jobs.erase(jobs.begin() + i);
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		pso_job_added.notify_all();
+		pso_job_done.wait(lock, [material_id] { return !has_pso_jobs(material_id); });
+	}
+
 	bool initialize()
 	{
+		const u32 hw_threads{ std::thread::hardware_concurrency() };
+		pso_compiler_count = std::clamp(hw_threads / 2, 1u, max_pso_compilers);
+		stop_pso_compilers = false;
+		for (u32 i{ 0 }; i < pso_compiler_count; ++i)
+		{
+			compiling_materials[i] = id::invalid_id;
+			pso_compilers[i] = std::thread{ pso_compiler_loop, i };
+		}
+
 		return true;
 	}
 
 	void shutdown()
 	{
+		{
+			std::lock_guard lock{ pso_mutex };
+			stop_pso_compilers = true;
+		}
+
+		pso_job_added.notify_all();
+		for (u32 i{ 0 }; i < pso_compiler_count; ++i)
+		{
+			pso_compilers[i].join();
+		}
+
+		pso_compiler_count = 0;
+		for (u32 i{ 0 }; i < pso_priority::count; ++i)
+		{
+			pso_jobs[i].clear();
+		}
+
+		pso_stats = {};
+		pso_variants.clear();
+		loaded_materials.clear();
+
 		for (auto& item : root_signatures)
 		{
 			core::release(item);
@@ -400,15 +710,31 @@ namespace triengine::graphics::d3d12::content {
 		pipeline_states.clear();
 	}
 
+	pso_compile_stats get_pso_compile_stats()
+	{
+		std::lock_guard lock{ pso_mutex };
+		return pso_stats;
+	}
+
 	namespace submesh {
 		// NOTE: Expects 'data' to contain:
 		//     u32 element_size, u32 vertex_count,
-		//     u32 index_count, u32 elements_type, u32 primitive_topology
-		//     u8 positions[sizeof(f32) * 3 * vertex_count],
+		//     u32 index_count, u32 elements_type, u32 primitive_topology,
+		//     u32 encoding,
+		//     f32 position_offset[3], f32 position_scale[3] (only if encoding has submesh_encoding::quantized_positions)
+		//     u8 positions[sizeof(f32) * 3 * vertex_count] (or sizeof(u16) * 3 * vertex_count if quantized),
 		//     u8 elements[sizeof(element_size) * index_count],
 		//     u8 indices[index_size * index_count]
+		//
+		// If encoding has submesh_encoding::compressed_streams, positions, elements and indices are replaced by:
+		//     u32 position_stream_size, u32 element_stream_size, u32 index_stream_size,
+		//     u8 position_stream[position_stream_size],
+		//     u8 element_stream[element_stream_size],
+		//     u8 index_stream[index_stream_size]
 		// Remarks:
 		// - Advances the data pointer
+		// - Quantized positions are preceded by their dequantization parameters in the GPU buffer
+		//   (see hlsl::PositionDequantization).
 		id::id_type add(const u8*& data)
 		{
 			utl::blob_stream_reader blob{ (const u8*)data };
@@ -418,10 +744,21 @@ namespace triengine::graphics::d3d12::content {
 			const u32 index_count{ blob.read<u32>() };
 			const u32 elements_type{ blob.read<u32>() };
 			const u32 primitive_topology{ blob.read<u32>() };
+			const u32 encoding{ blob.read<u32>() };
 			const u32 index_size{ (u32) (vertex_count < 1 << 16 ? sizeof(u16) : sizeof(u32)) };
 
+			const bool is_quantized{ (encoding & submesh_encoding::quantized_positions) != 0 };
+			hlsl::PositionDequantization dequantization{};
+			if (is_quantized)
+			{
+				blob.read((u8*)&dequantization.Offset, sizeof(math::v3));
+				blob.read((u8*)&dequantization.Scale, sizeof(math::v3));
+			}
+
 			// NOTE: element size maybe be 0, for position-only vertex formats.
-			const u32 position_buffer_size{ (u32)(sizeof(math::v3) * vertex_count) };
+			const u32 position_header_size{ is_quantized ? (u32)sizeof(hlsl::PositionDequantization) : 0 };
+			const u32 position_size{ is_quantized ? (u32)sizeof(u16) * 3 : (u32)sizeof(math::v3) };
+			const u32 position_buffer_size{ position_header_size + position_size * vertex_count };
 			const u32 element_buffer_size{ element_size * vertex_count };
 			const u32 index_buffer_size{ index_size * index_count };
 
@@ -430,32 +767,86 @@ namespace triengine::graphics::d3d12::content {
 			const u32 aligned_element_buffer_size{ (u32)math::align_size_up<alignment>(element_buffer_size) };
 			const u32 total_buffer_size{ aligned_position_buffer_size + aligned_element_buffer_size + index_buffer_size };
 
-			ID3D12Resource* resource{ d3dx::create_buffer(blob.position(), total_buffer_size) };
+			memory::gpu_allocation buffer{ memory::allocate(total_buffer_size, alignment, memory::category::geometry) };
+			assert(buffer.is_valid());
+			submesh_view view{};
+			bool is_decoded{ true };
+			{
+				upload::d3d12_upload_context context{ total_buffer_size };
+				u8* const cpu_address{ (u8* const)context.cpu_address() };
+				u8* const positions{ cpu_address + position_header_size };
+				u8* const elements{ cpu_address + aligned_position_buffer_size };
+				u8* const indices{ elements + aligned_element_buffer_size };
+
+				if (is_quantized)
+				{
+					memcpy(cpu_address, &dequantization, sizeof(hlsl::PositionDequantization));
+				}
+
+				if (encoding & submesh_encoding::compressed_streams)
+				{
+					const u32 position_stream_size{ blob.read<u32>() };
+					const u32 element_stream_size{ blob.read<u32>() };
+					const u32 index_stream_size{ blob.read<u32>() };
+					const u8* const position_stream{ blob.position() };
+					const u8* const element_stream{ position_stream + position_stream_size };
+					const u8* const index_stream{ element_stream + element_stream_size };
+
+					// Decode straight into the upload buffer instead of decompressing to a temporary copy first.
+					is_decoded = utl::decode_vertex_stream(positions, vertex_count, position_size, position_stream, position_stream_size) &&
+						(!element_size || utl::decode_vertex_stream(elements, vertex_count, element_size, element_stream, element_stream_size)) &&
+						utl::decode_index_stream(indices, index_count, index_size, index_stream, index_stream_size);
+
+					blob.skip(position_stream_size + element_stream_size + index_stream_size);
+				}
+				else
+				{
+					// NOTE: the blob has the same layout as the GPU buffer, minus the dequantization header.
+					const u32 data_size{ total_buffer_size - position_header_size };
+					memcpy(positions, blob.position(), data_size);
+					blob.skip(data_size);
+				}
+
+				// NOTE: the context is ended even if nothing is copied, so its space in the upload ring is given back.
+				if (is_decoded)
+				{
+					context.command_list()->CopyBufferRegion(buffer.buffer, buffer.offset, context.upload_buffer(), context.upload_offset(), total_buffer_size);
+				}
+				// NOTE: the copy may not be submitted yet, so draws of the submesh wait for the ticket (see is_ready()).
+				view.upload = context.end_upload();
+			}
 
-			blob.skip(total_buffer_size);
 			data = blob.position();
 
-			submesh_view view{};
-			view.position_buffer_view.BufferLocation = resource->GetGPUVirtualAddress();
+			// corrupt or truncated streams fail the submesh instead of uploading garbage.
+			if (!is_decoded)
+			{
+				memory::deferred_free(buffer);
+				return id::invalid_id;
+			}
+
+			view.position_buffer_view.BufferLocation = buffer.gpu_address;
 			view.position_buffer_view.SizeInBytes = position_buffer_size;
-			view.position_buffer_view.StrideInBytes = sizeof(math::v3);
+			view.position_buffer_view.StrideInBytes = position_size;
 
 			if (element_size)
 			{
-				view.elements_buffer_view.BufferLocation = resource->GetGPUVirtualAddress() + aligned_position_buffer_size;
+				view.elements_buffer_view.BufferLocation = buffer.gpu_address + aligned_position_buffer_size;
 				view.elements_buffer_view.SizeInBytes = element_buffer_size;
 				view.elements_buffer_view.StrideInBytes = element_size;
 			}
 
-			view.index_buffer_view.BufferLocation = resource->GetGPUVirtualAddress() + aligned_position_buffer_size + aligned_element_buffer_size;
+			view.index_buffer_view.BufferLocation = buffer.gpu_address + aligned_position_buffer_size + aligned_element_buffer_size;
 			view.index_buffer_view.Format = (index_size == sizeof(u16)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 			view.index_buffer_view.SizeInBytes = index_buffer_size;
 
-			view.element_type = elements_type;
+			view.element_type = is_quantized ? elements_type | quantized_positions_shader_key : elements_type;
 			view.primitive_topology = get_d3d_primitive_topology((primitive_topology::type)primitive_topology);
 
+			precompile_psos(view.element_type, view.primitive_topology);
+
 			std::lock_guard lock{ submesh_mutex };
-			submesh_buffers.add(resource);
+			submesh_buffers.add(buffer);
 
 			return submesh_views.add(view);
 		}
@@ -465,7 +856,7 @@ namespace triengine::graphics::d3d12::content {
 			std::lock_guard lock{ submesh_mutex };
 			submesh_views.remove(id);
 
-			core::deferred_release(submesh_buffers[id]);
+			memory::deferred_free(submesh_buffers[id]);
 			submesh_buffers.remove(id);
 		}
 
@@ -523,35 +914,108 @@ namespace triengine::graphics::d3d12::content {
 		// } d3d12_material;
 		id::id_type add(material_init_info info)
 		{
-			std::unique_ptr<u8[]> buffer;
-			std::lock_guard lock{ material_mutex };
-			d3d12_material_stream stream{ buffer, info };
-			assert(buffer);
-			return materials.add(std::move(buffer));
+			id::id_type id{ id::invalid_id };
+			{
+				std::unique_ptr<u8[]> buffer;
+				std::lock_guard lock{ material_mutex };
+				d3d12_material_stream stream{ buffer, info };
+				assert(buffer);
+				id = materials.add(std::move(buffer));
+			}
+
+			precompile_psos(id);
+			return id;
 		}
 
 		void remove(id::id_type id)
 		{
+			{
+				std::lock_guard lock{ pso_variant_mutex };
+				for (u32 i{ 0 }; i < loaded_materials.size(); ++i)
+				{
+					if (loaded_materials[i] == id)
+					{
+						utl::erase_unordered(loaded_materials, i);
+						break;
+					}
+				}
+			}
+
+			finish_pso_jobs(id);
+
 			std::lock_guard lock{ material_mutex };
 			materials.remove(id);
 		}
+	}
 
-		void get_materials(const id::id_type* const material_ids, u32 material_count, const materials_cache& cache)
-		{
-			assert(material_ids && material_count);
-			assert(cache.root_signatures && cache.material_types);
+	namespace render_item {
+		namespace {
+			u64 make_sort_key(material_type::type type, id::id_type root_signature_id, id::id_type pso_id, id::id_type material_id, id::id_type submesh_gpu_id)
+			{
+				// NOTE: draws without PSOs are never drawn, so they only need a key that's in range.
+				if (!id::is_valid(pso_id)) pso_id = 0;
+
+				constexpr u64 submesh_mask{ (1ull << sort_key::submesh_bits) - 1 };
+				constexpr u64 material_mask{ (1ull << sort_key::material_bits) - 1 };
+				constexpr u64 pso_mask{ (1ull << sort_key::pso_bits) - 1 };
+				constexpr u64 root_signature_mask{ (1ull << sort_key::root_signature_bits) - 1 };
+				constexpr u64 pass_mask{ (1ull << sort_key::pass_bits) - 1 };
+
+				return
+					(((u64)type & pass_mask) << sort_key::pass_shift) |
+					(((u64)root_signature_id & root_signature_mask) << sort_key::root_signature_shift) |
+					(((u64)pso_id & pso_mask) << sort_key::pso_shift) |
+					(((u64)material_id & material_mask) << sort_key::material_shift) |
+					(((u64)submesh_gpu_id & submesh_mask) << sort_key::submesh_shift);
+			}
 
-			std::lock_guard lock{ material_mutex };
-			for (u32 i{ 0 }; i < material_count; ++i)
+			u32 lod_from_threshold(const d3d12_render_item_group& group, f32 threshold)
 			{
-				const d3d12_material_stream stream{ materials[material_ids[i]].get() };
-				cache.root_signatures[i] = root_signatures[stream.root_signature_id()];
-				cache.material_types[i] = stream.material_type();
+				const u32 lod_count{ (u32)group.thresholds.size() };
+				if (lod_count == 1) return 0;
+
+				for (u32 i{ lod_count - 1 }; i > 0; --i)
+				{
+					if (group.thresholds[i] <= threshold) return i;
+				}
+
+				return 0;
 			}
-		}
-	}
 
-	namespace render_item {
+			u32 lod_from_metric(d3d12_render_item_group& group, f32 metric)
+			{
+				const u32 lod_count{ (u32)group.thresholds.size() };
+				u32 lod{ std::min(group.lod, lod_count - 1) };
+				while (lod + 1 < lod_count && metric >= group.thresholds[lod + 1] * (1.f + lod_hysteresis)) ++lod;
+				while (lod > 0 && metric < group.thresholds[lod] * (1.f - lod_hysteresis)) --lod;
+				group.lod = lod;
+				return lod;
+			}
+
+			// Picks up the PSOs of a draw once they're compiled. Returns false until the submesh is uploaded and
+			// both PSOs are ready, and always for draws without PSOs (see create_pso()).
+			// NOTE: called with render_item_mutex locked.
+			bool is_ready(u32 slot)
+			{
+				upload::upload_ticket& upload{ draws.uploads[slot] };
+				if (upload.fence_value)
+				{
+					if (!upload::is_complete(upload)) return false;
+					upload = {};
+				}
+
+				if (draws.gpass_psos[slot] && draws.depth_psos[slot]) return true;
+
+				const pso_id& ids{ draws.pso_ids[slot] };
+				if (!id::is_valid(ids.gpass_pso_id) || !id::is_valid(ids.depth_pso_id)) return false;
+
+				std::lock_guard lock{ pso_mutex };
+				draws.gpass_psos[slot] = pipeline_states[ids.gpass_pso_id];
+				draws.depth_psos[slot] = pipeline_states[ids.depth_pso_id];
+				return draws.gpass_psos[slot] && draws.depth_psos[slot];
+			}
+		} // anonymous namespace
+
 		id::id_type add(id::id_type item_id, id::id_type geometry_content_id, u32 material_count, const id::id_type* const material_ids)
 		{
 			assert(id::is_valid(item_id) && id::is_valid(geometry_content_id));
@@ -570,104 +1034,197 @@ namespace triengine::graphics::d3d12::content {
 
 			submesh::get_views(gpu_ids, material_count, views_cache);
 
-			std::unique_ptr<id::id_type[]> items{ std::make_unique<id::id_type[]>(sizeof(id::id_type) * (1 + (u64)material_count + 1)) };
-
-			items[0] = geometry_content_id;
-			id::id_type* const item_ids{ &items[1] };
+			upload::upload_ticket* const uploads{ (upload::upload_ticket* const)alloca(material_count * sizeof(upload::upload_ticket)) };
+			{
+				std::lock_guard lock{ submesh_mutex };
+				for (u32 i{ 0 }; i < material_count; ++i) uploads[i] = submesh_views[gpu_ids[i]].upload;
+			}
 
-			std::lock_guard lock{ render_item_mutex };
+			triengine::content::mesh_bounds* const bounds{ (triengine::content::mesh_bounds* const)alloca(material_count * sizeof(triengine::content::mesh_bounds)) };
+			triengine::content::get_submesh_bounds(geometry_content_id, material_count, bounds);
+
+			d3d12_render_item_group group{};
+			const u32 lod_count{ triengine::content::get_lod_count(geometry_content_id) };
+			group.thresholds.resize(lod_count);
+			group.lod_offsets.resize(lod_count);
+			triengine::content::get_lods(geometry_content_id, lod_count, group.thresholds.data(), group.lod_offsets.data());
+			group.item_ids.resize(material_count);
+			triengine::content::get_geometry_bounds(geometry_content_id, group.bounds);
+			group.entity_id = item_id;
+			group.lod = 0;
+
+			// NOTE: PSOs and material data are looked up before render_item_mutex is locked, so drawing isn't
+			//       blocked while they're created.
+			pso_id* const pso_ids{ (pso_id* const)alloca(material_count * sizeof(pso_id)) };
+			id::id_type* const root_signature_ids{ (id::id_type* const)alloca(material_count * sizeof(id::id_type)) };
+			ID3D12RootSignature** const root_signature_ptrs{ (ID3D12RootSignature** const)alloca(material_count * sizeof(ID3D12RootSignature*)) };
+			material_type::type* const types{ (material_type::type* const)alloca(material_count * sizeof(material_type::type)) };
+			ID3D12PipelineState** const gpass_psos{ (ID3D12PipelineState** const)alloca(material_count * sizeof(ID3D12PipelineState*)) };
+			ID3D12PipelineState** const depth_psos{ (ID3D12PipelineState** const)alloca(material_count * sizeof(ID3D12PipelineState*)) };
 
 			for (u32 i{ 0 }; i < material_count; ++i)
 			{
-				d3d12_render_item item{};
-				item.item_id = item_id;
-				item.submesh_gpu_ids = gpu_ids[i];
-				item.material_id = material_ids[i];
-				pso_id id_pair{create_pso(item.material_id, views_cache.primitive_topologies[i], views_cache.element_types[i])};
-				item.pso_id = id_pair.gpass_pso_id;
-				item.depth_pso_id = id_pair.depth_pso_id;
+				assert(id::is_valid(gpu_ids[i]) && id::is_valid(material_ids[i]));
+				pso_ids[i] = create_pso(material_ids[i], views_cache.primitive_topologies[i], views_cache.element_types[i], pso_priority::draw);
+			}
 
-				assert(id::is_valid(item.submesh_gpu_ids) && id::is_valid(item.material_id));
-				item_ids[i] = render_items.add(item);
+			{
+				std::lock_guard material_lock{ material_mutex };
+				for (u32 i{ 0 }; i < material_count; ++i)
+				{
+					const d3d12_material_stream stream{ materials[material_ids[i]].get() };
+					root_signature_ids[i] = stream.root_signature_id();
+					root_signature_ptrs[i] = root_signatures[root_signature_ids[i]];
+					types[i] = stream.material_type();
+				}
 			}
 
-			// mark the end of ids list
-			item_ids[material_count] = id::invalid_id;
+			{
+				std::lock_guard pso_lock{ pso_mutex };
+				for (u32 i{ 0 }; i < material_count; ++i)
+				{
+					const bool has_ids{ id::is_valid(pso_ids[i].gpass_pso_id) && id::is_valid(pso_ids[i].depth_pso_id) };
+					gpass_psos[i] = has_ids ? pipeline_states[pso_ids[i].gpass_pso_id] : nullptr;
+					depth_psos[i] = has_ids ? pipeline_states[pso_ids[i].depth_pso_id] : nullptr;
+				}
+			}
 
-			return render_item_ids.add(std::move(items));
+			std::lock_guard lock{ render_item_mutex };
+
+			for (u32 i{ 0 }; i < material_count; ++i)
+			{
+				const u32 slot{ draws.add() };
+				const id::id_type id{ render_items.add(d3d12_render_item{ item_id, slot }) };
+				draws.render_item_ids[slot] = id;
+				draws.entity_ids[slot] = item_id;
+				draws.submesh_gpu_ids[slot] = gpu_ids[i];
+				draws.material_ids[slot] = material_ids[i];
+				draws.pso_ids[slot] = pso_ids[i];
+				draws.gpass_psos[slot] = gpass_psos[i];
+				draws.depth_psos[slot] = depth_psos[i];
+				draws.root_signatures[slot] = root_signature_ptrs[i];
+				draws.material_types[slot] = types[i];
+				draws.position_buffers[slot] = views_cache.positions_buffers[i];
+				draws.element_buffers[slot] = views_cache.elements_buffers[i];
+				draws.index_buffer_views[slot] = views_cache.index_buffer_views[i];
+				draws.primitive_topologies[slot] = views_cache.primitive_topologies[i];
+				draws.elements_types[slot] = views_cache.element_types[i];
+				draws.bounds[slot] = bounds[i];
+				draws.sort_keys[slot] = make_sort_key(types[i], root_signature_ids[i], pso_ids[i].gpass_pso_id, material_ids[i], gpu_ids[i]);
+				draws.uploads[slot] = uploads[i];
+
+				group.item_ids[i] = id;
+			}
+
+			return render_item_groups.add(std::move(group));
 		}
 
 		void remove(id::id_type id)
 		{
 			std::lock_guard lock{ render_item_mutex };
-			const id::id_type* const item_ids{ &render_item_ids[id][1] };
-			for (u32 i{ 0 }; id::is_valid(item_ids[i]); ++i)
+			const d3d12_render_item_group& group{ render_item_groups[id] };
+			for (const id::id_type item_id : group.item_ids)
 			{
-				render_items.remove(item_ids[i]);
+				draws.remove(render_items[item_id].slot);
+				render_items.remove(item_id);
 			}
 
-			render_item_ids.remove(id);
+			render_item_groups.remove(id);
 		}
 
-		void get_d3d12_render_item_ids(const frame_info& info, utl::vector<id::id_type>& d3d12_render_item_ids)
+		void get_item_bounds(const id::id_type* const render_item_ids, u32 count, id::id_type* const entity_ids, triengine::content::mesh_bounds* const bounds)
 		{
-			assert(info.render_item_ids && info.thresholds && info.render_item_count);
-			assert(d3d12_render_item_ids.empty());
-
-			frame_cache.lod_offsets.clear();
-			frame_cache.geometry_ids.clear();
-			const u32 count{ info.render_item_count };
+			assert(render_item_ids && count && entity_ids && bounds);
 
 			std::lock_guard lock{ render_item_mutex };
 
 			for (u32 i{ 0 }; i < count; ++i)
 			{
-				const id::id_type* const buffer{ render_item_ids[info.render_item_ids[i]].get() };
-				frame_cache.geometry_ids.emplace_back(buffer[0]);
+				const d3d12_render_item_group& group{ render_item_groups[render_item_ids[i]] };
+				entity_ids[i] = group.entity_id;
+				bounds[i] = group.bounds;
 			}
+		}
 
-			triengine::content::get_lod_offset(frame_cache.geometry_ids.data(), info.thresholds, count, frame_cache.lod_offsets);
-			assert(frame_cache.lod_offsets.size() == count);
+		void get_draw_slots(const frame_info& info, const f32* const lod_metrics, utl::vector<u32>& slots)
+		{
+			assert(info.render_item_ids && info.render_item_count);
+			assert(info.thresholds || lod_metrics);
+			assert(slots.empty());
+			const u32 count{ info.render_item_count };
+
+			std::lock_guard lock{ render_item_mutex };
+
+			// NOTE: the slots only move here, so the ones gathered below stay valid until the next frame.
+			draws.compact([](id::id_type item_id, u32 slot) { render_items[item_id].slot = slot; });
 
-			u32 d3d12_render_item_count{ 0 };
 			for (u32 i{ 0 }; i < count; ++i)
 			{
-				d3d12_render_item_count += frame_cache.lod_offsets[i].count;
+				d3d12_render_item_group& group{ render_item_groups[info.render_item_ids[i]] };
+				const u32 lod{ info.thresholds ? lod_from_threshold(group, info.thresholds[i]) : lod_from_metric(group, lod_metrics[i]) };
+				const triengine::content::lod_offsets& lod_offset{ group.lod_offsets[lod] };
+				for (u32 j{ 0 }; j < lod_offset.count; ++j)
+				{
+					const u32 slot{ render_items[group.item_ids[lod_offset.offset + j]].slot };
+					if (is_ready(slot)) slots.emplace_back(slot);
+				}
 			}
+		}
 
-			assert(d3d12_render_item_count);
-			d3d12_render_item_ids.resize(d3d12_render_item_count);
+		void get_draws(const u32* const slots, u32 slot_count, const items_cache& items, const submesh::views_cache& views, const material::materials_cache& materials)
+		{
+			assert(slots && slot_count);
+			assert(items.item_id && items.submesh_gpu_ids && items.material_id && items.psos && items.depth_psos);
+			assert(views.positions_buffers && views.elements_buffers && views.index_buffer_views && views.primitive_topologies && views.element_types);
+			assert(materials.root_signatures && materials.material_types);
 
-			u32 item_index{ 0 };
-			for (u32 i{ 0 }; i < count; ++i)
+			std::lock_guard lock{ render_item_mutex };
+
+			for (u32 i{ 0 }; i < slot_count; ++i)
 			{
-				const id::id_type* const item_ids{ &render_item_ids[info.render_item_ids[i]][1] };
-				const triengine::content::lod_offsets& lod_offset{ frame_cache.lod_offsets[i] };
-				memcpy(&d3d12_render_item_ids[item_index], &item_ids[lod_offset.offset], sizeof(id::id_type) * lod_offset.count);
-				item_index += lod_offset.count;
-				assert(item_index <= d3d12_render_item_count);
+				const u32 slot{ slots[i] };
+				assert(slot < draws.size());
+				items.item_id[i] = draws.entity_ids[slot];
+				items.submesh_gpu_ids[i] = draws.submesh_gpu_ids[slot];
+				items.material_id[i] = draws.material_ids[slot];
+				items.psos[i] = draws.gpass_psos[slot];
+				items.depth_psos[i] = draws.depth_psos[slot];
+				views.positions_buffers[i] = draws.position_buffers[slot];
+				views.elements_buffers[i] = draws.element_buffers[slot];
+				views.index_buffer_views[i] = draws.index_buffer_views[slot];
+				views.primitive_topologies[i] = draws.primitive_topologies[slot];
+				views.element_types[i] = draws.elements_types[slot];
+				materials.root_signatures[i] = draws.root_signatures[slot];
+				materials.material_types[i] = draws.material_types[slot];
 			}
+		}
+
+		void get_bounds(const u32* const slots, u32 slot_count, id::id_type* const entity_ids, triengine::content::mesh_bounds* const bounds)
+		{
+			assert(slots && slot_count && entity_ids && bounds);
+
+			std::lock_guard lock{ render_item_mutex };
 
-			assert(item_index <= d3d12_render_item_count);
+			for (u32 i{ 0 }; i < slot_count; ++i)
+			{
+				const u32 slot{ slots[i] };
+				assert(slot < draws.size());
+				entity_ids[i] = draws.entity_ids[slot];
+				bounds[i] = draws.bounds[slot];
+			}
 		}
 
-		void get_items(const id::id_type* const d3d12_render_item_ids, u32 id_count, const items_cache& cache)
+		void get_sort_keys(const u32* const slots, u32 slot_count, u64* const keys)
 		{
-			assert(d3d12_render_item_ids && id_count);
-			assert(cache.item_id && cache.submesh_gpu_ids && cache.material_id && cache.psos && cache.depth_psos);
+			assert(slots && slot_count && keys);
 
-			std::lock_guard lock1{ render_item_mutex };
-			std::lock_guard lock2{ pso_mutex };
+			std::lock_guard lock{ render_item_mutex };
 
-			for (u32 i{ 0 }; i < id_count; ++i)
+			for (u32 i{ 0 }; i < slot_count; ++i)
 			{
-				const d3d12_render_item& item{ render_items[d3d12_render_item_ids[i]] };
-				cache.item_id[i] = item.item_id;
-				cache.submesh_gpu_ids[i] = item.submesh_gpu_ids;
-				cache.material_id[i] = item.material_id;
-				cache.psos[i] = pipeline_states[item.pso_id];
-				cache.depth_psos[i] = pipeline_states[item.depth_pso_id];
+				assert(slots[i] < draws.size());
+				keys[i] = draws.sort_keys[slots[i]];
 			}
 		}
 	}
-}
\ No newline at end of file
+}
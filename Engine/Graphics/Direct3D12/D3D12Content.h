@@ -1,11 +1,25 @@
 #pragma once
 #include "D3D12CommonHeader.h"
+#include "Content/ContentToEngine.h"
 
 namespace triengine::graphics::d3d12::content {
 
 	bool initialize();
 	void shutdown();
 
+	// PSOs are compiled in the background. Times are measured on the threads that compile them.
+	struct pso_compile_stats
+	{
+		u32 compiled;
+		u32 failed;
+		u32 pending;
+		u32 missing_shaders;	// draws that are never drawn, because their material has no shaders for their elements type
+		f32 total_ms;
+		f32 max_ms;
+	};
+
+	[[nodiscard]] pso_compile_stats get_pso_compile_stats();
+
 	namespace submesh {
 		struct views_cache
 		{
@@ -36,7 +50,6 @@ namespace triengine::graphics::d3d12::content {
 
 		id::id_type add(material_init_info data);
 		void remove(id::id_type id);
-		void get_materials(const id::id_type* const material_ids, u32 material_count, const materials_cache& cache);
 	}
 
 	namespace render_item {
@@ -49,9 +62,38 @@ namespace triengine::graphics::d3d12::content {
 			ID3D12PipelineState* *const depth_psos;
 		};
 
+		// Draws are sorted by 64-bit keys, so items that share a root signature, pipeline state and material
+		// are drawn together, and items that also share a submesh can be drawn as instances.
+		// Fields, from the most significant bits:
+		// pass (material type) | root signature id | pipeline state id | material id | submesh gpu id | depth
+		// NOTE: ids are truncated to their field, which only affects the order, not what is drawn.
+		struct sort_key {
+			static constexpr u32 depth_bits{ 12 };
+			static constexpr u32 submesh_shift{ depth_bits };
+			static constexpr u32 submesh_bits{ 14 };
+			static constexpr u32 material_shift{ submesh_shift + submesh_bits };
+			static constexpr u32 material_bits{ 14 };
+			static constexpr u32 pso_shift{ material_shift + material_bits };
+			static constexpr u32 pso_bits{ 14 };
+			static constexpr u32 root_signature_shift{ pso_shift + pso_bits };
+			static constexpr u32 root_signature_bits{ 6 };
+			static constexpr u32 pass_shift{ root_signature_shift + root_signature_bits };
+			static constexpr u32 pass_bits{ 4 };
+			static_assert(pass_shift + pass_bits == 64);
+		};
+
 		id::id_type add(id::id_type item_id, id::id_type geometry_content_id, u32 material_count, const id::id_type* const material_ids);
 		void remove(id::id_type id);
-		void get_d3d12_render_item_ids(const frame_info& info, utl::vector<id::id_type>& d3d12_render_item_ids);
-		void get_items(const id::id_type* const d3d12_render_item_ids, u32 id_count, const items_cache& cache);
+		// Writes the entity and the bounds of the whole geometry of each render item.
+		void get_item_bounds(const id::id_type* const render_item_ids, u32 count, id::id_type* const entity_ids, triengine::content::mesh_bounds* const bounds);
+		// Selects the LOD of every render item in the frame and writes the draw slots of its submeshes.
+		// LODs are selected with the frame's thresholds if it has them, or else with 'lod_metrics' (see culling::lod_camera),
+		// with some hysteresis. Draws whose PSOs are still being compiled are left out.
+		// NOTE: slots are only valid until the next call to remove().
+		void get_draw_slots(const frame_info& info, const f32* const lod_metrics, utl::vector<u32>& slots);
+		void get_draws(const u32* const slots, u32 slot_count, const items_cache& items, const submesh::views_cache& views, const material::materials_cache& materials);
+		void get_bounds(const u32* const slots, u32 slot_count, id::id_type* const entity_ids, triengine::content::mesh_bounds* const bounds);
+		// Writes the sort keys of the draws, without the depth field.
+		void get_sort_keys(const u32* const slots, u32 slot_count, u64* const keys);
 	}
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "D3D12Gpass.h"
 #include "D3D12PostProcess.h"
 #include "D3D12Upload.h"
+#include "D3D12Memory.h"
 #include "D3D12Content.h"
 #include "D3D12Camera.h"
 #include "Shaders/SharedTypes.h"
@@ -121,6 +122,8 @@ namespace triengine::graphics::d3d12::core {
 			[[nodiscard]] constexpr ID3D12CommandQueue* const command_queue() const noexcept { return _cmd_queue; }
 			[[nodiscard]] constexpr id3d12_graphics_command_list* const command_list() const noexcept { return _cmd_list; }
 			[[nodiscard]] constexpr u32 frame_index() const noexcept { return _frame_index; }
+			[[nodiscard]] constexpr u64 fence_value() const noexcept { return _fence_value; }
+			[[nodiscard]] u64 completed_fence_value() const { return _fence->GetCompletedValue(); }
 		private:
 			struct command_frame
 			{
@@ -161,7 +164,7 @@ namespace triengine::graphics::d3d12::core {
 		d3d12_command gfx_command;
 		surface_collection surfaces;
 		d3dx::d3d12_resource_barrier resource_barriers{};
-		constant_buffer constants_buffers[frame_buffer_count];
+		constant_buffer constants_buffer;
 
 		descriptor_heap rtv_desc_heap{ D3D12_DESCRIPTOR_HEAP_TYPE_RTV };
 		descriptor_heap dsv_desc_heap{ D3D12_DESCRIPTOR_HEAP_TYPE_DSV };
@@ -226,6 +229,7 @@ namespace triengine::graphics::d3d12::core {
 			dsv_desc_heap.process_defered_free(frame_idx);
 			srv_desc_heap.process_defered_free(frame_idx);
 			uav_desc_heap.process_defered_free(frame_idx);
+			memory::process_deferred_frees(frame_idx);
 
 			utl::vector<IUnknown*>& resources{ deferred_releases[frame_idx] };
 			if (!resources.empty())
@@ -259,7 +263,7 @@ namespace triengine::graphics::d3d12::core {
 			d3d12_frame_info d3d12_info{
 				&info,
 				&camera,
-				cbuffer.gpu_address(),
+				cbuffer.gpu_address(shader_data),
 				data.ViewWidth,
 				data.ViewHeight,
 				frame_idx,
@@ -338,17 +342,14 @@ namespace triengine::graphics::d3d12::core {
 		result &= uav_desc_heap.initialize(512, false);
 		if (!result) return failed_init();
 
-		for (u32 i{ 0 }; i < frame_buffer_count; ++i)
-		{
-			new (&constants_buffers[i])
-				constant_buffer{ constant_buffer::get_default_init_info(1024 * 1024) };
-			NAME_D3D12_OBJECT_INDEXED(constants_buffers[i].buffer(), i, L"Global Constant Buffer");
-		}
+		new (&constants_buffer)
+			constant_buffer{ constant_buffer::get_default_init_info(frame_buffer_count * 1024 * 1024) };
+		NAME_D3D12_OBJECT(constants_buffer.buffer(), L"Global Constant Buffer");
 
 		new (&gfx_command) d3d12_command(main_device, D3D12_COMMAND_LIST_TYPE_DIRECT);
 		if (!gfx_command.command_queue()) return failed_init();
 
-		if (!(shaders::initialize() && gpass::initialize() && fx::initialize() && upload::initialize() && content::initialize())) return failed_init();
+		if (!(shaders::initialize() && gpass::initialize() && fx::initialize() && upload::initialize() && memory::initialize() && content::initialize())) return failed_init();
 
 		NAME_D3D12_OBJECT(main_device, L"MAIN DEVICE");
 		NAME_D3D12_OBJECT(rtv_desc_heap.heap(), L"RTV DESCRIPTOR HEAP");
@@ -370,6 +371,7 @@ namespace triengine::graphics::d3d12::core {
 
 		// Shutdown modules
 		content::shutdown();
+		memory::shutdown();
 		upload::shutdown();
 		fx::shutdown();
 		gpass::shutdown();
@@ -377,10 +379,7 @@ namespace triengine::graphics::d3d12::core {
 
 		release(dxgi_factory);
 
-		for (u32 i{ 0 }; i < frame_buffer_count; ++i)
-		{
-			constants_buffers[i].release();
-		}
+		constants_buffer.release();
 
 		rtv_desc_heap.process_defered_free(0);
 		dsv_desc_heap.process_defered_free(0);
@@ -442,7 +441,7 @@ namespace triengine::graphics::d3d12::core {
 
 	constant_buffer& cbuffer()
 	{
-		return constants_buffers[current_frame_index()];
+		return constants_buffer;
 	}
 
 	u32 current_frame_index() { return gfx_command.frame_index(); }
@@ -484,10 +483,13 @@ namespace triengine::graphics::d3d12::core {
 		gfx_command.begin_frame();
 		id3d12_graphics_command_list* cmd_list{ gfx_command.command_list() };
 
+		// NOTE: the frame can use anything that finished uploading before it was rendered.
+		upload::sync_queue(gfx_command.command_queue());
+
 		const u32 frame_idx{ current_frame_index() };
 
-		constant_buffer& cbuffer{ constants_buffers[frame_idx] };
-		cbuffer.clear();
+		constant_buffer& cbuffer{ constants_buffer };
+		cbuffer.retire(gfx_command.completed_fence_value());
 
 		if (deferred_releases_flag[frame_idx])
 		{
@@ -540,5 +542,10 @@ namespace triengine::graphics::d3d12::core {
 		d3dx::transition_resource(cmd_list, current_back_buffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 
 		gfx_command.end_frame(surface);
+		// NOTE: frames are rendered in lockstep with frame_buffer_count, so the constant buffer ring can't
+		//       have more frames in flight than it tracks.
+		static_assert(frame_buffer_count < utl::ring_allocator::max_frames);
+		[[maybe_unused]] const bool is_tracked{ cbuffer.end_frame(gfx_command.fence_value()) };
+		assert(is_tracked);
 	}
 }
\ No newline at end of file
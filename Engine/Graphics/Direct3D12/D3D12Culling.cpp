@@ -0,0 +1,124 @@
+#include "D3D12Culling.h"
+#include "Utilities/ThreadPool.h"
+#include <immintrin.h>
+
+namespace triengine::graphics::d3d12::culling {
+	namespace {
+		// NOTE: spheres are culled in chunks, so large scenes are spread over the thread pool.
+		//       Must be a multiple of 4.
+		constexpr u32 chunk_size{ 1024 };
+
+		u32 cull_chunk(const frustum& frustum, const sphere_soa& spheres, u32 first, u32 count, u32* const visible_indices)
+		{
+			__m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+			for (u32 i{ 0 }; i < 6; ++i)
+			{
+				plane_x[i] = _mm_set1_ps(frustum.planes[i].x);
+				plane_y[i] = _mm_set1_ps(frustum.planes[i].y);
+				plane_z[i] = _mm_set1_ps(frustum.planes[i].z);
+				plane_w[i] = _mm_set1_ps(frustum.planes[i].w);
+			}
+
+			u32 visible_count{ 0 };
+			const u32 last{ first + count };
+			for (u32 i{ first }; i < last; i += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(&spheres.center_x[i]) };
+				const __m128 y{ _mm_loadu_ps(&spheres.center_y[i]) };
+				const __m128 z{ _mm_loadu_ps(&spheres.center_z[i]) };
+				const __m128 neg_radius{ _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i])) };
+
+				__m128 inside{ _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+				for (u32 p{ 0 }; p < 6; ++p)
+				{
+					const __m128 d{ _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(x, plane_x[p]), _mm_mul_ps(y, plane_y[p])),
+						_mm_add_ps(_mm_mul_ps(z, plane_z[p]), plane_w[p])) };
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_radius));
+				}
+
+				// NOTE: every index is written and only kept when visible, so there's no branch per sphere.
+				const u32 mask{ (u32)_mm_movemask_ps(inside) };
+				const u32 lanes{ std::min(4u, last - i) };
+				for (u32 lane{ 0 }; lane < lanes; ++lane)
+				{
+					visible_indices[visible_count] = i + lane;
+					visible_count += (mask >> lane) & 1;
+				}
+			}
+
+			return visible_count;
+		}
+	} // anonymous namespace
+
+	frustum extract_frustum(DirectX::FXMMATRIX view_projection)
+	{
+		using namespace DirectX;
+		// NOTE: DirectXMath uses row vectors, so clip space coordinates are dot products with the columns.
+		const XMMATRIX m{ XMMatrixTranspose(view_projection) };
+		const XMVECTOR planes[6]{
+			m.r[3] + m.r[0],	// left:	-w <= x
+			m.r[3] - m.r[0],	// right:	x <= w
+			m.r[3] + m.r[1],	// bottom:	-w <= y
+			m.r[3] - m.r[1],	// top:		y <= w
+			m.r[2],				// far:		0 <= z (depth is reversed)
+			m.r[3] - m.r[2],	// near:	z <= w
+		};
+
+		frustum f{};
+		for (u32 i{ 0 }; i < _countof(planes); ++i)
+		{
+			XMStoreFloat4(&f.planes[i], XMPlaneNormalize(planes[i]));
+		}
+
+		return f;
+	}
+
+	u32 cull_spheres(const frustum& frustum, const sphere_soa& spheres, u32 count, u32* const visible_indices)
+	{
+		assert(spheres.center_x && spheres.center_y && spheres.center_z && spheres.radius && visible_indices);
+		if (!count) return 0;
+
+		const u32 chunk_count{ (count + chunk_size - 1) / chunk_size };
+		u32* const visible_counts{ (u32* const)alloca(chunk_count * sizeof(u32)) };
+
+		utl::default_thread_pool().parallel_for(chunk_count, [&](u32 chunk) {
+			const u32 first{ chunk * chunk_size };
+			visible_counts[chunk] = cull_chunk(frustum, spheres, first, std::min(chunk_size, count - first), &visible_indices[first]);
+		});
+
+		// each chunk wrote its indices at the chunk's offset, so move them together.
+		u32 visible_count{ visible_counts[0] };
+		for (u32 chunk{ 1 }; chunk < chunk_count; ++chunk)
+		{
+			memmove(&visible_indices[visible_count], &visible_indices[chunk * chunk_size], visible_counts[chunk] * sizeof(u32));
+			visible_count += visible_counts[chunk];
+		}
+
+		assert(visible_count <= count);
+		return visible_count;
+	}
+
+	void compute_lod_metrics(const lod_camera& camera, const sphere_soa& spheres, const f32* const scales, u32 count, f32* const metrics)
+	{
+		assert(spheres.center_x && spheres.center_y && spheres.center_z && spheres.radius && scales && metrics);
+		const __m128 camera_x{ _mm_set1_ps(camera.position.x) };
+		const __m128 camera_y{ _mm_set1_ps(camera.position.y) };
+		const __m128 camera_z{ _mm_set1_ps(camera.position.z) };
+		const __m128 distance_scale{ _mm_set1_ps(camera.distance_scale) };
+		const __m128 constant{ _mm_set1_ps(camera.constant) };
+		const __m128 min_scale{ _mm_set1_ps(1e-6f) };
+
+		for (u32 i{ 0 }; i < count; i += 4)
+		{
+			const __m128 dx{ _mm_sub_ps(_mm_loadu_ps(&spheres.center_x[i]), camera_x) };
+			const __m128 dy{ _mm_sub_ps(_mm_loadu_ps(&spheres.center_y[i]), camera_y) };
+			const __m128 dz{ _mm_sub_ps(_mm_loadu_ps(&spheres.center_z[i]), camera_z) };
+			const __m128 center_distance{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))) };
+			// NOTE: the distance to the closest point of the sphere, so large items don't switch to coarse LODs too soon.
+			const __m128 distance{ _mm_max_ps(_mm_sub_ps(center_distance, _mm_loadu_ps(&spheres.radius[i])), _mm_setzero_ps()) };
+			const __m128 scale{ _mm_max_ps(_mm_loadu_ps(&scales[i]), min_scale) };
+			_mm_storeu_ps(&metrics[i], _mm_div_ps(_mm_add_ps(_mm_mul_ps(distance, distance_scale), constant), scale));
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include "D3D12CommonHeader.h"
+
+namespace triengine::graphics::d3d12::culling {
+
+	// World space bounding spheres, stored as separate arrays so 4 of them can be tested at once.
+	// NOTE: each array needs room for the sphere count rounded up to a multiple of 4.
+	struct sphere_soa
+	{
+		f32* center_x;
+		f32* center_y;
+		f32* center_z;
+		f32* radius;
+	};
+
+	// Normalized planes facing inward: a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all planes.
+	struct frustum
+	{
+		math::v4 planes[6];
+	};
+
+	// LOD thresholds are view distances in a reference view (see generate_lods() in ContentTools).
+	// The LOD metric of an item is the distance to its bounding sphere, converted to the distance in the reference
+	// view at which its triangles look as large, and divided by the item's scale:
+	// (distance * distance_scale + constant) / scale. Larger metrics select coarser LODs.
+	struct lod_camera
+	{
+		math::v3 position;
+		f32 distance_scale;		// for perspective cameras, 0 for orthographic ones
+		f32 constant;			// for orthographic cameras, 0 for perspective ones
+	};
+
+	struct culling_stats
+	{
+		u32 item_count;
+		u32 visible_count;
+		u32 occluded_count;	// items inside the frustum that are hidden by occluders
+	};
+
+	[[nodiscard]] frustum extract_frustum(DirectX::FXMMATRIX view_projection);
+
+	// Writes the indices of the spheres that intersect the frustum to 'visible_indices', in increasing order,
+	// and returns how many there are. 'visible_indices' needs room for 'count' indices.
+	u32 cull_spheres(const frustum& frustum, const sphere_soa& spheres, u32 count, u32* const visible_indices);
+
+	// Writes the LOD metric of each item to 'metrics'. 'scales' are the largest axis scales of the items.
+	// NOTE: 'scales' and 'metrics' need room for 'count' rounded up to a multiple of 4.
+	void compute_lod_metrics(const lod_camera& camera, const sphere_soa& spheres, const f32* const scales, u32 count, f32* const metrics);
+}
\ No newline at end of file
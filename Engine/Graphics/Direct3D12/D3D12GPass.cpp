@@ -3,6 +3,9 @@
 #include "D3D12Shaders.h"
 #include "D3D12Content.h"
 #include "D3D12Camera.h"
+#include "D3D12Culling.h"
+#include "Graphics/OcclusionCulling.h"
+#include "Utilities/RadixSort.h"
 #include "Shaders/SharedTypes.h"
 #include "Components/Entity.h"
 #include "Components/Transform.h"
@@ -28,9 +31,19 @@ namespace triengine::graphics::d3d12::gpass {
 #define CONSTEPXR constexpr
 #endif
 
+		// Consecutive render items that use the same submesh, material and pipeline states are drawn with a single
+		// instanced draw call. The indices of their entities' per-object data are stored next to each other,
+		// in the order of the items.
+		struct instanced_draw
+		{
+			u32 first_item;
+			u32 instance_count;
+		};
+
 		struct gpass_cache
 		{
-			utl::vector<id::id_type> d3d12_render_item_ids;
+			utl::vector<u32> draw_slots; // see content::render_item::get_draw_slots()
+			utl::vector<instanced_draw> draws;
 
 			id::id_type* entity_ids{ nullptr };
 			id::id_type* submesh_gpu_ids{ nullptr };
@@ -44,7 +57,7 @@ namespace triengine::graphics::d3d12::gpass {
 			D3D12_INDEX_BUFFER_VIEW* index_buffer_views{ nullptr };
 			D3D_PRIMITIVE_TOPOLOGY* primitive_topologies{ nullptr };
 			u32* elements_types{ nullptr };
-			D3D12_GPU_VIRTUAL_ADDRESS* per_object_data{ nullptr };
+			D3D12_GPU_VIRTUAL_ADDRESS* object_indices{ nullptr };	// only set for the first item of each draw
 
 			constexpr content::render_item::items_cache items_cache() const
 			{
@@ -78,17 +91,18 @@ namespace triengine::graphics::d3d12::gpass {
 
 			CONSTEPXR u32 size() const
 			{
-				return (u32)d3d12_render_item_ids.size();
+				return (u32)draw_slots.size();
 			}
 
 			CONSTEPXR void clear()
 			{
-				d3d12_render_item_ids.clear();
+				draw_slots.clear();
+				draws.clear();
 			}
 
 			CONSTEPXR void resize()
 			{
-				const u64 items_count{ d3d12_render_item_ids.size()};
+				const u64 items_count{ draw_slots.size()};
 				const u64 new_buffer_size{ items_count * struct_size };
 				const u64 old_buffer_size{ _buffer.size() };
 				if (new_buffer_size > old_buffer_size)
@@ -110,7 +124,7 @@ namespace triengine::graphics::d3d12::gpass {
 					index_buffer_views = reinterpret_cast<D3D12_INDEX_BUFFER_VIEW*>(element_buffers + items_count);
 					primitive_topologies = reinterpret_cast<D3D_PRIMITIVE_TOPOLOGY*>(index_buffer_views + items_count);
 					elements_types = reinterpret_cast<u32*>(primitive_topologies + items_count);
-					per_object_data = reinterpret_cast<D3D12_GPU_VIRTUAL_ADDRESS*>(elements_types + items_count);
+					object_indices = reinterpret_cast<D3D12_GPU_VIRTUAL_ADDRESS*>(elements_types + items_count);
 				}
 			}
 
@@ -128,7 +142,7 @@ namespace triengine::graphics::d3d12::gpass {
 				sizeof(index_buffer_views) +
 				sizeof(primitive_topologies) +
 				sizeof(elements_types) +
-				sizeof(per_object_data)
+				sizeof(object_indices)
 			};
 
 			utl::vector<u8> _buffer;
@@ -136,6 +150,60 @@ namespace triengine::graphics::d3d12::gpass {
 
 #undef CONSTEXPR
 
+		struct culling_cache
+		{
+			utl::vector<id::id_type> entity_ids;
+			utl::vector<triengine::content::mesh_bounds> bounds;	// model space
+			utl::vector<f32> world_spheres;							// world space, as 4 arrays (see culling::sphere_soa)
+			utl::vector<u32> visible_indices;
+			utl::vector<game_entity::entity_id> entities;			// entities of the render items, in order
+			utl::vector<math::m4x3> worlds;							// one per entity
+			utl::vector<math::m4x4> world_view_projections;			// one per entity, only with occluders
+			utl::vector<u32> transform_indices;						// index in entities, per item
+			utl::vector<occlusion::occludee_box> boxes;
+			utl::vector<f32> depths;								// distance to the camera, per item
+		} cull_cache;
+
+		struct lod_metrics_cache
+		{
+			utl::vector<id::id_type> entity_ids;
+			utl::vector<triengine::content::mesh_bounds> bounds;	// model space
+			utl::vector<f32> world_spheres;							// world space, as 4 arrays (see culling::sphere_soa)
+			utl::vector<f32> scales;
+			utl::vector<f32> metrics;								// one per render item in the frame
+		} lod_cache;
+
+		// NOTE: the view in which LOD thresholds are computed. Has to match generate_lods() in ContentTools.
+		constexpr f32 lod_reference_height{ 1080.f };
+		constexpr f32 lod_reference_fov{ DirectX::XM_PI / 3.f };
+
+		struct sort_cache
+		{
+			utl::vector<u64> keys;
+			utl::vector<u32> indices;
+			utl::vector<u64> temp_keys;
+			utl::vector<u32> temp_indices;
+			utl::vector<u32> slots;
+		} draw_sort_cache;
+
+		// PerObjectData of the entities that have render items, indexed by entity index. The buffer is kept between
+		// frames and only the data of entities that are new or whose transform changed is copied to it.
+		struct object_data_cache
+		{
+			d3d12_buffer buffer;
+			utl::vector<id::id_type> entity_ids;	// entity whose data is in the buffer, per entity index
+			utl::vector<u32> frames;				// last frame in which the entity was checked, per entity index
+			utl::vector<u8> flags;
+			utl::vector<u32> updates;
+			u32 frame{ 0 };
+		} object_cache;
+
+		constexpr D3D12_RESOURCE_STATES object_buffer_state{ D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE };
+
+		culling::culling_stats frame_culling_stats{};
+		sort_stats frame_sort_stats{};
+		instancing_stats frame_instancing_stats{};
+
 		bool create_buffers(math::u32v2 size)
 		{
 			assert(size.x && size.y);
@@ -186,34 +254,133 @@ namespace triengine::graphics::d3d12::gpass {
 			return gpass_main_buffer.resource() && gpass_depth_buffer.resource();
 		}
 
-		void fill_per_object_data(const d3d12_frame_info& d3d12_info)
+		// Copies the PerObjectData of entities that weren't in the last frame or whose transform changed since then
+		// to the object buffer. The buffer is recreated when an entity index doesn't fit, and then all entities
+		// are copied again.
+		void update_object_data(id3d12_graphics_command_list* const cmd_list, const game_entity::entity_id* const entity_ids, u32 count)
 		{
-			const gpass_cache& cache{ frame_cache };
-			const u32 render_items_count{ (u32)cache.size() };
-			id::id_type current_entity_id{ id::invalid_id };
-			hlsl::PerObjectData* current_data_pointer{ nullptr };
+			object_data_cache& cache{ object_cache };
+			++cache.frame;
+			if (!count) return;
 
-			constant_buffer& cbuffer{ core::cbuffer() };
+			u32 max_index{ 0 };
+			for (u32 i{ 0 }; i < count; ++i)
+			{
+				max_index = std::max(max_index, (u32)id::index(entity_ids[i]));
+			}
 
-			using namespace DirectX;
-			for (u32 i{ 0 }; i < render_items_count; ++i)
+			if (max_index >= cache.entity_ids.size())
 			{
-				if (current_entity_id != cache.entity_ids[i])
+				cache.entity_ids.resize(max_index + 1, id::invalid_id);
+				cache.frames.resize(max_index + 1, 0);
+			}
+
+			constexpr u32 object_size{ sizeof(hlsl::PerObjectData) };
+			if (max_index >= cache.buffer.size() / object_size)
+			{
+				const u32 capacity{ (u32)math::align_size_up<1024>(max_index + 1 + (max_index >> 1)) };
+				d3d12_buffer_init_info info{};
+				info.size = capacity * object_size;
+				info.alignment = object_size;
+				info.initial_state = object_buffer_state;
+				cache.buffer = d3d12_buffer{ info, false };
+				NAME_D3D12_OBJECT(cache.buffer.buffer(), L"GPass Per Object Data Buffer");
+
+				for (u32 i{ 0 }; i < cache.entity_ids.size(); ++i) cache.entity_ids[i] = id::invalid_id;
+			}
+
+			cache.flags.resize(count);
+			transform::get_updated_components_flags(entity_ids, count, cache.flags.data());
+			cache.updates.clear();
+
+			for (u32 i{ 0 }; i < count; ++i)
+			{
+				const id::id_type entity_id{ entity_ids[i] };
+				const u32 index{ (u32)id::index(entity_id) };
+				// NOTE: an entity can be in the list more than once if its render items aren't next to each other.
+				if (cache.frames[index] == cache.frame) continue;
+
+				// NOTE: transform change flags are cleared on the next transform update, so changes of entities
+				//       that weren't rendered in the last frame may have been missed.
+				const bool is_up_to_date{ cache.entity_ids[index] == entity_id && cache.frames[index] + 1 == cache.frame };
+				if (!is_up_to_date || cache.flags[i])
 				{
-					current_entity_id = cache.entity_ids[i];
-					hlsl::PerObjectData data{};
-					transform::get_transform_matrices(game_entity::entity_id{ current_entity_id }, data.World, data.InvWorld);
-					XMMATRIX world{ XMLoadFloat4x4(&data.World) };
-					XMMATRIX wvp{ XMMatrixMultiply(world, d3d12_info.camera->view_projection()) };
-					XMStoreFloat4x4(&data.WorldViewProjection, wvp);
-
-					current_data_pointer = cbuffer.allocate<hlsl::PerObjectData>();
-					memcpy(current_data_pointer, &data, sizeof(hlsl::PerObjectData));
+					cache.updates.emplace_back(index);
+					cache.entity_ids[index] = entity_id;
 				}
 
-				assert(current_data_pointer);
-				cache.per_object_data[i] = cbuffer.gpu_address(current_data_pointer);
+				cache.frames[index] = cache.frame;
+			}
+
+			const u32 update_count{ (u32)cache.updates.size() };
+			if (!update_count) return;
+
+			std::sort(cache.updates.begin(), cache.updates.end());
+			constant_buffer& cbuffer{ core::cbuffer() };
+			hlsl::PerObjectData* const data{ (hlsl::PerObjectData* const)cbuffer.allocate(update_count * object_size) };
+			assert(data);
+
+			for (u32 i{ 0 }; i < update_count; ++i)
+			{
+				hlsl::PerObjectData object_data{};
+				transform::get_transform_matrices(game_entity::entity_id{ cache.entity_ids[cache.updates[i]] }, object_data.World, object_data.InvWorld);
+				// NOTE: the constant buffer is in upload memory, so it's only written, in order.
+				memcpy(&data[i], &object_data, object_size);
+			}
+
+			ID3D12Resource* const buffer{ cache.buffer.buffer() };
+			const u64 source_offset{ (u64)((u8*)data - cbuffer.cpu_address()) };
+			d3dx::transition_resource(cmd_list, buffer, object_buffer_state, D3D12_RESOURCE_STATE_COPY_DEST);
+
+			// copy runs of consecutive entity indices with a single copy.
+			u32 first{ 0 };
+			while (first < update_count)
+			{
+				u32 last{ first + 1 };
+				while (last < update_count && cache.updates[last] == cache.updates[last - 1] + 1) ++last;
+				cmd_list->CopyBufferRegion(buffer, (u64)cache.updates[first] * object_size, cbuffer.buffer(), source_offset + (u64)first * object_size, (u64)(last - first) * object_size);
+				first = last;
+			}
+
+			d3dx::transition_resource(cmd_list, buffer, D3D12_RESOURCE_STATE_COPY_DEST, object_buffer_state);
+		}
+
+		[[nodiscard]] bool can_instance(const gpass_cache& cache, u32 first_item, u32 item)
+		{
+			return cache.submesh_gpu_ids[item] == cache.submesh_gpu_ids[first_item] &&
+				cache.material_ids[item] == cache.material_ids[first_item] &&
+				cache.gpass_pipeline_states[item] == cache.gpass_pipeline_states[first_item] &&
+				cache.depth_pipeline_states[item] == cache.depth_pipeline_states[first_item];
+		}
+
+		// Groups the sorted render items into instanced draws and writes the object buffer index of each item.
+		void fill_object_indices()
+		{
+			gpass_cache& cache{ frame_cache };
+			const u32 render_items_count{ (u32)cache.size() };
+			constant_buffer& cbuffer{ core::cbuffer() };
+
+			u32* const object_indices{ (u32* const)cbuffer.allocate(render_items_count * sizeof(u32)) };
+			assert(object_indices);
+			const D3D12_GPU_VIRTUAL_ADDRESS object_indices_address{ cbuffer.gpu_address(object_indices) };
+
+			for (u32 i{ 0 }; i < render_items_count; ++i)
+			{
+				object_indices[i] = (u32)id::index(cache.entity_ids[i]);
 			}
+
+			u32 first_item{ 0 };
+			while (first_item < render_items_count)
+			{
+				u32 last_item{ first_item + 1 };
+				while (last_item < render_items_count && can_instance(cache, first_item, last_item)) ++last_item;
+
+				cache.object_indices[first_item] = object_indices_address + first_item * sizeof(u32);
+				cache.draws.emplace_back(instanced_draw{ first_item, last_item - first_item });
+				first_item = last_item;
+			}
+
+			frame_instancing_stats = { (u32)cache.draws.size(), render_items_count };
 		}
 
 		void set_root_parameters(id3d12_graphics_command_list* const cmd_list, u32 cache_index)
@@ -229,14 +396,265 @@ namespace triengine::graphics::d3d12::gpass {
 				using params = opaque_root_parameter;
 				cmd_list->SetGraphicsRootShaderResourceView(params::position_buffer, cache.position_buffers[cache_index]);
 				cmd_list->SetGraphicsRootShaderResourceView(params::element_buffer, cache.element_buffers[cache_index]);
-				cmd_list->SetGraphicsRootConstantBufferView(params::per_object_data, cache.per_object_data[cache_index]);
+				cmd_list->SetGraphicsRootShaderResourceView(params::per_object_data, object_cache.buffer.gpu_address());
+				cmd_list->SetGraphicsRootShaderResourceView(params::object_indices, cache.object_indices[cache_index]);
 			}
 			break;
 			}
 		}
 
 
-		void prepare_render_frame(const d3d12_frame_info& d3d12_info)
+		// Removes the render items whose bounding sphere is outside of the camera's frustum from the frame cache.
+		// The remaining items are then tested against the occlusion buffer, if there are any occluders.
+		void cull_render_items(const d3d12_frame_info& d3d12_info)
+		{
+			utl::vector<u32>& slots{ frame_cache.draw_slots };
+			culling_cache& cache{ cull_cache };
+			const u32 items_count{ (u32)slots.size() };
+			const u32 padded_count{ (u32)math::align_size_up<4>(items_count) };
+
+			cache.entity_ids.resize(items_count);
+			cache.bounds.resize(items_count);
+			cache.world_spheres.resize(padded_count * 4);
+			cache.visible_indices.resize(items_count);
+			cache.transform_indices.resize(items_count);
+			cache.depths.resize(items_count);
+			cache.entities.clear();
+			cache.worlds.clear();
+
+			content::render_item::get_bounds(slots.data(), items_count, cache.entity_ids.data(), cache.bounds.data());
+
+			const culling::sphere_soa spheres{
+				&cache.world_spheres[0],
+				&cache.world_spheres[padded_count],
+				&cache.world_spheres[padded_count * 2],
+				&cache.world_spheres[padded_count * 3],
+			};
+
+			using namespace DirectX;
+			const XMMATRIX view_projection{ d3d12_info.camera->view_projection() };
+			const XMVECTOR camera_position{ d3d12_info.camera->position() };
+			id::id_type current_entity_id{ id::invalid_id };
+			XMMATRIX world{};
+			f32 scale{ 1.f };
+
+			for (u32 i{ 0 }; i < items_count; ++i)
+			{
+				if (current_entity_id != cache.entity_ids[i])
+				{
+					current_entity_id = cache.entity_ids[i];
+					math::m4x3 world_matrix, inverse_world_matrix;
+					transform::get_transform_matrices(game_entity::entity_id{ current_entity_id }, world_matrix, inverse_world_matrix);
+					world = XMLoadFloat4x3(&world_matrix);
+					// NOTE: non-uniform scaling stretches the sphere, so the largest axis scale is used for the radius.
+					const XMVECTOR scale_sq{ XMVectorMax(XMVector3LengthSq(world.r[0]), XMVectorMax(XMVector3LengthSq(world.r[1]), XMVector3LengthSq(world.r[2]))) };
+					scale = sqrtf(XMVectorGetX(scale_sq));
+					cache.entities.emplace_back(current_entity_id);
+					cache.worlds.emplace_back(world_matrix);
+				}
+
+				const triengine::content::mesh_bounds& bounds{ cache.bounds[i] };
+				const XMVECTOR world_center{ XMVector3Transform(XMLoadFloat3(&bounds.center), world) };
+				math::v3 center;
+				XMStoreFloat3(&center, world_center);
+				cache.depths[i] = XMVectorGetX(XMVector3Length(world_center - camera_position));
+				spheres.center_x[i] = center.x;
+				spheres.center_y[i] = center.y;
+				spheres.center_z[i] = center.z;
+				spheres.radius[i] = bounds.radius * scale;
+				cache.transform_indices[i] = (u32)cache.entities.size() - 1;
+			}
+
+			const culling::frustum frustum{ culling::extract_frustum(view_projection) };
+			u32 visible_count{ culling::cull_spheres(frustum, spheres, items_count, cache.visible_indices.data()) };
+
+			// compact the list of visible items, keeping their order.
+			for (u32 i{ 0 }; i < visible_count; ++i)
+			{
+				slots[i] = slots[cache.visible_indices[i]];
+				cache.depths[i] = cache.depths[cache.visible_indices[i]];
+			}
+
+			u32 occluded_count{ 0 };
+			if (visible_count && occlusion::render_occluders(view_projection))
+			{
+				const u32 entity_count{ (u32)cache.worlds.size() };
+				cache.world_view_projections.resize(entity_count);
+				for (u32 i{ 0 }; i < entity_count; ++i)
+				{
+					XMStoreFloat4x4(&cache.world_view_projections[i], XMMatrixMultiply(XMLoadFloat4x3(&cache.worlds[i]), view_projection));
+				}
+
+				cache.boxes.resize(visible_count);
+				for (u32 i{ 0 }; i < visible_count; ++i)
+				{
+					const u32 index{ cache.visible_indices[i] };
+					const triengine::content::mesh_bounds& bounds{ cache.bounds[index] };
+					cache.boxes[i] = { bounds.min, bounds.max, &cache.world_view_projections[cache.transform_indices[index]] };
+				}
+
+				const u32 unoccluded_count{ occlusion::shared_buffer().cull(cache.boxes.data(), visible_count, cache.visible_indices.data()) };
+				for (u32 i{ 0 }; i < unoccluded_count; ++i)
+				{
+					slots[i] = slots[cache.visible_indices[i]];
+					cache.depths[i] = cache.depths[cache.visible_indices[i]];
+				}
+
+				occluded_count = visible_count - unoccluded_count;
+				visible_count = unoccluded_count;
+			}
+
+			slots.resize(visible_count);
+			frame_culling_stats = { items_count, visible_count, occluded_count };
+		}
+
+		[[nodiscard]] u32 count_state_changes(const u64* const keys, u32 count)
+		{
+			// NOTE: the pass and root signature are above the pipeline state in the key, so a change of either
+			//       is also a different value here.
+			constexpr u32 state_shift{ content::render_item::sort_key::pso_shift };
+			u32 state_changes{ 0 };
+			u64 current_state{ ~0ull };
+			for (u32 i{ 0 }; i < count; ++i)
+			{
+				const u64 state{ keys[i] >> state_shift };
+				state_changes += state != current_state ? 1 : 0;
+				current_state = state;
+			}
+
+			return state_changes;
+		}
+
+		// Sorts the visible render items by state and then front to back, so the GPU changes root signatures and
+		// pipeline states as little as possible and can reject occluded pixels early.
+		void sort_render_items()
+		{
+			utl::vector<u32>& slots{ frame_cache.draw_slots };
+			sort_cache& cache{ draw_sort_cache };
+			const u32 items_count{ (u32)slots.size() };
+			if (!items_count)
+			{
+				frame_sort_stats = {};
+				return;
+			}
+
+			cache.keys.resize(items_count);
+			cache.indices.resize(items_count);
+			cache.temp_keys.resize(items_count);
+			cache.temp_indices.resize(items_count);
+			cache.slots.resize(items_count);
+
+			content::render_item::get_sort_keys(slots.data(), items_count, cache.keys.data());
+
+			constexpr u32 depth_bits{ content::render_item::sort_key::depth_bits };
+			for (u32 i{ 0 }; i < items_count; ++i)
+			{
+				// NOTE: the bits of a positive float grow with its value, so the top bits are a logarithmic
+				//       depth bucket. The sign bit is always 0 and is left out.
+				const f32 depth{ std::max(cull_cache.depths[i], 0.f) };
+				u32 depth_bucket;
+				memcpy(&depth_bucket, &depth, sizeof(u32));
+				cache.keys[i] |= depth_bucket >> (31 - depth_bits);
+				cache.indices[i] = i;
+			}
+
+			const u32 unsorted_state_changes{ count_state_changes(cache.keys.data(), items_count) };
+			utl::radix_sort(cache.keys.data(), cache.indices.data(), items_count, cache.temp_keys.data(), cache.temp_indices.data());
+			const u32 state_changes{ count_state_changes(cache.keys.data(), items_count) };
+			assert(state_changes <= unsorted_state_changes);
+
+			for (u32 i{ 0 }; i < items_count; ++i)
+			{
+				cache.slots[i] = slots[cache.indices[i]];
+			}
+
+			slots.swap(cache.slots);
+			frame_sort_stats = { state_changes, unsorted_state_changes - state_changes };
+		}
+
+		[[nodiscard]] culling::lod_camera get_lod_camera(const d3d12_frame_info& d3d12_info)
+		{
+			const camera::d3d12_camera& camera{ *d3d12_info.camera };
+			const f32 tan_reference_half_fov{ tanf(lod_reference_fov * 0.5f) };
+			const f32 pixel_ratio{ lod_reference_height / (f32)std::max(d3d12_info.surface_height, 1u) * d3d12_info.info->lod_bias };
+
+			culling::lod_camera lod_info{};
+			DirectX::XMStoreFloat3(&lod_info.position, camera.position());
+			if (camera.projection_type() == graphics::camera::perspective)
+			{
+				// NOTE: field_of_view() is a fraction of pi.
+				lod_info.distance_scale = tanf(camera.field_of_view() * DirectX::XM_PI * 0.5f) / tan_reference_half_fov * pixel_ratio;
+			}
+			else
+			{
+				// the distance at which the reference view shows as much as the orthographic view's height.
+				lod_info.constant = camera.view_height() * 0.5f / tan_reference_half_fov * pixel_ratio;
+			}
+
+			return lod_info;
+		}
+
+		// Computes the LOD metric of every render item in the frame, for frames that don't provide LOD thresholds.
+		void compute_lod_metrics(const d3d12_frame_info& d3d12_info)
+		{
+			lod_metrics_cache& cache{ lod_cache };
+			const frame_info& info{ *d3d12_info.info };
+			const u32 items_count{ info.render_item_count };
+			const u32 padded_count{ (u32)math::align_size_up<4>(items_count) };
+
+			cache.entity_ids.resize(items_count);
+			cache.bounds.resize(items_count);
+			cache.world_spheres.resize(padded_count * 4);
+			cache.scales.resize(padded_count);
+			cache.metrics.resize(padded_count);
+
+			content::render_item::get_item_bounds(info.render_item_ids, items_count, cache.entity_ids.data(), cache.bounds.data());
+
+			const culling::sphere_soa spheres{
+				&cache.world_spheres[0],
+				&cache.world_spheres[padded_count],
+				&cache.world_spheres[padded_count * 2],
+				&cache.world_spheres[padded_count * 3],
+			};
+
+			using namespace DirectX;
+			id::id_type current_entity_id{ id::invalid_id };
+			XMMATRIX world{};
+			f32 scale{ 1.f };
+
+			for (u32 i{ 0 }; i < items_count; ++i)
+			{
+				if (current_entity_id != cache.entity_ids[i])
+				{
+					current_entity_id = cache.entity_ids[i];
+					math::m4x3 world_matrix, inverse_world_matrix;
+					transform::get_transform_matrices(game_entity::entity_id{ current_entity_id }, world_matrix, inverse_world_matrix);
+					world = XMLoadFloat4x3(&world_matrix);
+					const XMVECTOR scale_sq{ XMVectorMax(XMVector3LengthSq(world.r[0]), XMVectorMax(XMVector3LengthSq(world.r[1]), XMVector3LengthSq(world.r[2]))) };
+					scale = sqrtf(XMVectorGetX(scale_sq));
+				}
+
+				const triengine::content::mesh_bounds& bounds{ cache.bounds[i] };
+				math::v3 center;
+				XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&bounds.center), world));
+				spheres.center_x[i] = center.x;
+				spheres.center_y[i] = center.y;
+				spheres.center_z[i] = center.z;
+				spheres.radius[i] = bounds.radius * scale;
+				cache.scales[i] = scale;
+			}
+
+			// NOTE: the padding gets a metric too, so it must not be garbage.
+			for (u32 i{ items_count }; i < padded_count; ++i)
+			{
+				spheres.center_x[i] = spheres.center_y[i] = spheres.center_z[i] = spheres.radius[i] = 0.f;
+				cache.scales[i] = 1.f;
+			}
+
+			culling::compute_lod_metrics(get_lod_camera(d3d12_info), spheres, cache.scales.data(), items_count, cache.metrics.data());
+		}
+
+		void prepare_render_frame(id3d12_graphics_command_list* cmd_list, const d3d12_frame_info& d3d12_info)
 		{
 			assert(d3d12_info.info && d3d12_info.camera);
 			assert(d3d12_info.info->render_item_ids && d3d12_info.info->render_item_count);
@@ -244,19 +662,31 @@ namespace triengine::graphics::d3d12::gpass {
 			cache.clear();
 
 			using namespace content;
-			render_item::get_d3d12_render_item_ids(*d3d12_info.info, cache.d3d12_render_item_ids);
+			const bool has_thresholds{ d3d12_info.info->thresholds != nullptr };
+			if (!has_thresholds) compute_lod_metrics(d3d12_info);
+			render_item::get_draw_slots(*d3d12_info.info, has_thresholds ? nullptr : lod_cache.metrics.data(), cache.draw_slots);
+			if (cache.draw_slots.empty())
+			{
+				// NOTE: none of the items can be drawn yet, e.g. while their pipeline states are compiled.
+				frame_culling_stats = {};
+				frame_sort_stats = {};
+				frame_instancing_stats = {};
+				return;
+			}
+
+			cull_render_items(d3d12_info);
+			update_object_data(cmd_list, cull_cache.entities.data(), (u32)cull_cache.entities.size());
+			sort_render_items();
 			cache.resize();
 			const u32 items_count{ cache.size() };
-			const render_item::items_cache items_cache{ cache.items_cache() };
-			render_item::get_items(cache.d3d12_render_item_ids.data(), items_count, items_cache);
-
-			const submesh::views_cache views_cache{ cache.views_cache() };
-			submesh::get_views(items_cache.submesh_gpu_ids, items_count, views_cache);
-
-			const material::materials_cache material_cache{ cache.material_cache() };
-			material::get_materials(items_cache.material_id, items_count, material_cache);
+			if (!items_count)
+			{
+				frame_instancing_stats = {};
+				return;
+			}
+			render_item::get_draws(cache.draw_slots.data(), items_count, cache.items_cache(), cache.views_cache(), cache.material_cache());
 
-			fill_per_object_data(d3d12_info);
+			fill_object_indices();
 		}
 	} // anonymous namespace
 
@@ -270,6 +700,9 @@ namespace triengine::graphics::d3d12::gpass {
 	{
 		gpass_main_buffer.release();
 		gpass_depth_buffer.release();
+		object_cache.buffer.release();
+		object_cache.entity_ids.clear();
+		object_cache.frames.clear();
 		dimensions = initial_dimensions;
 	}
 
@@ -283,6 +716,21 @@ namespace triengine::graphics::d3d12::gpass {
 		return gpass_depth_buffer;
 	}
 
+	const culling::culling_stats& culling_stats()
+	{
+		return frame_culling_stats;
+	}
+
+	const gpass::sort_stats& draw_sort_stats()
+	{
+		return frame_sort_stats;
+	}
+
+	const gpass::instancing_stats& draw_instancing_stats()
+	{
+		return frame_instancing_stats;
+	}
+
 	void set_size(math::u32v2 size)
 	{
 		math::u32v2& d{ dimensions };
@@ -294,16 +742,16 @@ namespace triengine::graphics::d3d12::gpass {
 	}
 	void depth_prepass(id3d12_graphics_command_list* cmd_list, const d3d12_frame_info& d3d12_info)
 	{
-		prepare_render_frame(d3d12_info);
+		prepare_render_frame(cmd_list, d3d12_info);
 
 		const gpass_cache& cache{ frame_cache };
-		const u32 items_count{ cache.size() };
 
 		ID3D12RootSignature* current_root_signature{ nullptr };
 		ID3D12PipelineState* current_pipeline_state{ nullptr };
 
-		for (u32 i{ 0 }; i < items_count; ++i)
+		for (const instanced_draw& draw : cache.draws)
 		{
+			const u32 i{ draw.first_item };
 			if (current_root_signature != cache.root_signatures[i])
 			{
 				current_root_signature = cache.root_signatures[i];
@@ -324,20 +772,20 @@ namespace triengine::graphics::d3d12::gpass {
 
 			cmd_list->IASetIndexBuffer(&ibv);
 			cmd_list->IASetPrimitiveTopology(cache.primitive_topologies[i]);
-			cmd_list->DrawIndexedInstanced(index_count, 1, 0, 0, 0);
+			cmd_list->DrawIndexedInstanced(index_count, draw.instance_count, 0, 0, 0);
 		}
 	}
 
 	void render(id3d12_graphics_command_list* cmd_list, const d3d12_frame_info& d3d12_info)
 	{
 		const gpass_cache& cache{ frame_cache };
-		const u32 items_count{ cache.size() };
 
 		ID3D12RootSignature* current_root_signature{ nullptr };
 		ID3D12PipelineState* current_pipeline_state{ nullptr };
 
-		for (u32 i{ 0 }; i < items_count; ++i)
+		for (const instanced_draw& draw : cache.draws)
 		{
+			const u32 i{ draw.first_item };
 			if (current_root_signature != cache.root_signatures[i])
 			{
 				current_root_signature = cache.root_signatures[i];
@@ -358,7 +806,7 @@ namespace triengine::graphics::d3d12::gpass {
 
 			cmd_list->IASetIndexBuffer(&ibv);
 			cmd_list->IASetPrimitiveTopology(cache.primitive_topologies[i]);
-			cmd_list->DrawIndexedInstanced(index_count, 1, 0, 0, 0);
+			cmd_list->DrawIndexedInstanced(index_count, draw.instance_count, 0, 0, 0);
 		}
 	}
 
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "D3D12CommonHeader.h"
+#include "D3D12Culling.h"
 
 namespace triengine::graphics::d3d12 {
 	struct d3d12_frame_info;
@@ -18,16 +19,36 @@ namespace triengine::graphics::d3d12::gpass {
 			element_buffer,
 			srv_indices,
 			per_object_data,
+			object_indices,
 
 			count
 		};
 	};
 
+	// Root signature and pipeline state changes in the last frame, after sorting the draws, and how many
+	// more there would have been in submission order.
+	struct sort_stats
+	{
+		u32 state_changes;
+		u32 saved_state_changes;
+	};
+
+	// Draw calls in the last frame and how many render items they drew.
+	struct instancing_stats
+	{
+		u32 draw_count;
+		u32 instance_count;
+	};
+
 	bool initialize();
 	void shutdown();
 
 	[[nodiscard]] const d3d12_render_texture& main_buffer();
 	[[nodiscard]] const d3d12_depth_buffer& depth_buffer();
+	// Number of render items and how many of them passed frustum culling in the last frame.
+	[[nodiscard]] const culling::culling_stats& culling_stats();
+	[[nodiscard]] const gpass::sort_stats& draw_sort_stats();
+	[[nodiscard]] const gpass::instancing_stats& draw_instancing_stats();
 
 	// NOTE: call this every frame before rendering anything to gpass
 	void set_size(math::u32v2 size);
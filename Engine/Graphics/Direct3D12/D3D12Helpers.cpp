@@ -121,8 +121,9 @@ namespace triengine::graphics::d3d12::d3dx {
 			{
 				upload::d3d12_upload_context context{ buffer_size };
 				memcpy(context.cpu_address(), data, buffer_size);
-				context.command_list()->CopyResource(resource, context.upload_buffer());
-				context.end_upload();
+				context.command_list()->CopyBufferRegion(resource, 0, context.upload_buffer(), context.upload_offset(), buffer_size);
+				// NOTE: the caller may use the buffer in the next command list, so this waits until it's copied.
+				upload::wait(context.end_upload());
 			}
 		}
 
@@ -0,0 +1,210 @@
+#include "D3D12Memory.h"
+#include "D3D12Core.h"
+#include "Utilities/TlsfAllocator.h"
+
+namespace triengine::graphics::d3d12::memory {
+	namespace {
+		// NOTE: placed buffers have to be 64KB aligned, which wastes most of a heap on small meshes.
+		//       So geometry is sub-allocated from large committed buffers, and only textures are placed in heaps.
+		constexpr u64 page_size[category::count]{ 64 * 1024 * 1024, 64 * 1024 * 1024 };
+		constexpr u64 granularity[category::count]{ 256, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT };
+
+		struct page
+		{
+			utl::tlsf_allocator allocator;
+			ID3D12Resource* buffer{ nullptr };
+			ID3D12Heap* heap{ nullptr };
+			D3D12_GPU_VIRTUAL_ADDRESS gpu_address{ 0 };
+			category::type category{ category::count };
+			bool is_dedicated{ false };	// made for a single allocation that's too large for a page
+		};
+
+		utl::vector<std::unique_ptr<page>> pages;		// released pages are null
+		utl::vector<gpu_allocation> deferred_frees[frame_buffer_count]{};
+		u32 failed_allocations[category::count]{};
+		std::mutex memory_mutex{};
+
+		// NOTE: the functions below are called with memory_mutex locked.
+		[[nodiscard]] u32 create_page(category::type category, u64 size, bool is_dedicated)
+		{
+			std::unique_ptr<page> p{ std::make_unique<page>() };
+			if (category == category::texture)
+			{
+				D3D12_HEAP_DESC desc{};
+				desc.SizeInBytes = size;
+				desc.Properties = d3dx::heap_properties.default_heap;
+				desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+				desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+				HRESULT hr{ S_OK };
+				DXCall(hr = core::device()->CreateHeap(&desc, IID_PPV_ARGS(&p->heap)));
+				if (FAILED(hr)) return u32_invalid_id;
+				NAME_D3D12_OBJECT_INDEXED(p->heap, size, L"Texture Heap - size");
+			}
+			else
+			{
+				assert(size < u32_invalid_id);
+				p->buffer = d3dx::create_buffer(nullptr, (u32)size);
+				if (!p->buffer) return u32_invalid_id;
+				NAME_D3D12_OBJECT_INDEXED(p->buffer, size, L"Geometry Buffer - size");
+				p->gpu_address = p->buffer->GetGPUVirtualAddress();
+			}
+
+			p->allocator.initialize(size, granularity[category]);
+			p->category = category;
+			p->is_dedicated = is_dedicated;
+
+			for (u32 i{ 0 }; i < pages.size(); ++i)
+			{
+				if (!pages[i])
+				{
+					pages[i] = std::move(p);
+					return i;
+				}
+			}
+
+			pages.emplace_back(std::move(p));
+			return (u32)pages.size() - 1;
+		}
+
+		void release_page(u32 index)
+		{
+			page& p{ *pages[index] };
+			assert(p.allocator.empty());
+			core::release(p.buffer);
+			core::release(p.heap);
+			pages[index].reset();
+		}
+
+		void free(const gpu_allocation& allocation)
+		{
+			assert(allocation.page < pages.size() && pages[allocation.page]);
+			page& p{ *pages[allocation.page] };
+			assert(p.category == allocation.category);
+			p.allocator.free(allocation.handle);
+			if (!p.allocator.empty()) return;
+
+			// keep one empty page of each category, so loading and unloading a mesh doesn't create a page each time.
+			bool has_other_page{ false };
+			for (u32 i{ 0 }; i < pages.size() && !has_other_page; ++i)
+			{
+				has_other_page = i != allocation.page && pages[i] && pages[i]->category == p.category && !pages[i]->is_dedicated;
+			}
+
+			if (p.is_dedicated || has_other_page) release_page(allocation.page);
+		}
+	} // anonymous namespace
+
+	bool initialize()
+	{
+		std::lock_guard lock{ memory_mutex };
+		assert(pages.empty());
+		return create_page(category::geometry, page_size[category::geometry], false) != u32_invalid_id;
+	}
+
+	void shutdown()
+	{
+		for (u32 i{ 0 }; i < frame_buffer_count; ++i)
+		{
+			process_deferred_frees(i);
+		}
+
+		std::lock_guard lock{ memory_mutex };
+		for (u32 i{ 0 }; i < pages.size(); ++i)
+		{
+			if (pages[i]) release_page(i);
+		}
+
+		pages.clear();
+		memset(failed_allocations, 0, sizeof(failed_allocations));
+	}
+
+	gpu_allocation allocate(u64 size, u64 alignment, category::type category)
+	{
+		assert(size && category < category::count);
+		std::lock_guard lock{ memory_mutex };
+
+		u32 page_index{ u32_invalid_id };
+		u32 handle{ utl::tlsf_allocator::invalid_handle };
+		if (math::align_size_up(size, granularity[category]) > page_size[category] / 2)
+		{
+			page_index = create_page(category, math::align_size_up(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT), true);
+			if (page_index != u32_invalid_id) handle = pages[page_index]->allocator.allocate(size, alignment);
+		}
+		else
+		{
+			for (u32 i{ 0 }; i < pages.size() && handle == utl::tlsf_allocator::invalid_handle; ++i)
+			{
+				page* const p{ pages[i].get() };
+				if (!p || p->category != category || p->is_dedicated) continue;
+				handle = p->allocator.allocate(size, alignment);
+				page_index = i;
+			}
+
+			if (handle == utl::tlsf_allocator::invalid_handle)
+			{
+				page_index = create_page(category, page_size[category], false);
+				if (page_index != u32_invalid_id) handle = pages[page_index]->allocator.allocate(size, alignment);
+			}
+		}
+
+		if (handle == utl::tlsf_allocator::invalid_handle)
+		{
+			++failed_allocations[category];
+			return {};
+		}
+
+		const page& p{ *pages[page_index] };
+		gpu_allocation allocation{};
+		allocation.buffer = p.buffer;
+		allocation.heap = p.heap;
+		allocation.offset = p.allocator.offset(handle);
+		allocation.size = p.allocator.size(handle);
+		allocation.gpu_address = p.buffer ? p.gpu_address + allocation.offset : 0;
+		allocation.page = page_index;
+		allocation.handle = handle;
+		allocation.category = category;
+		return allocation;
+	}
+
+	void deferred_free(gpu_allocation& allocation)
+	{
+		if (!allocation.is_valid()) return;
+		const u32 frame_idx{ core::current_frame_index() };
+		{
+			std::lock_guard lock{ memory_mutex };
+			deferred_frees[frame_idx].emplace_back(allocation);
+		}
+
+		core::set_deferred_releases_flag();
+		allocation = {};
+	}
+
+	void process_deferred_frees(u32 frame_idx)
+	{
+		std::lock_guard lock{ memory_mutex };
+		utl::vector<gpu_allocation>& frees{ deferred_frees[frame_idx] };
+		for (const gpu_allocation& allocation : frees) free(allocation);
+		frees.clear();
+	}
+
+	category_stats stats(category::type category)
+	{
+		assert(category < category::count);
+		std::lock_guard lock{ memory_mutex };
+		category_stats stats{};
+		for (const std::unique_ptr<page>& p : pages)
+		{
+			if (!p || p->category != category) continue;
+			const utl::tlsf_allocator::allocator_stats page_stats{ p->allocator.stats() };
+			stats.reserved += page_stats.size;
+			stats.allocated += page_stats.allocated;
+			stats.largest_free_block = std::max(stats.largest_free_block, page_stats.largest_free_block);
+			stats.allocation_count += page_stats.allocation_count;
+			++stats.page_count;
+		}
+
+		stats.failed_allocations = failed_allocations[category];
+		return stats;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "D3D12CommonHeader.h"
+
+namespace triengine::graphics::d3d12::memory {
+	struct category {
+		enum type : u32 {
+			geometry,		// vertex and index data, sub-allocated from large buffers
+			texture,		// placed textures, sub-allocated from large heaps
+			count
+		};
+	};
+
+	struct gpu_allocation
+	{
+		ID3D12Resource* buffer{ nullptr };			// buffer the allocation is in, for geometry
+		ID3D12Heap* heap{ nullptr };				// heap the allocation is in, for textures
+		D3D12_GPU_VIRTUAL_ADDRESS gpu_address{ 0 };	// only for allocations in a buffer
+		u64 offset{ 0 };							// offset in the buffer or heap
+		u64 size{ 0 };
+		u32 page{ u32_invalid_id };
+		u32 handle{ u32_invalid_id };
+		category::type category{ category::count };
+
+		[[nodiscard]] constexpr bool is_valid() const { return page != u32_invalid_id; }
+	};
+
+	struct category_stats
+	{
+		u64 reserved;				// total size of the buffers or heaps of the category
+		u64 allocated;
+		u64 largest_free_block;
+		u32 allocation_count;
+		u32 page_count;
+		u32 failed_allocations;
+	};
+
+	bool initialize();
+	void shutdown();
+
+	// Returns an invalid allocation if the device is out of memory.
+	[[nodiscard]] gpu_allocation allocate(u64 size, u64 alignment, category::type category);
+	// The allocation is freed when the GPU is done with the current frame.
+	void deferred_free(gpu_allocation& allocation);
+	void process_deferred_frees(u32 frame_idx);
+	[[nodiscard]] category_stats stats(category::type category);
+}
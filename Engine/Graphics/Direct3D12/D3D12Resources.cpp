@@ -6,7 +6,6 @@ namespace triengine::graphics::d3d12 {
 
 	bool descriptor_heap::initialize(u32 capacity, bool is_shader_visible)
 	{
-		std::lock_guard lock{ _mutex };
 		assert(capacity && capacity < D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_2);
 		assert(!(_type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER && capacity > D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE));
 
@@ -30,12 +29,8 @@ namespace triengine::graphics::d3d12 {
 		DXCall(hr = device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&_heap)));
 		if (FAILED(hr)) return false;
 
-		_free_handles = std::move(std::make_unique<u32[]>(capacity));
+		_indices.initialize(capacity);
 		_capacity = capacity;
-		_size = 0;
-
-		for (u32 i{ 0 }; i < capacity; ++i) _free_handles[i] = i;
-		DEBUG_OP(for (u32 i{ 0 }; i < frame_buffer_count; ++i) assert(_deferred_free_indices[i].empty()));
 
 		_descriptor_size = device->GetDescriptorHandleIncrementSize(_type);
 		_cpu_start = _heap->GetCPUDescriptorHandleForHeapStart();
@@ -46,36 +41,58 @@ namespace triengine::graphics::d3d12 {
 
 	void descriptor_heap::release()
 	{
-		assert(!_size);
+		// NOTE: the GPU is done with all frames when the heap is released, so descriptors that wait for one are free.
+		_indices.drain_deferred();
+		_indices.release();
 		core::deferred_release(_heap);
 	}
 
 	void descriptor_heap::process_defered_free(u32 frame_idx)
 	{
-		std::lock_guard lock{ _mutex };
 		assert(frame_idx < frame_buffer_count);
-
-		std::vector<u32>& indices{ _deferred_free_indices[frame_idx] };
-		if (!indices.empty())
-		{
-			for (auto index : indices)
-			{
-				--_size;
-				_free_handles[_size] = index;
-			}
-			indices.clear();
-		}
+		_indices.process_deferred(frame_idx);
 	}
 
 	descriptor_handle descriptor_heap::allocate()
 	{
-		std::lock_guard lock{ _mutex };
 		assert(_heap);
-		assert(_size < _capacity);
+		const u32 index{ _indices.allocate() };
+		assert(index != utl::index_allocator::invalid_index);
+		return index != utl::index_allocator::invalid_index ? make_handle(index) : descriptor_handle{};
+	}
+
+	void descriptor_heap::free(descriptor_handle& handle)
+	{
+		if (!handle.is_valid())
+			return;
+
+		defer_free(handle_index(handle), 1);
+		handle = {};
+	}
+
+	descriptor_handle descriptor_heap::allocate_range(u32 count)
+	{
+		assert(_heap && count);
+		const u32 index{ _indices.allocate_range(count) };
+		// NOTE: the heap may still have 'count' free descriptors, but not next to each other.
+		assert(index != utl::index_allocator::invalid_index);
+		return index != utl::index_allocator::invalid_index ? make_handle(index) : descriptor_handle{};
+	}
 
-		const u32 index{ _free_handles[_size] };
-		const u32 offset{ index * _descriptor_size };
-		++_size;
+	void descriptor_heap::free_range(descriptor_handle& first, u32 count)
+	{
+		if (!first.is_valid())
+			return;
+
+		assert(count && first.index + count <= _capacity);
+		defer_free(handle_index(first), count);
+		first = {};
+	}
+
+	descriptor_handle descriptor_heap::make_handle(u32 index)
+	{
+		assert(index < _capacity);
+		const u64 offset{ (u64)index * _descriptor_size };
 
 		descriptor_handle handle{};
 		handle.cpu.ptr = _cpu_start.ptr + offset;
@@ -87,25 +104,25 @@ namespace triengine::graphics::d3d12 {
 		return handle;
 	}
 
-	void descriptor_heap::free(descriptor_handle& handle)
+	u32 descriptor_heap::handle_index(const descriptor_handle& handle) const
 	{
-		if (!handle.is_valid())
-			return;
-		std::lock_guard lock{ _mutex };
 		assert(handle.container == this);
 		assert(handle.cpu.ptr >= _cpu_start.ptr);
 		assert((handle.cpu.ptr - _cpu_start.ptr) % _descriptor_size == 0);
 		assert(handle.index < _capacity);
 		const u32 index{ (u32)(handle.cpu.ptr - _cpu_start.ptr) / _descriptor_size };
 		assert(handle.index == index);
+		return index;
+	}
 
+	void descriptor_heap::defer_free(u32 index, u32 count)
+	{
+		// NOTE: single descriptors wait in the cache of the thread that frees them, which reuses them later.
 		const u32 frame_idx{ core::current_frame_index() };
-		
-		_deferred_free_indices[frame_idx].push_back(index);
+		if (count == 1) _indices.free_deferred(index, frame_idx);
+		else _indices.free_range_deferred(index, count, frame_idx);
 
 		core::set_deferred_releases_flag();
-
-		handle = {};
 	}
 
 #pragma endregion
@@ -140,21 +157,15 @@ namespace triengine::graphics::d3d12 {
 		D3D12_RANGE range{};
 		DXCall(buffer()->Map(0, &range, (void**)(&_cpu_address)));
 		assert(_cpu_address);
+
+		_ring.initialize(size(), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, block_size);
 	}
 
 	u8* const constant_buffer::allocate(u32 size)
 	{
-		std::lock_guard lock{ _mutex };
-		const u32 aligned_size{(u32)d3dx::align_size_for_constant_buffer(size)};
-		assert(_cpu_offset + aligned_size <= _buffer.size());
-		if (_cpu_offset + aligned_size <= _buffer.size())
-		{
-			u8* const address{ _cpu_address + _cpu_offset };
-			_cpu_offset += aligned_size;
-			return address;
-		}
-
-		return nullptr;
+		const u32 offset{ _ring.allocate(size) };
+		assert(offset != utl::ring_allocator::invalid_offset);
+		return offset != utl::ring_allocator::invalid_offset ? _cpu_address + offset : nullptr;
 	}
 
 #pragma endregion
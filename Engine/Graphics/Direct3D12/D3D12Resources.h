@@ -1,5 +1,7 @@
 #pragma once
 #include "D3D12CommonHeader.h"
+#include "Utilities/RingAllocator.h"
+#include "Utilities/IndexAllocator.h"
 
 namespace triengine::graphics::d3d12 {
 	struct descriptor_handle
@@ -17,8 +19,11 @@ namespace triengine::graphics::d3d12 {
 #endif
 	};
 
+	// Descriptors are allocated from a cache per thread, see utl::index_allocator. Descriptor tables are
+	// allocated as contiguous ranges. Freed descriptors are reused once the GPU is done with the current frame.
 	class descriptor_heap
 	{
+		static_assert(frame_buffer_count <= utl::index_allocator::max_deferred_frames);
 	public:
 		explicit descriptor_heap(D3D12_DESCRIPTOR_HEAP_TYPE type) : _type{ type } {}
 		DISABLE_COPY_AND_MOVE(descriptor_heap);
@@ -33,13 +38,17 @@ namespace triengine::graphics::d3d12 {
 
 		[[nodiscard]] descriptor_handle allocate();
 		void free(descriptor_handle& handle);
+		// Returns the first of 'count' consecutive descriptors. Descriptor i is at cpu.ptr/gpu.ptr + i * descriptor_size().
+		[[nodiscard]] descriptor_handle allocate_range(u32 count);
+		void free_range(descriptor_handle& first, u32 count);
+		[[nodiscard]] utl::index_allocator::allocator_stats stats() { return _indices.stats(); }
 
 		[[nodiscard]] constexpr D3D12_DESCRIPTOR_HEAP_TYPE type() const { return _type; }
 		[[nodiscard]] constexpr D3D12_CPU_DESCRIPTOR_HANDLE cpu_start() const { return _cpu_start; }
 		[[nodiscard]] constexpr D3D12_GPU_DESCRIPTOR_HANDLE gpu_start() const { return _gpu_start; }
 		[[nodiscard]] constexpr ID3D12DescriptorHeap* heap() const { return _heap; }
 		[[nodiscard]] constexpr u32 capacity() const { return _capacity; }
-		[[nodiscard]] constexpr u32 size() const { return _size; }
+		[[nodiscard]] u32 size() const { return _indices.allocated(); }
 		[[nodiscard]] constexpr u32 descriptor_size() const { return _descriptor_size; }
 		[[nodiscard]] constexpr bool is_shader_visible() const { return _gpu_start.ptr != 0; }
 
@@ -47,11 +56,13 @@ namespace triengine::graphics::d3d12 {
 		ID3D12DescriptorHeap* _heap{ nullptr };
 		D3D12_CPU_DESCRIPTOR_HANDLE _cpu_start{};
 		D3D12_GPU_DESCRIPTOR_HANDLE _gpu_start{};
-		std::unique_ptr<u32[]> _free_handles{};
-		std::vector<u32> _deferred_free_indices[frame_buffer_count]{};
-		std::mutex _mutex{};
+
+		[[nodiscard]] descriptor_handle make_handle(u32 index);
+		[[nodiscard]] u32 handle_index(const descriptor_handle& handle) const;
+		void defer_free(u32 index, u32 count);
+
+		utl::index_allocator _indices{};
 		u32 _capacity{ 0 };
-		u32 _size{ 0 };
 		u32 _descriptor_size{};
 		const D3D12_DESCRIPTOR_HEAP_TYPE _type{};
 	};
@@ -120,9 +131,13 @@ namespace triengine::graphics::d3d12 {
 		u32 _size{ 0 };
 	};
 
+	// Upload buffer for data that's used for one frame. Allocations are lock-free and made from a ring that spans
+	// all frames in flight. Space is reclaimed when the GPU is done with the frame it was allocated in.
 	class constant_buffer
 	{
 	public:
+		constexpr static u32 block_size{ 16 * 1024 };
+
 		constant_buffer() = default;
 		explicit constant_buffer(d3d12_buffer_init_info info);
 		DISABLE_COPY_AND_MOVE(constant_buffer);
@@ -132,10 +147,13 @@ namespace triengine::graphics::d3d12 {
 		{
 			_buffer.release();
 			_cpu_address = nullptr;
-			_cpu_offset = 0;
+			_ring.reset();
 		}
 
-		constexpr void clear() { _cpu_offset = 0; };
+		// 'fence_value' is signaled when the GPU is done with the frame that was just submitted.
+		// Returns false if too many frames were in flight (see utl::ring_allocator::end_frame()).
+		[[nodiscard]] bool end_frame(u64 fence_value) { return _ring.end_frame(fence_value); }
+		void retire(u64 completed_fence_value) { _ring.retire(completed_fence_value); }
 		[[nodiscard]] u8* const allocate(u32 size);
 
 		template<typename T>
@@ -148,15 +166,15 @@ namespace triengine::graphics::d3d12 {
 		[[nodiscard]] constexpr D3D12_GPU_VIRTUAL_ADDRESS gpu_address() const { return _buffer.gpu_address(); };
 		[[nodiscard]] constexpr u32 size() const { return _buffer.size(); };
 		[[nodiscard]] constexpr u8* const cpu_address() const { return _cpu_address; };
+		[[nodiscard]] utl::ring_allocator::ring_stats stats() const { return _ring.stats(); }
 
 		template<typename T>
-		[[nodiscard]] constexpr D3D12_GPU_VIRTUAL_ADDRESS gpu_address(T* const allocation)
+		[[nodiscard]] constexpr D3D12_GPU_VIRTUAL_ADDRESS gpu_address(T* const allocation) const
 		{
-			std::lock_guard lock{ _mutex };
 			assert(_cpu_address);
 			if (!_cpu_address) return {};
 			const u8* const address{ (const u8* const)allocation };
-			assert(address <= _cpu_address + _cpu_offset);
+			assert(address < _cpu_address + _buffer.size());
 			assert(address >= _cpu_address);
 			const u64 offset{ (u64)(address - _cpu_address) };
 			return _buffer.gpu_address() + offset;
@@ -170,8 +188,7 @@ namespace triengine::graphics::d3d12 {
 	private:
 		d3d12_buffer _buffer{};
 		u8* _cpu_address{ nullptr };
-		u32 _cpu_offset{ 0 };
-		std::mutex _mutex{};
+		utl::ring_allocator _ring{};
 	};
 
 
@@ -3,74 +3,171 @@
 
 namespace triengine::graphics::d3d12::upload {
 	namespace {
-		struct upload_frame
+		struct upload_list
 		{
 			ID3D12CommandAllocator* cmd_allocator{ nullptr };
 			id3d12_graphics_command_list* cmd_list{ nullptr };
-			ID3D12Resource* upload_buffer{ nullptr };
-			void* cpu_address{ nullptr };
-			u64 fence_value{ 0 };
+			u64 fence_value{ 0 };	// submission that last used the list
+			bool is_free{ true };
 
-			void wait_and_reset();
 			void release()
 			{
-				wait_and_reset();
 				core::release(cmd_allocator);
 				core::release(cmd_list);
 			}
+		};
 
-			constexpr bool is_ready() const { return upload_buffer == nullptr; }
+		// Staging space of an upload context. Regions are kept in the order they were taken from the ring,
+		// and the ring's space is reclaimed when the oldest regions are done.
+		struct staging_region
+		{
+			u64 end;				// ring position after the region
+			u64 fence_value;		// 0 until the commands of the context are submitted
+			ID3D12Resource* buffer;	// upload buffer of its own, for uploads that are too large for the ring
+			std::thread::id owner;	// thread that opened the context
 		};
 
-		constexpr u32 upload_frame_count{ 4 };
-		upload_frame upload_frames[upload_frame_count]{};
+		constexpr u32 ring_size{ 64 * 1024 * 1024 };
+		constexpr u32 max_batch_size{ 64 };		// ended contexts that are submitted together
+
+		utl::vector<upload_list> upload_lists;
+		utl::vector<staging_region> regions;
+		utl::vector<u32> pending_lists;
+		utl::vector<u64> pending_regions;
+		u64 retired_region_count{ 0 };			// number of the first region in 'regions'
+		ID3D12Resource* ring_buffer{ nullptr };
+		u8* ring_cpu_address{ nullptr };
+		u64 ring_head{ 0 };
+		u64 ring_tail{ 0 };
 		ID3D12CommandQueue* upload_cmd_queue{ nullptr };
 		ID3D12Fence1* upload_fence{ nullptr };
 		u64 upload_fence_value{ 0 };
-		HANDLE fence_event{};
-		std::mutex frame_mutex{};
-		std::mutex queue_mutex{};
+		std::mutex upload_mutex{};
 
-		void upload_frame::wait_and_reset()
+		// NOTE: the functions below are called with upload_mutex locked.
+		void retire()
 		{
-			assert(upload_fence && fence_event);
-			if (upload_fence->GetCompletedValue() < fence_value)
+			const u64 completed_value{ upload_fence->GetCompletedValue() };
+			u32 count{ 0 };
+			while (count < regions.size() && regions[count].fence_value && regions[count].fence_value <= completed_value)
 			{
-				upload_fence->SetEventOnCompletion(fence_value, fence_event);
-				WaitForSingleObject(fence_event, INFINITE);
+				staging_region& region{ regions[count] };
+				core::release(region.buffer);
+				ring_tail = region.end;
+				++count;
 			}
 
-			core::release(upload_buffer);
-			cpu_address = nullptr;
+			if (!count) return;
+			const u32 size{ (u32)regions.size() };
+			if (count < size) memmove(&regions[0], &regions[count], (size - count) * sizeof(staging_region));
+			regions.resize(size - count);
+			retired_region_count += count;
 		}
 
-		u32 get_available_upload_frame()
+		void submit()
 		{
-			u32 index{ u32_invalid_id };
-			const u32 count{ upload_frame_count };
-			upload_frame* const frames{ &upload_frames[0]};
+			if (pending_lists.empty()) return;
+			ID3D12CommandList* cmd_lists[max_batch_size];
+			const u32 count{ (u32)pending_lists.size() };
+			assert(count <= max_batch_size);
+			for (u32 i{ 0 }; i < count; ++i)
+			{
+				cmd_lists[i] = upload_lists[pending_lists[i]].cmd_list;
+			}
+
+			upload_cmd_queue->ExecuteCommandLists(count, &cmd_lists[0]);
+			++upload_fence_value;
+			DXCall(upload_cmd_queue->Signal(upload_fence, upload_fence_value));
 
 			for (u32 i{ 0 }; i < count; ++i)
 			{
-				if (frames[i].is_ready())
+				upload_list& list{ upload_lists[pending_lists[i]] };
+				list.fence_value = upload_fence_value;
+				list.is_free = true;
+				regions[pending_regions[i] - retired_region_count].fence_value = upload_fence_value;
+			}
+
+			pending_lists.clear();
+			pending_regions.clear();
+		}
+
+		[[nodiscard]] u32 get_free_list()
+		{
+			const u64 completed_value{ upload_fence->GetCompletedValue() };
+			for (u32 i{ 0 }; i < upload_lists.size(); ++i)
+			{
+				upload_list& list{ upload_lists[i] };
+				if (list.is_free && list.fence_value <= completed_value)
 				{
-					index = i;
-					break;
+					list.is_free = false;
+					return i;
 				}
 			}
 
-			// None of the frames are ready. We need to wait for one of them to finish.
-			if (index == u32_invalid_id)
+			upload_list list{};
+			id3d12_device* const device{ core::device() };
+			DXCall(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&list.cmd_allocator)));
+			DXCall(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, list.cmd_allocator, nullptr, IID_PPV_ARGS(&list.cmd_list)));
+			assert(list.cmd_allocator && list.cmd_list);
+			DXCall(list.cmd_list->Close());
+			NAME_D3D12_OBJECT_INDEXED(list.cmd_allocator, upload_lists.size(), L"Upload Command Allocator");
+			NAME_D3D12_OBJECT_INDEXED(list.cmd_list, upload_lists.size(), L"Upload Command List");
+
+			list.is_free = false;
+			upload_lists.emplace_back(list);
+			return (u32)upload_lists.size() - 1;
+		}
+
+		// Takes 'size' bytes from the ring. Returns the number of the region and its offset in the ring, or
+		// u64_invalid_id if the ring is full and the oldest upload is a context that this thread hasn't ended.
+		// NOTE: when the ring is full, this waits for the oldest upload with upload_mutex unlocked.
+		u64 allocate_from_ring(u64 size, std::unique_lock<std::mutex>& lock, u64& offset)
+		{
+			while (true)
 			{
-				index = 0;
-				while (!frames[index].is_ready())
+				retire();
+				u64 position{ ring_head };
+				const u64 ring_offset{ position % ring_size };
+				if (ring_offset + size > ring_size) position += ring_size - ring_offset;
+
+				if (position + size - ring_tail <= ring_size)
 				{
-					index = (index + 1) % count;
+					ring_head = position + size;
+					offset = position % ring_size;
+					regions.emplace_back(staging_region{ ring_head, 0, nullptr, std::this_thread::get_id() });
+					return retired_region_count + regions.size() - 1;
+				}
+
+				submit();
+				assert(!regions.empty());
+				const u64 fence_value{ regions[0].fence_value };
+				// NOTE: the oldest context can't end while this thread waits for it, if this thread opened it.
+				if (!fence_value && regions[0].owner == std::this_thread::get_id()) return u64_invalid_id;
+
+				lock.unlock();
+				if (fence_value)
+				{
+					DXCall(upload_fence->SetEventOnCompletion(fence_value, nullptr));
+				}
+				else
+				{
+					// the oldest context hasn't ended yet.
 					std::this_thread::yield();
 				}
+				lock.lock();
 			}
+		}
 
-			return index;
+		// Creates an upload buffer that's only used by one context. Returns the number of the region.
+		u64 allocate_buffer(u32 size, ID3D12Resource*& upload_buffer, void*& cpu_address)
+		{
+			upload_buffer = d3dx::create_buffer(nullptr, size, true);
+			NAME_D3D12_OBJECT_INDEXED(upload_buffer, size, L"Upload Buffer - size");
+
+			const D3D12_RANGE range{};
+			DXCall(upload_buffer->Map(0, &range, &cpu_address));
+			regions.emplace_back(staging_region{ ring_head, 0, upload_buffer, std::this_thread::get_id() });
+			return retired_region_count + regions.size() - 1;
 		}
 
 		bool init_failed()
@@ -78,55 +175,52 @@ namespace triengine::graphics::d3d12::upload {
 			shutdown();
 			return false;
 		}
-	}
+	} // anonymous namespace
 
 	d3d12_upload_context::d3d12_upload_context(u32 aligned_size)
 	{
-		assert(upload_cmd_queue);
-		// We don't want to lock this function for longer than necessary. So, we scope lock the mutex.
+		assert(upload_cmd_queue && aligned_size);
+		const u64 size{ math::align_size_up(aligned_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT) };
+
+		std::unique_lock lock{ upload_mutex };
+		// NOTE: large uploads get a buffer of their own, so they don't wait for the whole ring to be free.
+		_region = size > ring_size / 2 ? u64_invalid_id : allocate_from_ring(size, lock, _upload_offset);
+		if (_region == u64_invalid_id)
 		{
-			std::lock_guard lock{ frame_mutex };
-			_frame_index = get_available_upload_frame();
-			assert(_frame_index != u32_invalid_id);
-			upload_frames[_frame_index].upload_buffer = (ID3D12Resource*)1;
+			// also used when the ring is full and waiting for it would wait for a context of this thread.
+			_region = allocate_buffer(aligned_size, _upload_buffer, _cpu_address);
+			_upload_offset = 0;
+		}
+		else
+		{
+			_upload_buffer = ring_buffer;
+			_cpu_address = ring_cpu_address + _upload_offset;
 		}
 
-		upload_frame& frame{ upload_frames[_frame_index] };
-		frame.upload_buffer = d3dx::create_buffer(nullptr, aligned_size, true);
-		NAME_D3D12_OBJECT_INDEXED(frame.upload_buffer, aligned_size, L"Upload Buffer - size");
-
-		const D3D12_RANGE range{};
-		DXCall(frame.upload_buffer->Map(0, &range, reinterpret_cast<void**>(&frame.cpu_address)));
-		assert(frame.cpu_address);
-
-		_cmd_list = frame.cmd_list;
-		_upload_buffer = frame.upload_buffer;
-		_cpu_address = frame.cpu_address;
+		_list_index = get_free_list();
+		const upload_list& list{ upload_lists[_list_index] };
+		_cmd_list = list.cmd_list;
+		DXCall(list.cmd_allocator->Reset());
+		DXCall(_cmd_list->Reset(list.cmd_allocator, nullptr));
 		assert(_cmd_list && _upload_buffer && _cpu_address);
-
-		DXCall(frame.cmd_allocator->Reset());
-		DXCall(frame.cmd_list->Reset(frame.cmd_allocator, nullptr));
 	}
 
-	void d3d12_upload_context::end_upload()
+	upload_ticket d3d12_upload_context::end_upload()
 	{
-		assert(_frame_index != u32_invalid_id);
-		upload_frame& frame{ upload_frames[_frame_index] };
-		id3d12_graphics_command_list* const cmd_list{ frame.cmd_list };
-		DXCall(cmd_list->Close());
-
-		std::lock_guard lock{ queue_mutex };
-		ID3D12CommandList* const cmd_lists[]{ cmd_list };
-		ID3D12CommandQueue* const cmd_queue{ upload_cmd_queue };
-		cmd_queue->ExecuteCommandLists(_countof(cmd_lists), cmd_lists);
-
-		++upload_fence_value;
-		frame.fence_value = upload_fence_value;
-		DXCall(cmd_queue->Signal(upload_fence, frame.fence_value));
-
-		// Wait for copy queue to finish. Then release the upload buffer.
-		frame.wait_and_reset();
+		assert(_list_index != u32_invalid_id && _region != u64_invalid_id);
+		DXCall(_cmd_list->Close());
+
+		upload_ticket ticket{};
+		{
+			std::lock_guard lock{ upload_mutex };
+			pending_lists.emplace_back(_list_index);
+			pending_regions.emplace_back(_region);
+			ticket.fence_value = upload_fence_value + 1;
+			if (pending_lists.size() == max_batch_size) submit();
+		}
+
 		DEBUG_OP(new (this) d3d12_upload_context{});
+		return ticket;
 	}
 
 	bool initialize()
@@ -136,59 +230,95 @@ namespace triengine::graphics::d3d12::upload {
 
 		HRESULT hr{ S_OK };
 
-		for (u32 i{ 0 }; i < upload_frame_count; ++i)
-		{
-			upload_frame& frame{ upload_frames[i] };
-			DXCall(hr=device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&frame.cmd_allocator)));
-			if (FAILED(hr)) return init_failed();
-
-			DXCall(hr=device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, frame.cmd_allocator, nullptr, IID_PPV_ARGS(&frame.cmd_list)));
-			if (FAILED(hr)) return init_failed();
-
-			DXCall(frame.cmd_list->Close());
-
-			NAME_D3D12_OBJECT_INDEXED(frame.cmd_allocator, i, L"Upload Command Allocator");
-			NAME_D3D12_OBJECT_INDEXED(frame.cmd_list, i, L"Upload Command List");
-		}
-
 		D3D12_COMMAND_QUEUE_DESC desc{};
 		desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
 		desc.NodeMask = 0;
 		desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
 		desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
 
-		DXCall(hr=core::device()->CreateCommandQueue(&desc, IID_PPV_ARGS(&upload_cmd_queue)));
+		DXCall(hr=device->CreateCommandQueue(&desc, IID_PPV_ARGS(&upload_cmd_queue)));
 		if (FAILED(hr)) return init_failed();
 		NAME_D3D12_OBJECT(upload_cmd_queue, L"Upload Copy Queue");
 
-		DXCall(hr=core::device()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&upload_fence)));
+		DXCall(hr=device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&upload_fence)));
 		if (FAILED(hr)) return init_failed();
 		NAME_D3D12_OBJECT(upload_fence, L"Upload Fence");
 
-		fence_event = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
-		if (fence_event == nullptr) return init_failed();
-		assert(fence_event);
+		ring_buffer = d3dx::create_buffer(nullptr, ring_size, true);
+		if (!ring_buffer) return init_failed();
+		NAME_D3D12_OBJECT(ring_buffer, L"Upload Ring Buffer");
+
+		// NOTE: upload buffers can stay mapped for as long as they exist.
+		const D3D12_RANGE range{};
+		DXCall(hr=ring_buffer->Map(0, &range, reinterpret_cast<void**>(&ring_cpu_address)));
+		if (FAILED(hr)) return init_failed();
+		assert(ring_cpu_address);
 
 		return true;
 	}
 
 	void shutdown()
 	{
-		for (u32 i{ 0 }; i < upload_frame_count; ++i)
 		{
-			upload_frames[i].release();
-		}
+			std::lock_guard lock{ upload_mutex };
+			if (upload_fence)
+			{
+				submit();
+				DXCall(upload_fence->SetEventOnCompletion(upload_fence_value, nullptr));
+				retire();
+			}
 
-		if (fence_event)
-		{
-			CloseHandle(fence_event);
-			fence_event = nullptr;
+			assert(regions.empty() && pending_lists.empty());
+			for (upload_list& list : upload_lists) list.release();
+			upload_lists.clear();
 		}
 
+		core::release(ring_buffer);
+		ring_cpu_address = nullptr;
+		ring_head = 0;
+		ring_tail = 0;
+		retired_region_count = 0;
+
 		core::release(upload_cmd_queue);
 		core::release(upload_fence);
 
 		upload_fence_value = 0;
 	}
 
-}
\ No newline at end of file
+	upload_ticket flush()
+	{
+		std::lock_guard lock{ upload_mutex };
+		submit();
+		return { upload_fence_value };
+	}
+
+	bool is_complete(upload_ticket ticket)
+	{
+		return upload_fence->GetCompletedValue() >= ticket.fence_value;
+	}
+
+	void wait(upload_ticket ticket)
+	{
+		{
+			std::lock_guard lock{ upload_mutex };
+			if (ticket.fence_value > upload_fence_value) submit();
+			assert(ticket.fence_value <= upload_fence_value);
+		}
+
+		if (!is_complete(ticket))
+		{
+			DXCall(upload_fence->SetEventOnCompletion(ticket.fence_value, nullptr));
+		}
+	}
+
+	void sync_queue(ID3D12CommandQueue* cmd_queue)
+	{
+		assert(cmd_queue);
+		std::lock_guard lock{ upload_mutex };
+		submit();
+		if (upload_fence->GetCompletedValue() < upload_fence_value)
+		{
+			DXCall(cmd_queue->Wait(upload_fence, upload_fence_value));
+		}
+	}
+}
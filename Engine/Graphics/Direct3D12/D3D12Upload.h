@@ -2,16 +2,26 @@
 #include "D3D12CommonHeader.h"
 
 namespace triengine::graphics::d3d12::upload {
+	// Identifies the submission that copies the data of an upload context.
+	struct upload_ticket
+	{
+		u64 fence_value{ 0 };
+	};
+
+	// NOTE: the staging memory comes from a persistent upload ring, so copies have to read from upload_offset().
+	//       end_upload() doesn't wait for the copy. The command lists of ended contexts are submitted together,
+	//       when enough of them are queued or when flush(), wait() or sync_queue() is called.
 	class d3d12_upload_context {
 	public:
 		d3d12_upload_context(u32 aligned_size);
 		DISABLE_COPY_AND_MOVE(d3d12_upload_context);
 		~d3d12_upload_context() {}
 
-		void end_upload();
+		upload_ticket end_upload();
 
 		[[nodiscard]] constexpr id3d12_graphics_command_list* const command_list() const { return _cmd_list; }
 		[[nodiscard]] constexpr ID3D12Resource* const upload_buffer() const { return _upload_buffer; }
+		[[nodiscard]] constexpr u64 upload_offset() const { return _upload_offset; }
 		[[nodiscard]] constexpr void* const cpu_address() const { return _cpu_address; }
 
 	private:
@@ -19,9 +29,19 @@ namespace triengine::graphics::d3d12::upload {
 		id3d12_graphics_command_list* _cmd_list{ nullptr };
 		ID3D12Resource* _upload_buffer{ nullptr };
 		void* _cpu_address{ nullptr };
-		u32 _frame_index{ u32_invalid_id };
+		u64 _upload_offset{ 0 };
+		u64 _region{ u64_invalid_id };
+		u32 _list_index{ u32_invalid_id };
 	};
 
 	bool initialize();
 	void shutdown();
-}
\ No newline at end of file
+
+	// Submits the command lists of all ended upload contexts.
+	upload_ticket flush();
+	[[nodiscard]] bool is_complete(upload_ticket ticket);
+	// Blocks until the copy of the ticket is done.
+	void wait(upload_ticket ticket);
+	// Makes 'cmd_queue' wait on the GPU until all ended uploads are done, without blocking the CPU.
+	void sync_queue(ID3D12CommandQueue* cmd_queue);
+}
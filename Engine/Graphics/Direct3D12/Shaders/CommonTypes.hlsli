@@ -21,13 +21,26 @@ struct GlobalShaderData
     float DeltaTime;
 };
 
+// Stored once per entity in a persistent buffer and only updated when the entity's transform changes.
+// The view-projection transform is applied in the shaders using GlobalShaderData.
+// NOTE: world transforms are affine, so the last row is left out. InvWorld is the inverse of the rotation and
+//       scale only, and its top-left 3x3 part transforms normals.
 struct PerObjectData
 {
-    float4x4 World;
-    float4x4 InvWorld;
-    float4x4 WorldViewProjection;
+    float3x4 World;
+    float3x4 InvWorld;
+};
+
+// Stored in front of quantized vertex positions: position = Offset + quantized * Scale
+struct PositionDequantization
+{
+    float3 Offset;
+    float Pad0;
+    float3 Scale;
+    float Pad1;
 };
 
 #ifdef __cplusplus
 static_assert((sizeof(PerObjectData) % 16) == 0, "Make sure PerObjectData is formatted in 16-bytes chunks without any implicit padding.");
+static_assert((sizeof(PositionDequantization) % 16) == 0, "Make sure PositionDequantization is formatted in 16-bytes chunks without any implicit padding.");
 #endif
\ No newline at end of file
@@ -5,6 +5,8 @@
 namespace triengine::graphics::d3d12::hlsl {
 
 	using float4x4 = math::m4x4a;
+	// NOTE: HLSL matrices are column major, so a 4x3 matrix is read as its 3x4 transpose, the same as float4x4.
+	using float3x4 = math::m4x3a;
 	using float4 = math::v4;
 	using float3 = math::v3;
 	using float2 = math::v2;
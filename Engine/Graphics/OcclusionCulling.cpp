@@ -0,0 +1,611 @@
+#include "OcclusionCulling.h"
+#include "Renderer.h"
+#include "Components/Entity.h"
+#include "Components/Transform.h"
+#include "Content/ContentToEngine.h"
+#include "Utilities/IOStream.h"
+#include "Utilities/MeshCodec.h"
+#include "Utilities/ThreadPool.h"
+#include <immintrin.h>
+#include <cfloat>
+
+namespace triengine::graphics::occlusion {
+	namespace {
+		// NOTE: vertices closer to the camera than this (in clip space w) can't be projected safely. Triangles
+		//       that have such a vertex are not rasterized and boxes that have such a corner are always visible.
+		constexpr f32 min_w{ 1e-4f };
+		// Rows of the depth buffer that are rasterized by one job.
+		constexpr u32 band_height{ 8 };
+		static_assert(occlusion_buffer::height % band_height == 0);
+		// Boxes are tested in chunks, so large scenes are spread over the thread pool.
+		constexpr u32 chunk_size{ 256 };
+
+		struct occluder
+		{
+			id::id_type entity_id;
+			utl::vector<math::v3> positions;
+			utl::vector<u32> indices;
+			utl::vector<u32> adjacency;
+		};
+
+		utl::free_list<occluder> occluders;
+		utl::vector<id::id_type> active_occluders;
+		utl::vector<occluder_draw> occluder_draws;
+		occlusion_buffer buffer;
+		std::mutex occluder_mutex;
+
+		// Computes the screen space bounding rectangle (in texels) and the nearest depth of the box.
+		// Returns false if the box can't be projected or is outside the buffer, in which case it is visible.
+		bool project_box(const occludee_box& box, u32& x0, u32& y0, u32& x1, u32& y1, f32& max_depth)
+		{
+			using namespace DirectX;
+			const XMMATRIX wvp{ XMLoadFloat4x4(box.world_view_projection) };
+			XMVECTOR rect_min{ XMVectorReplicate(FLT_MAX) };
+			XMVECTOR rect_max{ XMVectorReplicate(-FLT_MAX) };
+
+			for (u32 i{ 0 }; i < 8; ++i)
+			{
+				const XMVECTOR corner{ XMVectorSet(
+					i & 1 ? box.max.x : box.min.x,
+					i & 2 ? box.max.y : box.min.y,
+					i & 4 ? box.max.z : box.min.z, 1.f) };
+				const XMVECTOR clip{ XMVector4Transform(corner, wvp) };
+				const f32 w{ XMVectorGetW(clip) };
+				if (w <= min_w) return false;
+
+				const XMVECTOR ndc{ XMVectorDivide(clip, XMVectorReplicate(w)) };
+				rect_min = XMVectorMin(rect_min, ndc);
+				rect_max = XMVectorMax(rect_max, ndc);
+			}
+
+			// NOTE: y points down in the buffer, so the top of the rectangle comes from the largest y in clip space.
+			const f32 left{ (XMVectorGetX(rect_min) * 0.5f + 0.5f) * occlusion_buffer::width };
+			const f32 right{ (XMVectorGetX(rect_max) * 0.5f + 0.5f) * occlusion_buffer::width };
+			const f32 top{ (0.5f - XMVectorGetY(rect_max) * 0.5f) * occlusion_buffer::height };
+			const f32 bottom{ (0.5f - XMVectorGetY(rect_min) * 0.5f) * occlusion_buffer::height };
+			if (right < 0.f || bottom < 0.f || left >= (f32)occlusion_buffer::width || top >= (f32)occlusion_buffer::height) return false;
+
+			x0 = (u32)std::max(left, 0.f);
+			y0 = (u32)std::max(top, 0.f);
+			x1 = (u32)std::min(right, (f32)(occlusion_buffer::width - 1));
+			y1 = (u32)std::min(bottom, (f32)(occlusion_buffer::height - 1));
+			max_depth = XMVectorGetZ(rect_max);
+			return true;
+		}
+
+		[[nodiscard]] f32 edge_side(const math::v4& a, const math::v4& b, const math::v4& p)
+		{
+			return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+		}
+
+		// Returns a bit for each edge of the triangle at 'first_index' that's on the outline of the occluder: bit k
+		// for the edge across from its vertex k. Other edges have a triangle on their other side on screen.
+		[[nodiscard]] u8 outline_edges(const math::v4* const vertices, const u32* const indices, const u32* const adjacency, u32 first_index)
+		{
+			u8 outline{ 0 };
+			for (u32 k{ 0 }; k < 3; ++k)
+			{
+				const math::v4& a{ vertices[indices[first_index + k]] };
+				const math::v4& b{ vertices[indices[first_index + (k + 1) % 3]] };
+				const math::v4& c{ vertices[indices[first_index + (k + 2) % 3]] };
+				const u32 across{ adjacency[first_index + k] };
+				if (across == u32_invalid_id || vertices[across].w < 0.f || edge_side(a, b, c) * edge_side(a, b, vertices[across]) >= 0.f)
+				{
+					outline |= 1 << ((k + 2) % 3);
+				}
+			}
+
+			return outline;
+		}
+
+		// Rasterizes a triangle into the rows [first_row, last_row) of the depth buffer, keeping the nearest depth.
+		// Vertices are in screen space: x and y in texels and z is the depth.
+		void rasterize_triangle(f32* const depth, u32 first_row, u32 last_row, math::v4 v0, math::v4 v1, math::v4 v2)
+		{
+			f32 area{ (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x) };
+			if (area == 0.f) return;
+			// NOTE: occluders are rasterized without back-face culling, so both windings are accepted.
+			if (area < 0.f)
+			{
+				std::swap(v1, v2);
+				area = -area;
+			}
+
+			const f32 min_x{ std::min(v0.x, std::min(v1.x, v2.x)) };
+			const f32 max_x{ std::max(v0.x, std::max(v1.x, v2.x)) };
+			const f32 min_y{ std::min(v0.y, std::min(v1.y, v2.y)) };
+			const f32 max_y{ std::max(v0.y, std::max(v1.y, v2.y)) };
+			if (max_x < 0.f || max_y < (f32)first_row || min_x >= (f32)occlusion_buffer::width || min_y >= (f32)last_row) return;
+
+			// texels whose center is inside the triangle are covered.
+			const u32 x0{ (u32)std::max(min_x, 0.f) & ~3u };
+			const u32 x1{ (u32)std::min(max_x, (f32)(occlusion_buffer::width - 1)) };
+			const u32 y0{ std::max((u32)std::max(min_y, 0.f), first_row) };
+			const u32 y1{ std::min((u32)std::min(max_y, (f32)(occlusion_buffer::height - 1)), last_row - 1) };
+
+			// edge functions e(x, y) = a * x + b * y + c are positive inside the triangle.
+			const f32 a0{ v1.y - v2.y }, b0{ v2.x - v1.x }, c0{ -(a0 * v1.x + b0 * v1.y) };
+			const f32 a1{ v2.y - v0.y }, b1{ v0.x - v2.x }, c1{ -(a1 * v2.x + b1 * v2.y) };
+			const f32 a2{ v0.y - v1.y }, b2{ v1.x - v0.x }, c2{ -(a2 * v0.x + b2 * v0.y) };
+
+			// depth is interpolated with the barycentric coordinates, which are the edge functions divided by the area.
+			const f32 inv_area{ 1.f / area };
+			const f32 za{ (v0.z * a0 + v1.z * a1 + v2.z * a2) * inv_area };
+			const f32 zb{ (v0.z * b0 + v1.z * b1 + v2.z * b2) * inv_area };
+			// NOTE: the depth is taken at the corner of the texel that's farthest away, so it's never nearer than
+			//       the occluder anywhere in the texel.
+			const f32 zc{ (v0.z * c0 + v1.z * c1 + v2.z * c2) * inv_area - 0.5f * (fabsf(za) + fabsf(zb)) };
+
+			const __m128 offsets{ _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f) };
+			const __m128 zero{ _mm_setzero_ps() };
+
+			for (u32 y{ y0 }; y <= y1; ++y)
+			{
+				const f32 py{ (f32)y + 0.5f };
+				f32* const row{ &depth[y * occlusion_buffer::width] };
+
+				for (u32 x{ x0 }; x <= x1; x += 4)
+				{
+					const __m128 px{ _mm_add_ps(_mm_set1_ps((f32)x), offsets) };
+					const __m128 e0{ _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(a0)), _mm_set1_ps(b0 * py + c0)) };
+					const __m128 e1{ _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(a1)), _mm_set1_ps(b1 * py + c1)) };
+					const __m128 e2{ _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(a2)), _mm_set1_ps(b2 * py + c2)) };
+					const __m128 inside{ _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero))) };
+					if (!_mm_movemask_ps(inside)) continue;
+
+					const __m128 z{ _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(za)), _mm_set1_ps(zb * py + zc)) };
+					const __m128 old_z{ _mm_loadu_ps(&row[x]) };
+					_mm_storeu_ps(&row[x], _mm_blendv_ps(old_z, _mm_max_ps(old_z, z), inside));
+				}
+			}
+		}
+
+		// Clears the texels in the rows [first_row, last_row) that the edge from a to b passes through, back to the
+		// far plane.
+		void clear_edge(f32* const depth, u32 first_row, u32 last_row, const math::v4& a, const math::v4& b)
+		{
+			const f32 min_y{ std::min(a.y, b.y) };
+			const f32 max_y{ std::max(a.y, b.y) };
+			if (max_y < (f32)first_row || min_y >= (f32)last_row) return;
+
+			const u32 y0{ std::max((u32)std::max(min_y, 0.f), first_row) };
+			const u32 y1{ std::min((u32)std::min(max_y, (f32)(occlusion_buffer::height - 1)), last_row - 1) };
+			const f32 dx_dy{ a.y != b.y ? (b.x - a.x) / (b.y - a.y) : 0.f };
+
+			for (u32 y{ y0 }; y <= y1; ++y)
+			{
+				// the part of the edge that's in this row.
+				f32 left{ a.y != b.y ? a.x + (std::max((f32)y, min_y) - a.y) * dx_dy : a.x };
+				f32 right{ a.y != b.y ? a.x + (std::min((f32)y + 1.f, max_y) - a.y) * dx_dy : b.x };
+				if (left > right) std::swap(left, right);
+				if (right < 0.f || left >= (f32)occlusion_buffer::width) continue;
+
+				const u32 x0{ (u32)std::max(left, 0.f) };
+				const u32 x1{ (u32)std::min(right, (f32)(occlusion_buffer::width - 1)) };
+				f32* const row{ &depth[y * occlusion_buffer::width] };
+				for (u32 x{ x0 }; x <= x1; ++x) row[x] = 0.f;
+			}
+		}
+
+		// Copies the positions and indices of a submesh (see d3d12::content::submesh::add() for the format)
+		// to the occluder and returns a pointer to the next submesh.
+		const u8* append_submesh(occluder& o, const u8* const data)
+		{
+			utl::blob_stream_reader blob{ data };
+
+			const u32 element_size{ blob.read<u32>() };
+			const u32 vertex_count{ blob.read<u32>() };
+			const u32 index_count{ blob.read<u32>() };
+			blob.skip(sizeof(u32)); // skip elements type
+			const u32 topology{ blob.read<u32>() };
+			const u32 encoding{ blob.read<u32>() };
+			const u32 index_size{ (u32)(vertex_count < 1 << 16 ? sizeof(u16) : sizeof(u32)) };
+
+			const bool is_quantized{ (encoding & submesh_encoding::quantized_positions) != 0 };
+			math::v3 offset{}, scale{};
+			if (is_quantized)
+			{
+				blob.read((u8*)&offset, sizeof(math::v3));
+				blob.read((u8*)&scale, sizeof(math::v3));
+			}
+
+			const u32 position_size{ is_quantized ? (u32)sizeof(u16) * 3 : (u32)sizeof(math::v3) };
+			utl::vector<u8> positions(position_size * vertex_count);
+			utl::vector<u32> indices(index_count);
+
+			if (encoding & submesh_encoding::compressed_streams)
+			{
+				const u32 position_stream_size{ blob.read<u32>() };
+				const u32 element_stream_size{ blob.read<u32>() };
+				const u32 index_stream_size{ blob.read<u32>() };
+				const u8* const position_stream{ blob.position() };
+				const u8* const index_stream{ position_stream + position_stream_size + element_stream_size };
+
+				[[maybe_unused]] bool result{ utl::decode_vertex_stream(positions.data(), vertex_count, position_size, position_stream, position_stream_size) };
+				assert(result);
+				result = utl::decode_index_stream(indices.data(), index_count, sizeof(u32), index_stream, index_stream_size);
+				assert(result);
+
+				blob.skip(position_stream_size + element_stream_size + index_stream_size);
+			}
+			else
+			{
+				// NOTE: position and element buffers are padded to 4 bytes, the same as in the GPU buffer.
+				const u32 position_buffer_size{ (u32)math::align_size_up<4>(position_size * vertex_count) };
+				const u32 element_buffer_size{ (u32)math::align_size_up<4>(element_size * vertex_count) };
+				memcpy(positions.data(), blob.position(), position_size * vertex_count);
+				blob.skip(position_buffer_size + element_buffer_size);
+
+				if (index_size == sizeof(u16))
+				{
+					const u16* const indices16{ (const u16*)blob.position() };
+					for (u32 i{ 0 }; i < index_count; ++i) indices[i] = indices16[i];
+				}
+				else
+				{
+					memcpy(indices.data(), blob.position(), index_count * sizeof(u32));
+				}
+				blob.skip(index_size * index_count);
+			}
+
+			// only triangles can hide anything.
+			if (topology != primitive_topology::triangle_list) return blob.position();
+
+			const u32 base_vertex{ (u32)o.positions.size() };
+			o.positions.resize(base_vertex + vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+			{
+				math::v3& p{ o.positions[base_vertex + i] };
+				if (is_quantized)
+				{
+					const u16* const q{ (const u16*)&positions[i * position_size] };
+					p = { offset.x + q[0] * scale.x, offset.y + q[1] * scale.y, offset.z + q[2] * scale.z };
+				}
+				else
+				{
+					memcpy(&p, &positions[i * position_size], sizeof(math::v3));
+				}
+			}
+
+			const u32 first_index{ (u32)o.indices.size() };
+			o.indices.resize(first_index + index_count);
+			for (u32 i{ 0 }; i < index_count; ++i)
+			{
+				o.indices[first_index + i] = base_vertex + indices[i];
+			}
+
+			return blob.position();
+		}
+
+		// Finds the vertex across each edge of the occluder's triangles. Edges that only one triangle has, or more
+		// than two, have none and are always on the outline.
+		// NOTE: vertices are split where the UVs or normals of a mesh are, and submeshes have their own, so
+		//       vertices are matched by position.
+		void build_adjacency(occluder& o)
+		{
+			const u32 vertex_count{ (u32)o.positions.size() };
+			utl::vector<u32> order(vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i) order[i] = i;
+			std::sort(order.begin(), order.end(), [&o](u32 a, u32 b) { return memcmp(&o.positions[a], &o.positions[b], sizeof(math::v3)) < 0; });
+
+			utl::vector<u32> welded(vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+			{
+				const bool is_same{ i > 0 && !memcmp(&o.positions[order[i]], &o.positions[order[i - 1]], sizeof(math::v3)) };
+				welded[order[i]] = is_same ? welded[order[i - 1]] : order[i];
+			}
+
+			struct edge
+			{
+				u64 key;	// welded vertices, smaller one first
+				u32 index;	// of the edge's first vertex in the index list
+			};
+
+			const u32 index_count{ (u32)o.indices.size() / 3 * 3 };
+			utl::vector<edge> edges(index_count);
+			for (u32 i{ 0 }; i < index_count; ++i)
+			{
+				const u32 a{ welded[o.indices[i]] };
+				const u32 b{ welded[o.indices[i - i % 3 + (i + 1) % 3]] };
+				edges[i] = { ((u64)std::min(a, b) << 32) | std::max(a, b), i };
+			}
+
+			std::sort(edges.begin(), edges.end(), [](const edge& a, const edge& b) { return a.key < b.key; });
+
+			o.adjacency.resize(o.indices.size(), u32_invalid_id);
+			for (u32 first{ 0 }; first < index_count;)
+			{
+				u32 last{ first + 1 };
+				while (last < index_count && edges[last].key == edges[first].key) ++last;
+				if (last - first == 2)
+				{
+					// the vertex across an edge is the one of the other triangle that's not on the edge.
+					const u32 i{ edges[first].index };
+					const u32 j{ edges[first + 1].index };
+					o.adjacency[i] = o.indices[j - j % 3 + (j + 2) % 3];
+					o.adjacency[j] = o.indices[i - i % 3 + (i + 2) % 3];
+				}
+
+				first = last;
+			}
+		}
+	} // anonymous namespace
+
+	occlusion_buffer::occlusion_buffer()
+	{
+		u32 size{ 0 };
+		for (u32 i{ 0 }; i < level_count; ++i)
+		{
+			_level_offsets[i] = size;
+			size += (width >> i) * (height >> i);
+		}
+
+		_depth.resize(size, 0.f);
+	}
+
+	void occlusion_buffer::render(const occluder_draw* const draws, u32 draw_count)
+	{
+		assert(draws || !draw_count);
+		// NOTE: depth is cleared to the far plane.
+		memset(_depth.data(), 0, width * height * sizeof(f32));
+
+		utl::vector<u32> first_vertices(draw_count);
+		utl::vector<u32> first_triangles(draw_count);
+		u32 vertex_count{ 0 };
+		u32 triangle_count{ 0 };
+		for (u32 i{ 0 }; i < draw_count; ++i)
+		{
+			first_vertices[i] = vertex_count;
+			first_triangles[i] = triangle_count;
+			vertex_count += draws[i].vertex_count;
+			triangle_count += draws[i].index_count / 3;
+		}
+		_vertices.resize(vertex_count);
+		_outline_edges.resize(triangle_count);
+
+		// transform all vertices to screen space.
+		utl::default_thread_pool().parallel_for(draw_count, [&](u32 draw_index) {
+			using namespace DirectX;
+			const occluder_draw& draw{ draws[draw_index] };
+			const XMMATRIX wvp{ XMLoadFloat4x4(&draw.world_view_projection) };
+			math::v4* const vertices{ &_vertices[first_vertices[draw_index]] };
+
+			for (u32 i{ 0 }; i < draw.vertex_count; ++i)
+			{
+				const XMVECTOR clip{ XMVector3Transform(XMLoadFloat3(&draw.positions[i]), wvp) };
+				const f32 w{ XMVectorGetW(clip) };
+				if (w <= min_w)
+				{
+					vertices[i] = { 0.f, 0.f, 0.f, -1.f };
+					continue;
+				}
+
+				const f32 inv_w{ 1.f / w };
+				vertices[i] = {
+					(XMVectorGetX(clip) * inv_w * 0.5f + 0.5f) * width,
+					(0.5f - XMVectorGetY(clip) * inv_w * 0.5f) * height,
+					XMVectorGetZ(clip) * inv_w,
+					w,
+				};
+			}
+
+			u8* const outlines{ &_outline_edges[first_triangles[draw_index]] };
+			for (u32 i{ 0 }; i + 2 < draw.index_count; i += 3)
+			{
+				outlines[i / 3] = outline_edges(vertices, draw.indices, draw.adjacency, i);
+			}
+		});
+
+		// every job rasterizes all triangles, clipped to its own rows, so no two jobs write the same texels.
+		utl::default_thread_pool().parallel_for(height / band_height, [&](u32 band) {
+			const u32 first_row{ band * band_height };
+			for (u32 draw_index{ 0 }; draw_index < draw_count; ++draw_index)
+			{
+				const occluder_draw& draw{ draws[draw_index] };
+				const math::v4* const vertices{ &_vertices[first_vertices[draw_index]] };
+
+				for (u32 i{ 0 }; i + 2 < draw.index_count; i += 3)
+				{
+					const math::v4& v0{ vertices[draw.indices[i]] };
+					const math::v4& v1{ vertices[draw.indices[i + 1]] };
+					const math::v4& v2{ vertices[draw.indices[i + 2]] };
+					if (v0.w < 0.f || v1.w < 0.f || v2.w < 0.f) continue;
+
+					rasterize_triangle(_depth.data(), first_row, first_row + band_height, v0, v1, v2);
+				}
+			}
+
+			// NOTE: texels are covered where the center is, so the ones an outline edge passes through are only
+			//       partly covered and are cleared, after all triangles, since any of them could cover them again.
+			for (u32 draw_index{ 0 }; draw_index < draw_count; ++draw_index)
+			{
+				const occluder_draw& draw{ draws[draw_index] };
+				const math::v4* const vertices{ &_vertices[first_vertices[draw_index]] };
+				const u8* const outlines{ &_outline_edges[first_triangles[draw_index]] };
+
+				for (u32 i{ 0 }; i + 2 < draw.index_count; i += 3)
+				{
+					const u8 outline{ outlines[i / 3] };
+					const u32* const triangle{ &draw.indices[i] };
+					if (!outline || vertices[triangle[0]].w < 0.f || vertices[triangle[1]].w < 0.f || vertices[triangle[2]].w < 0.f) continue;
+
+					for (u32 k{ 0 }; k < 3; ++k)
+					{
+						if (outline & (1 << k))
+						{
+							clear_edge(_depth.data(), first_row, first_row + band_height, vertices[triangle[(k + 1) % 3]], vertices[triangle[(k + 2) % 3]]);
+						}
+					}
+				}
+			}
+		});
+
+		build_hierarchy();
+	}
+
+	void occlusion_buffer::build_hierarchy()
+	{
+		for (u32 level{ 1 }; level < level_count; ++level)
+		{
+			const f32* const src{ &_depth[_level_offsets[level - 1]] };
+			f32* const dst{ &_depth[_level_offsets[level]] };
+			const u32 src_width{ width >> (level - 1) };
+			const u32 dst_width{ width >> level };
+			const u32 dst_height{ height >> level };
+
+			for (u32 y{ 0 }; y < dst_height; ++y)
+			{
+				const f32* const row0{ &src[(y * 2) * src_width] };
+				const f32* const row1{ row0 + src_width };
+				for (u32 x{ 0 }; x < dst_width; ++x)
+				{
+					dst[y * dst_width + x] = std::min(std::min(row0[x * 2], row0[x * 2 + 1]), std::min(row1[x * 2], row1[x * 2 + 1]));
+				}
+			}
+		}
+	}
+
+	bool occlusion_buffer::is_visible(const occludee_box& box) const
+	{
+		assert(box.world_view_projection);
+		u32 x0, y0, x1, y1;
+		f32 max_depth;
+		if (!project_box(box, x0, y0, x1, y1, max_depth)) return true;
+
+		// use the finest level where the rectangle covers at most 2x2 texels.
+		u32 level{ 0 };
+		while (level + 1 < level_count && (((x1 >> level) - (x0 >> level)) > 1 || ((y1 >> level) - (y0 >> level)) > 1)) ++level;
+
+		const f32* const depth{ &_depth[_level_offsets[level]] };
+		const u32 level_width{ width >> level };
+		for (u32 y{ y0 >> level }; y <= (y1 >> level); ++y)
+		{
+			for (u32 x{ x0 >> level }; x <= (x1 >> level); ++x)
+			{
+				// the box may be in front of the farthest occluder in this texel.
+				if (max_depth >= depth[y * level_width + x]) return true;
+			}
+		}
+
+		return false;
+	}
+
+	u32 occlusion_buffer::cull(const occludee_box* const boxes, u32 count, u32* const visible_indices) const
+	{
+		assert(boxes && visible_indices);
+		if (!count) return 0;
+
+		const u32 chunk_count{ (count + chunk_size - 1) / chunk_size };
+		u32* const visible_counts{ (u32* const)alloca(chunk_count * sizeof(u32)) };
+
+		utl::default_thread_pool().parallel_for(chunk_count, [&](u32 chunk) {
+			const u32 first{ chunk * chunk_size };
+			const u32 last{ std::min(first + chunk_size, count) };
+			u32 visible_count{ 0 };
+			for (u32 i{ first }; i < last; ++i)
+			{
+				visible_indices[first + visible_count] = i;
+				visible_count += is_visible(boxes[i]) ? 1 : 0;
+			}
+			visible_counts[chunk] = visible_count;
+		});
+
+		// each chunk wrote its indices at the chunk's offset, so move them together.
+		u32 visible_count{ visible_counts[0] };
+		for (u32 chunk{ 1 }; chunk < chunk_count; ++chunk)
+		{
+			memmove(&visible_indices[visible_count], &visible_indices[chunk * chunk_size], visible_counts[chunk] * sizeof(u32));
+			visible_count += visible_counts[chunk];
+		}
+
+		assert(visible_count <= count);
+		return visible_count;
+	}
+
+	id::id_type add_occluder(id::id_type entity_id, const void* const geometry_data)
+	{
+		assert(id::is_valid(entity_id) && geometry_data);
+		occluder o{ entity_id };
+
+		utl::blob_stream_reader blob{ (const u8*)geometry_data };
+		const u32 lod_count{ blob.read<u32>() };
+		assert(lod_count);
+		// skip geometry bounds
+		blob.skip(sizeof(content::mesh_bounds));
+
+		// NOTE: the coarsest LOD is used, because the occlusion buffer is too small for details to matter.
+		for (u32 lod_idx{ 0 }; lod_idx < lod_count - 1; ++lod_idx)
+		{
+			// skip threshold
+			blob.skip(sizeof(f32));
+			const u32 submesh_count{ blob.read<u32>() };
+			// skip LOD and submesh bounds, then the submesh data
+			blob.skip(sizeof(content::mesh_bounds) * (1 + submesh_count));
+			blob.skip(blob.read<u32>());
+		}
+
+		blob.skip(sizeof(f32));
+		const u32 submesh_count{ blob.read<u32>() };
+		blob.skip(sizeof(content::mesh_bounds) * (1 + submesh_count) + sizeof(u32));
+
+		const u8* at{ blob.position() };
+		for (u32 i{ 0 }; i < submesh_count; ++i)
+		{
+			at = append_submesh(o, at);
+		}
+
+		build_adjacency(o);
+
+		std::lock_guard lock{ occluder_mutex };
+		const id::id_type id{ occluders.add(std::move(o)) };
+		active_occluders.emplace_back(id);
+		return id;
+	}
+
+	void remove_occluder(id::id_type id)
+	{
+		std::lock_guard lock{ occluder_mutex };
+		for (u32 i{ 0 }; i < active_occluders.size(); ++i)
+		{
+			if (active_occluders[i] == id)
+			{
+				utl::erase_unordered(active_occluders, i);
+				break;
+			}
+		}
+
+		occluders.remove(id);
+	}
+
+	bool render_occluders(DirectX::FXMMATRIX view_projection)
+	{
+		using namespace DirectX;
+		std::lock_guard lock{ occluder_mutex };
+		const u32 occluder_count{ (u32)active_occluders.size() };
+		if (!occluder_count) return false;
+
+		occluder_draws.resize(occluder_count);
+		for (u32 i{ 0 }; i < occluder_count; ++i)
+		{
+			const occluder& o{ occluders[active_occluders[i]] };
+			math::m4x3 world, inverse_world;
+			transform::get_transform_matrices(game_entity::entity_id{ o.entity_id }, world, inverse_world);
+
+			occluder_draw& draw{ occluder_draws[i] };
+			draw.positions = o.positions.data();
+			draw.indices = o.indices.data();
+			draw.adjacency = o.adjacency.data();
+			draw.vertex_count = (u32)o.positions.size();
+			draw.index_count = (u32)o.indices.size();
+			XMStoreFloat4x4(&draw.world_view_projection, XMMatrixMultiply(XMLoadFloat4x3(&world), view_projection));
+		}
+
+		buffer.render(occluder_draws.data(), occluder_count);
+		return true;
+	}
+
+	const occlusion_buffer& shared_buffer()
+	{
+		return buffer;
+	}
+}
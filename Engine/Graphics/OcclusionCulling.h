@@ -0,0 +1,73 @@
+#pragma once
+#include "CommonHeaders.h"
+
+// CPU occlusion culling: occluder meshes are rasterized into a small depth buffer, which is reduced to a
+// hierarchical-Z buffer, and the bounding boxes of render items are tested against it.
+// NOTE: depth is reversed (1 is the near plane and 0 the far plane), the same as the gpass.
+namespace triengine::graphics::occlusion {
+
+	struct occluder_draw
+	{
+		const math::v3* positions;				// model space
+		const u32* indices;						// triangle list
+		const u32* adjacency;					// per index i, the vertex across the edge from it to the next index
+												// of its triangle, or u32_invalid_id (see add_occluder())
+		u32 vertex_count;
+		u32 index_count;
+		math::m4x4 world_view_projection;
+	};
+
+	struct occludee_box
+	{
+		math::v3 min;							// model space bounding box
+		math::v3 max;
+		const math::m4x4* world_view_projection;
+	};
+
+	class occlusion_buffer
+	{
+	public:
+		static constexpr u32 width{ 256 };
+		static constexpr u32 height{ 128 };
+		static constexpr u32 level_count{ 8 }; // down to 2x1 texels
+		static_assert(width % 4 == 0 && (width >> (level_count - 1)) && (height >> (level_count - 1)));
+
+		occlusion_buffer();
+		DISABLE_COPY_AND_MOVE(occlusion_buffer);
+
+		// Clears the buffer and rasterizes the occluders. Horizontal bands of the buffer are rasterized
+		// in parallel, then the hierarchical-Z levels are built.
+		// NOTE: a texel is only covered where an occluder covers all of it, with the farthest depth it has in
+		//       the texel. Texels that an edge of an occluder's outline passes through are cleared for that.
+		void render(const occluder_draw* const draws, u32 draw_count);
+
+		// Returns false if the box is certainly hidden behind the occluders.
+		[[nodiscard]] bool is_visible(const occludee_box& box) const;
+
+		// Writes the indices of the boxes that may be visible to 'visible_indices', in increasing order, and
+		// returns how many there are. 'visible_indices' needs room for 'count' indices.
+		u32 cull(const occludee_box* const boxes, u32 count, u32* const visible_indices) const;
+
+		// Each texel of a level holds the farthest depth of the texels it covers in the level below.
+		// Level 0 is the rasterized depth buffer.
+		[[nodiscard]] const f32* level(u32 index) const { assert(index < level_count); return &_depth[_level_offsets[index]]; }
+
+	private:
+		void build_hierarchy();
+
+		utl::vector<f32>		_depth;
+		utl::vector<math::v4>	_vertices; // screen space x, y and depth. w is negative for vertices behind the near plane.
+		utl::vector<u8>			_outline_edges; // per triangle, a bit for each edge that's on the outline of its occluder
+		u32						_level_offsets[level_count];
+	};
+
+	// Occluders are rendered every frame with their entity's transform. 'geometry_data' has the same format as
+	// for content::create_resource() and its coarsest LOD is used. Occluders should not be larger than the
+	// geometry they stand for, or they'll hide things that are visible.
+	id::id_type add_occluder(id::id_type entity_id, const void* const geometry_data);
+	void remove_occluder(id::id_type id);
+
+	// Renders all occluders to the shared occlusion buffer. Returns false if there are no occluders.
+	bool render_occluders(DirectX::FXMMATRIX view_projection);
+	[[nodiscard]] const occlusion_buffer& shared_buffer();
+}
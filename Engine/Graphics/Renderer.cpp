@@ -1,6 +1,8 @@
 #include "Renderer.h"
 #include "GraphicsPlatformInterface.h"
 #include "Direct3D12\D3D12Interface.h"
+#include "OcclusionCulling.h"
+#include "Utilities\ThreadPool.h"
 
 namespace triengine::graphics {
 	namespace {
@@ -40,6 +42,8 @@ namespace triengine::graphics {
 	void shutdown()
 	{
 		if (gfx.platform != (graphics_platform)-1) gfx.shutdown();
+		// NOTE: culling runs on the shared pool, so its workers are joined here rather than when the module is unloaded.
+		utl::shutdown_default_thread_pool();
 	}
 
 	const char* get_engine_shaders_path()
@@ -276,4 +280,14 @@ namespace triengine::graphics {
 	{
 		gfx.resources.remove_render_item(id);
 	}
+
+	id::id_type add_occluder(id::id_type entity_id, const void* const geometry_data)
+	{
+		return occlusion::add_occluder(entity_id, geometry_data);
+	}
+
+	void remove_occluder(id::id_type id)
+	{
+		occlusion::remove_occluder(id);
+	}
 }
\ No newline at end of file
@@ -4,12 +4,15 @@
 #include "EngineAPI/Camera.h"
 
 namespace triengine::graphics {
+	// NOTE: when 'thresholds' is null, the renderer selects the LODs from how large the render items appear
+	//       to the camera. 'lod_bias' scales that for all items: values above 1 select coarser LODs.
 	struct frame_info
 	{
 		id::id_type* render_item_ids{ nullptr };
 		f32* thresholds{ nullptr };
 		u32 render_item_count{ 0 };
 		camera_id camera_id{ id::invalid_id };
+		f32 lod_bias{ 1.f };
 	};
 
 	DEFINE_TYPED_ID(surface_id);
@@ -161,6 +164,19 @@ namespace triengine::graphics {
 		};
 	};
 
+	// Flags that describe how a submesh's vertex and index data is stored.
+	struct submesh_encoding {
+		enum type : u32 {
+			none = 0x00,
+			compressed_streams = 0x01, // see Utilities/MeshCodec.h
+			quantized_positions = 0x02, // 16 bits per axis, relative to the submesh's bounding box
+		};
+	};
+
+	// Vertex shaders are looked up by the submesh's elements type. Submeshes with quantized positions
+	// add this flag to the key, so they get a shader variant that dequantizes positions.
+	constexpr u32 quantized_positions_shader_key{ 0x100 };
+
 #ifndef PRIMAL_PLUS
 	enum class graphics_platform {
 		direct3d12 = 0,
@@ -189,4 +205,9 @@ namespace triengine::graphics {
 
 	id::id_type add_render_item(id::id_type item_id, id::id_type geometry_content_id, u32 material_count, const id::id_type* const material_ids);
 	void remove_render_item(id::id_type id);
+
+	// Occluders hide render items that are behind them (see OcclusionCulling.h). 'geometry_data' has the
+	// same format as for content::create_resource().
+	id::id_type add_occluder(id::id_type entity_id, const void* const geometry_data);
+	void remove_occluder(id::id_type id);
 }
\ No newline at end of file
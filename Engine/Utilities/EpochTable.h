@@ -0,0 +1,249 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <atomic>
+
+namespace triengine::utl {
+
+	// Epoch based reclamation. A reader marks the epoch in which it started reading, and memory that was unlinked
+	// in an epoch is only freed once no reader is still in that epoch or an earlier one. Readers never wait.
+	class epoch
+	{
+	public:
+		constexpr static u32 max_readers{ 64 };	// threads after this many share a counter, which holds back all reclaiming
+
+		// Memory retired while a guard exists isn't freed until the guard is gone. Guards can be nested.
+		class read_guard
+		{
+		public:
+			read_guard() : _slot{ thread_slot() }
+			{
+				if (_slot == invalid_slot)
+				{
+					fallback_readers().fetch_add(1, std::memory_order_seq_cst);
+					return;
+				}
+
+				std::atomic<u64>& reader{ readers()[_slot] };
+				_is_outer = reader.load(std::memory_order_relaxed) == 0;
+				if (!_is_outer) return;
+
+				// NOTE: has to be visible before the reader loads anything from a table. If the epoch ended before
+				//       it was published, is_safe() may have missed it, so publish the new one.
+				u64 reader_epoch{ 0 };
+				do
+				{
+					reader_epoch = current().load(std::memory_order_seq_cst);
+					reader.store(reader_epoch, std::memory_order_seq_cst);
+				} while (current().load(std::memory_order_seq_cst) != reader_epoch);
+			}
+
+			~read_guard()
+			{
+				if (_slot == invalid_slot) fallback_readers().fetch_sub(1, std::memory_order_release);
+				else if (_is_outer) readers()[_slot].store(0, std::memory_order_release);
+			}
+
+			DISABLE_COPY_AND_MOVE(read_guard);
+		private:
+			u32		_slot;
+			bool	_is_outer{ false };
+		};
+
+		// Ends the current epoch and returns it. Memory unlinked before the call can be freed once
+		// is_safe() is true for the returned epoch.
+		[[nodiscard]] static u64 advance()
+		{
+			return current().fetch_add(1, std::memory_order_seq_cst);
+		}
+
+		[[nodiscard]] static bool is_safe(u64 retired_epoch)
+		{
+			for (u32 i{ 0 }; i < max_readers; ++i)
+			{
+				const u64 reader_epoch{ readers()[i].load(std::memory_order_seq_cst) };
+				if (reader_epoch && reader_epoch <= retired_epoch) return false;
+			}
+
+			// readers without a slot don't record their epoch, so wait until none is reading.
+			return fallback_readers().load(std::memory_order_seq_cst) == 0;
+		}
+
+	private:
+		constexpr static u32 invalid_slot{ u32_invalid_id };
+
+		struct thread_reader
+		{
+			u32 slot{ invalid_slot };
+			bool has_tried{ false };
+
+			~thread_reader()
+			{
+				if (slot != invalid_slot) claimed_slots()[slot].store(false, std::memory_order_release);
+			}
+		};
+
+		[[nodiscard]] static std::atomic<u64>& current()
+		{
+			// NOTE: starts at 1, because 0 marks readers that aren't reading.
+			static std::atomic<u64> epoch{ 1 };
+			return epoch;
+		}
+
+		[[nodiscard]] static std::atomic<u64>* readers()
+		{
+			static std::atomic<u64> epochs[max_readers]{};
+			return &epochs[0];
+		}
+
+		[[nodiscard]] static std::atomic<bool>* claimed_slots()
+		{
+			static std::atomic<bool> claimed[max_readers]{};
+			return &claimed[0];
+		}
+
+		[[nodiscard]] static std::atomic<u32>& fallback_readers()
+		{
+			static std::atomic<u32> count{ 0 };
+			return count;
+		}
+
+		// Each thread takes a reader slot the first time it reads, and gives it back when it exits.
+		[[nodiscard]] static u32 thread_slot()
+		{
+			static thread_local thread_reader reader{};
+			if (!reader.has_tried)
+			{
+				reader.has_tried = true;
+				for (u32 i{ 0 }; i < max_readers; ++i)
+				{
+					bool expected{ false };
+					if (claimed_slots()[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+					{
+						reader.slot = i;
+						break;
+					}
+				}
+			}
+
+			return reader.slot;
+		}
+	};
+
+	// Free list for data that's read far more often than it changes, like content that's looked up while
+	// frames are prepared. Items live in chunks that don't move until the table is destroyed, so reading
+	// an item never takes a lock, even while other threads add or remove items. add() and remove() take a lock.
+	// Removed ids, and memory that an item pointed to, are retired and only reused or freed once no thread
+	// that was in an epoch::read_guard at the time of the removal is still in it.
+	// NOTE: an item is written by add() and doesn't change until it's removed.
+	template<typename T>
+	class epoch_table
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+	public:
+		constexpr static u32 chunk_size{ 1024 };
+		constexpr static u32 max_chunks{ 1024 };
+
+		epoch_table() = default;
+		DISABLE_COPY_AND_MOVE(epoch_table);
+		~epoch_table()
+		{
+			assert(!_size);
+			for (const retired& r : _retired) free(r.memory);
+			for (u32 i{ 0 }; i < max_chunks; ++i)
+			{
+				free(_chunks[i].load(std::memory_order_relaxed));
+			}
+		}
+
+		[[nodiscard]] u32 add(const T& item)
+		{
+			std::lock_guard lock{ _mutex };
+			reclaim_retired();
+
+			u32 id{ u32_invalid_id };
+			if (!_free_ids.empty())
+			{
+				id = _free_ids.back();
+				_free_ids.resize(_free_ids.size() - 1);
+			}
+			else
+			{
+				id = _capacity++;
+				const u32 chunk{ id / chunk_size };
+				assert(chunk < max_chunks);
+				if (!_chunks[chunk].load(std::memory_order_relaxed))
+				{
+					_chunks[chunk].store((T*)malloc(sizeof(T) * chunk_size), std::memory_order_release);
+				}
+			}
+
+			_chunks[id / chunk_size].load(std::memory_order_relaxed)[id % chunk_size] = item;
+			++_size;
+			return id;
+		}
+
+		// 'memory' is freed, with free(), when no reader can be using it anymore.
+		void remove(u32 id, void* const memory = nullptr)
+		{
+			std::lock_guard lock{ _mutex };
+			assert(id < _capacity && _size);
+			_retired.emplace_back(retired{ memory, epoch::advance(), id });
+			--_size;
+			reclaim_retired();
+		}
+
+		// NOTE: doesn't lock. Memory that the item points to is only safe to use while in an epoch::read_guard.
+		[[nodiscard]] const T& operator[](u32 id) const
+		{
+			const T* const items{ _chunks[id / chunk_size].load(std::memory_order_acquire) };
+			assert(id < max_chunks * chunk_size && items);
+			return items[id % chunk_size];
+		}
+
+		// Frees the retired memory that no reader can be using anymore.
+		void reclaim()
+		{
+			std::lock_guard lock{ _mutex };
+			reclaim_retired();
+		}
+
+		[[nodiscard]] u32 size()
+		{
+			std::lock_guard lock{ _mutex };
+			return _size;
+		}
+
+	private:
+		struct retired
+		{
+			void*	memory;
+			u64		epoch;
+			u32		id;
+		};
+
+		// NOTE: called with _mutex locked.
+		void reclaim_retired()
+		{
+			// items are retired in epoch order, so stop at the first one that's still in use.
+			u32 count{ 0 };
+			while (count < _retired.size() && epoch::is_safe(_retired[count].epoch))
+			{
+				free(_retired[count].memory);
+				_free_ids.emplace_back(_retired[count].id);
+				++count;
+			}
+
+			if (!count) return;
+			const u32 size{ (u32)_retired.size() };
+			if (count < size) memmove(&_retired[0], &_retired[count], (size - count) * sizeof(retired));
+			_retired.resize(size - count);
+		}
+
+		std::atomic<T*>		_chunks[max_chunks]{};
+		utl::vector<u32>	_free_ids;
+		utl::vector<retired> _retired;			// oldest first
+		std::mutex			_mutex;
+		u32					_capacity{ 0 };
+		u32					_size{ 0 };
+	};
+}
@@ -0,0 +1,438 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <atomic>
+
+namespace triengine::utl {
+
+	// Hands out indices in [0, capacity), one at a time or as contiguous ranges, like the descriptors of a
+	// descriptor heap. Single indices come from a small cache per thread, which is refilled from and flushed
+	// to the shared free list in batches, so most allocations and frees don't take the lock.
+	// Free ranges are kept sorted and merged with their neighbours. Single indices are taken from the end of
+	// the free space and ranges from the start, so they don't fragment each other more than needed.
+	// Indices that are still in use by the GPU are freed with free_deferred(), which queues them in the thread's
+	// cache until the next process_deferred() for the same frame. The thread then reuses them from its cache.
+	class index_allocator
+	{
+	public:
+		constexpr static u32 invalid_index{ u32_invalid_id };
+		constexpr static u32 cache_size{ 32 };
+		constexpr static u32 max_allocators{ 16 };	// allocators after this many don't use thread caches
+		constexpr static u32 max_deferred_frames{ 4 };
+
+		struct allocator_stats
+		{
+			u32 capacity;
+			u32 allocated;
+			u32 cached;					// free, but held in the cache of a thread
+			u32 deferred;				// freed with free_deferred(), still counted as allocated
+			u32 free_range_count;
+			u32 largest_free_range;		// less than the free count when free space is fragmented
+			u32 failed_allocations;
+		};
+
+		index_allocator() = default;
+		DISABLE_COPY_AND_MOVE(index_allocator);
+		~index_allocator() { release(); }
+
+		void initialize(u32 capacity)
+		{
+			release();
+			assert(capacity && capacity != invalid_index);
+			std::lock_guard lock{ _mutex };
+			_capacity = capacity;
+			_free_ranges.clear();
+			_free_ranges.emplace_back(range{ 0, capacity });
+			_allocated = 0;
+			_cached = 0;
+			_deferred = 0;
+			_failed_allocations = 0;
+
+			// NOTE: a new generation makes threads drop indices they cached from an earlier allocator in the same slot.
+			_generation = next_generation().fetch_add(1, std::memory_order_relaxed);
+			for (u32 i{ 0 }; i < max_allocators; ++i)
+			{
+				u64 expected{ 0 };
+				if (slot_generations()[i].compare_exchange_strong(expected, _generation))
+				{
+					_slot = i;
+					break;
+				}
+			}
+		}
+
+		// NOTE: indices cached by other threads are dropped. All indices should be freed before release, the ones
+		//       freed with free_deferred() that wait in the cache of another thread are dropped as well.
+		void release()
+		{
+			assert(_allocated == _deferred);
+			if (_slot != invalid_index)
+			{
+				slot_generations()[_slot].store(0, std::memory_order_release);
+				_slot = invalid_index;
+			}
+
+			std::lock_guard lock{ _mutex };
+			_free_ranges.clear();
+			for (u32 i{ 0 }; i < max_deferred_frames; ++i) _deferred_ranges[i].clear();
+			_capacity = 0;
+		}
+
+		// Returns invalid_index if all indices are allocated.
+		[[nodiscard]] u32 allocate()
+		{
+			assert(_capacity);
+			thread_cache* const cache{ get_thread_cache() };
+			if (!cache)
+			{
+				std::lock_guard lock{ _mutex };
+				return count_allocation(take_one());
+			}
+
+			reclaim_deferred(*cache);
+			if (!cache->count)
+			{
+				std::lock_guard lock{ _mutex };
+				while (cache->count < cache_size / 2)
+				{
+					const u32 index{ take_one() };
+					if (index == invalid_index) break;
+					cache->indices[cache->count++] = index;
+				}
+				_cached += cache->count;
+			}
+
+			if (!cache->count) return count_allocation(invalid_index);
+
+			--_cached;
+			return count_allocation(cache->indices[--cache->count]);
+		}
+
+		void free(u32 index)
+		{
+			assert(index < _capacity);
+			thread_cache* const cache{ get_thread_cache() };
+			--_allocated;
+			if (!cache)
+			{
+				std::lock_guard lock{ _mutex };
+				insert(index, 1);
+				return;
+			}
+
+			if (cache->count == cache_size)
+			{
+				flush(*cache, cache_size / 2);
+			}
+
+			cache->indices[cache->count++] = index;
+			++_cached;
+		}
+
+		// Returns the first index of 'count' contiguous indices, or invalid_index if there's no free range that large.
+		[[nodiscard]] u32 allocate_range(u32 count)
+		{
+			assert(_capacity && count);
+			std::lock_guard lock{ _mutex };
+			for (u32 i{ 0 }; i < _free_ranges.size(); ++i)
+			{
+				range& r{ _free_ranges[i] };
+				if (r.count < count) continue;
+
+				const u32 first{ r.first };
+				r.first += count;
+				r.count -= count;
+				if (!r.count) erase(i);
+				_allocated += count;
+				return first;
+			}
+
+			++_failed_allocations;
+			return invalid_index;
+		}
+
+		void free_range(u32 first, u32 count)
+		{
+			assert(count && first + count <= _capacity);
+			std::lock_guard lock{ _mutex };
+			insert(first, count);
+			_allocated -= count;
+		}
+
+		// The index is reused after the next process_deferred('frame'). Until then it still counts as allocated.
+		void free_deferred(u32 index, u32 frame)
+		{
+			assert(index < _capacity && frame < max_deferred_frames);
+			thread_cache* const cache{ get_thread_cache() };
+			++_deferred;
+			if (!cache)
+			{
+				std::lock_guard lock{ _mutex };
+				_deferred_ranges[frame].emplace_back(range{ index, 1 });
+				return;
+			}
+
+			reclaim_deferred(*cache);
+			deferred_list& list{ cache->deferred[frame] };
+			if (list.count == cache_size) flush_deferred(*cache, frame);
+
+			// NOTE: if process_deferred() ran since the list's older indices were added, they now wait
+			//       for the next one too, which is later than needed but still safe.
+			list.frame_generation = _frame_generations[frame].load(std::memory_order_acquire);
+			list.indices[list.count++] = index;
+		}
+
+		void free_range_deferred(u32 first, u32 count, u32 frame)
+		{
+			assert(count && first + count <= _capacity && frame < max_deferred_frames);
+			std::lock_guard lock{ _mutex };
+			_deferred_ranges[frame].emplace_back(range{ first, count });
+			_deferred += count;
+		}
+
+		// Makes the indices that were freed for 'frame' before this call free again. Threads take back the ones in
+		// their cache the next time they allocate or free, the others go back to the free list now.
+		void process_deferred(u32 frame)
+		{
+			assert(frame < max_deferred_frames);
+			std::lock_guard lock{ _mutex };
+			_frame_generations[frame].fetch_add(1, std::memory_order_release);
+
+			utl::vector<range>& ranges{ _deferred_ranges[frame] };
+			u32 count{ 0 };
+			for (const range& r : ranges)
+			{
+				insert(r.first, r.count);
+				count += r.count;
+			}
+
+			ranges.clear();
+			_deferred -= count;
+			_allocated -= count;
+		}
+
+		// Makes the indices of all frames that were freed with free_deferred() free again, including the ones in
+		// the cache of the calling thread. Only for when the GPU is done with all frames, like before release().
+		void drain_deferred()
+		{
+			for (u32 i{ 0 }; i < max_deferred_frames; ++i) process_deferred(i);
+
+			thread_cache* const cache{ get_thread_cache() };
+			if (!cache) return;
+			for (u32 i{ 0 }; i < max_deferred_frames; ++i)
+			{
+				if (cache->deferred[i].count) flush_deferred(*cache, i);
+			}
+		}
+
+		[[nodiscard]] allocator_stats stats()
+		{
+			std::lock_guard lock{ _mutex };
+			u32 largest_free_range{ 0 };
+			for (const range& r : _free_ranges) largest_free_range = std::max(largest_free_range, r.count);
+
+			return {
+				_capacity,
+				_allocated.load(std::memory_order_relaxed),
+				_cached.load(std::memory_order_relaxed),
+				_deferred.load(std::memory_order_relaxed),
+				(u32)_free_ranges.size(),
+				largest_free_range,
+				_failed_allocations.load(std::memory_order_relaxed),
+			};
+		}
+
+		[[nodiscard]] constexpr u32 capacity() const { return _capacity; }
+		[[nodiscard]] u32 allocated() const { return _allocated.load(std::memory_order_relaxed); }
+
+	private:
+		struct range
+		{
+			u32 first;
+			u32 count;
+		};
+
+		struct deferred_list
+		{
+			u64 frame_generation{ 0 };	// of the frame when the indices were freed
+			u32 count{ 0 };
+			u32 indices[cache_size];
+		};
+
+		struct thread_cache
+		{
+			index_allocator* owner{ nullptr };
+			u64 generation{ 0 };
+			u32 slot{ 0 };
+			u32 count{ 0 };
+			u32 indices[cache_size];
+			deferred_list deferred[max_deferred_frames];
+
+			~thread_cache()
+			{
+				// give cached indices back when the thread exits, if the allocator is still around.
+				if (!owner || slot_generations()[slot].load(std::memory_order_acquire) != generation) return;
+				if (count) owner->flush(*this, count);
+				for (u32 i{ 0 }; i < max_deferred_frames; ++i)
+				{
+					if (deferred[i].count) owner->flush_deferred(*this, i);
+				}
+			}
+		};
+
+		[[nodiscard]] static std::atomic<u64>* slot_generations()
+		{
+			static std::atomic<u64> generations[max_allocators]{};
+			return &generations[0];
+		}
+
+		[[nodiscard]] static std::atomic<u64>& next_generation()
+		{
+			static std::atomic<u64> generation{ 1 };
+			return generation;
+		}
+
+		[[nodiscard]] thread_cache* get_thread_cache()
+		{
+			if (_slot == invalid_index) return nullptr;
+			static thread_local thread_cache caches[max_allocators]{};
+			thread_cache& cache{ caches[_slot] };
+			if (cache.generation != _generation)
+			{
+				cache.owner = this;
+				cache.generation = _generation;
+				cache.slot = _slot;
+				cache.count = 0;
+				for (deferred_list& list : cache.deferred) list.count = 0;
+			}
+
+			return &cache;
+		}
+
+		[[nodiscard]] u32 count_allocation(u32 index)
+		{
+			if (index == invalid_index) ++_failed_allocations;
+			else ++_allocated;
+			return index;
+		}
+
+		void flush(thread_cache& cache, u32 count)
+		{
+			assert(count <= cache.count);
+			std::lock_guard lock{ _mutex };
+			for (u32 i{ 0 }; i < count; ++i)
+			{
+				insert(cache.indices[--cache.count], 1);
+			}
+			_cached -= count;
+		}
+
+		// Moves the deferred indices that can be reused into the cache.
+		void reclaim_deferred(thread_cache& cache)
+		{
+			for (u32 i{ 0 }; i < max_deferred_frames; ++i)
+			{
+				deferred_list& list{ cache.deferred[i] };
+				if (!list.count || list.frame_generation == _frame_generations[i].load(std::memory_order_acquire)) continue;
+
+				const u32 count{ std::min(list.count, cache_size - cache.count) };
+				list.count -= count;
+				memcpy(&cache.indices[cache.count], &list.indices[list.count], count * sizeof(u32));
+				cache.count += count;
+				_cached += count;
+				_deferred -= count;
+				_allocated -= count;
+
+				if (list.count) flush_deferred(cache, i);
+			}
+		}
+
+		// Gives the deferred indices to the free list if they can be reused, or else to the frame's shared list.
+		void flush_deferred(thread_cache& cache, u32 frame)
+		{
+			deferred_list& list{ cache.deferred[frame] };
+			std::lock_guard lock{ _mutex };
+			if (list.frame_generation != _frame_generations[frame].load(std::memory_order_relaxed))
+			{
+				for (u32 i{ 0 }; i < list.count; ++i) insert(list.indices[i], 1);
+				_deferred -= list.count;
+				_allocated -= list.count;
+			}
+			else
+			{
+				for (u32 i{ 0 }; i < list.count; ++i) _deferred_ranges[frame].emplace_back(range{ list.indices[i], 1 });
+			}
+
+			list.count = 0;
+		}
+
+		// NOTE: the functions below are called with _mutex locked.
+		[[nodiscard]] u32 take_one()
+		{
+			if (_free_ranges.empty()) return invalid_index;
+			range& r{ _free_ranges.back() };
+			const u32 index{ r.first + r.count - 1 };
+			if (!--r.count) _free_ranges.resize(_free_ranges.size() - 1);
+			return index;
+		}
+
+		void insert(u32 first, u32 count)
+		{
+			// find the first free range after 'first'.
+			u32 lo{ 0 };
+			u32 hi{ (u32)_free_ranges.size() };
+			while (lo < hi)
+			{
+				const u32 mid{ (lo + hi) / 2 };
+				if (_free_ranges[mid].first < first) lo = mid + 1;
+				else hi = mid;
+			}
+
+			const u32 size{ (u32)_free_ranges.size() };
+			assert(lo == size || first + count <= _free_ranges[lo].first);
+			assert(!lo || _free_ranges[lo - 1].first + _free_ranges[lo - 1].count <= first);
+			const bool merge_previous{ lo > 0 && _free_ranges[lo - 1].first + _free_ranges[lo - 1].count == first };
+			const bool merge_next{ lo < size && first + count == _free_ranges[lo].first };
+
+			if (merge_previous && merge_next)
+			{
+				_free_ranges[lo - 1].count += count + _free_ranges[lo].count;
+				erase(lo);
+			}
+			else if (merge_previous)
+			{
+				_free_ranges[lo - 1].count += count;
+			}
+			else if (merge_next)
+			{
+				_free_ranges[lo].first = first;
+				_free_ranges[lo].count += count;
+			}
+			else
+			{
+				_free_ranges.emplace_back();
+				if (lo < size) memmove(&_free_ranges[lo + 1], &_free_ranges[lo], (size - lo) * sizeof(range));
+				_free_ranges[lo] = { first, count };
+			}
+		}
+
+		void erase(u32 index)
+		{
+			const u32 size{ (u32)_free_ranges.size() };
+			assert(index < size);
+			if (index + 1 < size) memmove(&_free_ranges[index], &_free_ranges[index + 1], (size - index - 1) * sizeof(range));
+			_free_ranges.resize(size - 1);
+		}
+
+		utl::vector<range>	_free_ranges;		// sorted by first index
+		utl::vector<range>	_deferred_ranges[max_deferred_frames];
+		std::atomic<u64>	_frame_generations[max_deferred_frames]{};
+		std::mutex			_mutex;
+		std::atomic<u32>	_allocated{ 0 };
+		std::atomic<u32>	_cached{ 0 };
+		std::atomic<u32>	_deferred{ 0 };
+		std::atomic<u32>	_failed_allocations{ 0 };
+		u64					_generation{ 0 };
+		u32					_slot{ invalid_index };
+		u32					_capacity{ 0 };
+	};
+}
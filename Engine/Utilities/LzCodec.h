@@ -0,0 +1,155 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace triengine::utl {
+
+	// General purpose LZ77 compression for asset data. The content tools compress and the engine decompresses,
+	// which is mostly plain copies, so it's fast enough to run while loading.
+	//
+	// The stream is a list of sequences. Each sequence is some literal bytes followed by a match, a copy of
+	// earlier output. The last sequence has literals only.
+	//
+	// struct {
+	//     u8 token,					// literal length (high 4 bits) and match length - 4 (low 4 bits)
+	//     u8 literal_length[],			// only if the high bits are 15: bytes that are added until one is < 255
+	//     u8 literals[literal_length],
+	//     u16 offset,					// distance back to the match, 1 to 65535
+	//     u8 match_length[]			// only if the low bits are 15, like literal_length
+	// } sequences[];
+
+	namespace lz_codec {
+		constexpr u32 min_match{ 4 };
+		constexpr u32 max_offset{ 0xffff };
+		constexpr u32 hash_bits{ 16 };
+
+		[[nodiscard]] inline u32 read32(const u8* const p)
+		{
+			u32 v;
+			memcpy(&v, p, sizeof(u32));
+			return v;
+		}
+
+		[[nodiscard]] constexpr u32 hash(u32 v) { return (v * 2654435761u) >> (32 - hash_bits); }
+
+		inline void write_length(u64 length, utl::vector<u8>& stream)
+		{
+			while (length >= 255)
+			{
+				stream.emplace_back((u8)255);
+				length -= 255;
+			}
+			stream.emplace_back((u8)length);
+		}
+
+		[[nodiscard]] inline bool read_length(const u8*& at, const u8* const end, u64& length)
+		{
+			u8 b{ 0 };
+			do
+			{
+				if (at == end) return false;
+				b = *at++;
+				length += b;
+			} while (b == 255);
+			return true;
+		}
+
+		inline void write_sequence(const u8* const literals, u64 literal_count, u64 match_length, u32 offset, utl::vector<u8>& stream)
+		{
+			const u64 match_code{ match_length ? match_length - min_match : 0 };
+			stream.emplace_back((u8)((std::min(literal_count, (u64)15) << 4) | std::min(match_code, (u64)15)));
+			if (literal_count >= 15) write_length(literal_count - 15, stream);
+
+			const u64 position{ stream.size() };
+			stream.resize(position + literal_count);
+			if (literal_count) memcpy(&stream[position], literals, literal_count);
+
+			if (!match_length) return;
+			stream.emplace_back((u8)(offset & 0xff));
+			stream.emplace_back((u8)(offset >> 8));
+			if (match_code >= 15) write_length(match_code - 15, stream);
+		}
+	}
+
+	// Appends the compressed data to 'stream'.
+	// NOTE: the result can be slightly larger than the input, for data that doesn't compress.
+	inline void lz_compress(const u8* const src, u64 size, utl::vector<u8>& stream)
+	{
+		using namespace lz_codec;
+		assert(src || !size);
+		assert(size < u32_invalid_id);
+
+		utl::vector<u32> table(1 << hash_bits, u32_invalid_id);
+		u64 anchor{ 0 };	// first byte that isn't in a sequence yet
+		u64 i{ 0 };
+
+		while (size >= min_match && i <= size - min_match)
+		{
+			const u32 v{ read32(&src[i]) };
+			const u32 h{ hash(v) };
+			const u32 candidate{ table[h] };
+			table[h] = (u32)i;
+
+			if (candidate == u32_invalid_id || i - candidate > max_offset || read32(&src[candidate]) != v)
+			{
+				++i;
+				continue;
+			}
+
+			u64 length{ min_match };
+			while (i + length < size && src[candidate + length] == src[i + length]) ++length;
+
+			write_sequence(&src[anchor], i - anchor, length, (u32)(i - candidate), stream);
+			i += length;
+			anchor = i;
+		}
+
+		write_sequence(&src[anchor], size - anchor, 0, 0, stream);
+	}
+
+	// Returns false if the stream is corrupt or doesn't decompress to exactly 'dst_size' bytes.
+	[[nodiscard]] inline bool lz_decompress(void* const dst, u64 dst_size, const u8* const src, u64 src_size)
+	{
+		using namespace lz_codec;
+		assert(dst && src);
+		u8* const out{ (u8*)dst };
+		const u8* at{ src };
+		const u8* const end{ src + src_size };
+		u64 position{ 0 };
+
+		while (at < end)
+		{
+			const u8 token{ *at++ };
+			u64 literal_count{ (u64)(token >> 4) };
+			if (literal_count == 15 && !read_length(at, end, literal_count)) return false;
+			if (literal_count > (u64)(end - at) || literal_count > dst_size - position) return false;
+			memcpy(&out[position], at, literal_count);
+			at += literal_count;
+			position += literal_count;
+
+			// the last sequence has no match.
+			if (at == end) break;
+
+			if (end - at < 2) return false;
+			const u32 offset{ (u32)at[0] | ((u32)at[1] << 8) };
+			at += 2;
+			u64 length{ (u64)(token & 0x0f) };
+			if (length == 15 && !read_length(at, end, length)) return false;
+			length += min_match;
+			if (!offset || offset > position || length > dst_size - position) return false;
+
+			const u8* from{ &out[position - offset] };
+			if (offset >= length)
+			{
+				memcpy(&out[position], from, length);
+			}
+			else
+			{
+				// NOTE: the match overlaps the bytes it writes, which repeats the last 'offset' bytes.
+				for (u64 j{ 0 }; j < length; ++j) out[position + j] = from[j];
+			}
+			position += length;
+		}
+
+		return position == dst_size;
+	}
+}
@@ -20,6 +20,8 @@ namespace triengine::math {
 	using s32v3 = DirectX::XMINT3;
 	using s32v4 = DirectX::XMINT4;
 	using m3x3 = DirectX::XMFLOAT3X3; // NOTE: DirectXMath doesn't have aligned 3x3 matrices
+	using m4x3 = DirectX::XMFLOAT4X3;
+	using m4x3a = DirectX::XMFLOAT4X3A;
 	using m4x4 = DirectX::XMFLOAT4X4;
 	using m4x4a = DirectX::XMFLOAT4X4A;
 #endif
@@ -0,0 +1,368 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <immintrin.h>
+
+namespace triengine::utl {
+
+	// Lossless compression for packed vertex and index buffers. The content tools encode the streams and
+	// the engine decodes them straight into upload memory. Decoding uses SSE4.1.
+	//
+	// Index stream: indices are stored as zigzag deltas from the previous index, coded with 1 to 4 bytes.
+	// The byte lengths of 4 consecutive values are stored in a separate control byte (2 bits each), so a
+	// decoder can expand 4 values at once with a single shuffle.
+	//
+	// struct {
+	//     u32 index_count,
+	//     u8 control[(index_count + 3) / 4],
+	//     u8 data[]
+	// } index_stream;
+	//
+	// Vertex stream: each vertex is filtered against the previous one (per byte, or per 32-bit word for
+	// float data), then transposed into byte planes. Planes are stored in groups of 16 values using 0, 2, 4
+	// or 8 bits per value, which works well because filtered planes are mostly small numbers.
+	//
+	// struct {
+	//     u32 vertex_count, u32 stride, u32 filter,
+	//     struct {
+	//         struct {
+	//             u8 modes[(group_count + 3) / 4], // 2 bits per group of 16 vertices
+	//             u8 data[]
+	//         } planes[stride];
+	//     } chunks[(vertex_count + vertex_stream_chunk_size - 1) / vertex_stream_chunk_size];
+	// } vertex_stream;
+
+	struct vertex_stream_filter {
+		enum type : u32 {
+			bytes = 0,	// byte-wise delta. Good for mixed element data (colors, packed normals, uvs).
+			words32,	// 32-bit word delta. Good for float positions. Stride must be a multiple of 4.
+
+			count
+		};
+	};
+
+	constexpr u32 vertex_stream_chunk_size{ 256 };
+	constexpr u32 vertex_stream_max_stride{ 64 };
+
+	namespace mesh_codec {
+		constexpr u32 group_size{ 16 };
+
+		struct index_tables
+		{
+			u8 shuffle[256][16];
+			u8 length[256];
+		};
+
+		[[nodiscard]] constexpr index_tables make_index_tables()
+		{
+			index_tables tables{};
+			for (u32 control{ 0 }; control < 256; ++control)
+			{
+				u8 offset{ 0 };
+				for (u32 i{ 0 }; i < 4; ++i)
+				{
+					const u32 length{ ((control >> (i * 2)) & 0x03) + 1 };
+					for (u32 b{ 0 }; b < 4; ++b)
+					{
+						// 0x80 makes pshufb write a zero byte.
+						tables.shuffle[control][i * 4 + b] = b < length ? (u8)(offset + b) : 0x80;
+					}
+					offset += (u8)length;
+				}
+				tables.length[control] = offset;
+			}
+			return tables;
+		}
+
+		inline constexpr index_tables index_lookup{ make_index_tables() };
+
+		[[nodiscard]] constexpr u32 zigzag(s32 v) { return ((u32)v << 1) ^ (u32)(v >> 31); }
+		[[nodiscard]] constexpr s32 unzigzag(u32 v) { return (s32)(v >> 1) ^ -(s32)(v & 1); }
+		[[nodiscard]] constexpr u8 zigzag8(u8 v) { return (u8)((v << 1) ^ (u8)((s8)v >> 7)); }
+
+		inline void write_u32(utl::vector<u8>& stream, u32 value)
+		{
+			for (u32 i{ 0 }; i < 4; ++i) stream.emplace_back((u8)(value >> (i * 8)));
+		}
+
+		[[nodiscard]] inline u32 read_u32(const u8* const data)
+		{
+			u32 value;
+			memcpy(&value, data, sizeof(u32));
+			return value;
+		}
+
+		// Packs 16 values with the fewest bits that fit them all and returns the mode that was used.
+		inline u32 encode_group(const u8* const values, utl::vector<u8>& stream)
+		{
+			u8 max_value{ 0 };
+			for (u32 i{ 0 }; i < group_size; ++i) max_value = std::max(max_value, values[i]);
+
+			const u32 mode{ max_value == 0 ? 0u : max_value < 4 ? 1u : max_value < 16 ? 2u : 3u };
+
+			if (mode == 1)
+			{
+				for (u32 i{ 0 }; i < 4; ++i)
+					stream.emplace_back((u8)(values[i] | (values[i + 4] << 2) | (values[i + 8] << 4) | (values[i + 12] << 6)));
+			}
+			else if (mode == 2)
+			{
+				for (u32 i{ 0 }; i < 8; ++i)
+					stream.emplace_back((u8)(values[i] | (values[i + 8] << 4)));
+			}
+			else if (mode == 3)
+			{
+				for (u32 i{ 0 }; i < group_size; ++i)
+					stream.emplace_back(values[i]);
+			}
+
+			return mode;
+		}
+
+		// Unpacks 16 values and returns the number of bytes read.
+		[[nodiscard]] inline u32 decode_group(const u8* const data, u32 mode, __m128i& values)
+		{
+			switch (mode)
+			{
+			case 0:
+				values = _mm_setzero_si128();
+				return 0;
+			case 1:
+			{
+				const __m128i mask{ _mm_set1_epi8(0x03) };
+				const __m128i packed{ _mm_cvtsi32_si128((s32)read_u32(data)) };
+				const __m128i v0{ _mm_and_si128(packed, mask) };
+				const __m128i v1{ _mm_and_si128(_mm_srli_epi16(packed, 2), mask) };
+				const __m128i v2{ _mm_and_si128(_mm_srli_epi16(packed, 4), mask) };
+				const __m128i v3{ _mm_and_si128(_mm_srli_epi16(packed, 6), mask) };
+				values = _mm_unpacklo_epi64(_mm_unpacklo_epi32(v0, v1), _mm_unpacklo_epi32(v2, v3));
+				return 4;
+			}
+			case 2:
+			{
+				const __m128i mask{ _mm_set1_epi8(0x0f) };
+				const __m128i packed{ _mm_loadl_epi64((const __m128i*)data) };
+				values = _mm_unpacklo_epi64(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+				return 8;
+			}
+			default:
+				values = _mm_loadu_si128((const __m128i*)data);
+				return 16;
+			}
+		}
+	}
+
+	// Appends the encoded indices to 'stream'.
+	inline void encode_index_stream(const u32* const indices, u32 index_count, utl::vector<u8>& stream)
+	{
+		using namespace mesh_codec;
+		assert(indices || !index_count);
+
+		write_u32(stream, index_count);
+		const u64 control_offset{ stream.size() };
+		stream.resize(control_offset + (index_count + 3) / 4);
+
+		u32 previous{ 0 };
+		for (u32 i{ 0 }; i < index_count; ++i)
+		{
+			const u32 value{ zigzag((s32)(indices[i] - previous)) };
+			previous = indices[i];
+
+			const u32 length{ value < (1u << 8) ? 1u : value < (1u << 16) ? 2u : value < (1u << 24) ? 3u : 4u };
+			stream[control_offset + i / 4] |= (u8)((length - 1) << ((i & 3) * 2));
+			for (u32 b{ 0 }; b < length; ++b) stream.emplace_back((u8)(value >> (b * 8)));
+		}
+	}
+
+	// Decodes an index stream into 'dst' as 16 or 32-bit indices. Returns false if the stream is malformed.
+	[[nodiscard]] inline bool decode_index_stream(void* const dst, u32 index_count, u32 index_size, const u8* const src, u64 src_size)
+	{
+		using namespace mesh_codec;
+		assert(dst && src && (index_size == sizeof(u16) || index_size == sizeof(u32)));
+
+		const u64 control_size{ (index_count + 3) / 4 };
+		if (src_size < sizeof(u32) + control_size || read_u32(src) != index_count) return false;
+
+		const u8* control{ src + sizeof(u32) };
+		const u8* data{ control + control_size };
+		const u8* const end{ src + src_size };
+		u16* const dst16{ (u16*)dst };
+		u32* const dst32{ (u32*)dst };
+
+		__m128i previous{ _mm_setzero_si128() };
+		const __m128i one{ _mm_set1_epi32(1) };
+		u32 i{ 0 };
+
+		// NOTE: a group always loads 16 bytes, so the last few groups are decoded by the scalar loop below.
+		for (; i + 4 <= index_count && data + 16 <= end; i += 4, ++control)
+		{
+			const __m128i raw{ _mm_loadu_si128((const __m128i*)data) };
+			data += index_lookup.length[*control];
+
+			__m128i v{ _mm_shuffle_epi8(raw, _mm_loadu_si128((const __m128i*)index_lookup.shuffle[*control])) };
+			v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+			v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+			v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+			v = _mm_add_epi32(v, previous);
+			previous = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+
+			if (index_size == sizeof(u16)) _mm_storel_epi64((__m128i*)&dst16[i], _mm_packus_epi32(v, v));
+			else _mm_storeu_si128((__m128i*)&dst32[i], v);
+		}
+
+		u32 last{ (u32)_mm_cvtsi128_si32(previous) };
+		for (; i < index_count; ++i)
+		{
+			const u32 length{ ((src[sizeof(u32) + i / 4] >> ((i & 3) * 2)) & 0x03) + 1 };
+			if (data + length > end) return false;
+
+			u32 value{ 0 };
+			for (u32 b{ 0 }; b < length; ++b) value |= (u32)data[b] << (b * 8);
+			data += length;
+
+			last += (u32)unzigzag(value);
+			if (index_size == sizeof(u16)) dst16[i] = (u16)last;
+			else dst32[i] = last;
+		}
+
+		return true;
+	}
+
+	// Appends the encoded vertices to 'stream'.
+	inline void encode_vertex_stream(const u8* const vertices, u32 vertex_count, u32 stride, vertex_stream_filter::type filter, utl::vector<u8>& stream)
+	{
+		using namespace mesh_codec;
+		assert(vertices || !vertex_count);
+		assert(stride && stride <= vertex_stream_max_stride && filter < vertex_stream_filter::count);
+		assert(filter != vertex_stream_filter::words32 || (stride & 3) == 0);
+
+		write_u32(stream, vertex_count);
+		write_u32(stream, stride);
+		write_u32(stream, filter);
+
+		u8 previous[vertex_stream_max_stride]{};
+		u8 planes[vertex_stream_max_stride][vertex_stream_chunk_size];
+
+		for (u32 first{ 0 }; first < vertex_count; first += vertex_stream_chunk_size)
+		{
+			const u32 count{ std::min(vertex_count - first, vertex_stream_chunk_size) };
+			const u32 group_count{ (count + group_size - 1) / group_size };
+			memset(planes, 0, sizeof(planes));
+
+			for (u32 v{ 0 }; v < count; ++v)
+			{
+				const u8* const vertex{ &vertices[(u64)(first + v) * stride] };
+				if (filter == vertex_stream_filter::bytes)
+				{
+					for (u32 k{ 0 }; k < stride; ++k)
+						planes[k][v] = zigzag8((u8)(vertex[k] - previous[k]));
+				}
+				else
+				{
+					for (u32 k{ 0 }; k < stride; k += 4)
+					{
+						const u32 delta{ zigzag((s32)(read_u32(&vertex[k]) - read_u32(&previous[k]))) };
+						for (u32 b{ 0 }; b < 4; ++b) planes[k + b][v] = (u8)(delta >> (b * 8));
+					}
+				}
+
+				memcpy(previous, vertex, stride);
+			}
+
+			for (u32 k{ 0 }; k < stride; ++k)
+			{
+				const u64 modes_offset{ stream.size() };
+				stream.resize(modes_offset + (group_count + 3) / 4);
+				for (u32 g{ 0 }; g < group_count; ++g)
+				{
+					const u32 mode{ encode_group(&planes[k][g * group_size], stream) };
+					stream[modes_offset + g / 4] |= (u8)(mode << ((g & 3) * 2));
+				}
+			}
+		}
+	}
+
+	// Decodes a vertex stream into 'dst'. Vertices are built in a small cached buffer and copied out one
+	// chunk at a time, so 'dst' is written sequentially and can be write-combined upload memory.
+	// Returns false if the stream is malformed.
+	[[nodiscard]] inline bool decode_vertex_stream(void* const dst, u32 vertex_count, u32 stride, const u8* const src, u64 src_size)
+	{
+		using namespace mesh_codec;
+		assert(dst && src && stride && stride <= vertex_stream_max_stride);
+
+		if (src_size < sizeof(u32) * 3 || read_u32(src) != vertex_count || read_u32(src + 4) != stride) return false;
+		const u32 filter{ read_u32(src + 8) };
+		if (filter >= vertex_stream_filter::count || (filter == vertex_stream_filter::words32 && (stride & 3))) return false;
+
+		const u8* data{ src + sizeof(u32) * 3 };
+		const u8* const end{ src + src_size };
+		u8* out{ (u8*)dst };
+
+		alignas(16) u8 planes[vertex_stream_max_stride][vertex_stream_chunk_size];
+		alignas(16) u8 chunk[vertex_stream_max_stride * vertex_stream_chunk_size];
+		u8 carry[vertex_stream_max_stride]{};
+		u32 previous[vertex_stream_max_stride / 4]{};
+
+		const __m128i one{ _mm_set1_epi8(1) };
+		const __m128i low_bits{ _mm_set1_epi8(0x7f) };
+
+		for (u32 first{ 0 }; first < vertex_count; first += vertex_stream_chunk_size)
+		{
+			const u32 count{ std::min(vertex_count - first, vertex_stream_chunk_size) };
+			const u32 group_count{ (count + group_size - 1) / group_size };
+
+			for (u32 k{ 0 }; k < stride; ++k)
+			{
+				const u8* const modes{ data };
+				data += (group_count + 3) / 4;
+				if (data > end) return false;
+
+				__m128i sum{ _mm_set1_epi8((char)carry[k]) };
+				for (u32 g{ 0 }; g < group_count; ++g)
+				{
+					const u32 mode{ (u32)(modes[g / 4] >> ((g & 3) * 2)) & 0x03 };
+					constexpr u32 group_bytes[4]{ 0, 4, 8, 16 };
+					if (data + group_bytes[mode] > end) return false;
+
+					__m128i v;
+					data += decode_group(data, mode, v);
+
+					if (filter == vertex_stream_filter::bytes)
+					{
+						// undo zigzag, then a running sum across the group.
+						v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), low_bits), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, one)));
+						v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+						v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+						v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+						v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+						v = _mm_add_epi8(v, sum);
+						sum = _mm_shuffle_epi8(v, _mm_set1_epi8(15));
+					}
+
+					_mm_store_si128((__m128i*)&planes[k][g * group_size], v);
+				}
+
+				carry[k] = (u8)_mm_cvtsi128_si32(sum);
+			}
+
+			for (u32 v{ 0 }; v < count; ++v)
+			{
+				u8* const vertex{ &chunk[v * stride] };
+				for (u32 k{ 0 }; k < stride; ++k) vertex[k] = planes[k][v];
+
+				if (filter == vertex_stream_filter::words32)
+				{
+					for (u32 w{ 0 }; w < stride / 4; ++w)
+					{
+						previous[w] += (u32)unzigzag(read_u32(&vertex[w * 4]));
+						memcpy(&vertex[w * 4], &previous[w], sizeof(u32));
+					}
+				}
+			}
+
+			memcpy(out, chunk, (u64)count * stride);
+			out += (u64)count * stride;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace triengine::utl {
+
+	// Sorts 'keys' in increasing order and moves 'values' along with them. The sort is stable.
+	// 'temp_keys' and 'temp_values' need room for 'count' elements. Keys are sorted 8 bits at a time,
+	// starting with the least significant byte. Bytes that are the same in every key are skipped.
+	inline void radix_sort(u64* keys, u32* values, u32 count, u64* temp_keys, u32* temp_values)
+	{
+		if (count < 2) return;
+		assert(keys && values && temp_keys && temp_values);
+		u64* const sorted_keys{ keys };
+		u32* const sorted_values{ values };
+
+		// NOTE: histograms of all 8 bytes are built in a single pass over the keys.
+		u32 histograms[8][256]{};
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			const u64 key{ keys[i] };
+			for (u32 b{ 0 }; b < 8; ++b)
+			{
+				++histograms[b][(key >> (b * 8)) & 0xff];
+			}
+		}
+
+		for (u32 b{ 0 }; b < 8; ++b)
+		{
+			u32* const histogram{ histograms[b] };
+			// all keys have the same value for this byte, so they're already in order.
+			if (histogram[(keys[0] >> (b * 8)) & 0xff] == count) continue;
+
+			u32 offset{ 0 };
+			for (u32 i{ 0 }; i < 256; ++i)
+			{
+				const u32 bucket_size{ histogram[i] };
+				histogram[i] = offset;
+				offset += bucket_size;
+			}
+
+			for (u32 i{ 0 }; i < count; ++i)
+			{
+				const u32 index{ histogram[(keys[i] >> (b * 8)) & 0xff]++ };
+				temp_keys[index] = keys[i];
+				temp_values[index] = values[i];
+			}
+
+			std::swap(keys, temp_keys);
+			std::swap(values, temp_values);
+		}
+
+		// after an odd number of passes the sorted data is in the temporary arrays.
+		if (keys != sorted_keys)
+		{
+			memcpy(sorted_keys, keys, count * sizeof(u64));
+			memcpy(sorted_values, values, count * sizeof(u32));
+		}
+	}
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <atomic>
+
+namespace triengine::utl {
+
+	// Hands out space from a fixed size ring for data that only lives until the GPU is done with a frame.
+	// The ring only deals with offsets, so it can manage any memory, like a mapped upload buffer.
+	// Allocation is lock-free. Each thread takes a block from the ring and makes small allocations from it,
+	// so most allocations don't touch shared state at all.
+	// NOTE: end_frame() and retire() are called by the thread that submits frames, while no other thread
+	//       allocates for that frame. Allocators after the first max_allocators don't use thread blocks.
+	class ring_allocator
+	{
+	public:
+		constexpr static u32 invalid_offset{ u32_invalid_id };
+		constexpr static u32 max_frames{ 8 };
+		constexpr static u32 max_allocators{ 8 };
+
+		struct ring_stats
+		{
+			u32 capacity;
+			u32 used;					// allocated in frames that haven't retired, including unused block space
+			u32 high_water_mark;		// most that was ever used
+			u32 failed_allocations;
+			u32 frame_overflows;		// frames ended while max_frames were in flight (see end_frame())
+		};
+
+		ring_allocator() = default;
+		DISABLE_COPY_AND_MOVE(ring_allocator);
+		~ring_allocator() { release_slot(); }
+
+		// 'alignment' must be a power of 2 and 'block_size' a multiple of it. Allocations larger than
+		// a quarter of a block are taken directly from the ring.
+		void initialize(u32 capacity, u32 alignment, u32 block_size)
+		{
+			assert(capacity && alignment && !(alignment & (alignment - 1)));
+			assert(block_size && block_size % alignment == 0 && block_size <= capacity);
+			_capacity = capacity;
+			_alignment = alignment;
+			_block_size = block_size;
+			reset();
+
+			release_slot();
+			for (u32 i{ 0 }; i < max_allocators; ++i)
+			{
+				bool expected{ false };
+				if (claimed_slots()[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+				{
+					_slot = i;
+					break;
+				}
+			}
+		}
+
+		void reset()
+		{
+			_head.store(0, std::memory_order_relaxed);
+			_tail.store(0, std::memory_order_relaxed);
+			_high_water_mark.store(0, std::memory_order_relaxed);
+			_failed_allocations.store(0, std::memory_order_relaxed);
+			_frame_overflows = 0;
+			_first_frame = 0;
+			_frame_count = 0;
+			new_epoch();
+		}
+
+		// Returns the offset of 'size' bytes, aligned to the ring's alignment, or invalid_offset if
+		// the ring is full.
+		[[nodiscard]] u32 allocate(u32 size)
+		{
+			assert(_capacity && size);
+			const u64 aligned_size{ math::align_size_up(size, _alignment) };
+			if (aligned_size > _block_size / 4 || _slot == invalid_slot)
+			{
+				const u64 position{ allocate_from_ring(aligned_size) };
+				return position == invalid_position ? invalid_offset : (u32)(position % _capacity);
+			}
+
+			// NOTE: blocks can't be used after the frame they were taken in has ended, because they're reclaimed
+			//       with that frame. Epochs are unique to an allocator and a frame, so a block left by an earlier
+			//       allocator in the same slot is never used.
+			static thread_local thread_block blocks[max_allocators]{};
+			thread_block& block{ blocks[_slot] };
+
+			const u32 epoch{ _epoch.load(std::memory_order_acquire) };
+			if (block.epoch != epoch || block.next + aligned_size > block.end)
+			{
+				const u64 position{ allocate_from_ring(_block_size) };
+				if (position == invalid_position) return invalid_offset;
+				block = { epoch, position, position + _block_size };
+			}
+
+			const u64 position{ block.next };
+			block.next += aligned_size;
+			return (u32)(position % _capacity);
+		}
+
+		// Ends the allocations of a frame. Its space is reclaimed once 'fence_value' is passed to retire().
+		// Returns false if max_frames were already in flight. The frame is then merged with the newest one, so
+		// its space is still reclaimed, but only with the later fence value. Overflows are counted in stats().
+		[[nodiscard]] bool end_frame(u64 fence_value)
+		{
+			assert(!_frame_count || _frames[(_first_frame + _frame_count - 1) % max_frames].fence_value <= fence_value);
+			const u64 end{ _head.load(std::memory_order_relaxed) };
+			new_epoch();
+
+			if (_frame_count == max_frames)
+			{
+				_frames[(_first_frame + _frame_count - 1) % max_frames] = { end, fence_value };
+				++_frame_overflows;
+				return false;
+			}
+
+			_frames[(_first_frame + _frame_count) % max_frames] = { end, fence_value };
+			++_frame_count;
+			return true;
+		}
+
+		// Reclaims the space of all frames whose fence value is 'completed_fence_value' or less.
+		void retire(u64 completed_fence_value)
+		{
+			while (_frame_count && _frames[_first_frame].fence_value <= completed_fence_value)
+			{
+				_tail.store(_frames[_first_frame].end, std::memory_order_release);
+				_first_frame = (_first_frame + 1) % max_frames;
+				--_frame_count;
+			}
+		}
+
+		[[nodiscard]] ring_stats stats() const
+		{
+			return {
+				_capacity,
+				(u32)(_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_relaxed)),
+				_high_water_mark.load(std::memory_order_relaxed),
+				_failed_allocations.load(std::memory_order_relaxed),
+				_frame_overflows,
+			};
+		}
+
+		[[nodiscard]] constexpr u32 capacity() const { return _capacity; }
+
+	private:
+		constexpr static u64 invalid_position{ ~0ull };
+		constexpr static u32 invalid_slot{ u32_invalid_id };
+
+		struct thread_block
+		{
+			u32 epoch;
+			u64 next;
+			u64 end;
+		};
+
+		[[nodiscard]] static std::atomic<bool>* claimed_slots()
+		{
+			static std::atomic<bool> claimed[max_allocators]{};
+			return &claimed[0];
+		}
+
+		void release_slot()
+		{
+			if (_slot == invalid_slot) return;
+			claimed_slots()[_slot].store(false, std::memory_order_release);
+			_slot = invalid_slot;
+		}
+
+		struct frame
+		{
+			u64 end;
+			u64 fence_value;
+		};
+
+		void new_epoch()
+		{
+			static std::atomic<u32> next_epoch{ 1 };
+			_epoch.store(next_epoch.fetch_add(1, std::memory_order_relaxed), std::memory_order_release);
+		}
+
+		// Positions only grow and the offset in the ring is the position modulo capacity.
+		// An allocation that doesn't fit before the end of the ring starts at the beginning.
+		[[nodiscard]] u64 allocate_from_ring(u64 size)
+		{
+			u64 head{ _head.load(std::memory_order_relaxed) };
+			u64 new_head;
+			u64 position;
+			do
+			{
+				position = head;
+				const u64 offset{ position % _capacity };
+				if (offset + size > _capacity) position += _capacity - offset;
+				new_head = position + size;
+
+				if (new_head - _tail.load(std::memory_order_acquire) > _capacity)
+				{
+					_failed_allocations.fetch_add(1, std::memory_order_relaxed);
+					return invalid_position;
+				}
+			} while (!_head.compare_exchange_weak(head, new_head, std::memory_order_relaxed));
+
+			const u32 used{ (u32)(new_head - _tail.load(std::memory_order_relaxed)) };
+			u32 high_water_mark{ _high_water_mark.load(std::memory_order_relaxed) };
+			while (used > high_water_mark && !_high_water_mark.compare_exchange_weak(high_water_mark, used, std::memory_order_relaxed)) {}
+
+			return position;
+		}
+
+		std::atomic<u64>	_head{ 0 };					// position of the next allocation
+		std::atomic<u64>	_tail{ 0 };					// end of the last retired frame
+		std::atomic<u32>	_epoch{ 0 };
+		std::atomic<u32>	_high_water_mark{ 0 };
+		std::atomic<u32>	_failed_allocations{ 0 };
+		frame				_frames[max_frames]{};		// frames that haven't retired, oldest first
+		u32					_first_frame{ 0 };
+		u32					_frame_count{ 0 };
+		u32					_frame_overflows{ 0 };
+		u32					_slot{ invalid_slot };	// index of the allocator's block in each thread
+		u32					_capacity{ 0 };
+		u32					_alignment{ 0 };
+		u32					_block_size{ 0 };
+	};
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+namespace triengine::utl {
+
+	// A small persistent pool of worker threads for data-parallel loops.
+	// NOTE: parallel_for() blocks until every index is processed. The calling thread
+	//       takes part in the work, so nested calls from inside a job can't deadlock.
+	class thread_pool
+	{
+	public:
+		DISABLE_COPY_AND_MOVE(thread_pool);
+		explicit thread_pool(u32 thread_count = 0)
+		{
+			if (!thread_count)
+			{
+				const u32 hw_threads{ std::thread::hardware_concurrency() };
+				thread_count = hw_threads > 1 ? hw_threads - 1 : 1;
+			}
+
+			_workers.reserve(thread_count);
+			for (u32 i{ 0 }; i < thread_count; ++i)
+			{
+				_workers.emplace_back([this] { worker_loop(); });
+			}
+		}
+
+		~thread_pool()
+		{
+			{
+				std::lock_guard lock{ _mutex };
+				assert(_jobs.empty());
+				_shutdown = true;
+			}
+
+			_wake.notify_all();
+			for (auto& worker : _workers)
+			{
+				worker.join();
+			}
+		}
+
+		// Calls func(i) for every i in [0, count). Calls may run concurrently and in any order.
+		template<typename F>
+		void parallel_for(u32 count, F&& func)
+		{
+			if (!count) return;
+
+			if (count == 1 || _workers.empty())
+			{
+				for (u32 i{ 0 }; i < count; ++i) func(i);
+				return;
+			}
+
+			job j{};
+			j.count = count;
+			j.context = (void*)std::addressof(func);
+			j.execute = [](void* context, u32 index) { (*(std::remove_reference_t<F>*)context)(index); };
+
+			const u32 helper_count{ std::min(count - 1, (u32)_workers.size()) };
+			{
+				std::lock_guard lock{ _mutex };
+				for (u32 i{ 0 }; i < helper_count; ++i) _jobs.push_back(&j);
+			}
+			_wake.notify_all();
+
+			run(j);
+
+			// NOTE: j lives on this stack frame. Retract the helper slots nobody picked up
+			//       and wait for the workers that did, before returning.
+			std::unique_lock lock{ _mutex };
+			std::erase(_jobs, &j);
+			_job_done.wait(lock, [&j] { return j.active == 0; });
+			assert(j.next >= j.count);
+		}
+
+		[[nodiscard]] u32 thread_count() const { return (u32)_workers.size(); }
+
+	private:
+		struct job
+		{
+			std::atomic<u32>	next{ 0 };
+			u32					count{ 0 };
+			u32					active{ 0 }; // guarded by _mutex
+			void*				context{ nullptr };
+			void				(*execute)(void*, u32) { nullptr };
+		};
+
+		static void run(job& j)
+		{
+			for (u32 i{ j.next++ }; i < j.count; i = j.next++)
+			{
+				j.execute(j.context, i);
+			}
+		}
+
+		void worker_loop()
+		{
+			std::unique_lock lock{ _mutex };
+			while (true)
+			{
+				_wake.wait(lock, [this] { return _shutdown || !_jobs.empty(); });
+				if (_shutdown) return;
+
+				job* const j{ _jobs.front() };
+				_jobs.pop_front();
+				++j->active;
+
+				lock.unlock();
+				run(*j);
+				lock.lock();
+
+				if (--j->active == 0) _job_done.notify_all();
+			}
+		}
+
+		std::vector<std::thread>	_workers;
+		std::deque<job*>			_jobs;
+		std::mutex					_mutex;
+		std::condition_variable		_wake;
+		std::condition_variable		_job_done;
+		bool						_shutdown{ false };
+	};
+
+	namespace detail {
+		inline thread_pool* default_pool{ nullptr };
+		inline std::mutex default_pool_mutex{};
+	}
+
+	// Shared pool for tools and engine systems that don't need their own workers. It's created on first use.
+	// NOTE: the pool isn't destroyed by a static destructor, since joining its workers while a DLL is unloaded
+	//       deadlocks on the loader lock. Modules call shutdown_default_thread_pool() before they're unloaded.
+	inline thread_pool& default_thread_pool()
+	{
+		std::lock_guard lock{ detail::default_pool_mutex };
+		if (!detail::default_pool) detail::default_pool = new thread_pool{};
+		return *detail::default_pool;
+	}
+
+	// Joins the workers of the shared pool. No parallel_for() of the pool may be running.
+	inline void shutdown_default_thread_pool()
+	{
+		thread_pool* pool{ nullptr };
+		{
+			std::lock_guard lock{ detail::default_pool_mutex };
+			std::swap(pool, detail::default_pool);
+		}
+
+		delete pool;
+	}
+}
@@ -0,0 +1,396 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace triengine::utl {
+
+	// Two-level segregated fit allocator for ranges of a memory pool, like a GPU heap or a large buffer.
+	// Free blocks are kept in lists by size class: the first level is the power of 2 of the size and the second
+	// level splits each power of 2 in 16 classes. Bitmaps of the non-empty lists make allocate() and free()
+	// constant time. Block information lives in a separate array, so the pool itself is never read or written.
+	// NOTE: sizes and offsets are multiples of the granularity given to initialize(). Allocations are identified
+	//       by a handle, which stays the same when defragment() moves them.
+	class tlsf_allocator
+	{
+	public:
+		constexpr static u32 invalid_handle{ u32_invalid_id };
+
+		struct allocator_stats
+		{
+			u64 size;
+			u64 allocated;				// including alignment padding that couldn't be split off
+			u64 largest_free_block;
+			u32 allocation_count;
+			u32 free_block_count;
+		};
+
+		tlsf_allocator() = default;
+		DISABLE_COPY_AND_MOVE(tlsf_allocator);
+		~tlsf_allocator() { assert(!_allocation_count); }
+
+		// 'granularity' must be a power of 2. It's also the smallest alignment of allocations.
+		void initialize(u64 size, u64 granularity)
+		{
+			assert(granularity && !(granularity & (granularity - 1)));
+			assert(size >= granularity && size / granularity < (1ull << (fl_count + sl_bits - 1)));
+			assert(!_allocation_count);
+			_granularity = granularity;
+			_size = math::align_size_down(size, granularity);
+			_allocated = 0;
+			_allocation_count = 0;
+			_free_block_count = 0;
+			_blocks.clear();
+			_free_nodes.clear();
+			_fl_bitmap = 0;
+			memset(_sl_bitmaps, 0, sizeof(_sl_bitmaps));
+			for (u32 i{ 0 }; i < fl_count; ++i)
+			{
+				for (u32 j{ 0 }; j < sl_count; ++j) _free_lists[i][j] = invalid_handle;
+			}
+
+			_first_block = new_block();
+			_blocks[_first_block] = { 0, _size, invalid_handle, invalid_handle, invalid_handle, invalid_handle, 0, true };
+			insert_free(_first_block);
+		}
+
+		// Returns invalid_handle if there's no free block that's large enough.
+		[[nodiscard]] u32 allocate(u64 size, u64 alignment = 0)
+		{
+			assert(_size && size);
+			alignment = std::max(alignment, _granularity);
+			assert(!(alignment & (alignment - 1)));
+			size = math::align_size_up(size, _granularity);
+
+			// NOTE: in the worst case the block starts just after an aligned offset.
+			const u32 handle{ find_free(size + alignment - _granularity) };
+			if (handle == invalid_handle) return invalid_handle;
+
+			remove_free(handle);
+			const u64 offset{ _blocks[handle].offset };
+			const u64 aligned_offset{ math::align_size_up(offset, alignment) };
+			if (aligned_offset != offset)
+			{
+				// put the space in front of the aligned offset in a free block of its own.
+				const u32 aligned{ split(handle, aligned_offset - offset) };
+				insert_free(handle);
+				return finish_allocation(aligned, size, alignment);
+			}
+
+			return finish_allocation(handle, size, alignment);
+		}
+
+		void free(u32 handle)
+		{
+			assert(handle < _blocks.size() && !_blocks[handle].is_free);
+			block& b{ _blocks[handle] };
+			_allocated -= b.size;
+			--_allocation_count;
+			b.is_free = true;
+
+			if (b.next_physical != invalid_handle && _blocks[b.next_physical].is_free)
+			{
+				remove_free(b.next_physical);
+				merge_next(handle);
+			}
+
+			if (b.prev_physical != invalid_handle && _blocks[b.prev_physical].is_free)
+			{
+				const u32 prev{ b.prev_physical };
+				remove_free(prev);
+				merge_next(prev);
+				insert_free(prev);
+			}
+			else
+			{
+				insert_free(handle);
+			}
+		}
+
+		[[nodiscard]] u64 offset(u32 handle) const { assert(!_blocks[handle].is_free); return _blocks[handle].offset; }
+		[[nodiscard]] u64 size(u32 handle) const { assert(!_blocks[handle].is_free); return _blocks[handle].size; }
+		[[nodiscard]] constexpr u64 capacity() const { return _size; }
+		[[nodiscard]] constexpr bool empty() const { return !_allocation_count; }
+
+		// Moves up to 'max_moves' allocations towards the start of the pool, so free blocks merge. For each moved
+		// allocation 'move(handle, old_offset, new_offset, size)' is called, which has to copy its data.
+		// The old and new ranges can overlap. Returns the number of moved allocations.
+		template<typename move_function>
+		u32 defragment(u32 max_moves, move_function move)
+		{
+			u32 moves{ 0 };
+			u32 handle{ _first_block };
+			while (handle != invalid_handle && moves < max_moves)
+			{
+				const u32 next{ _blocks[handle].next_physical };
+				if (!_blocks[handle].is_free || next == invalid_handle)
+				{
+					handle = next;
+					continue;
+				}
+
+				// 'handle' is free and 'next' is allocated, because free neighbours are always merged.
+				const block& allocation{ _blocks[next] };
+				assert(!allocation.is_free);
+				const u64 old_offset{ allocation.offset };
+				const u64 new_offset{ math::align_size_up(_blocks[handle].offset, allocation.alignment) };
+				if (new_offset >= old_offset)
+				{
+					handle = next;
+					continue;
+				}
+
+				move(next, old_offset, new_offset, allocation.size);
+				slide_down(handle, next, new_offset);
+				++moves;
+				handle = _blocks[next].next_physical;
+			}
+
+			return moves;
+		}
+
+		[[nodiscard]] allocator_stats stats() const
+		{
+			u64 largest_free_block{ 0 };
+			if (_fl_bitmap)
+			{
+				const u32 fl{ highest_bit(_fl_bitmap) };
+				const u32 sl{ highest_bit(_sl_bitmaps[fl]) };
+				for (u32 i{ _free_lists[fl][sl] }; i != invalid_handle; i = _blocks[i].next_free)
+				{
+					largest_free_block = std::max(largest_free_block, _blocks[i].size);
+				}
+			}
+
+			return { _size, _allocated, largest_free_block, _allocation_count, _free_block_count };
+		}
+
+	private:
+		constexpr static u32 sl_bits{ 4 };
+		constexpr static u32 sl_count{ 1 << sl_bits };
+		constexpr static u32 fl_count{ 32 };
+
+		struct block
+		{
+			u64 offset;
+			u64 size;
+			u32 prev_physical;
+			u32 next_physical;
+			u32 prev_free;
+			u32 next_free;
+			u64 alignment;
+			bool is_free;
+		};
+
+		[[nodiscard]] static u32 highest_bit(u64 value)
+		{
+			assert(value);
+			u32 bit{ 0 };
+			while (value >>= 1) ++bit;
+			return bit;
+		}
+
+		[[nodiscard]] static u32 lowest_bit(u32 value)
+		{
+			assert(value);
+			u32 bit{ 0 };
+			while (!(value & 1)) { value >>= 1; ++bit; }
+			return bit;
+		}
+
+		// Size classes are in units of the granularity. Sizes below sl_count units have a class each,
+		// larger sizes share a class with sizes that have the same top sl_bits + 1 bits.
+		void mapping(u64 size, u32& fl, u32& sl) const
+		{
+			const u64 units{ size / _granularity };
+			if (units < sl_count)
+			{
+				fl = 0;
+				sl = (u32)units;
+			}
+			else
+			{
+				const u32 bit{ highest_bit(units) };
+				fl = bit - sl_bits + 1;
+				sl = (u32)(units >> (bit - sl_bits)) - sl_count;
+			}
+		}
+
+		[[nodiscard]] u32 find_free(u64 size) const
+		{
+			// round up to the next class, so any block in the classes that are searched is large enough.
+			u64 rounded_size{ size };
+			const u64 units{ size / _granularity };
+			if (units >= sl_count)
+			{
+				rounded_size += ((1ull << (highest_bit(units) - sl_bits)) - 1) * _granularity;
+			}
+
+			u32 fl, sl;
+			mapping(rounded_size, fl, sl);
+			u32 sl_map{ fl < fl_count ? _sl_bitmaps[fl] & (~0u << sl) : 0 };
+			if (!sl_map)
+			{
+				const u32 fl_map{ fl + 1 < fl_count ? _fl_bitmap & (~0u << (fl + 1)) : 0 };
+				if (fl_map)
+				{
+					fl = lowest_bit(fl_map);
+					sl_map = _sl_bitmaps[fl];
+				}
+			}
+
+			if (sl_map) return _free_lists[fl][lowest_bit(sl_map)];
+
+			// the class of 'size' itself may still have a block that's large enough.
+			mapping(size, fl, sl);
+			for (u32 i{ _free_lists[fl][sl] }; i != invalid_handle; i = _blocks[i].next_free)
+			{
+				if (_blocks[i].size >= size) return i;
+			}
+
+			return invalid_handle;
+		}
+
+		void insert_free(u32 handle)
+		{
+			block& b{ _blocks[handle] };
+			assert(b.is_free && b.size);
+			u32 fl, sl;
+			mapping(b.size, fl, sl);
+			b.prev_free = invalid_handle;
+			b.next_free = _free_lists[fl][sl];
+			if (b.next_free != invalid_handle) _blocks[b.next_free].prev_free = handle;
+			_free_lists[fl][sl] = handle;
+			_fl_bitmap |= 1u << fl;
+			_sl_bitmaps[fl] |= 1u << sl;
+			++_free_block_count;
+		}
+
+		void remove_free(u32 handle)
+		{
+			block& b{ _blocks[handle] };
+			assert(b.is_free);
+			u32 fl, sl;
+			mapping(b.size, fl, sl);
+			if (b.prev_free != invalid_handle) _blocks[b.prev_free].next_free = b.next_free;
+			else _free_lists[fl][sl] = b.next_free;
+			if (b.next_free != invalid_handle) _blocks[b.next_free].prev_free = b.prev_free;
+
+			if (_free_lists[fl][sl] == invalid_handle)
+			{
+				_sl_bitmaps[fl] &= ~(1u << sl);
+				if (!_sl_bitmaps[fl]) _fl_bitmap &= ~(1u << fl);
+			}
+
+			b.prev_free = b.next_free = invalid_handle;
+			--_free_block_count;
+		}
+
+		[[nodiscard]] u32 new_block()
+		{
+			if (!_free_nodes.empty())
+			{
+				const u32 handle{ _free_nodes.back() };
+				_free_nodes.resize(_free_nodes.size() - 1);
+				return handle;
+			}
+
+			_blocks.emplace_back();
+			return (u32)_blocks.size() - 1;
+		}
+
+		// Splits 'size' off the front of a block that isn't in a free list. Returns the block with the rest,
+		// which is free and not in a free list either.
+		[[nodiscard]] u32 split(u32 handle, u64 size)
+		{
+			assert(size && size < _blocks[handle].size);
+			const u32 rest{ new_block() };
+			block& b{ _blocks[handle] };
+			_blocks[rest] = { b.offset + size, b.size - size, handle, b.next_physical, invalid_handle, invalid_handle, 0, true };
+			if (b.next_physical != invalid_handle) _blocks[b.next_physical].prev_physical = rest;
+			b.next_physical = rest;
+			b.size = size;
+			return rest;
+		}
+
+		// Merges the next block, which isn't in a free list, into 'handle'.
+		void merge_next(u32 handle)
+		{
+			block& b{ _blocks[handle] };
+			const u32 next{ b.next_physical };
+			assert(next != invalid_handle);
+			b.size += _blocks[next].size;
+			b.next_physical = _blocks[next].next_physical;
+			if (b.next_physical != invalid_handle) _blocks[b.next_physical].prev_physical = handle;
+			_free_nodes.emplace_back(next);
+		}
+
+		[[nodiscard]] u32 finish_allocation(u32 handle, u64 size, u64 alignment)
+		{
+			block& b{ _blocks[handle] };
+			if (b.size > size)
+			{
+				insert_free(split(handle, size));
+			}
+
+			block& allocation{ _blocks[handle] };
+			allocation.is_free = false;
+			allocation.alignment = alignment;
+			_allocated += allocation.size;
+			++_allocation_count;
+			return handle;
+		}
+
+		// Moves 'allocation' down to 'new_offset' inside the free block in front of it.
+		void slide_down(u32 free_block, u32 allocation, u64 new_offset)
+		{
+			remove_free(free_block);
+			block& f{ _blocks[free_block] };
+			block& a{ _blocks[allocation] };
+			const u64 freed{ a.offset - new_offset };
+
+			if (new_offset > f.offset)
+			{
+				f.size = new_offset - f.offset;
+				insert_free(free_block);
+			}
+			else
+			{
+				// the free block is gone, so the allocation takes its place in the list of blocks.
+				a.prev_physical = f.prev_physical;
+				if (a.prev_physical != invalid_handle) _blocks[a.prev_physical].next_physical = allocation;
+				if (_first_block == free_block) _first_block = allocation;
+				_free_nodes.emplace_back(free_block);
+			}
+
+			a.offset = new_offset;
+			const u32 next{ a.next_physical };
+			if (next != invalid_handle && _blocks[next].is_free)
+			{
+				remove_free(next);
+				_blocks[next].offset -= freed;
+				_blocks[next].size += freed;
+				insert_free(next);
+			}
+			else
+			{
+				const u32 rest{ new_block() };
+				block& a2{ _blocks[allocation] };
+				_blocks[rest] = { a2.offset + a2.size, freed, allocation, next, invalid_handle, invalid_handle, 0, true };
+				if (next != invalid_handle) _blocks[next].prev_physical = rest;
+				a2.next_physical = rest;
+				insert_free(rest);
+			}
+		}
+
+		utl::vector<block>	_blocks;
+		utl::vector<u32>	_free_nodes;
+		u32					_free_lists[fl_count][sl_count]{};
+		u32					_sl_bitmaps[fl_count]{};
+		u32					_fl_bitmap{ 0 };
+		u32					_first_block{ invalid_handle };	// block at offset 0
+		u64					_size{ 0 };
+		u64					_granularity{ 0 };
+		u64					_allocated{ 0 };
+		u32					_allocation_count{ 0 };
+		u32					_free_block_count{ 0 };
+	};
+}
@@ -8,6 +8,20 @@
 #include "TestWindow.h"
 #elif TEST_RENDERER
 #include "TestRenderer.h"
+#elif TEST_RING_ALLOCATOR
+#include "TestRingAllocator.h"
+#elif TEST_INDEX_ALLOCATOR
+#include "TestIndexAllocator.h"
+#elif TEST_TLSF_ALLOCATOR
+#include "TestTlsfAllocator.h"
+#elif TEST_EPOCH_TABLE
+#include "TestEpochTable.h"
+#elif TEST_OCCLUSION_CULLING
+#include "TestOcclusionCulling.h"
+#elif TEST_MESHLETS
+#include "TestMeshlets.h"
+#elif TEST_MESH_CODEC
+#include "TestMeshCodec.h"
 #else
 #error One of the tests must be defined
 #endif
@@ -1,6 +1,7 @@
 #include <filesystem>
 #include "CommonHeaders.h"
 #include "Content/ContentToEngine.h"
+#include "Content/ContentLoader.h"
 #include "Graphics/Renderer.h"
 #include "ShaderCompilation.h"
 #include "Components/Entity.h"
@@ -18,8 +19,12 @@ namespace {
 
 	std::unordered_map<id::id_type, id::id_type> render_item_entity_map{};
 
+	// NOTE: the test opens an archive with the model (see open_test_archive()), the file is read if it can't.
 	void load_model()
 	{
+		model_id = content::create_resource_from_archive("model.model");
+		if (id::is_valid(model_id)) return;
+
 		std::unique_ptr<u8[]> model;
 		u64 size{ 0 };
 		read_file("..\\..\\enginetest\\model.model", model, size);
@@ -37,22 +42,36 @@ namespace {
 
 		const char* shader_path{ "..\\..\\enginetest\\" };
 
-		std::wstring defines[]{ L"ELEMENTS_TYPE=1", L"ELEMENTS_TYPE=3" };
+		using namespace tools::elements;
+		const u32 elements_types[]{
+			elements_type::static_normal, elements_type::static_normal_texture,
+			elements_type::static_normal_oct16, elements_type::static_normal_texture_oct16,
+			elements_type::static_normal_oct8, elements_type::static_normal_texture_oct8,
+			elements_type::static_normal_packed, elements_type::static_normal_texture_packed,
+		};
 		std::vector<u32> keys;
-		keys.emplace_back(tools::elements::elements_type::static_normal);
-		keys.emplace_back(tools::elements::elements_type::static_normal_texture);
 
 		utl::vector<std::wstring> extra_args{};
 		utl::vector<std::unique_ptr<u8[]>> vertex_shaders{};
 		utl::vector<const u8*> vertex_shader_pointers;
-		for (u32 i{0}; i < _countof(defines); ++i)
+		// NOTE: each elements type also gets a variant for submeshes with quantized positions.
+		for (u32 quantized{ 0 }; quantized < 2; ++quantized)
 		{
-			extra_args.clear();
-			extra_args.emplace_back(L"-D");
-			extra_args.emplace_back(defines[i]);
-			vertex_shaders.emplace_back(std::move(compile_shader(info, shader_path, extra_args)));
-			assert(vertex_shaders.back().get());
-			vertex_shader_pointers.emplace_back(vertex_shaders.back().get());
+			for (u32 i{0}; i < _countof(elements_types); ++i)
+			{
+				extra_args.clear();
+				extra_args.emplace_back(L"-D");
+				extra_args.emplace_back(L"ELEMENTS_TYPE=" + std::to_wstring(elements_types[i]));
+				if (quantized)
+				{
+					extra_args.emplace_back(L"-D");
+					extra_args.emplace_back(L"POSITION_QUANTIZED=1");
+				}
+				vertex_shaders.emplace_back(std::move(compile_shader(info, shader_path, extra_args)));
+				assert(vertex_shaders.back().get());
+				vertex_shader_pointers.emplace_back(vertex_shaders.back().get());
+				keys.emplace_back(quantized ? elements_types[i] | graphics::quantized_positions_shader_key : elements_types[i]);
+			}
 		}
 
 		extra_args.clear();
@@ -2,10 +2,18 @@
 #include <thread>
 #include <chrono>
 #include <string>
+#include <iostream>
 
 #define TEST_ENTITY_COMPONENTS 0
 #define TEST_WINDOW 0
 #define TEST_RENDERER 1
+#define TEST_RING_ALLOCATOR 0
+#define TEST_INDEX_ALLOCATOR 0
+#define TEST_TLSF_ALLOCATOR 0
+#define TEST_EPOCH_TABLE 0
+#define TEST_OCCLUSION_CULLING 0
+#define TEST_MESHLETS 0
+#define TEST_MESH_CODEC 0
 
 class test
 {
@@ -15,6 +23,37 @@ public:
 	virtual void shutdown() = 0;
 };
 
+// Base of the CPU-only tests, which count their checks and print the ones that fail.
+class checked_test : public test
+{
+protected:
+	void check(bool condition, const char* name)
+	{
+		if (condition) ++_passed;
+		else
+		{
+			++_failed;
+			std::cout << "FAILED: " << name << std::endl;
+		}
+	}
+
+	void reset_results()
+	{
+		_passed = 0;
+		_failed = 0;
+	}
+
+	void print_results() const
+	{
+		std::cout << "Passed: " << _passed << std::endl;
+		std::cout << "Failed: " << _failed << std::endl;
+	}
+
+private:
+	unsigned int _passed{ 0 };
+	unsigned int _failed{ 0 };
+};
+
 #if _WIN64
 #include <Windows.h>
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Test.h"
+#include "Engine\Utilities\EpochTable.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace triengine;
+
+// CPU-only tests of utl::epoch and utl::epoch_table: guards hold back reclaiming, readers without a slot,
+// and a stress test where readers use items while a writer removes them.
+class engine_test : public checked_test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			reset_results();
+			test_guards();
+			test_fallback_readers();
+			test_readers_race_remove();
+			print_results();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	constexpr static u32 item_size{ 256 };
+
+	void test_guards()
+	{
+		check(utl::epoch::is_safe(utl::epoch::advance()), "retired epochs are safe without readers");
+
+		u64 retired{ 0 };
+		{
+			utl::epoch::read_guard guard{};
+			retired = utl::epoch::advance();
+			{
+				utl::epoch::read_guard nested{};
+			}
+			check(!utl::epoch::is_safe(retired), "a nested guard doesn't end the outer one");
+		}
+		check(utl::epoch::is_safe(retired), "the epoch is safe when the guard is gone");
+
+		utl::epoch_table<u8*> table{};
+		u8* const memory{ (u8*)malloc(item_size) };
+		const u32 id{ table.add(memory) };
+		u32 other_id{ u32_invalid_id };
+		{
+			utl::epoch::read_guard guard{};
+			table.remove(id, memory);
+			other_id = table.add(nullptr);
+			check(other_id != id, "removed ids aren't reused while a reader may use them");
+		}
+
+		table.reclaim();
+		check(table.add(nullptr) == id, "removed ids are reused when no reader can use them");
+		table.remove(id);
+		table.remove(other_id);
+		table.reclaim();
+	}
+
+	void test_fallback_readers()
+	{
+		// hold a guard on more threads than there are slots, so the last ones read without a slot.
+		constexpr u32 thread_count{ utl::epoch::max_readers + 4 };
+		std::atomic<u32> started{ 0 };
+		std::atomic<u64> retired{ 0 };
+		std::atomic<u32> unsafe_count{ 0 };
+		std::vector<std::thread> threads;
+		for (u32 i{ 0 }; i < thread_count; ++i)
+		{
+			threads.emplace_back([&started, &retired, &unsafe_count] {
+				utl::epoch::read_guard guard{};
+				{
+					utl::epoch::read_guard nested{};
+				}
+				++started;
+				while (!retired) std::this_thread::yield();
+				// a reader, with or without a slot, can't reclaim what it may still be reading itself.
+				if (!utl::epoch::is_safe(retired)) ++unsafe_count;
+			});
+		}
+
+		while (started < thread_count) std::this_thread::yield();
+		const u64 epoch{ utl::epoch::advance() };
+		check(!utl::epoch::is_safe(epoch), "readers hold back reclaiming");
+		retired = epoch;
+
+		for (auto& thread : threads) thread.join();
+		check(unsafe_count == thread_count, "readers see their own epoch as not safe");
+		check(utl::epoch::is_safe(epoch), "the epoch is safe when all readers are gone");
+	}
+
+	void test_readers_race_remove()
+	{
+		constexpr u32 reader_count{ 8 };
+		constexpr u32 live_count{ 64 };
+		constexpr u32 iterations{ 20000 };
+
+		utl::epoch_table<u8*> table{};
+		std::atomic<u32> live_ids[live_count];
+		for (auto& id : live_ids) id = u32_invalid_id;
+		std::atomic<bool> stop{ false };
+		std::atomic<u32> corrupt_reads{ 0 };
+		std::atomic<u64> reads{ 0 };
+
+		// every byte of an item's memory is the same, so a read of memory that was freed and reused shows up.
+		std::vector<std::thread> readers;
+		for (u32 t{ 0 }; t < reader_count; ++t)
+		{
+			readers.emplace_back([&, t] {
+				u32 seed{ t * 7 + 1 };
+				u64 count{ 0 };
+				while (!stop)
+				{
+					seed = seed * 1103515245u + 12345u;
+					utl::epoch::read_guard guard{};
+					const u32 id{ live_ids[(seed >> 8) % live_count].load(std::memory_order_acquire) };
+					if (id == u32_invalid_id) continue;
+
+					const u8* const memory{ table[id] };
+					for (u32 i{ 1 }; i < item_size; ++i)
+					{
+						if (memory[i] != memory[0])
+						{
+							++corrupt_reads;
+							break;
+						}
+					}
+					++count;
+				}
+				reads += count;
+			});
+		}
+
+		u32 seed{ 99 };
+		for (u32 i{ 0 }; i < iterations; ++i)
+		{
+			seed = seed * 1103515245u + 12345u;
+			std::atomic<u32>& live_id{ live_ids[(seed >> 8) % live_count] };
+			const u32 old_id{ live_id.exchange(u32_invalid_id) };
+			if (old_id != u32_invalid_id)
+			{
+				table.remove(old_id, table[old_id]);
+			}
+
+			u8* const memory{ (u8*)malloc(item_size) };
+			memset(memory, (u8)i, item_size);
+			live_id.store(table.add(memory), std::memory_order_release);
+		}
+
+		stop = true;
+		for (auto& reader : readers) reader.join();
+
+		for (auto& id : live_ids)
+		{
+			if (id != u32_invalid_id) table.remove(id, table[id]);
+		}
+
+		table.reclaim();
+		check(reads > 0, "readers read while items were removed");
+		check(corrupt_reads == 0, "readers never see memory that was freed");
+		check(table.size() == 0, "all items are removed");
+	}
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "Test.h"
+#include "Engine\Utilities\IndexAllocator.h"
+
+#include <thread>
+#include <vector>
+
+using namespace triengine;
+
+// CPU-only tests of utl::index_allocator: single indices and ranges, merging, exhaustion, fragmentation,
+// deferred frees and thread caches.
+class engine_test : public checked_test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			reset_results();
+			test_single_and_range();
+			test_merge();
+			test_exhaustion();
+			test_fragmentation();
+			test_deferred_free();
+			test_release_deferred();
+			test_thread_exit();
+			print_results();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	constexpr static u32 capacity{ 1024 };
+
+	void test_single_and_range()
+	{
+		utl::index_allocator indices{};
+		indices.initialize(capacity);
+
+		const u32 a{ indices.allocate() };
+		const u32 b{ indices.allocate() };
+		check(a >= capacity - utl::index_allocator::cache_size / 2 && b == a + 1, "single indices are taken from the end");
+		check(indices.stats().cached == utl::index_allocator::cache_size / 2 - 2, "the thread's cache is refilled in a batch");
+
+		const u32 first{ indices.allocate_range(16) };
+		check(first == 0, "ranges are taken from the start");
+		check(indices.allocated() == 18, "allocated count");
+
+		indices.free(a);
+		check(indices.allocate() == a, "a freed index is reused from the thread's cache");
+
+		indices.free(a);
+		indices.free(b);
+		indices.free_range(first, 16);
+		check(indices.allocated() == 0, "everything is freed");
+		indices.release();
+	}
+
+	void test_merge()
+	{
+		utl::index_allocator indices{};
+		indices.initialize(capacity);
+
+		const u32 a{ indices.allocate_range(8) };
+		const u32 b{ indices.allocate_range(8) };
+		const u32 c{ indices.allocate_range(8) };
+		check(indices.stats().free_range_count == 1, "one free range after contiguous ranges");
+
+		indices.free_range(a, 8);
+		indices.free_range(c, 8);
+		check(indices.stats().free_range_count == 2, "ranges that aren't neighbours don't merge");
+
+		indices.free_range(b, 8);
+		const utl::index_allocator::allocator_stats stats{ indices.stats() };
+		check(stats.free_range_count == 1 && stats.largest_free_range == capacity, "neighbouring free ranges merge");
+		indices.release();
+	}
+
+	void test_exhaustion()
+	{
+		utl::index_allocator indices{};
+		indices.initialize(capacity);
+
+		std::vector<u32> allocated;
+		for (u32 index{ indices.allocate() }; index != utl::index_allocator::invalid_index; index = indices.allocate())
+		{
+			allocated.emplace_back(index);
+		}
+
+		check(allocated.size() == capacity, "all indices can be allocated");
+		check(indices.stats().failed_allocations == 1, "allocations fail when there are no free indices");
+		check(indices.allocate_range(1) == utl::index_allocator::invalid_index, "ranges fail when there are no free indices");
+		check(indices.stats().failed_allocations == 2, "failed ranges are counted");
+
+		for (u32 index : allocated) indices.free(index);
+		check(indices.allocated() == 0, "everything is freed");
+		indices.release();
+	}
+
+	void test_fragmentation()
+	{
+		utl::index_allocator indices{};
+		indices.initialize(capacity);
+
+		const u32 first{ indices.allocate_range(capacity) };
+		check(first == 0, "the whole capacity can be allocated as one range");
+
+		// free every other block of 4, so there's half the capacity free but no range larger than 4.
+		for (u32 i{ 0 }; i < capacity; i += 8) indices.free_range(first + i, 4);
+		utl::index_allocator::allocator_stats stats{ indices.stats() };
+		check(stats.free_range_count == capacity / 8, "free range count");
+		check(stats.largest_free_range == 4, "largest free range when fragmented");
+		check(indices.allocate_range(5) == utl::index_allocator::invalid_index, "a range larger than any free range fails");
+		check(indices.allocate_range(4) == 0, "the first range that fits is used");
+
+		indices.free_range(0, 4);
+		for (u32 i{ 4 }; i < capacity; i += 8) indices.free_range(first + i, 4);
+		stats = indices.stats();
+		check(stats.free_range_count == 1 && stats.largest_free_range == capacity, "freed blocks merge back");
+		indices.release();
+	}
+
+	void test_deferred_free()
+	{
+		utl::index_allocator indices{};
+		indices.initialize(capacity);
+
+		const u32 a{ indices.allocate() };
+		const u32 range{ indices.allocate_range(4) };
+		indices.free_deferred(a, 1);
+		indices.free_range_deferred(range, 4, 1);
+		utl::index_allocator::allocator_stats stats{ indices.stats() };
+		check(stats.deferred == 5 && stats.allocated == 5, "deferred indices still count as allocated");
+
+		indices.process_deferred(0);
+		const u32 b{ indices.allocate() };
+		check(b != a, "a deferred index isn't reused before its frame is processed");
+
+		indices.process_deferred(1);
+		stats = indices.stats();
+		check(stats.deferred == 1 && stats.allocated == 2, "processing a frame frees its ranges");
+		check(indices.allocate() == a, "the thread takes its deferred index back into its cache");
+		stats = indices.stats();
+		check(stats.deferred == 0, "no deferred indices are left");
+
+		// more than a thread's list holds, so some go to the frame's shared list.
+		std::vector<u32> allocated;
+		for (u32 i{ 0 }; i < utl::index_allocator::cache_size * 3; ++i) allocated.emplace_back(indices.allocate());
+		for (u32 index : allocated) indices.free_deferred(index, 2);
+		check(indices.stats().deferred == allocated.size(), "all frees are deferred");
+		indices.process_deferred(2);
+		const u32 c{ indices.allocate() };
+		check(c != utl::index_allocator::invalid_index, "allocate after processing");
+		stats = indices.stats();
+		check(stats.deferred == 0 && stats.allocated == 3, "deferred indices of a thread are reclaimed");
+
+		indices.free(a);
+		indices.free(b);
+		indices.free(c);
+		indices.release();
+	}
+
+	void test_release_deferred()
+	{
+		utl::index_allocator indices{};
+		indices.initialize(capacity);
+
+		// like at shutdown: frees for several frames, but only one frame is processed before release.
+		const u32 a{ indices.allocate() };
+		const u32 b{ indices.allocate() };
+		const u32 range{ indices.allocate_range(4) };
+		indices.free_deferred(a, 0);
+		indices.free_deferred(b, 2);
+		indices.free_range_deferred(range, 4, 1);
+		indices.process_deferred(0);
+		check(indices.allocated() == 6, "the thread's deferred indices wait until it allocates or frees again");
+
+		indices.drain_deferred();
+		const utl::index_allocator::allocator_stats stats{ indices.stats() };
+		check(stats.allocated == 0 && stats.deferred == 0, "draining frees the deferred indices of all frames");
+		check(stats.free_range_count == 1 && stats.largest_free_range + stats.cached == capacity, "drained indices go back to the free list");
+		indices.release();
+	}
+
+	void test_thread_exit()
+	{
+		utl::index_allocator indices{};
+		indices.initialize(capacity);
+
+		constexpr u32 thread_count{ 8 };
+		constexpr u32 allocation_count{ 100 };
+		std::vector<std::vector<u32>> allocations(thread_count);
+		std::vector<std::thread> threads;
+		for (u32 t{ 0 }; t < thread_count; ++t)
+		{
+			threads.emplace_back([&indices, &allocations, t] {
+				for (u32 i{ 0 }; i < allocation_count; ++i) allocations[t].emplace_back(indices.allocate());
+				// free half, so the thread's cache holds indices when it exits.
+				for (u32 i{ 0 }; i < allocation_count / 2; ++i) indices.free(allocations[t][i]);
+				allocations[t].erase(allocations[t].begin(), allocations[t].begin() + allocation_count / 2);
+			});
+		}
+
+		for (auto& thread : threads) thread.join();
+
+		std::vector<u32> all;
+		for (const auto& a : allocations) all.insert(all.end(), a.begin(), a.end());
+		std::sort(all.begin(), all.end());
+		check(std::adjacent_find(all.begin(), all.end()) == all.end(), "threads never get the same index");
+
+		utl::index_allocator::allocator_stats stats{ indices.stats() };
+		check(stats.cached == 0, "thread caches are flushed when the threads exit");
+		check(stats.allocated == all.size(), "allocated count with threads");
+
+		for (u32 index : all) indices.free(index);
+		indices.release();
+	}
+};
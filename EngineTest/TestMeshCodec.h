@@ -0,0 +1,229 @@
+#pragma once
+
+#include "Test.h"
+#include "Engine\Utilities\MeshCodec.h"
+
+#include <vector>
+
+using namespace triengine;
+
+// CPU-only round-trip tests of the index and vertex stream codecs in utl/MeshCodec.h: index counts that
+// aren't multiples of 4, 16 and 32-bit indices, partial groups of 16 vertices, chunk boundaries and
+// truncated streams.
+class engine_test : public checked_test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			reset_results();
+			test_indices();
+			test_vertices();
+			test_malformed();
+			print_results();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	// NOTE: the decoders write whole groups with SIMD stores, so the bytes after the output are checked too.
+	constexpr static u8 guard{ 0xcd };
+	constexpr static u32 guard_size{ 64 };
+
+	u32 _seed{ 12345 };
+
+	[[nodiscard]] u32 random()
+	{
+		_seed = _seed * 1664525u + 1013904223u;
+		return _seed >> 8;
+	}
+
+	// Indices of a triangle list, mostly close to the previous ones but with some large jumps both ways.
+	[[nodiscard]] std::vector<u32> make_indices(u32 index_count, u32 vertex_count)
+	{
+		std::vector<u32> indices(index_count);
+		u32 previous{ 0 };
+		for (u32 i{ 0 }; i < index_count; ++i)
+		{
+			const u32 r{ random() };
+			previous = (r % 8 == 0) ? random() % vertex_count : (previous + r % 5) % vertex_count;
+			indices[i] = previous;
+		}
+
+		return indices;
+	}
+
+	// Copies the first 'size' bytes of a stream to a buffer of that size, so reads past its end are found.
+	[[nodiscard]] static std::vector<u8> copy_exact(const utl::vector<u8>& stream, u64 size)
+	{
+		std::vector<u8> truncated(std::max(size, (u64)1));
+		memcpy(truncated.data(), stream.data(), size);
+		return truncated;
+	}
+
+	template<typename T>
+	[[nodiscard]] bool decode_indices(const utl::vector<u8>& stream, const std::vector<u32>& indices)
+	{
+		const u32 index_count{ (u32)indices.size() };
+		std::vector<u8> dst(index_count * sizeof(T) + guard_size, guard);
+		if (!utl::decode_index_stream(dst.data(), index_count, sizeof(T), copy_exact(stream, stream.size()).data(), stream.size())) return false;
+
+		for (u32 i{ 0 }; i < index_count; ++i)
+		{
+			T index;
+			memcpy(&index, &dst[i * sizeof(T)], sizeof(T));
+			if (index != (T)indices[i]) return false;
+		}
+
+		for (u32 i{ index_count * (u32)sizeof(T) }; i < dst.size(); ++i)
+		{
+			if (dst[i] != guard) return false;
+		}
+
+		return true;
+	}
+
+	void test_indices()
+	{
+		bool is_same16{ true };
+		bool is_same32{ true };
+		bool is_same_large{ true };
+		for (u32 index_count : { 0u, 1u, 2u, 3u, 4u, 5u, 6u, 7u, 9u, 15u, 17u, 33u, 255u, 1001u, 4099u })
+		{
+			const std::vector<u32> indices{ make_indices(index_count, 1 << 16) };
+			utl::vector<u8> stream;
+			utl::encode_index_stream(indices.data(), index_count, stream);
+			is_same16 &= decode_indices<u16>(stream, indices);
+			is_same32 &= decode_indices<u32>(stream, indices);
+
+			// jumps large enough to need 3 and 4 bytes.
+			const std::vector<u32> large{ make_indices(index_count, 0xffffffffu) };
+			stream.clear();
+			utl::encode_index_stream(large.data(), index_count, stream);
+			is_same_large &= decode_indices<u32>(stream, large);
+		}
+
+		check(is_same16, "16-bit indices round-trip");
+		check(is_same32, "32-bit indices round-trip");
+		check(is_same_large, "indices with 3 and 4-byte deltas round-trip");
+
+		// the largest deltas that 16-bit indices have, in groups of 4 and in the last 3 indices.
+		std::vector<u32> edge;
+		for (u32 i{ 0 }; i < 8; ++i) edge.insert(edge.end(), { 0, 0xffff, 1, 0xfffe });
+		edge.insert(edge.end(), { 0xffff, 0, 2 });
+		utl::vector<u8> stream;
+		utl::encode_index_stream(edge.data(), (u32)edge.size(), stream);
+		check(decode_indices<u16>(stream, edge) && decode_indices<u32>(stream, edge), "the largest 16-bit deltas round-trip");
+	}
+
+	[[nodiscard]] bool round_trip_vertices(const std::vector<u8>& vertices, u32 stride, utl::vertex_stream_filter::type filter)
+	{
+		const u32 vertex_count{ (u32)(vertices.size() / stride) };
+		utl::vector<u8> stream;
+		utl::encode_vertex_stream(vertices.data(), vertex_count, stride, filter, stream);
+
+		std::vector<u8> dst(vertices.size() + guard_size, guard);
+		if (!utl::decode_vertex_stream(dst.data(), vertex_count, stride, copy_exact(stream, stream.size()).data(), stream.size())) return false;
+		if (memcmp(dst.data(), vertices.data(), vertices.size())) return false;
+
+		for (u64 i{ vertices.size() }; i < dst.size(); ++i)
+		{
+			if (dst[i] != guard) return false;
+		}
+
+		return true;
+	}
+
+	void test_vertices()
+	{
+		// counts around the groups of 16 and the chunks of vertex_stream_chunk_size vertices.
+		constexpr u32 chunk{ utl::vertex_stream_chunk_size };
+		constexpr u32 vertex_counts[]{ 1, 15, 16, 17, 31, chunk - 1, chunk, chunk + 1, chunk * 2 + 7, chunk * 4 };
+
+		bool is_same_positions{ true };
+		bool is_same_elements{ true };
+		bool is_same_random{ true };
+		for (u32 vertex_count : vertex_counts)
+		{
+			// positions along a curve, so the deltas are small but not zero.
+			std::vector<u8> positions(vertex_count * sizeof(math::v3));
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+			{
+				const math::v3 p{ sinf(i * 0.01f) * 10.f, (f32)i * 0.25f, cosf(i * 0.03f) };
+				memcpy(&positions[i * sizeof(math::v3)], &p, sizeof(math::v3));
+			}
+
+			is_same_positions &= round_trip_vertices(positions, sizeof(math::v3), utl::vertex_stream_filter::words32);
+			is_same_positions &= round_trip_vertices(positions, sizeof(math::v3), utl::vertex_stream_filter::bytes);
+
+			// element data with an odd stride: a color that doesn't change, a counter and random bytes.
+			constexpr u32 stride{ 7 };
+			std::vector<u8> elements(vertex_count * stride);
+			for (u32 i{ 0 }; i < vertex_count; ++i)
+			{
+				u8* const element{ &elements[i * stride] };
+				element[0] = 0x80; element[1] = 0x40; element[2] = 0xff;
+				element[3] = (u8)i; element[4] = (u8)(i / 3);
+				element[5] = (u8)random(); element[6] = (u8)(random() & 0x03);
+			}
+
+			is_same_elements &= round_trip_vertices(elements, stride, utl::vertex_stream_filter::bytes);
+
+			// random data with the largest stride, so every group needs 8 bits per value.
+			std::vector<u8> noise(vertex_count * utl::vertex_stream_max_stride);
+			for (u8& b : noise) b = (u8)random();
+			is_same_random &= round_trip_vertices(noise, utl::vertex_stream_max_stride, utl::vertex_stream_filter::words32);
+			is_same_random &= round_trip_vertices(noise, utl::vertex_stream_max_stride, utl::vertex_stream_filter::bytes);
+		}
+
+		check(is_same_positions, "positions round-trip with both filters");
+		check(is_same_elements, "element data with an odd stride round-trips");
+		check(is_same_random, "random data with the largest stride round-trips");
+	}
+
+	void test_malformed()
+	{
+		const std::vector<u32> indices{ make_indices(301, 1 << 20) };
+		utl::vector<u8> index_stream;
+		utl::encode_index_stream(indices.data(), (u32)indices.size(), index_stream);
+
+		std::vector<u32> index_dst(indices.size());
+		bool is_rejected{ true };
+		for (u64 size{ 0 }; size < index_stream.size(); ++size)
+		{
+			is_rejected &= !utl::decode_index_stream(index_dst.data(), (u32)indices.size(), sizeof(u32), copy_exact(index_stream, size).data(), size);
+		}
+
+		check(is_rejected, "truncated index streams are rejected");
+		check(!utl::decode_index_stream(index_dst.data(), (u32)indices.size() - 1, sizeof(u32), index_stream.data(), index_stream.size()),
+			"index streams with another index count are rejected");
+
+		constexpr u32 vertex_count{ utl::vertex_stream_chunk_size + 40 };
+		constexpr u32 stride{ 12 };
+		std::vector<u8> vertices(vertex_count * stride);
+		for (u32 i{ 0 }; i < vertices.size(); ++i) vertices[i] = (u8)(i % 7 == 0 ? random() : i / stride);
+		utl::vector<u8> vertex_stream;
+		utl::encode_vertex_stream(vertices.data(), vertex_count, stride, utl::vertex_stream_filter::bytes, vertex_stream);
+
+		std::vector<u8> vertex_dst(vertices.size());
+		is_rejected = true;
+		for (u64 size{ 0 }; size < vertex_stream.size(); ++size)
+		{
+			is_rejected &= !utl::decode_vertex_stream(vertex_dst.data(), vertex_count, stride, copy_exact(vertex_stream, size).data(), size);
+		}
+
+		check(is_rejected, "truncated vertex streams are rejected");
+		check(!utl::decode_vertex_stream(vertex_dst.data(), vertex_count, stride + 4, vertex_stream.data(), vertex_stream.size()),
+			"vertex streams with another stride are rejected");
+
+		// a stride that isn't a multiple of 4 can't use the 32-bit filter.
+		utl::vector<u8> bad_filter{ vertex_stream };
+		bad_filter[8] = utl::vertex_stream_filter::words32;
+		bad_filter[4] = 13;
+		check(!utl::decode_vertex_stream(vertex_dst.data(), vertex_count, 13, bad_filter.data(), bad_filter.size()),
+			"the 32-bit filter with a stride that isn't a multiple of 4 is rejected");
+	}
+};
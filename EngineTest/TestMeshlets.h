@@ -0,0 +1,204 @@
+#pragma once
+
+#include "Test.h"
+#include "..\ContentTools\Meshlets.h"
+#include "Engine\Content\ContentToEngine.h"
+#include "Engine\Utilities\IOStream.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace triengine;
+
+// CPU-only tests of tools::build_meshlets(), calculate_meshlet_bounds() and is_meshlet_backfacing(): the limits
+// and triangles of the meshlets of the test model, their bounding spheres, and the normal cone of a flat patch.
+class engine_test : public checked_test
+{
+public:
+	bool initialize() override
+	{
+		std::ifstream file{ "..\\..\\enginetest\\model.model", std::ios::in | std::ios::binary };
+		if (!file) return false;
+		const std::vector<u8> model{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+		utl::blob_stream_reader blob{ model.data() };
+		read_first_lod(blob);
+		return !_submeshes.empty();
+	}
+
+	void run() override
+	{
+		do {
+			reset_results();
+			test_limits(tools::max_meshlet_vertices, tools::max_meshlet_triangles);
+			test_limits(16, 8);
+			test_bounding_spheres();
+			test_normal_cone();
+			print_results();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	struct submesh
+	{
+		std::vector<math::v3> positions;
+		std::vector<u32> indices;
+	};
+
+	void test_limits(u32 max_vertices, u32 max_triangles)
+	{
+		bool is_within_limits{ true };
+		bool is_same_triangles{ true };
+		bool is_contiguous{ true };
+		bool is_sized{ true };
+		for (const submesh& mesh : _submeshes)
+		{
+			tools::meshlet_data data{};
+			tools::build_meshlets(mesh.indices.data(), (u32)mesh.indices.size(), mesh.positions.data(), (u32)mesh.positions.size(),
+				data, max_vertices, max_triangles);
+
+			is_sized &= data.meshlets.size() == data.bounds.size();
+			// every meshlet after the first starts because the previous one was full, so there are never more
+			// meshlets than triangles and never fewer than the triangle limit allows.
+			const u32 triangle_count{ (u32)mesh.indices.size() / 3 };
+			is_sized &= data.meshlets.size() >= (triangle_count + max_triangles - 1) / max_triangles && data.meshlets.size() <= triangle_count;
+
+			// the meshlets hold the triangles of the mesh, in the same order.
+			u32 index{ 0 };
+			u32 vertex_offset{ 0 };
+			u32 triangle_offset{ 0 };
+			for (const tools::meshlet& m : data.meshlets)
+			{
+				is_within_limits &= m.vertex_count && m.vertex_count <= max_vertices;
+				is_within_limits &= m.triangle_count && m.triangle_count <= max_triangles;
+				is_contiguous &= m.vertex_offset == vertex_offset && m.triangle_offset == triangle_offset;
+				vertex_offset += m.vertex_count;
+				triangle_offset += m.triangle_count * 3;
+
+				for (u32 i{ 0 }; i < m.triangle_count * 3; ++i)
+				{
+					const u8 local_index{ data.triangles[m.triangle_offset + i] };
+					is_within_limits &= local_index < m.vertex_count;
+					is_same_triangles &= local_index < m.vertex_count && data.vertices[m.vertex_offset + local_index] == mesh.indices[index++];
+				}
+			}
+
+			is_same_triangles &= index == mesh.indices.size();
+			is_contiguous &= vertex_offset == data.vertices.size() && triangle_offset == data.triangles.size();
+		}
+
+		check(is_within_limits, "meshlets stay within the vertex and triangle limits");
+		check(is_same_triangles, "meshlets hold every triangle of the mesh in order");
+		check(is_contiguous, "meshlets are packed one after the other");
+		check(is_sized, "meshlet count and one set of bounds per meshlet");
+	}
+
+	void test_bounding_spheres()
+	{
+		bool is_inside{ true };
+		for (const submesh& mesh : _submeshes)
+		{
+			tools::meshlet_data data{};
+			tools::build_meshlets(mesh.indices.data(), (u32)mesh.indices.size(), mesh.positions.data(), (u32)mesh.positions.size(), data);
+
+			for (u32 i{ 0 }; i < data.meshlets.size(); ++i)
+			{
+				const tools::meshlet& m{ data.meshlets[i] };
+				const tools::meshlet_bounds& bounds{ data.bounds[i] };
+				for (u32 j{ 0 }; j < m.vertex_count; ++j)
+				{
+					const math::v3& p{ mesh.positions[data.vertices[m.vertex_offset + j]] };
+					const f32 dx{ p.x - bounds.center.x }, dy{ p.y - bounds.center.y }, dz{ p.z - bounds.center.z };
+					// NOTE: a little slack for the rounding of sqrtf().
+					is_inside &= sqrtf(dx * dx + dy * dy + dz * dz) <= bounds.radius * (1.f + 1e-5f) + 1e-6f;
+				}
+			}
+		}
+
+		check(is_inside, "every vertex of a meshlet is inside its bounding sphere");
+	}
+
+	void test_normal_cone()
+	{
+		// a flat 4x4 grid of quads in the xy plane that faces +z.
+		constexpr u32 size{ 5 };
+		std::vector<math::v3> positions;
+		std::vector<u32> indices;
+		for (u32 y{ 0 }; y < size; ++y)
+		{
+			for (u32 x{ 0 }; x < size; ++x) positions.push_back({ (f32)x, (f32)y, 0.f });
+		}
+
+		for (u32 y{ 0 }; y + 1 < size; ++y)
+		{
+			for (u32 x{ 0 }; x + 1 < size; ++x)
+			{
+				const u32 i{ y * size + x };
+				indices.insert(indices.end(), { i, i + 1, i + size + 1, i, i + size + 1, i + size });
+			}
+		}
+
+		tools::meshlet_data data{};
+		tools::build_meshlets(indices.data(), (u32)indices.size(), positions.data(), (u32)positions.size(), data);
+		check(data.meshlets.size() == 1, "a small patch is one meshlet");
+
+		const tools::meshlet_bounds& bounds{ data.bounds[0] };
+		check(bounds.cone_cutoff < 1.f && bounds.cone_axis.z > 0.99f, "the normal cone of a flat patch points along its normal");
+		check(tools::is_meshlet_backfacing(bounds, { 2.f, 2.f, -5.f }), "a camera behind the patch culls it");
+		check(tools::is_meshlet_backfacing(bounds, { 20.f, -10.f, -1.f }), "a camera behind the patch at an angle culls it");
+		check(!tools::is_meshlet_backfacing(bounds, { 2.f, 2.f, 5.f }), "a camera in front of the patch doesn't cull it");
+		check(!tools::is_meshlet_backfacing(bounds, { 20.f, -10.f, 1.f }), "a camera in front of the patch at an angle doesn't cull it");
+
+		// a second patch that faces the other way makes the cone too wide to cull anything.
+		const u32 vertex_count{ (u32)positions.size() };
+		for (u32 i{ 0 }; i < vertex_count; ++i) positions.push_back({ positions[i].x, positions[i].y, -1.f });
+		const u32 index_count{ (u32)indices.size() };
+		for (u32 i{ 0 }; i < index_count; i += 3)
+		{
+			indices.insert(indices.end(), { indices[i] + vertex_count, indices[i + 2] + vertex_count, indices[i + 1] + vertex_count });
+		}
+
+		data = {};
+		tools::build_meshlets(indices.data(), (u32)indices.size(), positions.data(), (u32)positions.size(), data);
+		check(data.meshlets.size() == 1 && data.bounds[0].cone_cutoff >= 1.f, "opposite normals can't be culled");
+		check(!tools::is_meshlet_backfacing(data.bounds[0], { 2.f, 2.f, -5.f }) && !tools::is_meshlet_backfacing(data.bounds[0], { 2.f, 2.f, 5.f }),
+			"a meshlet with opposite normals is never culled");
+	}
+
+	// Reads the submeshes of the first LOD. Only uncompressed, unquantized submeshes are read, the test model
+	// has no others.
+	void read_first_lod(utl::blob_stream_reader& blob)
+	{
+		blob.skip(sizeof(u32) + sizeof(content::mesh_bounds) + sizeof(f32)); // lod count, mesh bounds and threshold
+		const u32 submesh_count{ blob.read<u32>() };
+		blob.skip(sizeof(content::mesh_bounds) * (1 + submesh_count) + sizeof(u32));
+
+		for (u32 i{ 0 }; i < submesh_count; ++i)
+		{
+			const u32 element_size{ blob.read<u32>() };
+			const u32 vertex_count{ blob.read<u32>() };
+			const u32 index_count{ blob.read<u32>() };
+			blob.skip(sizeof(u32) * 2);
+			const u32 encoding{ blob.read<u32>() };
+			assert(!encoding);
+			const u32 index_size{ (u32)(vertex_count < 1 << 16 ? sizeof(u16) : sizeof(u32)) };
+
+			submesh& mesh{ _submeshes.emplace_back() };
+			const math::v3* const positions{ (const math::v3*)blob.position() };
+			mesh.positions.assign(positions, positions + vertex_count);
+			blob.skip((u32)math::align_size_up<4>(sizeof(math::v3) * vertex_count) + (u32)math::align_size_up<4>(element_size * vertex_count));
+
+			const u8* const indices{ blob.position() };
+			for (u32 j{ 0 }; j < index_count; ++j)
+			{
+				mesh.indices.push_back(index_size == sizeof(u16) ? ((const u16*)indices)[j] : ((const u32*)indices)[j]);
+			}
+			blob.skip(index_size * index_count);
+		}
+	}
+
+	std::vector<submesh> _submeshes;
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "Test.h"
+#include "Engine\Components\Entity.h"
+#include "Engine\Components\Transform.h"
+#include "Engine\Graphics\OcclusionCulling.h"
+#include "Engine\Content\ContentToEngine.h"
+#include "Engine\Utilities\IOStream.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace triengine;
+
+// CPU-only tests of graphics::occlusion: the coarsest LOD of the test model is rasterized as an occluder, then
+// boxes behind, beside and in front of it are tested, and the levels of the hierarchical-Z buffer are checked.
+class engine_test : public checked_test
+{
+public:
+	bool initialize() override
+	{
+		std::ifstream file{ "..\\..\\enginetest\\model.model", std::ios::in | std::ios::binary };
+		if (!file) return false;
+		_model.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+
+		transform::init_info transform_info{};
+		game_entity::entity_info entity_info{ &transform_info };
+		_entity = game_entity::create(entity_info);
+		_occluder_id = graphics::occlusion::add_occluder(_entity.get_id(), _model.data());
+		return _entity.is_valid() && id::is_valid(_occluder_id);
+	}
+
+	void run() override
+	{
+		do {
+			reset_results();
+			test_occluder();
+			test_conservative_edges();
+			test_hierarchy();
+			print_results();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override
+	{
+		if (id::is_valid(_occluder_id)) graphics::occlusion::remove_occluder(_occluder_id);
+		if (_entity.is_valid()) game_entity::remove(_entity.get_id());
+	}
+
+private:
+	using occlusion_buffer = graphics::occlusion::occlusion_buffer;
+
+	// NOTE: the model stands at the origin, about 1.9 units tall and facing +z.
+	constexpr static f32 center_x{ -0.07f };
+	constexpr static f32 center_y{ 1.1f };
+
+	[[nodiscard]] static DirectX::XMMATRIX view_projection(f32 camera_z)
+	{
+		using namespace DirectX;
+		const XMMATRIX view{ XMMatrixLookAtRH(XMVectorSet(center_x, center_y, camera_z, 1.f), XMVectorSet(center_x, center_y, 0.f, 1.f), XMVectorSet(0.f, 1.f, 0.f, 0.f)) };
+		// NOTE: depth is reversed, the same as the engine's cameras.
+		const XMMATRIX projection{ XMMatrixPerspectiveFovRH(XM_PI / 3.f, (f32)occlusion_buffer::width / occlusion_buffer::height, 1000.f, 0.01f) };
+		return XMMatrixMultiply(view, projection);
+	}
+
+	[[nodiscard]] static bool is_visible(math::v3 center, f32 half_size, const math::m4x4& world_view_projection)
+	{
+		const graphics::occlusion::occludee_box box{
+			{ center.x - half_size, center.y - half_size, center.z - half_size },
+			{ center.x + half_size, center.y + half_size, center.z + half_size },
+			&world_view_projection,
+		};
+
+		return graphics::occlusion::shared_buffer().is_visible(box);
+	}
+
+	void test_occluder()
+	{
+		const DirectX::XMMATRIX vp{ view_projection(3.f) };
+		check(graphics::occlusion::render_occluders(vp), "the occluder is rendered");
+
+		// the entity is at the origin without rotation or scale, so the boxes use the view-projection matrix.
+		math::m4x4 wvp;
+		DirectX::XMStoreFloat4x4(&wvp, vp);
+
+		check(!is_visible({ center_x, center_y, -1.5f }, 0.05f, wvp), "a box behind the occluder is culled");
+		check(!is_visible({ center_x, center_y, -20.f }, 0.2f, wvp), "a far box behind the occluder is culled");
+		check(is_visible({ center_x + 2.f, center_y, -1.5f }, 0.05f, wvp), "a box beside the occluder is visible");
+		check(is_visible({ center_x, center_y, 1.f }, 0.05f, wvp), "a box in front of the occluder is visible");
+		check(is_visible({ center_x, center_y, -1.5f }, 3.f, wvp), "a box larger than the occluder is visible");
+		check(is_visible({ center_x, center_y, 5.f }, 0.05f, wvp), "a box behind the camera is visible");
+	}
+
+	// Every texel the occluder covers must be covered completely, so the edges of the occluder are checked
+	// against a buffer that samples each texel many times.
+	void test_conservative_edges()
+	{
+		using namespace DirectX;
+		const XMMATRIX vp{ view_projection(3.f) };
+		graphics::occlusion::render_occluders(vp);
+		const f32* const depth{ graphics::occlusion::shared_buffer().level(0) };
+
+		// the triangles of the occluder, projected to texel coordinates.
+		utl::blob_stream_reader blob{ _model.data() };
+		std::vector<math::v2> texels;
+		read_coarsest_lod(blob, vp, texels);
+
+		constexpr u32 samples{ 4 };
+		u32 covered{ 0 };
+		u32 partly_covered{ 0 };
+		for (u32 y{ 0 }; y < occlusion_buffer::height; ++y)
+		{
+			for (u32 x{ 0 }; x < occlusion_buffer::width; ++x)
+			{
+				if (depth[y * occlusion_buffer::width + x] == 0.f) continue;
+				++covered;
+
+				bool is_covered{ true };
+				for (u32 s{ 0 }; s < samples && is_covered; ++s)
+				{
+					for (u32 t{ 0 }; t < samples && is_covered; ++t)
+					{
+						is_covered = is_inside(texels, { x + (s + 0.5f) / samples, y + (t + 0.5f) / samples });
+					}
+				}
+
+				partly_covered += is_covered ? 0 : 1;
+			}
+		}
+
+		check(covered > 0, "the occluder covers texels");
+		check(partly_covered == 0, "texels are only covered if the occluder covers all of them");
+	}
+
+	void test_hierarchy()
+	{
+		graphics::occlusion::render_occluders(view_projection(3.f));
+		const occlusion_buffer& buffer{ graphics::occlusion::shared_buffer() };
+
+		bool is_farthest{ true };
+		for (u32 level{ 1 }; level < occlusion_buffer::level_count; ++level)
+		{
+			const f32* const src{ buffer.level(level - 1) };
+			const f32* const dst{ buffer.level(level) };
+			const u32 src_width{ occlusion_buffer::width >> (level - 1) };
+			const u32 dst_width{ occlusion_buffer::width >> level };
+			for (u32 y{ 0 }; y < (occlusion_buffer::height >> level); ++y)
+			{
+				for (u32 x{ 0 }; x < dst_width; ++x)
+				{
+					const f32* const row0{ &src[y * 2 * src_width + x * 2] };
+					const f32* const row1{ row0 + src_width };
+					is_farthest &= dst[y * dst_width + x] == std::min(std::min(row0[0], row0[1]), std::min(row1[0], row1[1]));
+				}
+			}
+		}
+
+		check(is_farthest, "each texel of a level holds the farthest depth of the level below");
+
+		// the occluder is much smaller than the view, so the coarsest level sees past it everywhere.
+		const f32* const coarsest{ buffer.level(occlusion_buffer::level_count - 1) };
+		check(coarsest[0] == 0.f && coarsest[1] == 0.f, "the coarsest level is at the far plane");
+	}
+
+	// Projects the triangles of the coarsest LOD to texel coordinates. Only uncompressed, unquantized submeshes
+	// are read, the test model has no others.
+	static void read_coarsest_lod(utl::blob_stream_reader& blob, DirectX::FXMMATRIX vp, std::vector<math::v2>& texels)
+	{
+		using namespace DirectX;
+		const u32 lod_count{ blob.read<u32>() };
+		blob.skip(sizeof(content::mesh_bounds));
+		for (u32 lod_idx{ 0 }; lod_idx < lod_count - 1; ++lod_idx)
+		{
+			blob.skip(sizeof(f32));
+			const u32 submesh_count{ blob.read<u32>() };
+			blob.skip(sizeof(content::mesh_bounds) * (1 + submesh_count));
+			blob.skip(blob.read<u32>());
+		}
+
+		blob.skip(sizeof(f32));
+		const u32 submesh_count{ blob.read<u32>() };
+		blob.skip(sizeof(content::mesh_bounds) * (1 + submesh_count) + sizeof(u32));
+
+		for (u32 i{ 0 }; i < submesh_count; ++i)
+		{
+			const u32 element_size{ blob.read<u32>() };
+			const u32 vertex_count{ blob.read<u32>() };
+			const u32 index_count{ blob.read<u32>() };
+			blob.skip(sizeof(u32) * 2);
+			const u32 encoding{ blob.read<u32>() };
+			assert(!encoding);
+			const u32 index_size{ (u32)(vertex_count < 1 << 16 ? sizeof(u16) : sizeof(u32)) };
+
+			const math::v3* const positions{ (const math::v3*)blob.position() };
+			blob.skip((u32)math::align_size_up<4>(sizeof(math::v3) * vertex_count) + (u32)math::align_size_up<4>(element_size * vertex_count));
+			const u8* const indices{ blob.position() };
+			blob.skip(index_size * index_count);
+
+			for (u32 j{ 0 }; j < index_count; ++j)
+			{
+				const u32 index{ index_size == sizeof(u16) ? ((const u16*)indices)[j] : ((const u32*)indices)[j] };
+				const XMVECTOR clip{ XMVector3Transform(XMLoadFloat3(&positions[index]), vp) };
+				const f32 w{ XMVectorGetW(clip) };
+				texels.push_back({
+					(XMVectorGetX(clip) / w * 0.5f + 0.5f) * occlusion_buffer::width,
+					(0.5f - XMVectorGetY(clip) / w * 0.5f) * occlusion_buffer::height,
+				});
+			}
+		}
+	}
+
+	[[nodiscard]] static bool is_inside(const std::vector<math::v2>& triangles, math::v2 p)
+	{
+		for (u32 i{ 0 }; i + 2 < triangles.size(); i += 3)
+		{
+			const math::v2& a{ triangles[i] };
+			const math::v2& b{ triangles[i + 1] };
+			const math::v2& c{ triangles[i + 2] };
+			const f32 e0{ (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x) };
+			const f32 e1{ (c.x - b.x) * (p.y - b.y) - (c.y - b.y) * (p.x - b.x) };
+			const f32 e2{ (a.x - c.x) * (p.y - c.y) - (a.y - c.y) * (p.x - c.x) };
+			if ((e0 >= 0.f && e1 >= 0.f && e2 >= 0.f) || (e0 <= 0.f && e1 <= 0.f && e2 <= 0.f)) return true;
+		}
+
+		return false;
+	}
+
+	std::vector<u8> _model;
+	game_entity::entity _entity{};
+	id::id_type _occluder_id{ id::invalid_id };
+};
@@ -3,10 +3,12 @@
 #include "Graphics\Renderer.h"
 #include "Graphics\Direct3D12\D3D12Core.h"
 #include "Content\ContentToEngine.h"
+#include "Content\ContentLoader.h"
 #include "Components/Entity.h"
 #include "Components/Transform.h"
 #include "TestRenderer.h"
 #include "ShaderCompilation.h"
+#include "..\ContentTools\PakArchive.h"
 #include <filesystem>
 #include <fstream>
 
@@ -225,6 +227,28 @@ bool read_file(std::filesystem::path path, std::unique_ptr<u8[]>& data, u64& siz
 	;
 }
 
+// The test model is loaded from an archive, like the content of a game. The archive is written again when
+// the model is newer.
+bool open_test_archive()
+{
+	const std::filesystem::path model_path{ "..\\..\\enginetest\\model.model" };
+	const std::filesystem::path archive_path{ "..\\..\\enginetest\\enginetest.pak" };
+	if (!std::filesystem::exists(model_path)) return false;
+
+	if (!std::filesystem::exists(archive_path) ||
+		std::filesystem::last_write_time(archive_path) < std::filesystem::last_write_time(model_path))
+	{
+		std::unique_ptr<u8[]> model;
+		u64 size{ 0 };
+		if (!read_file(model_path, model, size)) return false;
+
+		const tools::pak_asset asset{ "model.model", model.get(), size, content::asset_type::mesh, 1 };
+		if (!tools::WritePakArchive(archive_path.string().c_str(), &asset, 1)) return false;
+	}
+
+	return content::open_archive(archive_path.string().c_str());
+}
+
 void create_camera_surface(camera_surface& surface, platform::window_init_info& info)
 {
 	surface.surface.window = platform::create_window(&info);
@@ -269,16 +293,22 @@ bool test_initialize()
 		create_camera_surface(_surfaces[i], info[i]);
 
 	// load test model
-	std::unique_ptr<u8[]> model;
-	u64 size{ 0 };
-	if (!read_file("..\\..\\enginetest\\model.model", model, size)) return false;
+	const bool has_archive{ open_test_archive() };
+	model_id = content::create_resource_from_archive("model.model");
+	if (!id::is_valid(model_id))
+	{
+		std::unique_ptr<u8[]> model;
+		u64 size{ 0 };
+		if (!read_file("..\\..\\enginetest\\model.model", model, size)) return false;
 
-	model_id = content::create_resource(model.get(), content::asset_type::mesh);
-	if (!id::is_valid(model_id)) return false;
+		model_id = content::create_resource(model.get(), content::asset_type::mesh);
+		if (!id::is_valid(model_id)) return false;
+	}
 
 	init_test_workers(buffer_test_worker);
 
 	item_id = create_render_item(create_one_game_entity({}, {}, true).get_id());
+	if (has_archive) content::close_archive();
 
 	is_restarting = false;
 	return true;
@@ -312,12 +342,9 @@ void engine_test::run()
 	{
 		if (_surfaces[i].surface.surface.is_valid())
 		{
-			f32 threshold{ 10 };
-
 			graphics::frame_info info{};
 			info.render_item_ids = &item_id;
 			info.render_item_count = 1;
-			info.thresholds = &threshold;
 			info.camera_id = _surfaces[i].camera.get_id();
 
 			_surfaces[i].surface.surface.render(info);
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Test.h"
+#include "Engine\Utilities\RingAllocator.h"
+
+#include <thread>
+#include <vector>
+
+using namespace triengine;
+
+// CPU-only tests of utl::ring_allocator: alignment, thread blocks, frame retirement and overflow.
+class engine_test : public checked_test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			reset_results();
+			test_alignment_and_blocks();
+			test_full_ring();
+			test_retire();
+			test_frame_overflow();
+			test_two_allocators();
+			test_threads();
+			print_results();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	constexpr static u32 capacity{ 64 * 1024 };
+	constexpr static u32 alignment{ 256 };
+	constexpr static u32 block_size{ 4 * 1024 };
+
+	void test_alignment_and_blocks()
+	{
+		utl::ring_allocator ring{};
+		ring.initialize(capacity, alignment, block_size);
+
+		const u32 a{ ring.allocate(1) };
+		const u32 b{ ring.allocate(100) };
+		check(a != utl::ring_allocator::invalid_offset && a % alignment == 0, "small allocations are aligned");
+		check(b == a + alignment, "small allocations come from the thread's block");
+		check(ring.stats().used == block_size, "a block is taken from the ring for small allocations");
+
+		// larger than a quarter of a block, so it's taken directly from the ring.
+		const u32 c{ ring.allocate(block_size / 2) };
+		check(c == a + block_size, "large allocations don't use the block");
+		check(ring.stats().used == block_size + block_size / 2, "used includes large allocations");
+		check(ring.end_frame(1), "end_frame");
+		ring.retire(1);
+	}
+
+	void test_full_ring()
+	{
+		utl::ring_allocator ring{};
+		ring.initialize(capacity, alignment, block_size);
+
+		u32 count{ 0 };
+		while (ring.allocate(block_size) != utl::ring_allocator::invalid_offset) ++count;
+		check(count == capacity / block_size, "the whole ring can be allocated");
+		check(ring.stats().failed_allocations == 1, "allocations fail when the ring is full");
+		check(ring.stats().high_water_mark == capacity, "high water mark");
+		check(ring.end_frame(1), "end_frame");
+		ring.retire(1);
+	}
+
+	void test_retire()
+	{
+		utl::ring_allocator ring{};
+		ring.initialize(capacity, alignment, block_size);
+
+		for (u64 frame{ 1 }; frame <= 100; ++frame)
+		{
+			for (u32 i{ 0 }; i < 10; ++i)
+			{
+				if (ring.allocate(alignment * 3) == utl::ring_allocator::invalid_offset) break;
+			}
+
+			check(ring.end_frame(frame), "end_frame");
+			// keep 2 frames in flight, like the renderer does.
+			if (frame > 2) ring.retire(frame - 2);
+		}
+
+		check(ring.stats().failed_allocations == 0, "retired space is reused");
+		ring.retire(100);
+		check(ring.stats().used == 0, "retiring all frames frees the ring");
+
+		// a block taken in a frame that ended isn't used anymore.
+		const u32 a{ ring.allocate(1) };
+		check(ring.end_frame(101), "end_frame");
+		const u32 b{ ring.allocate(1) };
+		check(b == (a + block_size) % capacity, "blocks aren't used after their frame ended");
+		check(ring.end_frame(102), "end_frame");
+		ring.retire(102);
+	}
+
+	void test_frame_overflow()
+	{
+		utl::ring_allocator ring{};
+		ring.initialize(capacity, alignment, block_size);
+
+		for (u64 frame{ 1 }; frame <= utl::ring_allocator::max_frames; ++frame)
+		{
+			[[maybe_unused]] const u32 offset{ ring.allocate(block_size) };
+			check(ring.end_frame(frame), "frames up to max_frames are tracked");
+		}
+
+		[[maybe_unused]] const u32 offset{ ring.allocate(block_size) };
+		check(!ring.end_frame(utl::ring_allocator::max_frames + 1), "end_frame fails past max_frames");
+		check(ring.stats().frame_overflows == 1, "overflows are counted");
+
+		ring.retire(utl::ring_allocator::max_frames);
+		check(ring.stats().used == block_size * 2, "the overflowed frame retires with the later fence");
+		ring.retire(utl::ring_allocator::max_frames + 1);
+		check(ring.stats().used == 0, "the overflowed frame's space is reclaimed");
+	}
+
+	void test_two_allocators()
+	{
+		utl::ring_allocator a{};
+		utl::ring_allocator b{};
+		a.initialize(capacity, alignment, block_size);
+		b.initialize(capacity, alignment, block_size);
+
+		for (u32 i{ 0 }; i < 8; ++i)
+		{
+			[[maybe_unused]] const u32 offset_a{ a.allocate(alignment) };
+			[[maybe_unused]] const u32 offset_b{ b.allocate(alignment) };
+		}
+
+		check(a.stats().used == block_size && b.stats().used == block_size, "allocators on one thread keep their own blocks");
+		check(a.end_frame(1) && b.end_frame(1), "end_frame");
+		a.retire(1);
+		b.retire(1);
+	}
+
+	void test_threads()
+	{
+		utl::ring_allocator ring{};
+		ring.initialize(capacity * 64, alignment, block_size);
+
+		constexpr u32 thread_count{ 8 };
+		constexpr u32 allocation_count{ 200 };
+		std::vector<std::vector<std::pair<u32, u32>>> allocations(thread_count);
+		std::vector<std::thread> threads;
+		for (u32 t{ 0 }; t < thread_count; ++t)
+		{
+			threads.emplace_back([&ring, &allocations, t] {
+				for (u32 i{ 0 }; i < allocation_count; ++i)
+				{
+					const u32 size{ 1 + (i * 37 + t * 101) % (block_size / 2) };
+					const u32 offset{ ring.allocate(size) };
+					if (offset != utl::ring_allocator::invalid_offset) allocations[t].emplace_back(offset, size);
+				}
+			});
+		}
+
+		for (auto& thread : threads) thread.join();
+
+		std::vector<std::pair<u32, u32>> all;
+		for (const auto& a : allocations) all.insert(all.end(), a.begin(), a.end());
+		std::sort(all.begin(), all.end());
+		bool overlaps{ false };
+		for (size_t i{ 1 }; i < all.size(); ++i)
+		{
+			overlaps |= all[i - 1].first + all[i - 1].second > all[i].first;
+		}
+
+		check(all.size() == thread_count * allocation_count, "threads can allocate concurrently");
+		check(!overlaps, "allocations of different threads don't overlap");
+		check(ring.end_frame(1), "end_frame");
+		ring.retire(1);
+	}
+};
@@ -26,15 +26,31 @@ struct PixelOut
 #define ElementsTypeSkeletalNormalTexture       ElementsTypeSkeletal | ElementsTypeStaticNormalTexture
 #define ElementsTypeSkeletalNormalTextureColor  ElementsTypeSkeletalNormalTexture | ElementsTypeStaticColor
 
+#define NormalEncodingXYSign                    0x00
+#define NormalEncodingOctahedral16              0x10
+#define NormalEncodingOctahedral8               0x20
+#define NormalEncodingOctahedralPacked          0x30
+
+#define ELEMENTS_LAYOUT (ELEMENTS_TYPE & 0x0f)
+#define NORMAL_ENCODING (ELEMENTS_TYPE & 0x30)
+
 struct VertexElement
 {
-#if ELEMENTS_TYPE == ElementsTypeStaticNormal
+#if ELEMENTS_LAYOUT == ElementsTypeStaticNormal
     uint        ColorTSign;
+#if NORMAL_ENCODING == NormalEncodingXYSign || NORMAL_ENCODING == NormalEncodingOctahedral16
     uint16_t2   Normal;
-#elif ELEMENTS_TYPE == ElementsTypeStaticNormalTexture
+#else
+    uint        Normal;
+#endif
+#elif ELEMENTS_LAYOUT == ElementsTypeStaticNormalTexture
     uint        ColorTSign;
+#if NORMAL_ENCODING == NormalEncodingXYSign || NORMAL_ENCODING == NormalEncodingOctahedral16
     uint16_t2   Normal;
     uint16_t2   Tangent;
+#else
+    uint        Normal; // normal and tangent
+#endif
     float2      UV;
 #elif ELEMENTS_TYPE == ElementsTypeStaticColor
 #elif ELEMENTS_TYPE == ElementsTypeSkeletal
@@ -49,47 +65,92 @@ struct VertexElement
 const static float InvIntervals = 2.f / ((1 << 16) - 1);
 
 ConstantBuffer<GlobalShaderData> GlobalData : register(b0, space0);
-ConstantBuffer<PerObjectData> PerObjectBuffer : register(b1, space0);
+// PerObjectData of all entities, and the index of the entity of each instance of the draw.
+StructuredBuffer<PerObjectData> PerObjectBuffer : register(t3, space0);
+StructuredBuffer<uint> ObjectIndices : register(t4, space0);
+#if POSITION_QUANTIZED
+ByteAddressBuffer VertexPositions : register(t0, space0);
+#else
 StructuredBuffer<float3> VertexPositions : register(t0, space0);
+#endif
 StructuredBuffer<VertexElement> Elements : register(t1, space0);
 
-VertexOut TestShaderVS(in uint VertexIdx : SV_VertexID)
+float3 UnpackOctahedral(uint packed, uint bits)
+{
+    float scale = (1u << (bits - 1)) - 1;
+    uint mask = (1u << bits) - 1;
+    float2 e = (float2(packed & mask, (packed >> bits) & mask) - scale) / scale;
+    float3 n = float3(e.x, e.y, 1.f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy -= (step(0.f, n.xy) * 2.f - 1.f) * t;
+    return normalize(n);
+}
+
+#if ELEMENTS_LAYOUT == ElementsTypeStaticNormal || ELEMENTS_LAYOUT == ElementsTypeStaticNormalTexture
+float3 GetNormal(VertexElement element)
+{
+#if NORMAL_ENCODING == NormalEncodingXYSign
+    float2 nXY = element.Normal * InvIntervals - 1.f;
+    uint signs = (element.ColorTSign >> 24) & 0xff;
+    float nSign = float(signs & 0x02) - 1;
+    return float3(nXY.x, nXY.y, sqrt(saturate(1.f - dot(nXY, nXY))) * nSign);
+#elif NORMAL_ENCODING == NormalEncodingOctahedral16
+    return UnpackOctahedral(uint(element.Normal.x) | (uint(element.Normal.y) << 16), 16);
+#elif NORMAL_ENCODING == NormalEncodingOctahedral8
+    return UnpackOctahedral(element.Normal & 0xffff, 8);
+#else
+    return UnpackOctahedral(element.Normal & 0xfffff, 10);
+#endif
+}
+#endif
+
+float3 LoadPosition(uint vertexIdx)
+{
+#if POSITION_QUANTIZED
+    // PositionDequantization followed by 3 x 16 bits per vertex. Loads must be 4-byte aligned,
+    // so odd vertices start in the upper half of a word.
+    PositionDequantization dequantization = VertexPositions.Load<PositionDequantization>(0);
+    uint address = 32 + vertexIdx * 6; // 32 = sizeof(PositionDequantization)
+    uint2 words = VertexPositions.Load2(address & ~3);
+    uint3 q = (address & 2) ? uint3(words.x >> 16, words.y & 0xffff, words.y >> 16) : uint3(words.x & 0xffff, words.x >> 16, words.y & 0xffff);
+    return dequantization.Offset + float3(q) * dequantization.Scale;
+#else
+    return VertexPositions[vertexIdx];
+#endif
+}
+
+VertexOut TestShaderVS(in uint VertexIdx : SV_VertexID, in uint InstanceIdx : SV_InstanceID)
 {
     VertexOut vsOut;
+    const PerObjectData objectData = PerObjectBuffer[ObjectIndices[InstanceIdx]];
 
-    float4 position = float4(VertexPositions[VertexIdx], 1.f);
-    float4 worldPosition = mul(PerObjectBuffer.World, position);
+    float4 position = float4(LoadPosition(VertexIdx), 1.f);
+    float4 worldPosition = float4(mul(objectData.World, position), 1.f);
 
-#if ELEMENTS_TYPE == ElementsTypeStaticNormal
+#if ELEMENTS_LAYOUT == ElementsTypeStaticNormal
 
     VertexElement element = Elements[VertexIdx];
-    float2 nXY = element.Normal * InvIntervals - 1.f;
-    uint signs = (element.ColorTSign >> 24) & 0xff;
-    float nSign = float(signs & 0x02) - 1;
-    float3 normal = float3(nXY.x, nXY.y, sqrt(saturate(1.f - dot(nXY, nXY))) * nSign);
+    float3 normal = GetNormal(element);
 
-    vsOut.HomogeneousPosition = mul(PerObjectBuffer.WorldViewProjection, position);
+    vsOut.HomogeneousPosition = mul(GlobalData.ViewProjection, worldPosition);
     vsOut.WorldPosition = worldPosition.xyz;
-    vsOut.WorldNormal = mul(float4(normal, 0.f), PerObjectBuffer.InvWorld).xyz;
+    vsOut.WorldNormal = mul(normal, (float3x3)objectData.InvWorld);
     vsOut.WorldTangent = 0.f;
     vsOut.UV = 0.f;
 
-#elif ELEMENTS_TYPE == ElementsTypeStaticNormalTexture
+#elif ELEMENTS_LAYOUT == ElementsTypeStaticNormalTexture
 
     VertexElement element = Elements[VertexIdx];
-    float2 nXY = element.Normal * InvIntervals - 1.f;
-    uint signs = (element.ColorTSign >> 24) & 0xff;
-    float nSign = float(signs & 0x02) - 1;
-    float3 normal = float3(nXY.x, nXY.y, sqrt(saturate(1.f - dot(nXY, nXY))) * nSign);
+    float3 normal = GetNormal(element);
 
-    vsOut.HomogeneousPosition = mul(PerObjectBuffer.WorldViewProjection, position);
+    vsOut.HomogeneousPosition = mul(GlobalData.ViewProjection, worldPosition);
     vsOut.WorldPosition = worldPosition.xyz;
-    vsOut.WorldNormal = mul(float4(normal, 0.f), PerObjectBuffer.InvWorld).xyz;
+    vsOut.WorldNormal = mul(normal, (float3x3)objectData.InvWorld);
     vsOut.WorldTangent = 0.f;
     vsOut.UV = 0.f;
 #else
 #undef ELEMENTS_TYPE
-    vsOut.HomogeneousPosition = mul(PerObjectBuffer.WorldViewProjection, position);
+    vsOut.HomogeneousPosition = mul(GlobalData.ViewProjection, worldPosition);
     vsOut.WorldPosition = worldPosition.xyz;
     vsOut.WorldNormal = 0.f;
     vsOut.WorldTangent = 0.f;
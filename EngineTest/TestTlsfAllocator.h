@@ -0,0 +1,262 @@
+#pragma once
+
+#include "Test.h"
+#include "Engine\Utilities\TlsfAllocator.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace triengine;
+
+// CPU-only tests of utl::tlsf_allocator: size classes, alignment, coalescing, defragment() and stats,
+// followed by a benchmark of allocate() and free() against a fragmented pool.
+class engine_test : public checked_test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			reset_results();
+			test_size_classes();
+			test_alignment();
+			test_coalescing();
+			test_defragment();
+			test_stats();
+			print_results();
+			benchmark();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	constexpr static u64 granularity{ 256 };
+	constexpr static u64 pool_size{ 64 * 1024 * 1024 };
+
+	// Tracks which granules of the pool are in use, to find allocations that overlap.
+	struct pool_map
+	{
+		std::vector<u32> owners;
+
+		explicit pool_map(u64 size) : owners(size / granularity, u32_invalid_id) {}
+
+		bool mark(u64 offset, u64 size, u32 handle)
+		{
+			bool is_free{ true };
+			for (u64 i{ offset / granularity }; i < (offset + size) / granularity; ++i)
+			{
+				is_free &= owners[i] == u32_invalid_id;
+				owners[i] = handle;
+			}
+			return is_free;
+		}
+	};
+
+	void test_size_classes()
+	{
+		utl::tlsf_allocator tlsf{};
+		tlsf.initialize(pool_size, granularity);
+		pool_map map{ pool_size };
+
+		// sizes on both sides of the boundaries between classes, from 1 byte to a few megabytes.
+		std::vector<u32> handles;
+		bool is_rounded{ true };
+		bool is_disjoint{ true };
+		for (u64 size{ 1 }; size <= 4 * 1024 * 1024; size = size * 3 / 2 + 1)
+		{
+			for (const u64 s : { size, math::align_size_up(size, granularity) + granularity })
+			{
+				const u32 handle{ tlsf.allocate(s) };
+				if (handle == utl::tlsf_allocator::invalid_handle) continue;
+				is_rounded &= tlsf.size(handle) == math::align_size_up(s, granularity);
+				is_rounded &= tlsf.offset(handle) % granularity == 0;
+				is_disjoint &= map.mark(tlsf.offset(handle), tlsf.size(handle), handle);
+				handles.emplace_back(handle);
+			}
+		}
+
+		check(!handles.empty(), "allocations of every size class succeed");
+		check(is_rounded, "sizes are rounded up to the granularity");
+		check(is_disjoint, "allocations don't overlap");
+
+		// a block that's exactly the size of the rest of the pool can still be allocated.
+		const u64 rest{ tlsf.stats().largest_free_block };
+		const u32 last{ tlsf.allocate(rest) };
+		check(last != utl::tlsf_allocator::invalid_handle, "the largest free block can be allocated with its exact size");
+		check(tlsf.allocate(granularity * 1024 * 1024) == utl::tlsf_allocator::invalid_handle, "allocations fail when no block is large enough");
+
+		tlsf.free(last);
+		for (u32 handle : handles) tlsf.free(handle);
+		check(tlsf.empty() && tlsf.stats().free_block_count == 1, "everything is freed");
+	}
+
+	void test_alignment()
+	{
+		utl::tlsf_allocator tlsf{};
+		tlsf.initialize(pool_size, granularity);
+
+		const u32 small{ tlsf.allocate(granularity) };
+		bool is_aligned{ true };
+		std::vector<u32> handles;
+		for (u64 alignment{ granularity * 2 }; alignment <= 4 * 1024 * 1024; alignment *= 2)
+		{
+			const u32 handle{ tlsf.allocate(granularity * 3, alignment) };
+			is_aligned &= handle != utl::tlsf_allocator::invalid_handle && tlsf.offset(handle) % alignment == 0;
+			handles.emplace_back(handle);
+		}
+
+		check(is_aligned, "allocations are aligned");
+		check(tlsf.stats().allocated == granularity * (1 + 3 * handles.size()), "the alignment padding is split off into free blocks");
+
+		tlsf.free(small);
+		for (u32 handle : handles) tlsf.free(handle);
+		check(tlsf.empty() && tlsf.stats().free_block_count == 1, "padding merges back when everything is freed");
+	}
+
+	void test_coalescing()
+	{
+		utl::tlsf_allocator tlsf{};
+		tlsf.initialize(granularity * 16, granularity);
+
+		const u32 a{ tlsf.allocate(granularity * 4) };
+		const u32 b{ tlsf.allocate(granularity * 4) };
+		const u32 c{ tlsf.allocate(granularity * 4) };
+		const u32 d{ tlsf.allocate(granularity * 4) };
+		check(tlsf.stats().free_block_count == 0, "the pool is full");
+
+		tlsf.free(a);
+		tlsf.free(c);
+		check(tlsf.stats().free_block_count == 2 && tlsf.stats().largest_free_block == granularity * 4, "blocks that aren't neighbours don't merge");
+		check(tlsf.allocate(granularity * 8) == utl::tlsf_allocator::invalid_handle, "fragmented space doesn't fit a larger block");
+
+		tlsf.free(b);
+		check(tlsf.stats().free_block_count == 1 && tlsf.stats().largest_free_block == granularity * 12, "a block merges with both neighbours");
+
+		tlsf.free(d);
+		check(tlsf.stats().free_block_count == 1 && tlsf.stats().largest_free_block == granularity * 16, "a block merges with the previous one");
+	}
+
+	void test_defragment()
+	{
+		utl::tlsf_allocator tlsf{};
+		constexpr u64 size{ granularity * 256 };
+		tlsf.initialize(size, granularity);
+
+		// every granule holds the handle of its allocation, so moves that lose data are found.
+		std::vector<u32> pool(size / granularity, u32_invalid_id);
+		std::vector<u32> handles;
+		std::vector<u64> alignments(size / granularity, 0);
+		for (u32 i{ 0 }; i < 64; ++i)
+		{
+			const u64 alignment{ (i % 4 == 0) ? granularity * 4 : granularity };
+			const u32 handle{ tlsf.allocate(granularity * (1 + i % 3), alignment) };
+			if (handle == utl::tlsf_allocator::invalid_handle) break;
+			alignments[handle] = alignment;
+			for (u64 j{ tlsf.offset(handle) / granularity }; j < (tlsf.offset(handle) + tlsf.size(handle)) / granularity; ++j) pool[j] = handle;
+			handles.emplace_back(handle);
+		}
+
+		std::vector<u32> kept;
+		for (u32 i{ 0 }; i < handles.size(); ++i)
+		{
+			if (i % 2) kept.emplace_back(handles[i]);
+			else tlsf.free(handles[i]);
+		}
+
+		const u64 largest_before{ tlsf.stats().largest_free_block };
+		bool is_aligned{ true };
+		u32 callbacks{ 0 };
+		const u32 moves{ tlsf.defragment(u32_invalid_id, [&](u32 handle, u64 old_offset, u64 new_offset, u64 move_size) {
+			++callbacks;
+			is_aligned &= new_offset < old_offset && new_offset % alignments[handle] == 0;
+			memmove(&pool[new_offset / granularity], &pool[old_offset / granularity], move_size / granularity * sizeof(u32));
+		}) };
+
+		check(moves && moves == callbacks, "the callback is called for each move");
+		check(is_aligned, "allocations move down and keep their alignment");
+
+		bool is_intact{ true };
+		for (u32 handle : kept)
+		{
+			for (u64 j{ tlsf.offset(handle) / granularity }; j < (tlsf.offset(handle) + tlsf.size(handle)) / granularity; ++j)
+			{
+				is_intact &= pool[j] == handle;
+			}
+		}
+
+		check(is_intact, "handles keep their data when allocations move");
+		check(tlsf.stats().largest_free_block > largest_before, "defragment merges the free space");
+		check(tlsf.defragment(u32_invalid_id, [](u32, u64, u64, u64) {}) == 0, "nothing moves after a full defragment");
+
+		for (u32 handle : kept) tlsf.free(handle);
+	}
+
+	void test_stats()
+	{
+		// two pools, like two memory categories, that keep their own stats.
+		utl::tlsf_allocator geometry{};
+		utl::tlsf_allocator textures{};
+		geometry.initialize(pool_size, granularity);
+		textures.initialize(pool_size / 2, 64 * 1024);
+
+		const u32 g{ geometry.allocate(1000) };
+		const u32 t0{ textures.allocate(1) };
+		const u32 t1{ textures.allocate(64 * 1024 + 1) };
+
+		const utl::tlsf_allocator::allocator_stats geometry_stats{ geometry.stats() };
+		const utl::tlsf_allocator::allocator_stats texture_stats{ textures.stats() };
+		check(geometry_stats.size == pool_size && texture_stats.size == pool_size / 2, "size");
+		check(geometry_stats.allocated == 1024 && geometry_stats.allocation_count == 1, "allocated is in granules");
+		check(texture_stats.allocated == 3 * 64 * 1024 && texture_stats.allocation_count == 2, "pools keep their own stats");
+		check(texture_stats.largest_free_block == pool_size / 2 - 3 * 64 * 1024, "largest free block");
+
+		geometry.free(g);
+		textures.free(t0);
+		textures.free(t1);
+		check(!geometry.stats().allocated && !textures.stats().allocation_count, "stats after free");
+	}
+
+	void benchmark()
+	{
+		utl::tlsf_allocator tlsf{};
+		tlsf.initialize(pool_size * 16, granularity);
+
+		constexpr u32 count{ 100000 };
+		std::vector<u32> handles(count, utl::tlsf_allocator::invalid_handle);
+		u32 seed{ 12345 };
+		auto random{ [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; } };
+
+		// fill half the slots first, so the pool is fragmented while it's measured.
+		for (u32 i{ 0 }; i < count; i += 2) handles[i] = tlsf.allocate(granularity * (1 + random() % 64));
+
+		using clock = std::chrono::high_resolution_clock;
+		const auto start{ clock::now() };
+		u32 operations{ 0 };
+		for (u32 i{ 0 }; i < count * 10; ++i)
+		{
+			u32& handle{ handles[random() % count] };
+			if (handle == utl::tlsf_allocator::invalid_handle)
+			{
+				handle = tlsf.allocate(granularity * (1 + random() % 64), random() % 4 ? 0 : granularity * 16);
+			}
+			else
+			{
+				tlsf.free(handle);
+				handle = utl::tlsf_allocator::invalid_handle;
+			}
+			++operations;
+		}
+
+		const auto ns{ std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count() };
+		const utl::tlsf_allocator::allocator_stats stats{ tlsf.stats() };
+		std::cout << "allocate/free: " << (f32)ns / operations << " ns per operation, "
+			<< stats.allocation_count << " allocations, " << stats.free_block_count << " free blocks" << std::endl;
+
+		for (u32 handle : handles)
+		{
+			if (handle != utl::tlsf_allocator::invalid_handle) tlsf.free(handle);
+		}
+	}
+};
@@ -1,4 +1,5 @@
 ﻿using System.Windows;
+using TriEngineEditor.DllWrappers;
 
 namespace TriEngineEditor
 {
@@ -7,6 +8,11 @@ namespace TriEngineEditor
     /// </summary>
     public partial class App : Application
     {
+        protected override void OnExit(ExitEventArgs e)
+        {
+            ContentToolsAPI.ShutdownContentTools();
+            base.OnExit(e);
+        }
     }
 
 }
@@ -34,6 +34,15 @@ namespace TriEngineEditor.Content
         Colors = 0x08
     }
 
+    // Stored in bits 4-5 of the elements type of meshes with normals.
+    enum NormalEncoding
+    {
+        XYSign = 0,
+        Octahedral16,
+        Octahedral8,
+        OctahedralPacked,
+    }
+
     enum PrimitiveTopology
     {
         PointList = 1,
@@ -43,6 +52,22 @@ namespace TriEngineEditor.Content
         TriangleStrip,
     };
 
+    enum MeshSectionType
+    {
+        Meshlets = 0,
+        CompressedStreams,
+        QuantizedPositions,
+        Bounds,
+    }
+
+    [Flags]
+    enum SubmeshEncoding
+    {
+        None = 0x00,
+        CompressedStreams = 0x01,
+        QuantizedPositions = 0x02,
+    }
+
     class Mesh : ViewModelBase
     {
         public static int PositionSize = sizeof(float) * 3;
@@ -125,6 +150,7 @@ namespace TriEngineEditor.Content
         public byte[] Positions { get; set; }
         public byte[] Elements { get; set; }
         public byte[] Indices { get; set; }
+        public Dictionary<MeshSectionType, byte[]> Sections { get; } = new Dictionary<MeshSectionType, byte[]>();
     }
 
     class MeshLOD : ViewModelBase
@@ -246,6 +272,76 @@ namespace TriEngineEditor.Content
             }
         }
 
+        private bool _generateMeshlets;
+        public bool GenerateMeshlets
+        {
+            get => _generateMeshlets;
+            set
+            {
+                if (_generateMeshlets != value)
+                {
+                    _generateMeshlets = value;
+                    OnPropertyChanged(nameof(GenerateMeshlets));
+                }
+            }
+        }
+
+        private byte _generatedLodCount;
+        public byte GeneratedLodCount
+        {
+            get => _generatedLodCount;
+            set
+            {
+                if (_generatedLodCount != value)
+                {
+                    _generatedLodCount = value;
+                    OnPropertyChanged(nameof(GeneratedLodCount));
+                }
+            }
+        }
+
+        private bool _compressStreams;
+        public bool CompressStreams
+        {
+            get => _compressStreams;
+            set
+            {
+                if (_compressStreams != value)
+                {
+                    _compressStreams = value;
+                    OnPropertyChanged(nameof(CompressStreams));
+                }
+            }
+        }
+
+        private bool _quantizePositions;
+        public bool QuantizePositions
+        {
+            get => _quantizePositions;
+            set
+            {
+                if (_quantizePositions != value)
+                {
+                    _quantizePositions = value;
+                    OnPropertyChanged(nameof(QuantizePositions));
+                }
+            }
+        }
+
+        private NormalEncoding _normalEncoding;
+        public NormalEncoding NormalEncoding
+        {
+            get => _normalEncoding;
+            set
+            {
+                if (_normalEncoding != value)
+                {
+                    _normalEncoding = value;
+                    OnPropertyChanged(nameof(NormalEncoding));
+                }
+            }
+        }
+
         public GeometryImportSettings()
         {
             CalculateNormals = false;
@@ -254,6 +350,11 @@ namespace TriEngineEditor.Content
             ReverseHandedness = false;
             ImportEmbeddedTextures = true;
             ImportAnimations = true;
+            GenerateMeshlets = false;
+            GeneratedLodCount = 0;
+            CompressStreams = false;
+            QuantizePositions = false;
+            NormalEncoding = NormalEncoding.XYSign;
         }
 
         public void ToBinary(BinaryWriter writer)
@@ -264,9 +365,15 @@ namespace TriEngineEditor.Content
             writer.Write(ReverseHandedness);
             writer.Write(ImportEmbeddedTextures);
             writer.Write(ImportAnimations);
+            writer.Write(GenerateMeshlets);
+            writer.Write(GeneratedLodCount);
+            writer.Write(CompressStreams);
+            writer.Write(QuantizePositions);
+            writer.Write((byte)NormalEncoding);
         }
 
-        public void FromBinary(BinaryReader reader)
+        // 'version' is the version of the geometry file the settings are read from (see Geometry.FileVersion).
+        public void FromBinary(BinaryReader reader, int version)
         {
             CalculateNormals = reader.ReadBoolean();
             CalculateTangents = reader.ReadBoolean();
@@ -274,6 +381,25 @@ namespace TriEngineEditor.Content
             ReverseHandedness = reader.ReadBoolean();
             ImportEmbeddedTextures = reader.ReadBoolean();
             ImportAnimations = reader.ReadBoolean();
+
+            if (version >= 1)
+            {
+                GenerateMeshlets = reader.ReadBoolean();
+                GeneratedLodCount = reader.ReadByte();
+                CompressStreams = reader.ReadBoolean();
+                QuantizePositions = reader.ReadBoolean();
+                NormalEncoding = (NormalEncoding)reader.ReadByte();
+            }
+            else
+            {
+                // NOTE: files without a version don't have the settings that were added later, so they get the defaults.
+                var defaults = new GeometryImportSettings();
+                GenerateMeshlets = defaults.GenerateMeshlets;
+                GeneratedLodCount = defaults.GeneratedLodCount;
+                CompressStreams = defaults.CompressStreams;
+                QuantizePositions = defaults.QuantizePositions;
+                NormalEncoding = defaults.NormalEncoding;
+            }
         }
     }
 
@@ -298,6 +424,14 @@ namespace TriEngineEditor.Content
 
     class Geometry : Asset
     {
+        // Version of the layout of geometry files, written after the asset header with a marker byte in front of it.
+        // The marker can't be the first byte of a file without a version, which starts with a bool import setting.
+        //
+        // 0: no version. Import settings up to ImportAnimations and no mesh sections.
+        // 1: import settings up to NormalEncoding and mesh sections.
+        public const int FileVersion = 1;
+        private const byte FileVersionMarker = 0xff;
+
         private readonly List<LODGroup> _lodGroups = new List<LODGroup>();
         private readonly object _lock = new object();
 
@@ -395,6 +529,7 @@ namespace TriEngineEditor.Content
             mesh.Positions = reader.ReadBytes(Mesh.PositionSize * mesh.VertexCount);
             mesh.Elements = reader.ReadBytes(elementBufferSize);
             mesh.Indices = reader.ReadBytes(indexBufferSize);
+            ReadSections(reader, mesh);
 
             MeshLOD lod;
             if (ID.IsValid(lodId) && lodIds.Contains(lodId))
@@ -412,6 +547,28 @@ namespace TriEngineEditor.Content
             lod.Meshes.Add(mesh);
         }
 
+        private static void ReadSections(BinaryReader reader, Mesh mesh)
+        {
+            var sectionCount = reader.ReadInt32();
+            for (int i = 0; i < sectionCount; ++i)
+            {
+                var type = (MeshSectionType)reader.ReadInt32();
+                var size = reader.ReadInt32();
+                mesh.Sections[type] = reader.ReadBytes(size);
+            }
+        }
+
+        private static void WriteSections(BinaryWriter writer, Mesh mesh)
+        {
+            writer.Write(mesh.Sections.Count);
+            foreach (var section in mesh.Sections)
+            {
+                writer.Write((int)section.Key);
+                writer.Write(section.Value.Length);
+                writer.Write(section.Value);
+            }
+        }
+
         public override void Import(string file)
         {
             Debug.Assert(File.Exists(file));
@@ -458,10 +615,12 @@ namespace TriEngineEditor.Content
             try
             {
                 byte[] data = null;
+                int version;
                 using (var reader = new BinaryReader(File.Open(file, FileMode.Open, FileAccess.Read)))
                 {
                     ReadAssetFileHeader(reader);
-                    ImportSettings.FromBinary(reader);
+                    version = ReadFileVersion(reader);
+                    ImportSettings.FromBinary(reader, version);
                     int dataLength = reader.ReadInt32();
                     Debug.Assert(dataLength > 0);
                     data = reader.ReadBytes(dataLength);
@@ -477,7 +636,7 @@ namespace TriEngineEditor.Content
 
                     for (int i = 0; i < lodCount; ++i)
                     {
-                        lodGroup.LODs.Add(BinaryToLOD(reader));
+                        lodGroup.LODs.Add(BinaryToLOD(reader, version));
                     }
 
                     _lodGroups.Clear();
@@ -538,6 +697,8 @@ namespace TriEngineEditor.Content
                     using (var writer = new BinaryWriter(File.Open(meshFileName, FileMode.Create, FileAccess.Write)))
                     {
                         WriteAssetFileHeader(writer);
+                        writer.Write(FileVersionMarker);
+                        writer.Write(FileVersion);
                         ImportSettings.ToBinary(writer);
                         writer.Write(data.Length);
                         writer.Write(data);
@@ -562,29 +723,42 @@ namespace TriEngineEditor.Content
         /// <returns>
         /// struct {
         ///     u32 lod_count,
+        ///     mesh_bounds bounds,
         ///     struct {
         ///          float lod_threshold,
         ///          u32 submesh_count,
+        ///          mesh_bounds lod_bounds,
+        ///          mesh_bounds submesh_bounds[submesh_count],
         ///          u32 size_of_submeshes,
         ///          struct {
         ///              u32 element_size, u32 vertex_count,
-        ///              u32 index_count, u32 elements_type, u32 primitive_topology
-        ///              u8 positions[sizeof(f32) * 3 * vertex_count],
+        ///              u32 index_count, u32 elements_type, u32 primitive_topology,
+        ///              u32 encoding,
+        ///              f32 position_offset[3], f32 position_scale[3] (only if positions are quantized),
+        ///              u8 positions[sizeof(f32) * 3 * vertex_count] (or sizeof(u16) * 3 * vertex_count if quantized),
         ///              u8 elements[sizeof(element_size) * index_count],
         ///              u8 indices[index_size * index_count]
         ///          } submeshes[submesh_count]
         ///     } mesh_lods[lod_count]
         /// } geometry;
+        ///
+        /// struct { f32 min[3], f32 max[3], f32 center[3], f32 radius } mesh_bounds;
         /// </returns>
         public override byte[] PackForEngine()
         {
             using var writer = new BinaryWriter(new MemoryStream());
 
             writer.Write(GetLODGroup().LODs.Count);
+            WriteBounds(writer, GetLODGroup().LODs[0].Meshes[0], BoundsLevel.LODGroup);
             foreach (var lod in GetLODGroup().LODs)
             {
                 writer.Write(lod.LodThreshold);
                 writer.Write(lod.Meshes.Count);
+                WriteBounds(writer, lod.Meshes[0], BoundsLevel.LOD);
+                foreach (var mesh in lod.Meshes)
+                {
+                    WriteBounds(writer, mesh, BoundsLevel.Submesh);
+                }
                 var sizeOfSubmeshesPosition = writer.BaseStream.Position;
                 writer.Write(0);
                 foreach (var mesh in lod.Meshes)
@@ -595,8 +769,38 @@ namespace TriEngineEditor.Content
                     writer.Write((int)mesh.ElementsType);
                     writer.Write((int)mesh.PrimitiveTopology);
 
-                    var alignedPositionBuffer = new byte[MathUtil.AlignSizeUp(mesh.Positions.Length, 4)];
-                    Array.Copy(mesh.Positions, alignedPositionBuffer, mesh.Positions.Length);
+                    var encoding = SubmeshEncoding.None;
+                    var hasCompressedStreams = mesh.Sections.TryGetValue(MeshSectionType.CompressedStreams, out var compressedStreams);
+                    var hasQuantizedPositions = mesh.Sections.TryGetValue(MeshSectionType.QuantizedPositions, out var quantizedPositions);
+                    if (hasCompressedStreams) encoding |= SubmeshEncoding.CompressedStreams;
+                    if (hasQuantizedPositions) encoding |= SubmeshEncoding.QuantizedPositions;
+                    writer.Write((int)encoding);
+
+                    // NOTE: the quantized positions section starts with the offset and scale (6 floats), followed by the positions.
+                    const int dequantizationSize = sizeof(float) * 6;
+                    if (hasQuantizedPositions)
+                    {
+                        writer.Write(quantizedPositions, 0, dequantizationSize);
+                    }
+
+                    // NOTE: compressed streams replace the positions, elements and indices.
+                    if (hasCompressedStreams)
+                    {
+                        writer.Write(compressedStreams);
+                        continue;
+                    }
+
+                    byte[] alignedPositionBuffer;
+                    if (hasQuantizedPositions)
+                    {
+                        alignedPositionBuffer = new byte[quantizedPositions.Length - dequantizationSize];
+                        Array.Copy(quantizedPositions, dequantizationSize, alignedPositionBuffer, 0, alignedPositionBuffer.Length);
+                    }
+                    else
+                    {
+                        alignedPositionBuffer = new byte[MathUtil.AlignSizeUp(mesh.Positions.Length, 4)];
+                        Array.Copy(mesh.Positions, alignedPositionBuffer, mesh.Positions.Length);
+                    }
                     var alignedElementBuffer = new byte[MathUtil.AlignSizeUp(mesh.Elements.Length, 4)];
                     Array.Copy(mesh.Elements, alignedElementBuffer, mesh.Elements.Length);
 
@@ -627,6 +831,31 @@ namespace TriEngineEditor.Content
             return data;
         }
 
+        // The bounds section holds the bounds of the mesh, of its LOD and of its LOD group, in that order.
+        private enum BoundsLevel
+        {
+            Submesh,
+            LOD,
+            LODGroup,
+        }
+
+        private static void WriteBounds(BinaryWriter writer, Mesh mesh, BoundsLevel level)
+        {
+            const int boundsSize = sizeof(float) * 10;
+            if (mesh.Sections.TryGetValue(MeshSectionType.Bounds, out var bounds))
+            {
+                writer.Write(bounds, (int)level * boundsSize, boundsSize);
+            }
+            else
+            {
+                // NOTE: meshes imported before bounds were stored get bounds that contain everything, so they're never culled.
+                for (int i = 0; i < 3; ++i) writer.Write(float.MinValue);
+                for (int i = 0; i < 3; ++i) writer.Write(float.MaxValue);
+                for (int i = 0; i < 3; ++i) writer.Write(0f);
+                writer.Write(float.MaxValue);
+            }
+        }
+
         private void LODToBinary(MeshLOD lod, BinaryWriter writer, out byte[]? hash)
         {
             writer.Write(lod.Name);
@@ -647,6 +876,7 @@ namespace TriEngineEditor.Content
                 writer.Write(mesh.Positions);
                 writer.Write(mesh.Elements);
                 writer.Write(mesh.Indices);
+                WriteSections(writer, mesh);
             }
 
             var meshDataSize = writer.BaseStream.Position - meshDataBegin;
@@ -655,7 +885,21 @@ namespace TriEngineEditor.Content
             hash = ContentHelper.ComputeHash(buffer, (int)meshDataBegin, (int)meshDataSize);
         }
 
-        private MeshLOD BinaryToLOD(BinaryReader reader)
+        private static int ReadFileVersion(BinaryReader reader)
+        {
+            var position = reader.BaseStream.Position;
+            if (reader.ReadByte() == FileVersionMarker)
+            {
+                var version = reader.ReadInt32();
+                Debug.Assert(version > 0 && version <= FileVersion);
+                return version;
+            }
+
+            reader.BaseStream.Position = position;
+            return 0;
+        }
+
+        private MeshLOD BinaryToLOD(BinaryReader reader, int version)
         {
             var lod = new MeshLOD();
             lod.Name = reader.ReadString();
@@ -678,6 +922,7 @@ namespace TriEngineEditor.Content
                 mesh.Positions = reader.ReadBytes(Mesh.PositionSize * mesh.VertexCount);
                 mesh.Elements = reader.ReadBytes(mesh.ElementSize * mesh.VertexCount);
                 mesh.Indices = reader.ReadBytes(mesh.IndexSize * mesh.IndexCount);
+                if (version >= 1) ReadSections(reader, mesh);
 
                 lod.Meshes.Add(mesh);
             }
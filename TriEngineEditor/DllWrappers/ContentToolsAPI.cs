@@ -20,6 +20,11 @@ namespace TriEngineEditor.ContentToolsAPIStructs
         public byte ReverseHandedness = 0;
         public byte ImportEmbeddedTextures = 1;
         public byte ImportAnimations = 1;
+        public byte GenerateMeshlets = 0;
+        public byte GeneratedLodCount = 0;
+        public byte CompressStreams = 0;
+        public byte QuantizePositions = 0;
+        public byte NormalEncoding = 0;
 
         private byte ToByte(bool value) => value ? (byte)1 : (byte)0;
 
@@ -33,6 +38,11 @@ namespace TriEngineEditor.ContentToolsAPIStructs
             ReverseHandedness = ToByte(settings.ReverseHandedness);
             ImportEmbeddedTextures = ToByte(settings.ImportEmbeddedTextures);
             ImportAnimations = ToByte(settings.ImportAnimations);
+            GenerateMeshlets = ToByte(settings.GenerateMeshlets);
+            GeneratedLodCount = settings.GeneratedLodCount;
+            CompressStreams = ToByte(settings.CompressStreams);
+            QuantizePositions = ToByte(settings.QuantizePositions);
+            NormalEncoding = (byte)settings.NormalEncoding;
         }
     }
 
@@ -65,6 +75,17 @@ namespace TriEngineEditor.ContentToolsAPIStructs
         public Vector3 Size = new Vector3(1f);
         public int LOD = 0;
     }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct PakAsset
+    {
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string Name;
+        public IntPtr Data;
+        public ulong Size;
+        public uint Type;
+        public uint Compress;
+    }
 }
 
 namespace TriEngineEditor.DllWrappers
@@ -106,5 +127,50 @@ namespace TriEngineEditor.DllWrappers
         {
             GeometryFromSceneData(geometry, (sceneData) => ImportFbx(file, sceneData), $"Failed to import FBX file: {file}");
         }
+
+        [DllImport(_toolsDLL)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        private static extern bool WritePakArchive(string path, [In] PakAsset[] assets, uint assetCount);
+        public static bool WritePakArchive(string path, IList<(string name, byte[] data, Content.AssetType type)> assets)
+        {
+            Debug.Assert(assets != null && assets.Any());
+            // NOTE: the data is pinned, so the content tools can read it while the archive is written.
+            var handles = new GCHandle[assets.Count];
+            try
+            {
+                var pakAssets = new PakAsset[assets.Count];
+                for (int i = 0; i < assets.Count; ++i)
+                {
+                    handles[i] = GCHandle.Alloc(assets[i].data, GCHandleType.Pinned);
+                    pakAssets[i] = new PakAsset()
+                    {
+                        Name = assets[i].name,
+                        Data = handles[i].AddrOfPinnedObject(),
+                        Size = (ulong)assets[i].data.Length,
+                        Type = (uint)assets[i].type,
+                        Compress = 1,
+                    };
+                }
+
+                if (WritePakArchive(path, pakAssets, (uint)pakAssets.Length)) return true;
+                Logger.Log(MessageType.Error, $"Failed to write archive: {path}");
+            }
+            catch (Exception e)
+            {
+                Logger.Log(MessageType.Error, $"Failed to write archive: {path}");
+                Debug.WriteLine(e.Message);
+            }
+            finally
+            {
+                foreach (var handle in handles.Where(x => x.IsAllocated)) handle.Free();
+            }
+
+            return false;
+        }
+
+        // NOTE: the worker threads of the content tools can't be joined while the DLL is unloaded,
+        //       so they're joined before the editor exits.
+        [DllImport(_toolsDLL)]
+        public static extern void ShutdownContentTools();
     }
 }
@@ -186,6 +186,20 @@ namespace TriEngineEditor.Editors
             }
         }
 
+        // Decodes two 'bits'-wide octahedral values (x in the low bits). Matches pack_octahedral() in ContentTools.
+        private static Vector3D UnpackOctahedral(uint packed, int bits)
+        {
+            var scale = (double)((1u << (bits - 1)) - 1);
+            var mask = (1u << bits) - 1;
+            var x = ((packed & mask) - scale) / scale;
+            var y = (((packed >> bits) & mask) - scale) / scale;
+            var z = 1.0 - Math.Abs(x) - Math.Abs(y);
+            var t = Math.Max(-z, 0.0);
+            x += x >= 0.0 ? -t : t;
+            y += y >= 0.0 ? -t : t;
+            return new Vector3D(x, y, z);
+        }
+
         public MeshRenderer(MeshLOD? lod, MeshRenderer old)
         {
             Debug.Assert(lod?.Meshes.Any() == true);
@@ -216,6 +230,7 @@ namespace TriEngineEditor.Editors
                 {
                     var tSpaceOffset = 0;
                     if (mesh.ElementsType.HasFlag(ElementsType.Joints)) tSpaceOffset = sizeof(short) * 4;
+                    var normalEncoding = (NormalEncoding)(((int)mesh.ElementsType >> 4) & 0x3);
                     // Read tangent space
                     using (var reader = new BinaryReader(new MemoryStream(mesh.Elements)))
                         for (int i = 0; i < mesh.VertexCount; ++i)
@@ -223,10 +238,25 @@ namespace TriEngineEditor.Editors
                             var signs = (reader.ReadUInt32() >> 24) & 0x000000FF;
 
                             // Read normals
-                            var nrmX = reader.ReadUInt16() * intervals - 1.0f;
-                            var nrmY = reader.ReadUInt16() * intervals - 1.0f;
-                            var nrmZ = Math.Sqrt(Math.Clamp(1.0f - nrmX * nrmX - nrmY * nrmY, 0.0f, 1.0f)) * ((signs & 0x2) - 1f);
-                            var normal = new Vector3D(nrmX, nrmY, nrmZ);
+                            Vector3D normal;
+                            var packedNormal = reader.ReadUInt32();
+                            if (normalEncoding == NormalEncoding.XYSign)
+                            {
+                                var nrmX = (packedNormal & 0xffff) * intervals - 1.0f;
+                                var nrmY = (packedNormal >> 16) * intervals - 1.0f;
+                                var nrmZ = Math.Sqrt(Math.Clamp(1.0f - nrmX * nrmX - nrmY * nrmY, 0.0f, 1.0f)) * ((signs & 0x2) - 1f);
+                                normal = new Vector3D(nrmX, nrmY, nrmZ);
+                            }
+                            else
+                            {
+                                var bits = normalEncoding switch
+                                {
+                                    NormalEncoding.Octahedral16 => 16,
+                                    NormalEncoding.Octahedral8 => 8,
+                                    _ => 10,
+                                };
+                                normal = UnpackOctahedral(packedNormal, bits);
+                            }
                             normal.Normalize();
                             vertexData.Normals.Add(normal);
                             avgNormal += normal;
@@ -234,7 +264,11 @@ namespace TriEngineEditor.Editors
                             // read UVs
                             if (mesh.ElementsType.HasFlag(ElementsType.TSpace))
                             {
-                                reader.BaseStream.Position += sizeof(short) * 2; // skip tangent
+                                // NOTE: 8-bit and packed octahedral encodings store the tangent in the same 4 bytes as the normal.
+                                if (normalEncoding == NormalEncoding.XYSign || normalEncoding == NormalEncoding.Octahedral16)
+                                {
+                                    reader.BaseStream.Position += sizeof(short) * 2; // skip tangent
+                                }
                                 var u = reader.ReadSingle();
                                 var v = reader.ReadSingle();
                                 vertexData.UVs.Add(new Point(u, v));
@@ -203,12 +203,33 @@ namespace TriEngineEditor.GameProject
             }
         }
 
+        // Packs the game's content in game.pak next to the executable. The engine reads from it instead of
+        // loose files, and still reads loose files that aren't in it.
+        private void PackGame()
+        {
+            var configName = VisualStudio.GetConfigurationName(StandAloneBuildConfig);
+            var folder = $@"{Path}x64\{configName}\";
+            var assets = new List<(string name, byte[] data, Content.AssetType type)>
+            {
+                ("game.bin", File.ReadAllBytes($@"{folder}game.bin"), Content.AssetType.Unknown)
+            };
+
+            const string shaders = @"shaders\d3d12\shaders.bin";
+            if (File.Exists($@"{folder}{shaders}"))
+            {
+                assets.Add((shaders, File.ReadAllBytes($@"{folder}{shaders}"), Content.AssetType.Unknown));
+            }
+
+            ContentToolsAPI.WritePakArchive($@"{folder}game.pak", assets);
+        }
+
         private async Task RunGame(bool debug)
         {
             await Task.Run(() => VisualStudio.BuildSolution(this, StandAloneBuildConfig, debug));
             if (VisualStudio.BuildSucceded)
             {
                 SaveToBinary();
+                PackGame();
                 await Task.Run(() => VisualStudio.Run(this, StandAloneBuildConfig, debug));
             }
         }